@@ -0,0 +1,444 @@
+// Benchmark harness for the extraction and cleanup pipeline.
+//
+// Times the CPU-bound steps the GUI runs on every document:
+//   extract/<file>      SafePdfLoader::loadPdf + extractTextSafely
+//   structured/<file>   SafePdfLoader::loadPdf + extractStructured (pages and lines, no boxes)
+//   boilerplate/<file>  BoilerplateFilter::apply on the structured text
+//   cleanup/<input>     TextCleaner::clean (what QueryRunner::cleanupText runs)
+//   harmony/<input>     PromptQuery::removeHarmonyArtifacts
+//   keywords/<input>    KeywordsQuery::processResponse
+// over the bundled paper*.pdf / test*.pdf files and synthetic large inputs, and
+// reports median/p95 time, heap allocations per iteration and throughput.
+//
+// Usage: pdfextract_bench [-n iterations] [-w warmup] [--json results.json]
+//                         [--no-synthetic] [file.pdf ...]
+// Without files, paper*.pdf and test*.pdf in the current directory (or next to
+// the executable) are used.
+
+#include <cstdlib>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPdfDocument>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <vector>
+#include "safepdfloader.h"
+#include "boilerplatefilter.h"
+#include "structuredtext.h"
+#include "textcleaner.h"
+#include "promptquery.h"
+#include "asynclogger.h"
+
+// ===== ALLOCATION COUNTING =====
+
+namespace {
+std::atomic<quint64> g_allocCount(0);
+std::atomic<quint64> g_allocBytes(0);
+
+inline void countAllocation(std::size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+}
+}
+
+#if defined(__GLIBC__) && !defined(QT_STATIC_BUILD)
+// Qt containers allocate with malloc, not operator new, so on glibc the malloc family
+// is interposed instead (operator new ends up in malloc and is counted there)
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+
+void* malloc(std::size_t size) {
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) {
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, std::size_t size) {
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+}
+#define BENCH_ALLOC_SCOPE "malloc"
+#else
+// Elsewhere only C++ allocations are visible; QString/QByteArray buffers are not counted
+void* operator new(std::size_t size) {
+    countAllocation(size);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#define BENCH_ALLOC_SCOPE "operator new"
+#endif
+
+namespace {
+
+// ===== BENCHMARK RUNNER =====
+
+struct BenchResult {
+    QString name;
+    qint64 inputBytes = 0;
+    int iterations = 0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double minMs = 0.0;
+    double meanMs = 0.0;
+    double allocsPerIter = 0.0;
+    double allocBytesPerIter = 0.0;
+    qint64 outputSize = 0;  // Characters produced, so regressions in output show up too
+
+    double mbPerSecond() const {
+        return medianMs > 0.0 ? (inputBytes / (1024.0 * 1024.0)) / (medianMs / 1000.0) : 0.0;
+    }
+
+    QJsonObject toJson() const {
+        QJsonObject obj;
+        obj["name"] = name;
+        obj["input_bytes"] = inputBytes;
+        obj["iterations"] = iterations;
+        obj["median_ms"] = medianMs;
+        obj["p95_ms"] = p95Ms;
+        obj["min_ms"] = minMs;
+        obj["mean_ms"] = meanMs;
+        obj["mb_per_s"] = mbPerSecond();
+        obj["allocs_per_iter"] = allocsPerIter;
+        obj["alloc_bytes_per_iter"] = allocBytesPerIter;
+        obj["output_size"] = outputSize;
+        return obj;
+    }
+};
+
+double percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    // Nearest rank
+    const std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// body returns the size of what it produced (also keeps the work from being optimized away)
+BenchResult runBench(const QString& name, qint64 inputBytes, int warmup, int iterations,
+                     const std::function<qint64()>& body) {
+    BenchResult result;
+    result.name = name;
+    result.inputBytes = inputBytes;
+    result.iterations = iterations;
+
+    for (int i = 0; i < warmup; ++i) {
+        result.outputSize = body();
+    }
+
+    std::vector<double> timesMs;
+    timesMs.reserve(iterations);
+    const quint64 allocCountBefore = g_allocCount.load();
+    const quint64 allocBytesBefore = g_allocBytes.load();
+
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        result.outputSize = body();
+        timesMs.push_back(timer.nsecsElapsed() / 1e6);
+    }
+
+    // timesMs was reserved up front, so only the body's allocations are counted
+    result.allocsPerIter = double(g_allocCount.load() - allocCountBefore) / iterations;
+    result.allocBytesPerIter = double(g_allocBytes.load() - allocBytesBefore) / iterations;
+
+    result.medianMs = percentile(timesMs, 0.5);
+    result.p95Ms = percentile(timesMs, 0.95);
+    result.minMs = *std::min_element(timesMs.begin(), timesMs.end());
+    double total = 0.0;
+    for (double ms : timesMs) {
+        total += ms;
+    }
+    result.meanMs = total / iterations;
+    return result;
+}
+
+void printHeader() {
+    std::cout << QString("%1 %2 %3 %4 %5 %6 %7")
+                     .arg(QStringLiteral("Benchmark"), -36)
+                     .arg(QStringLiteral("Input KB"), 10)
+                     .arg(QStringLiteral("Median ms"), 11)
+                     .arg(QStringLiteral("p95 ms"), 10)
+                     .arg(QStringLiteral("MB/s"), 9)
+                     .arg(QStringLiteral("Allocs"), 10)
+                     .arg(QStringLiteral("Alloc KB"), 10)
+                     .toStdString() << std::endl;
+}
+
+void printResult(const BenchResult& r) {
+    std::cout << QString("%1 %2 %3 %4 %5 %6 %7")
+                     .arg(r.name.left(36), -36)
+                     .arg(r.inputBytes / 1024.0, 10, 'f', 1)
+                     .arg(r.medianMs, 11, 'f', 3)
+                     .arg(r.p95Ms, 10, 'f', 3)
+                     .arg(r.mbPerSecond(), 9, 'f', 1)
+                     .arg(r.allocsPerIter, 10, 'f', 0)
+                     .arg(r.allocBytesPerIter / 1024.0, 10, 'f', 1)
+                     .toStdString() << std::endl;
+}
+
+// ===== INPUTS =====
+
+// Exposes the protected response helpers without touching the network
+class BenchKeywordsQuery : public KeywordsQuery {
+public:
+    using PromptQuery::removeHarmonyArtifacts;
+};
+
+QStringList defaultPdfs() {
+    QStringList files;
+    const QStringList dirs = { QDir::currentPath(), QCoreApplication::applicationDirPath() };
+    for (const QString& dirPath : dirs) {
+        QDir dir(dirPath);
+        const QStringList names = dir.entryList(QStringList() << "paper*.pdf" << "test*.pdf", QDir::Files, QDir::Name);
+        for (const QString& name : names) {
+            const QString path = dir.absoluteFilePath(name);
+            if (!files.contains(path)) {
+                files << path;
+            }
+        }
+    }
+    return files;
+}
+
+// Deterministic PDF-like text: paragraphs, hard-wrapped lines, page breaks, and the
+// licence lines, soft hyphens and whitespace runs the cleanup has to deal with
+QString syntheticDocument(qsizetype targetChars) {
+    static const QStringList words = {
+        "protein", "structure", "prediction", "neural", "network", "attention", "sequence",
+        "alignment", "genome", "editing", "transformer", "language", "model", "accuracy",
+        "the", "of", "and", "in", "to", "a", "is", "for", "with", "that", "we", "results"
+    };
+
+    QRandomGenerator rng(42);
+    QString text;
+    text.reserve(targetChars + 256);
+    int line = 0;
+    while (text.size() < targetChars) {
+        const int wordCount = 8 + rng.bounded(6);
+        for (int w = 0; w < wordCount; ++w) {
+            if (w > 0) {
+                text += rng.bounded(20) == 0 ? QStringLiteral(" \t ") : QStringLiteral(" ");
+            }
+            const QString& word = words[rng.bounded(static_cast<int>(words.size()))];
+            if (word.size() > 6 && rng.bounded(10) == 0) {
+                text += word.left(4) + QChar(0x00AD) + word.mid(4);
+            } else {
+                text += word;
+            }
+        }
+        text += '\n';
+
+        ++line;
+        if (line % 12 == 0) {
+            text += '\n';
+        }
+        if (line % 50 == 0) {
+            text += QStringLiteral("Copyright 2024 The Authors. All rights reserved.\n\n\n\n");
+        }
+        if (line % 173 == 0) {
+            text += QStringLiteral("This article is licensed under a Creative Commons license\r\n");
+        }
+    }
+    return text;
+}
+
+// A long comma-separated keyword list wrapped in Harmony channel markers
+QString syntheticKeywordResponse(int keywordCount) {
+    QRandomGenerator rng(7);
+    QStringList keywords;
+    keywords.reserve(keywordCount);
+    for (int i = 0; i < keywordCount; ++i) {
+        QString keyword = QString("keyword %1").arg(rng.bounded(100000));
+        if (i % 5 == 0) {
+            keyword = "  " + keyword + " ";
+        }
+        keywords << keyword;
+    }
+    return "<|start|>assistant<|channel|>final<|message|>" + keywords.join(",") + ", ,<|end|>";
+}
+
+qint64 utf8Size(const QString& text) {
+    return text.toUtf8().size();
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("pdfextract_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark the PDF extraction and text cleanup pipeline");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "PDF files to benchmark (default: bundled paper*.pdf / test*.pdf)");
+    QCommandLineOption iterationsOption(QStringList() << "n" << "iterations",
+                                        "Timed iterations per benchmark (default 20)", "count", "20");
+    QCommandLineOption warmupOption(QStringList() << "w" << "warmup",
+                                    "Untimed warm-up iterations (default 2)", "count", "2");
+    QCommandLineOption jsonOption("json", "Write results as JSON to file", "file");
+    QCommandLineOption noSyntheticOption("no-synthetic", "Skip the synthetic large inputs");
+    parser.addOption(iterationsOption);
+    parser.addOption(warmupOption);
+    parser.addOption(jsonOption);
+    parser.addOption(noSyntheticOption);
+    parser.process(app);
+
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const int warmup = qMax(0, parser.value(warmupOption).toInt());
+    const QStringList pdfs = parser.positionalArguments().isEmpty() ? defaultPdfs() : parser.positionalArguments();
+
+    // Harmony cleanup logs what it strips; keep disk I/O out of the measurements
+    AsyncLogger::instance()->setMinimumLevel(AsyncLogger::Off);
+
+    std::cout << "Iterations: " << iterations << " (+" << warmup << " warm-up), allocations counted via "
+              << BENCH_ALLOC_SCOPE << "\n" << std::endl;
+    printHeader();
+
+    QList<BenchResult> results;
+    auto report = [&results](const BenchResult& result) {
+        printResult(result);
+        results.append(result);
+    };
+
+    BenchKeywordsQuery query;
+    qint64 keywordsOutput = 0;
+    QObject::connect(&query, &PromptQuery::resultReady, [&keywordsOutput](const QString& result) {
+        keywordsOutput = result.size();
+    });
+
+    // Extraction and cleanup on the real documents
+    for (const QString& path : pdfs) {
+        const QString name = QFileInfo(path).fileName();
+        const qint64 fileBytes = QFileInfo(path).size();
+
+        QString extracted;
+        BenchResult extract = runBench("extract/" + name, fileBytes, warmup, iterations, [&path, &extracted]() -> qint64 {
+            QPdfDocument doc;
+            QString error;
+            if (!SafePdfLoader::loadPdf(&doc, path, error)) {
+                return -1;
+            }
+            extracted = SafePdfLoader::extractTextSafely(&doc, error);
+            doc.close();
+            return extracted.size();
+        });
+        if (extract.outputSize <= 0) {
+            std::cout << name.toStdString() << ": no text extracted, skipped" << std::endl;
+            continue;
+        }
+        report(extract);
+
+        StructuredText structure;
+        report(runBench("structured/" + name, fileBytes, warmup, iterations, [&path, &structure]() -> qint64 {
+            QPdfDocument doc;
+            QString error;
+            if (!SafePdfLoader::loadPdf(&doc, path, error)) {
+                return -1;
+            }
+            structure.clear();
+            SafePdfLoader::extractStructured(&doc, structure, error);
+            doc.close();
+            return structure.text().size();
+        }));
+
+        // The filter works on a copy each iteration
+        BoilerplateFilter::Stats removed;
+        report(runBench("boilerplate/" + name, utf8Size(extracted), warmup, iterations, [&structure, &removed]() -> qint64 {
+            StructuredText filtered = structure;
+            removed = BoilerplateFilter::apply(filtered);
+            return filtered.text().size();
+        }));
+        std::cout << "  boilerplate: " << removed.lines << " lines, " << removed.chars << " chars, ~"
+                  << removed.tokens << " tokens removed" << std::endl;
+
+        report(runBench("cleanup/" + name, utf8Size(extracted), warmup, iterations, [&extracted]() -> qint64 {
+            return TextCleaner::clean(extracted, TextCleaner::PdfText).size();
+        }));
+    }
+
+    // Synthetic inputs well beyond the bundled papers
+    if (!parser.isSet(noSyntheticOption)) {
+        for (qsizetype chars : { qsizetype(1) << 20, qsizetype(10) << 20 }) {
+            const QString document = syntheticDocument(chars);
+            const QString label = QString("%1MB").arg(chars >> 20);
+            report(runBench("cleanup/synthetic-" + label, utf8Size(document), warmup, iterations, [&document]() -> qint64 {
+                return TextCleaner::clean(document, TextCleaner::PdfText).size();
+            }));
+            report(runBench("cleanup/synthetic-pasted-" + label, utf8Size(document), warmup, iterations, [&document]() -> qint64 {
+                return TextCleaner::clean(document, TextCleaner::PastedText).size();
+            }));
+        }
+
+        for (int keywordCount : { 200, 50000 }) {
+            const QString response = syntheticKeywordResponse(keywordCount);
+            const QString label = QString("%1-keywords").arg(keywordCount);
+            report(runBench("harmony/" + label, utf8Size(response), warmup, iterations, [&query, &response]() -> qint64 {
+                return query.removeHarmonyArtifacts(response).size();
+            }));
+            report(runBench("keywords/" + label, utf8Size(response), warmup, iterations,
+                            [&query, &response, &keywordsOutput]() -> qint64 {
+                query.processResponse(response);
+                return keywordsOutput;
+            }));
+        }
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonArray benchmarks;
+        for (const BenchResult& result : std::as_const(results)) {
+            benchmarks.append(result.toJson());
+        }
+        QJsonObject root;
+        root["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+        root["qt_version"] = QString(qVersion());
+        root["iterations"] = iterations;
+        root["warmup"] = warmup;
+        root["alloc_counting"] = QString(BENCH_ALLOC_SCOPE);
+        root["benchmarks"] = benchmarks;
+
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            std::cerr << "Cannot write " << parser.value(jsonOption).toStdString() << std::endl;
+            return 1;
+        }
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        std::cout << "\nResults written to " << parser.value(jsonOption).toStdString() << std::endl;
+    }
+
+    AsyncLogger::instance()->shutdown();
+    return results.isEmpty() ? 1 : 0;
+}
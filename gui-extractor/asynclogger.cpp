@@ -0,0 +1,322 @@
+#include "asynclogger.h"
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+
+AsyncLogger* AsyncLogger::instance() {
+    static AsyncLogger logger;
+    return &logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : m_slots(new Slot[RingCapacity])
+    , m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_minimumLevel(Debug)
+    , m_flushIntervalMs(DefaultFlushIntervalMs)
+    , m_dropped(0)
+    , m_written(0)
+    , m_stopping(false)
+    , m_flushRequested(false)
+    , m_thread(nullptr)
+{
+    static_assert((RingCapacity & (RingCapacity - 1)) == 0, "RingCapacity must be a power of two");
+    for (quint64 i = 0; i < static_cast<quint64>(RingCapacity); ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("AsyncLogger");
+    m_thread->start(QThread::LowPriority);
+}
+
+AsyncLogger::~AsyncLogger() {
+    shutdown();
+}
+
+void AsyncLogger::append(const QString& path, const QString& text, Level level) {
+    Record record;
+    record.kind = Record::Text;
+    record.path = path;
+    record.text = text;
+    push(std::move(record), level);
+}
+
+void AsyncLogger::line(const QString& path, const QString& message, Level level, Stamp stamp) {
+    Record record;
+    record.kind = Record::Line;
+    record.stamp = stamp;
+    record.timestamp = (stamp == NoStamp) ? 0 : QDateTime::currentMSecsSinceEpoch();
+    record.path = path;
+    record.text = message;
+    push(std::move(record), level);
+}
+
+void AsyncLogger::lineNow(const QString& path, const QString& message, Level level, Stamp stamp) {
+    Record record;
+    record.kind = Record::Line;
+    record.stamp = stamp;
+    record.timestamp = (stamp == NoStamp) ? 0 : QDateTime::currentMSecsSinceEpoch();
+    record.path = path;
+    record.text = message;
+    push(std::move(record), level, true);
+}
+
+void AsyncLogger::truncate(const QString& path, const QString& header) {
+    Record record;
+    record.kind = Record::Truncate;
+    record.path = path;
+    record.text = header;
+    // Not subject to level filtering - a stale log from an earlier run is worse than an empty one
+    push(std::move(record), Error);
+}
+
+void AsyncLogger::data(const QString& path, const QString& line) {
+    Record record;
+    record.kind = Record::Line;
+    record.path = path;
+    record.text = line;
+    enqueue(std::move(record), false);
+}
+
+bool AsyncLogger::push(Record&& record, Level level, bool sync) {
+    if (level < m_minimumLevel.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    sync = sync || level >= Error;
+    if (!enqueue(std::move(record), sync)) {
+        return false;
+    }
+    // Errors and abort traces must survive a crash that follows right after them
+    return !sync || flush(SyncTimeoutMs);
+}
+
+bool AsyncLogger::enqueue(Record&& record, bool urgent) {
+    if (m_stopping.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // Bounded MPMC queue (Vyukov): claim a slot by advancing m_enqueuePos, then publish
+    // it by bumping the slot's sequence. No locks, and no allocation beyond the record itself.
+    quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = m_slots[pos & (RingCapacity - 1)];
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        const qint64 diff = static_cast<qint64>(sequence) - static_cast<qint64>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.record = std::move(record);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (diff < 0) {
+            // Full - the writer is behind. Drop rather than wait on it.
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (urgent) {
+        wake();
+    }
+    return true;
+}
+
+bool AsyncLogger::pop(Record& record) {
+    Slot& slot = m_slots[m_dequeuePos & (RingCapacity - 1)];
+    const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+    if (static_cast<qint64>(sequence) - static_cast<qint64>(m_dequeuePos + 1) < 0) {
+        return false;  // Empty (or the producer hasn't finished publishing yet)
+    }
+
+    record = std::move(slot.record);
+    slot.record = Record();
+    slot.sequence.store(m_dequeuePos + RingCapacity, std::memory_order_release);
+    ++m_dequeuePos;
+    return true;
+}
+
+void AsyncLogger::wake() {
+    // QWaitCondition may be woken without holding the mutex; a missed wake-up
+    // only delays the batch until the next flush interval
+    m_wakeCondition.wakeOne();
+}
+
+bool AsyncLogger::requestFlush(const QDeadlineTimer& deadline) {
+    // Unlike wake() this can't be lost: the writer checks the flag before sleeping
+    if (!m_wakeMutex.tryLock(deadline.remainingTime())) {
+        return false;
+    }
+    m_flushRequested = true;
+    m_wakeCondition.wakeOne();
+    m_wakeMutex.unlock();
+    return true;
+}
+
+void AsyncLogger::run() {
+    while (!m_stopping.load(std::memory_order_acquire)) {
+        {
+            QMutexLocker locker(&m_wakeMutex);
+            if (!m_stopping.load(std::memory_order_acquire) && !m_flushRequested) {
+                m_wakeCondition.wait(&m_wakeMutex, m_flushIntervalMs.load(std::memory_order_relaxed));
+            }
+            m_flushRequested = false;
+        }
+        writeBatch();
+    }
+
+    // Final drain
+    writeBatch();
+    for (QFile* file : std::as_const(m_files)) {
+        file->close();
+        delete file;
+    }
+    m_files.clear();
+}
+
+QFile* AsyncLogger::openFile(const QString& path, bool truncate) {
+    QFile* file = m_files.value(path);
+    if (file && !truncate) {
+        return file;
+    }
+    if (!file) {
+        file = new QFile(path);
+        m_files.insert(path, file);
+    }
+
+    file->close();
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | (truncate ? QIODevice::Truncate : QIODevice::Append);
+    if (!file->open(mode)) {
+        qWarning() << "AsyncLogger: cannot open" << path << file->errorString();
+    }
+    return file;
+}
+
+void AsyncLogger::writeBatch() {
+    // Gather everything per file first, so each file gets a single write + flush
+    QHash<QString, QByteArray> pending;
+    QStringList order;
+    auto writePending = [this, &pending](const QString& path) {
+        QByteArray& data = pending[path];
+        if (data.isEmpty()) {
+            return;
+        }
+        QFile* file = openFile(path, false);
+        if (file->isOpen()) {
+            file->write(data);
+            file->flush();
+        }
+        data.clear();
+    };
+
+    Record record;
+    quint64 count = 0;
+    while (count < static_cast<quint64>(RingCapacity) && pop(record)) {
+        ++count;
+        if (!pending.contains(record.path)) {
+            order.append(record.path);
+        }
+
+        QByteArray& data = pending[record.path];
+        switch (record.kind) {
+        case Record::Truncate:
+            data.clear();  // Queued before the truncate, so it would be thrown away anyway
+            openFile(record.path, true);
+            data += record.text.toUtf8();
+            break;
+        case Record::Line:
+            if (record.stamp == TimeStamp) {
+                data += QDateTime::fromMSecsSinceEpoch(record.timestamp).toString("[hh:mm:ss.zzz] ").toUtf8();
+            } else if (record.stamp == DateTimeStamp) {
+                data += QDateTime::fromMSecsSinceEpoch(record.timestamp).toString("yyyy-MM-dd hh:mm:ss.zzz - ").toUtf8();
+            }
+            data += record.text.toUtf8();
+            data += '\n';
+            break;
+        case Record::Text:
+            data += record.text.toUtf8();
+            break;
+        }
+    }
+
+    for (const QString& path : std::as_const(order)) {
+        writePending(path);
+    }
+
+    const quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        qWarning() << "AsyncLogger: queue full," << dropped << "log records dropped";
+    }
+
+    m_written.fetch_add(count, std::memory_order_release);
+    if (count > 0) {
+        QMutexLocker locker(&m_flushMutex);
+        m_flushedCondition.wakeAll();
+    }
+}
+
+bool AsyncLogger::flush(int timeoutMs) {
+    if (!m_thread || m_stopping.load(std::memory_order_acquire)) {
+        return true;
+    }
+    if (QThread::currentThread() == m_thread) {
+        return false;  // The writer can't wait for itself
+    }
+
+    const quint64 target = m_enqueuePos.load(std::memory_order_acquire);
+    QDeadlineTimer deadline(timeoutMs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(timeoutMs));
+
+    // tryLock so a crash handler can't hang on a mutex the crashed thread held
+    if (!m_flushMutex.tryLock(deadline.remainingTime())) {
+        return false;
+    }
+    bool done;
+    while (!(done = m_written.load(std::memory_order_acquire) >= target)) {
+        if (!requestFlush(deadline) || !m_flushedCondition.wait(&m_flushMutex, deadline)) {
+            done = m_written.load(std::memory_order_acquire) >= target;
+            break;
+        }
+    }
+    m_flushMutex.unlock();
+    return done;
+}
+
+void AsyncLogger::shutdown() {
+    if (!m_thread) {
+        return;
+    }
+
+    m_stopping.store(true, std::memory_order_release);
+    {
+        QMutexLocker locker(&m_wakeMutex);
+        m_wakeCondition.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+AsyncLogger::Level AsyncLogger::levelFromString(const QString& name, Level fallback) {
+    const QString lower = name.trimmed().toLower();
+    if (lower == "debug") return Debug;
+    if (lower == "info") return Info;
+    if (lower == "warning") return Warning;
+    if (lower == "error") return Error;
+    if (lower == "off") return Off;
+    return fallback;
+}
+
+QString AsyncLogger::levelToString(Level level) {
+    switch (level) {
+        case Debug: return "debug";
+        case Info: return "info";
+        case Warning: return "warning";
+        case Error: return "error";
+        case Off: return "off";
+        default: return "debug";
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+
+class QDeadlineTimer;
+class QFile;
+class QThread;
+
+// Background logging for the debug/transcript log files. Callers only push a
+// record into a lock-free multi-producer ring buffer; a single writer thread
+// drains it every flush interval, groups records by file and writes each file
+// once per batch. Ordinary records never make the caller wait for the disk.
+// Error records and lineNow() are the exception: they are the trail a crash
+// would otherwise lose, so the caller waits (at most SyncTimeoutMs) until the
+// writer has them on disk. If the ring is full the record is dropped and
+// counted, and the writer reports the count with qWarning.
+class AsyncLogger {
+public:
+    enum Level {
+        Debug,    // Full prompts, responses, transcripts
+        Info,     // Normal progress (abort traces, Zotero activity)
+        Warning,
+        Error,    // Written before the call returns (bounded by SyncTimeoutMs)
+        Off
+    };
+
+    // How a line() is prefixed; the timestamp is taken when the record is pushed
+    enum Stamp {
+        NoStamp,
+        TimeStamp,      // "[hh:mm:ss.zzz] message"
+        DateTimeStamp   // "yyyy-MM-dd hh:mm:ss.zzz - message"
+    };
+
+    static AsyncLogger* instance();
+
+    // Write text verbatim
+    void append(const QString& path, const QString& text, Level level = Debug);
+    // Write one line with an optional timestamp prefix
+    void line(const QString& path, const QString& message, Level level = Info, Stamp stamp = NoStamp);
+    // Like line(), but return only once the record is on disk (abort/crash trails)
+    void lineNow(const QString& path, const QString& message, Level level = Info, Stamp stamp = NoStamp);
+    // Empty the file, then write header (runs in order with the other records for path)
+    void truncate(const QString& path, const QString& header = QString());
+    // Write one line of machine-readable output (e.g. metrics); never filtered by level
+    void data(const QString& path, const QString& line);
+
+    void setMinimumLevel(Level level) { m_minimumLevel.store(level, std::memory_order_relaxed); }
+    Level minimumLevel() const { return static_cast<Level>(m_minimumLevel.load(std::memory_order_relaxed)); }
+    void setFlushInterval(int ms) { m_flushIntervalMs.store(qMax(10, ms), std::memory_order_relaxed); }
+    int flushInterval() const { return m_flushIntervalMs.load(std::memory_order_relaxed); }
+
+    static Level levelFromString(const QString& name, Level fallback = Debug);
+    static QString levelToString(Level level);
+
+    // Block until everything queued so far is on disk, or timeoutMs passed (-1 waits
+    // indefinitely). Returns false on timeout. Not for use on hot paths.
+    bool flush(int timeoutMs = -1);
+    // Drain the queue, close all files and stop the writer thread
+    void shutdown();
+
+    static constexpr int DefaultFlushIntervalMs = 200;
+    static constexpr int RingCapacity = 16384;  // Must be a power of two
+    static constexpr int SyncTimeoutMs = 1000;   // Longest a synchronous record or crash flush waits
+
+private:
+    struct Record {
+        enum Kind { Text, Line, Truncate };
+        Kind kind = Text;
+        Stamp stamp = NoStamp;
+        qint64 timestamp = 0;
+        QString path;
+        QString text;
+    };
+
+    AsyncLogger();
+    ~AsyncLogger();
+
+    bool push(Record&& record, Level level, bool sync = false);
+    bool enqueue(Record&& record, bool urgent);
+    bool pop(Record& record);
+    void run();
+    void writeBatch();
+    QFile* openFile(const QString& path, bool truncate);
+    void wake();
+    bool requestFlush(const QDeadlineTimer& deadline);
+
+    struct Slot {
+        std::atomic<quint64> sequence;
+        Record record;
+    };
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<quint64> m_enqueuePos;
+    alignas(64) quint64 m_dequeuePos;  // Writer thread only
+
+    std::atomic<int> m_minimumLevel;
+    std::atomic<int> m_flushIntervalMs;
+    std::atomic<quint64> m_dropped;
+    std::atomic<quint64> m_written;  // Records fully written, for flush()
+    std::atomic<bool> m_stopping;
+
+    QMutex m_wakeMutex;  // Only guards the writer's sleep, never taken by producers
+    QWaitCondition m_wakeCondition;
+    bool m_flushRequested;  // Guarded by m_wakeMutex, so flush() can't miss the writer
+    QMutex m_flushMutex;  // Pairs m_written with m_flushedCondition for flush()
+    QWaitCondition m_flushedCondition;
+    QThread* m_thread;
+    QHash<QString, QFile*> m_files;  // Writer thread only
+};
+
+#endif // ASYNCLOGGER_H
@@ -0,0 +1,99 @@
+#include "boilerplatefilter.h"
+#include "structuredtext.h"
+#include "tokenbudget.h"
+#include <QDebug>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+QString BoilerplateFilter::normalize(QStringView line) {
+    QString key;
+    key.reserve(line.size());
+    bool pendingSpace = false;
+    bool inDigits = false;
+    for (QChar c : line.trimmed()) {
+        if (c.isSpace()) {
+            pendingSpace = true;
+            inDigits = false;
+            continue;
+        }
+        if (pendingSpace) {
+            key += u' ';
+            pendingSpace = false;
+        }
+        if (c.isDigit()) {
+            if (!inDigits) {
+                key += u'#';
+            }
+            inDigits = true;
+            continue;
+        }
+        inDigits = false;
+        key += c.toLower();
+    }
+    return key;
+}
+
+BoilerplateFilter::Stats BoilerplateFilter::apply(StructuredText& text) {
+    Stats stats;
+    if (text.pageCount() < MinPages) {
+        return stats;
+    }
+
+    // Normalized edge blocks (empty key: too long to be furniture), each counted once per page
+    QVector<QString> keys(text.blockCount());
+    QHash<QString, int> pageCounts;
+    int textPages = 0;
+    for (int p = 0; p < text.pageCount(); ++p) {
+        const StructuredText::Page& page = text.page(p);
+        QSet<QString> seen;
+        for (int k = 0; k < page.blockCount; ++k) {
+            if (k >= EdgeLines && k < page.blockCount - EdgeLines) {
+                continue;
+            }
+            const int b = page.firstBlock + k;
+            const QStringView line = text.blockText(b).trimmed();
+            if (line.size() > MaxLineChars) {
+                continue;
+            }
+            keys[b] = normalize(line);
+            if (!keys[b].isEmpty() && !seen.contains(keys[b])) {
+                seen.insert(keys[b]);
+                pageCounts[keys[b]]++;
+            }
+        }
+        if (page.blockCount > 0) {
+            textPages++;
+        }
+    }
+
+    const int threshold = qMax(MinPages, (textPages * MinPageSharePercent + 99) / 100);
+    QSet<QString> boilerplate;
+    for (auto it = pageCounts.cbegin(); it != pageCounts.cend(); ++it) {
+        if (it.value() >= threshold) {
+            boilerplate.insert(it.key());
+        }
+    }
+    if (boilerplate.isEmpty()) {
+        return stats;
+    }
+    stats.patterns = static_cast<int>(boilerplate.size());
+
+    QVector<bool> drop(text.blockCount(), false);
+    for (int b = 0; b < text.blockCount(); ++b) {
+        if (!keys[b].isEmpty() && boilerplate.contains(keys[b])) {
+            drop[b] = true;
+            stats.lines++;
+            stats.tokens += TokenBudget::estimateTokens(text.blockText(b).toString());
+        }
+    }
+
+    const qsizetype before = text.text().size();
+    text.removeBlocks(drop);
+    stats.chars = before - text.text().size();
+
+    qDebug() << "BoilerplateFilter: removed" << stats.lines << "lines matching" << stats.patterns
+             << "recurring patterns, e.g." << QStringList(boilerplate.cbegin(), boilerplate.cend()).mid(0, 3);
+    return stats;
+}
@@ -0,0 +1,40 @@
+#ifndef BOILERPLATEFILTER_H
+#define BOILERPLATEFILTER_H
+
+#include <QString>
+#include <QStringView>
+
+class StructuredText;
+
+// Removes page furniture that getAllText repeats on every page: running heads,
+// journal names, DOIs, "Downloaded from ..." stamps and page numbers.
+//
+// Only the first and last EdgeLines lines (blocks) of each page are candidates.
+// A candidate is boilerplate when its normalized form (case folded, whitespace
+// collapsed, every run of digits replaced by '#', so "Page 3 of 12" matches
+// "Page 4 of 12") occurs in the edge zone of at least MinPageSharePercent of the
+// pages. The share is below half so headers that alternate between even and odd
+// pages are caught. The same text in the body of a page is never touched.
+//
+// Stateless and thread-safe; runs on the extraction thread.
+class BoilerplateFilter {
+public:
+    struct Stats {
+        int patterns = 0;     // Distinct recurring lines found
+        int lines = 0;        // Lines removed over all pages
+        qsizetype chars = 0;  // Characters removed, newlines included
+        int tokens = 0;       // TokenBudget::estimateTokens of the removed lines
+    };
+
+    // Removes the blocks in place. Documents with fewer than MinPages pages are left alone.
+    static Stats apply(StructuredText& text);
+
+    static QString normalize(QStringView line);
+
+    static constexpr int EdgeLines = 4;
+    static constexpr int MinPages = 3;
+    static constexpr int MinPageSharePercent = 40;
+    static constexpr int MaxLineChars = 200;  // Longer lines are body text
+};
+
+#endif // BOILERPLATEFILTER_H
@@ -0,0 +1,679 @@
+#include "bulkanalysisqueue.h"
+#include "mappedpdffile.h"
+#include "pdfextractionjob.h"
+#include "queryrunner.h"
+#include "zoterodownloader.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkRequest>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUrl>
+
+BulkAnalysisQueue::BulkAnalysisQueue(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+    , m_consecutiveFailures(0)
+    , m_tablesReady(false)
+{
+    m_directory = QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("zotero_bulk");
+    QDir().mkpath(m_directory);
+
+    // Leftovers from an interrupted session
+    QDir dir(m_directory);
+    for (const QString& name : dir.entryList(QStringList() << "*.part", QDir::Files)) {
+        dir.remove(name);
+    }
+}
+
+BulkAnalysisQueue::~BulkAnalysisQueue() {
+    abortAll();
+}
+
+void BulkAnalysisQueue::setLibrary(const QString& userId, const QString& apiKey) {
+    if (m_running && (userId != m_userId || apiKey != m_apiKey)) {
+        stop();
+    }
+    m_userId = userId;
+    m_apiKey = apiKey;
+}
+
+void BulkAnalysisQueue::setLimits(const Limits& limits) {
+    m_limits.downloads = qMax(1, limits.downloads);
+    m_limits.extractions = qMax(1, limits.extractions);
+    m_limits.analyses = qMax(1, limits.analyses);
+    if (m_running) {
+        prepareRunners();
+        schedule();
+    }
+}
+
+bool BulkAnalysisQueue::start(const QString& collectionKey, const QString& collectionName,
+                              const QList<ZoteroItem>& items) {
+    if (m_running) {
+        emit statusMessage(QString("Already analyzing %1").arg(m_collectionName));
+        return false;
+    }
+    if (m_userId.isEmpty() || m_apiKey.isEmpty() || !ensureTables()) {
+        emit statusMessage("Cannot start collection analysis: Zotero or database not available");
+        return false;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+    QSqlQuery query(db);
+
+    query.prepare("INSERT INTO bulk_jobs (library, collection_key, collection_name, created_at, finished_at) "
+                  "VALUES (:library, :collection, :name, :now, NULL) "
+                  "ON CONFLICT (library, collection_key) DO UPDATE SET "
+                  "collection_name = excluded.collection_name, finished_at = NULL");
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", collectionKey);
+    query.bindValue(":name", collectionName);
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+    bool ok = query.exec();
+
+    // Rows not re-queued below belong to items that left the collection
+    query.prepare("UPDATE bulk_items SET position = -1 WHERE library = :library AND collection_key = :collection");
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", collectionKey);
+    ok = ok && query.exec();
+
+    // Finished and downloaded items stay as they are unless Zotero has a newer file
+    query.prepare("INSERT INTO bulk_items (library, collection_key, item_key, title, attachment_key, "
+                  "attachment_version, position, status, updated_at) "
+                  "VALUES (:library, :collection, :item, :title, :attachment, :version, :position, 'pending', :now) "
+                  "ON CONFLICT (library, collection_key, item_key) DO UPDATE SET "
+                  "title = excluded.title, attachment_key = excluded.attachment_key, "
+                  "position = excluded.position, "
+                  "status = CASE WHEN bulk_items.attachment_key = excluded.attachment_key "
+                  "AND bulk_items.attachment_version = excluded.attachment_version "
+                  "AND bulk_items.status IN ('done', 'downloaded') THEN bulk_items.status ELSE 'pending' END, "
+                  "attachment_version = excluded.attachment_version");
+    int position = 0;
+    for (const ZoteroItem& item : items) {
+        if (!ok) {
+            break;
+        }
+        if (!item.hasPdf || item.pdfAttachmentKey.isEmpty()) {
+            continue;
+        }
+        query.bindValue(":library", libraryId());
+        query.bindValue(":collection", collectionKey);
+        query.bindValue(":item", item.key);
+        query.bindValue(":title", item.title);
+        query.bindValue(":attachment", item.pdfAttachmentKey);
+        query.bindValue(":version", item.pdfAttachmentVersion);
+        query.bindValue(":position", position++);
+        query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+        ok = query.exec();
+    }
+
+    query.prepare("DELETE FROM bulk_items WHERE library = :library AND collection_key = :collection AND position < 0");
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", collectionKey);
+    ok = ok && query.exec();
+
+    if (!ok) {
+        qDebug() << "BulkAnalysisQueue: could not queue collection:" << query.lastError().text();
+        db.rollback();
+        emit statusMessage("Cannot start collection analysis: failed to save the queue");
+        return false;
+    }
+    db.commit();
+
+    if (position == 0) {
+        emit statusMessage(QString("No papers with PDFs in %1").arg(collectionName));
+        return false;
+    }
+    return resume(collectionKey);
+}
+
+bool BulkAnalysisQueue::resume(const QString& collectionKey) {
+    if (m_running || m_userId.isEmpty() || m_apiKey.isEmpty() || !loadJob(collectionKey)) {
+        return false;
+    }
+
+    m_running = true;
+    m_consecutiveFailures = 0;
+    prepareRunners();
+
+    const int done = count(Done);
+    const int remaining = m_entries.size() - done - count(Failed);
+    emit statusMessage(QString("Analyzing %1 papers from %2 (%3 already done)")
+                       .arg(remaining).arg(m_collectionName).arg(done));
+    emitProgress();
+    schedule();
+    return true;
+}
+
+QList<BulkAnalysisQueue::JobSummary> BulkAnalysisQueue::unfinishedJobs() const {
+    QList<JobSummary> jobs;
+    if (m_userId.isEmpty() || !ensureTables()) {
+        return jobs;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT j.collection_key, j.collection_name, COUNT(i.item_key) AS total, "
+                  "SUM(CASE WHEN i.status IN ('pending', 'downloaded') THEN 1 ELSE 0 END) AS remaining "
+                  "FROM bulk_jobs j JOIN bulk_items i "
+                  "ON i.library = j.library AND i.collection_key = j.collection_key "
+                  "WHERE j.library = :library AND j.finished_at IS NULL "
+                  "GROUP BY j.collection_key, j.collection_name ORDER BY j.created_at");
+    query.bindValue(":library", libraryId());
+    if (!query.exec()) {
+        qDebug() << "BulkAnalysisQueue: could not list jobs:" << query.lastError().text();
+        return jobs;
+    }
+
+    while (query.next()) {
+        JobSummary job;
+        job.collectionKey = query.value("collection_key").toString();
+        job.collectionName = query.value("collection_name").toString();
+        job.total = query.value("total").toInt();
+        job.remaining = query.value("remaining").toInt();
+        if (job.remaining > 0 && !(m_running && job.collectionKey == m_collectionKey)) {
+            jobs.append(job);
+        }
+    }
+    return jobs;
+}
+
+void BulkAnalysisQueue::stop() {
+    if (!m_running) {
+        return;
+    }
+    abortAll();
+    m_running = false;
+
+    const int remaining = m_entries.size() - count(Done) - count(Failed);
+    qDebug() << "BulkAnalysisQueue: stopped" << m_collectionName << "with" << remaining << "papers left";
+    emit stopped(QString("Stopped analyzing %1 (%2 papers left)").arg(m_collectionName).arg(remaining));
+}
+
+bool BulkAnalysisQueue::loadJob(const QString& collectionKey) {
+    if (!ensureTables()) {
+        return false;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT collection_name FROM bulk_jobs WHERE library = :library AND collection_key = :collection");
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", collectionKey);
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+    m_collectionKey = collectionKey;
+    m_collectionName = query.value("collection_name").toString();
+
+    query.prepare("SELECT item_key, title, attachment_key, attachment_version, status, pdf_path, content_hash "
+                  "FROM bulk_items WHERE library = :library AND collection_key = :collection ORDER BY position");
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", collectionKey);
+    if (!query.exec()) {
+        qDebug() << "BulkAnalysisQueue: could not load job:" << query.lastError().text();
+        return false;
+    }
+
+    m_entries.clear();
+    while (query.next()) {
+        Entry entry;
+        entry.itemKey = query.value("item_key").toString();
+        entry.title = query.value("title").toString();
+        entry.attachmentKey = query.value("attachment_key").toString();
+        entry.attachmentVersion = query.value("attachment_version").toLongLong();
+        entry.pdfPath = query.value("pdf_path").toString();
+        entry.contentHash = QByteArray::fromHex(query.value("content_hash").toByteArray());
+
+        const QString status = query.value("status").toString();
+        if (status == "done") {
+            entry.stage = Done;
+        } else if (status == "failed") {
+            entry.stage = Failed;
+        } else if (status == "downloaded" && QFile::exists(entry.pdfPath)) {
+            entry.stage = Downloaded;
+        } else {
+            entry.stage = Pending;
+        }
+        m_entries.append(entry);
+    }
+    return !m_entries.isEmpty();
+}
+
+void BulkAnalysisQueue::prepareRunners() {
+    while (m_runners.size() < m_limits.analyses) {
+        QueryRunner* runner = new QueryRunner(this);
+        connect(runner, &QueryRunner::processingComplete, this, [this, runner]() {
+            finishAnalysis(runner, true, QString());
+        });
+        connect(runner, &QueryRunner::errorOccurred, this, [this, runner](const QString& error) {
+            finishAnalysis(runner, false, error);
+        });
+        m_runners.append(runner);
+    }
+
+    // Pick up settings changed since the runners were created
+    for (QueryRunner* runner : m_runners) {
+        if (!m_analyses.contains(runner)) {
+            runner->loadSettingsFromDatabase();
+        }
+    }
+}
+
+void BulkAnalysisQueue::schedule() {
+    if (!m_running) {
+        return;
+    }
+
+    // Later stages first, so finished work never waits behind new work
+    while (m_running && m_analyses.size() < m_limits.analyses) {
+        const int index = next(Extracted);
+        if (index < 0) {
+            break;
+        }
+        startAnalysis(index);
+    }
+
+    // Keep at most one extracted paper ready per LLM slot
+    while (m_running && m_extractions.size() < m_limits.extractions
+           && count(Extracted) + m_extractions.size() < m_limits.analyses + m_limits.extractions) {
+        const int index = next(Downloaded);
+        if (index < 0) {
+            break;
+        }
+        startExtraction(index);
+    }
+
+    while (m_running && m_downloads.size() < m_limits.downloads && count(Downloaded) + m_downloads.size() < DownloadAhead) {
+        const int index = next(Pending);
+        if (index < 0) {
+            break;
+        }
+        startDownload(index);
+    }
+
+    if (m_running && m_downloads.isEmpty() && m_extractions.isEmpty() && m_analyses.isEmpty()
+        && next(Pending) < 0 && next(Downloaded) < 0 && next(Extracted) < 0) {
+        finishJob();
+    }
+}
+
+int BulkAnalysisQueue::count(Stage stage) const {
+    int n = 0;
+    for (const Entry& entry : m_entries) {
+        if (entry.stage == stage) {
+            n++;
+        }
+    }
+    return n;
+}
+
+int BulkAnalysisQueue::next(Stage stage) const {
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].stage == stage) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BulkAnalysisQueue::startDownload(int index) {
+    Entry& entry = m_entries[index];
+    entry.stage = Downloading;
+
+    Download download;
+    download.file = new QFile(pdfPath(entry) + ".part");
+    if (!download.file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        const QString error = QString("Cannot create %1").arg(download.file->fileName());
+        delete download.file;
+        failItem(index, error);
+        return;
+    }
+
+    QNetworkRequest request{QUrl(QString("https://api.zotero.org/users/%1/items/%2/file")
+                                 .arg(m_userId, entry.attachmentKey))};
+    request.setRawHeader("Zotero-API-Version", "3");
+    request.setRawHeader("Authorization", QString("Bearer %1").arg(m_apiKey).toUtf8());
+
+    ZoteroDownloader* downloader = new ZoteroDownloader(this);
+    download.downloader = downloader;
+    connect(downloader, &ZoteroDownloader::finished, this, [this, index, downloader](qint64, const QByteArray& sha256) {
+        if (m_downloads.value(index).downloader == downloader) {
+            finishDownload(index, true, sha256, QString());
+        }
+    });
+    connect(downloader, &ZoteroDownloader::failed, this, [this, index, downloader](const QString& error) {
+        if (m_downloads.value(index).downloader == downloader) {
+            finishDownload(index, false, QByteArray(), error);
+        }
+    });
+
+    m_downloads.insert(index, download);
+    downloader->start(request, download.file);
+}
+
+void BulkAnalysisQueue::finishDownload(int index, bool ok, const QByteArray& sha256, const QString& error) {
+    Download download = m_downloads.take(index);
+    const QString partPath = download.file->fileName();
+    download.file->close();
+    delete download.file;
+    download.downloader->deleteLater();
+
+    Entry& entry = m_entries[index];
+    QString failure = error;
+    if (ok) {
+        // Cheap sanity check; extraction does the full parse
+        MappedPdfFile mapped;
+        ok = mapped.open(partPath, failure);
+    }
+    if (ok) {
+        entry.pdfPath = pdfPath(entry);
+        entry.contentHash = sha256;
+        QFile::remove(entry.pdfPath);
+        ok = QFile::rename(partPath, entry.pdfPath);
+        if (!ok) {
+            failure = "Could not store downloaded PDF";
+        }
+    }
+
+    if (!ok) {
+        QFile::remove(partPath);
+        failItem(index, failure);
+        schedule();
+        return;
+    }
+
+    entry.stage = Downloaded;
+    saveItem(entry, "downloaded");
+    schedule();
+}
+
+void BulkAnalysisQueue::startExtraction(int index) {
+    Entry& entry = m_entries[index];
+    entry.stage = Extracting;
+    emit statusMessage(QString("Extracting: %1").arg(entry.title.left(60)));
+
+    PdfExtractionJob* job = m_runners.first()->createExtractionJob(entry.pdfPath, entry.contentHash);
+    m_extractions.insert(index, job);
+
+    // Queued results can still arrive after stop()
+    connect(job, &PdfExtractionJob::finished, this,
+            [this, index, job](const QString& extractedText, const QString& cachedCleanedText,
+                               const QString& cacheKey, bool, const StructuredText& structure) {
+        if (m_extractions.value(index) != job) {
+            return;
+        }
+        m_extractions.remove(index);
+
+        Entry& entry = m_entries[index];
+        entry.extractedText = extractedText;
+        entry.structure = structure;
+        entry.cachedCleanedText = cachedCleanedText;
+        entry.cacheKey = cacheKey;
+        entry.stage = Extracted;
+        schedule();
+    });
+    connect(job, &PdfExtractionJob::failed, this, [this, index, job](const QString& error) {
+        if (m_extractions.value(index) != job) {
+            return;
+        }
+        m_extractions.remove(index);
+        failItem(index, error);
+        schedule();
+    });
+
+    job->start();
+}
+
+void BulkAnalysisQueue::startAnalysis(int index) {
+    QueryRunner* runner = nullptr;
+    for (QueryRunner* candidate : m_runners) {
+        if (!m_analyses.contains(candidate)) {
+            runner = candidate;
+            break;
+        }
+    }
+    if (!runner) {
+        return;
+    }
+
+    Entry& entry = m_entries[index];
+    entry.stage = Analyzing;
+    m_analyses.insert(runner, index);
+    emit statusMessage(QString("Analyzing: %1").arg(entry.title.left(60)));
+
+    // The runner keeps its own copy from here on
+    const QString extractedText = entry.extractedText;
+    const StructuredText structure = entry.structure;
+    const QString cachedCleanedText = entry.cachedCleanedText;
+    const QString cacheKey = entry.cacheKey;
+    entry.extractedText.clear();
+    entry.structure.clear();
+    entry.cachedCleanedText.clear();
+
+    // Started from the event loop: a run can fail (and reset the runner) inside
+    // processExtractedText, and a runner that just reported is still inside its signal
+    QMetaObject::invokeMethod(this, [this, runner, index, extractedText, structure, cachedCleanedText, cacheKey]() {
+        if (m_running && m_analyses.value(runner, -1) == index) {
+            runner->processExtractedText(extractedText, cachedCleanedText, cacheKey, structure);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void BulkAnalysisQueue::finishAnalysis(QueryRunner* runner, bool ok, const QString& error) {
+    // Aborted stages can report after the run already ended
+    if (!m_analyses.contains(runner)) {
+        return;
+    }
+    const int index = m_analyses.take(runner);
+
+    if (ok) {
+        const Entry& entry = m_entries[index];
+        const QString summary = runner->getSummary();
+        const QString keywords = runner->getOriginalKeywords();
+        const QString refinedKeywords = runner->getRefinedKeywords();
+
+        saveResults(entry, summary, keywords, refinedKeywords);
+        appendResult(entry, summary, keywords, refinedKeywords);
+        QFile::remove(entry.pdfPath);
+
+        m_entries[index].stage = Done;
+        m_consecutiveFailures = 0;
+        qDebug() << "BulkAnalysisQueue: analyzed" << entry.title.left(60);
+        emit itemFinished(entry.itemKey, entry.title, true, QString());
+        emitProgress();
+    } else {
+        failItem(index, error);
+    }
+
+    schedule();
+}
+
+void BulkAnalysisQueue::failItem(int index, const QString& error) {
+    Entry& entry = m_entries[index];
+    entry.stage = Failed;
+    entry.extractedText.clear();
+    entry.structure.clear();
+    entry.cachedCleanedText.clear();
+    saveItem(entry, "failed", error);
+    if (!entry.pdfPath.isEmpty()) {
+        QFile::remove(entry.pdfPath);
+    }
+
+    qDebug() << "BulkAnalysisQueue: failed" << entry.title.left(60) << "-" << error;
+    emit itemFinished(entry.itemKey, entry.title, false, error);
+    emitProgress();
+
+    // Several failures in a row usually mean the server or network is down, not bad papers
+    if (++m_consecutiveFailures >= MaxConsecutiveFailures) {
+        abortAll();
+        m_running = false;
+        emit stopped(QString("Stopped analyzing %1 after %2 failures in a row (last: %3)")
+                     .arg(m_collectionName).arg(m_consecutiveFailures).arg(error));
+    }
+}
+
+void BulkAnalysisQueue::emitProgress() {
+    emit progress(count(Done), count(Failed), m_entries.size());
+}
+
+void BulkAnalysisQueue::finishJob() {
+    m_running = false;
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("UPDATE bulk_jobs SET finished_at = :now WHERE library = :library AND collection_key = :collection");
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", m_collectionKey);
+    if (!query.exec()) {
+        qDebug() << "BulkAnalysisQueue: could not mark job finished:" << query.lastError().text();
+    }
+
+    qDebug() << "BulkAnalysisQueue: finished" << m_collectionName << "-" << count(Done) << "done,"
+             << count(Failed) << "failed";
+    emit finished(count(Done), count(Failed), resultsPath());
+}
+
+void BulkAnalysisQueue::abortAll() {
+    for (auto it = m_downloads.begin(); it != m_downloads.end(); ++it) {
+        it->downloader->disconnect(this);
+        it->downloader->abort();
+        it->downloader->deleteLater();
+        const QString partPath = it->file->fileName();
+        it->file->close();
+        delete it->file;
+        QFile::remove(partPath);
+    }
+    m_downloads.clear();
+
+    // Jobs delete themselves once their thread exits
+    for (PdfExtractionJob* job : m_extractions) {
+        job->disconnect(this);
+        job->cancel();
+    }
+    m_extractions.clear();
+
+    // Clear first so the errors abort() triggers are ignored
+    const QList<QueryRunner*> busy = m_analyses.keys();
+    m_analyses.clear();
+    for (QueryRunner* runner : busy) {
+        runner->abort();
+    }
+
+    for (Entry& entry : m_entries) {
+        entry.extractedText.clear();
+        entry.structure.clear();
+        entry.cachedCleanedText.clear();
+    }
+}
+
+bool BulkAnalysisQueue::saveItem(const Entry& entry, const QString& status, const QString& error) const {
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("UPDATE bulk_items SET status = :status, pdf_path = :path, content_hash = :hash, "
+                  "error = :error, updated_at = :now "
+                  "WHERE library = :library AND collection_key = :collection AND item_key = :item");
+    query.bindValue(":status", status);
+    query.bindValue(":path", status == "downloaded" ? entry.pdfPath : QString());
+    query.bindValue(":hash", QString::fromLatin1(entry.contentHash.toHex()));
+    query.bindValue(":error", error);
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", m_collectionKey);
+    query.bindValue(":item", entry.itemKey);
+
+    if (!query.exec()) {
+        qDebug() << "BulkAnalysisQueue: failed to save item:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool BulkAnalysisQueue::saveResults(const Entry& entry, const QString& summary, const QString& keywords,
+                                    const QString& refinedKeywords) const {
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("UPDATE bulk_items SET status = 'done', pdf_path = NULL, error = NULL, "
+                  "summary = :summary, keywords = :keywords, refined_keywords = :refined, updated_at = :now "
+                  "WHERE library = :library AND collection_key = :collection AND item_key = :item");
+    query.bindValue(":summary", summary);
+    query.bindValue(":keywords", keywords);
+    query.bindValue(":refined", refinedKeywords);
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", m_collectionKey);
+    query.bindValue(":item", entry.itemKey);
+
+    if (!query.exec()) {
+        qDebug() << "BulkAnalysisQueue: failed to save results:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void BulkAnalysisQueue::appendResult(const Entry& entry, const QString& summary, const QString& keywords,
+                                     const QString& refinedKeywords) const {
+    QDir().mkpath(QFileInfo(resultsPath()).absolutePath());
+    QFile file(resultsPath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "BulkAnalysisQueue: cannot write" << file.fileName();
+        return;
+    }
+
+    QJsonObject record;
+    record["item_key"] = entry.itemKey;
+    record["title"] = entry.title;
+    record["collection"] = m_collectionName;
+    record["summary"] = summary;
+    record["keywords"] = keywords;
+    record["refined_keywords"] = refinedKeywords;
+    record["analyzed_at"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + "\n");
+}
+
+QString BulkAnalysisQueue::pdfPath(const Entry& entry) const {
+    return QDir(m_directory).absoluteFilePath(QString("%1_v%2.pdf")
+                                              .arg(entry.attachmentKey).arg(entry.attachmentVersion));
+}
+
+QString BulkAnalysisQueue::resultsPath() const {
+    return QDir(QCoreApplication::applicationDirPath())
+        .absoluteFilePath(QString("bulk_results/%1.jsonl").arg(m_collectionKey));
+}
+
+bool BulkAnalysisQueue::ensureTables() const {
+    if (m_tablesReady) {
+        return true;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    const char* const statements[] = {
+        "CREATE TABLE IF NOT EXISTS bulk_jobs ("
+        "library TEXT, collection_key TEXT, collection_name TEXT, created_at INTEGER, finished_at INTEGER, "
+        "PRIMARY KEY (library, collection_key))",
+        "CREATE TABLE IF NOT EXISTS bulk_items ("
+        "library TEXT, collection_key TEXT, item_key TEXT, title TEXT, attachment_key TEXT, "
+        "attachment_version INTEGER, position INTEGER, status TEXT, pdf_path TEXT, content_hash TEXT, "
+        "summary TEXT, keywords TEXT, refined_keywords TEXT, error TEXT, updated_at INTEGER, "
+        "PRIMARY KEY (library, collection_key, item_key))",
+    };
+    for (const char* sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "BulkAnalysisQueue: could not create tables:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    m_tablesReady = true;
+    return true;
+}
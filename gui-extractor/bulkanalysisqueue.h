@@ -0,0 +1,150 @@
+#ifndef BULKANALYSISQUEUE_H
+#define BULKANALYSISQUEUE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "structuredtext.h"
+#include "zoterocache.h"
+
+class QFile;
+class PdfExtractionJob;
+class QueryRunner;
+class ZoteroDownloader;
+
+// Analyzes every paper with a PDF in a Zotero collection. Items move through
+// three stages - download, extraction, LLM analysis - each with its own
+// concurrency limit, so the next PDFs are downloading and extracting while the
+// LLM works on the current one. Downloads are held a few items ahead of
+// extraction so a slow LLM doesn't fill the disk.
+//
+// Progress lives in bulk_jobs / bulk_items tables of the settings database
+// (like ResponseCache). An item is written when its download completes (path
+// and SHA-256, so a restart doesn't fetch it again) and when it finishes, with
+// the summary and keywords or the error. Extracted text is only kept in memory;
+// after a restart it comes back from the extraction cache, and LLM stages that
+// finished before the interruption come back from the runners' JobStore
+// checkpoints. Finished results are also appended to
+// bulk_results/<collection>.jsonl next to the executable.
+//
+// Main thread only.
+class BulkAnalysisQueue : public QObject {
+    Q_OBJECT
+
+public:
+    struct Limits {
+        int downloads = 3;
+        int extractions = 2;
+        int analyses = 1;   // Local LLM servers mostly handle one request at a time
+    };
+
+    struct JobSummary {
+        QString collectionKey;
+        QString collectionName;
+        int total = 0;
+        int remaining = 0;
+    };
+
+    explicit BulkAnalysisQueue(QObject *parent = nullptr);
+    ~BulkAnalysisQueue();
+
+    void setLibrary(const QString& userId, const QString& apiKey);
+    void setLimits(const Limits& limits);
+
+    // Queue every item with a PDF and start. Items already analyzed in an earlier
+    // run of this collection are kept unless their attachment changed; failed
+    // items are retried.
+    bool start(const QString& collectionKey, const QString& collectionName, const QList<ZoteroItem>& items);
+
+    // Continue a job interrupted by a stop or a crash
+    bool resume(const QString& collectionKey);
+    QList<JobSummary> unfinishedJobs() const;
+
+    // Stop scheduling and drop work in flight; it is redone on resume
+    void stop();
+
+    bool isRunning() const { return m_running; }
+    QString collectionName() const { return m_collectionName; }
+
+    static constexpr int DownloadAhead = 4;           // Downloaded PDFs waiting for extraction
+    static constexpr int MaxConsecutiveFailures = 3;  // Items failing in a row before giving up
+
+signals:
+    void statusMessage(const QString& message);
+    void itemFinished(const QString& itemKey, const QString& title, bool ok, const QString& error);
+    void progress(int done, int failed, int total);
+    void finished(int done, int failed, const QString& resultsPath);
+    void stopped(const QString& reason);
+
+private:
+    enum Stage { Pending, Downloading, Downloaded, Extracting, Extracted, Analyzing, Done, Failed };
+
+    struct Entry {
+        QString itemKey;
+        QString title;
+        QString attachmentKey;
+        qint64 attachmentVersion = 0;
+        Stage stage = Pending;
+        QString pdfPath;
+        QByteArray contentHash;
+        QString extractedText;
+        StructuredText structure;   // Shares its text with extractedText
+        QString cachedCleanedText;
+        QString cacheKey;
+    };
+
+    struct Download {
+        ZoteroDownloader* downloader = nullptr;
+        QFile* file = nullptr;
+    };
+
+    bool loadJob(const QString& collectionKey);
+    void prepareRunners();
+    void schedule();
+    int count(Stage stage) const;
+    int next(Stage stage) const;
+
+    void startDownload(int index);
+    void finishDownload(int index, bool ok, const QByteArray& sha256, const QString& error);
+    void startExtraction(int index);
+    void startAnalysis(int index);
+    void finishAnalysis(QueryRunner* runner, bool ok, const QString& error);
+
+    void failItem(int index, const QString& error);
+    void emitProgress();
+    void finishJob();
+    void abortAll();
+
+    bool saveItem(const Entry& entry, const QString& status, const QString& error = QString()) const;
+    bool saveResults(const Entry& entry, const QString& summary, const QString& keywords,
+                     const QString& refinedKeywords) const;
+    void appendResult(const Entry& entry, const QString& summary, const QString& keywords,
+                      const QString& refinedKeywords) const;
+    QString pdfPath(const Entry& entry) const;
+    QString resultsPath() const;
+    bool ensureTables() const;
+    QString libraryId() const { return "users/" + m_userId; }
+
+    QString m_userId;
+    QString m_apiKey;
+    Limits m_limits;
+    QString m_directory;
+
+    bool m_running;
+    QString m_collectionKey;
+    QString m_collectionName;
+    QVector<Entry> m_entries;
+    int m_consecutiveFailures;
+
+    QHash<int, Download> m_downloads;
+    QHash<int, PdfExtractionJob*> m_extractions;
+    QList<QueryRunner*> m_runners;           // One per concurrent analysis; the first also configures extraction
+    QHash<QueryRunner*, int> m_analyses;     // Busy runner -> entry index
+
+    mutable bool m_tablesReady;
+};
+
+#endif // BULKANALYSISQUEUE_H
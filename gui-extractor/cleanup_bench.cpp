@@ -0,0 +1,192 @@
+// Cleanup benchmark: checks that TextCleaner produces exactly the same output as the
+// old chained-regex cleanup and reports the speedup.
+//
+// Usage: cleanup_bench [iterations] [file.pdf ...]
+// Without files, every PDF in the current directory (the bundled paper*.pdf when run
+// from gui-extractor/) or next to the executable is used.
+// Exits with 1 if any output differs.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QPdfDocument>
+#include <QRegularExpression>
+#include <QStringList>
+#include <iostream>
+#include "textcleaner.h"
+
+namespace {
+
+// The cleanup QueryRunner used before TextCleaner, kept verbatim (minus truncation) as the reference
+QString legacyRemoveCopyrightNotices(const QString& text) {
+    QString result = text;
+
+    result.remove(QRegularExpression("Copyright.*\\n", QRegularExpression::CaseInsensitiveOption));
+    result.remove(QRegularExpression("©.*\\n"));
+    result.remove(QRegularExpression("All [Rr]ights [Rr]eserved.*\\n"));
+    result.remove(QRegularExpression("Licensed under.*\\n"));
+    result.remove(QRegularExpression("This .* is licensed.*\\n"));
+    result.remove(QRegularExpression("\\bLicense\\b.*\\n", QRegularExpression::CaseInsensitiveOption));
+
+    return result;
+}
+
+QString legacyCleanup(const QString& text, bool pastedText) {
+    QString cleaned = text;
+
+    cleaned.replace("\r\n", "\n");
+    cleaned.replace("\r", "\n");
+
+    cleaned = legacyRemoveCopyrightNotices(cleaned);
+
+    cleaned.remove(QChar(0x00AD));
+    cleaned.remove(QChar(0xFFFD));
+    cleaned.remove(QChar(0xFFF9));
+    cleaned.remove(QChar(0xFFFA));
+    cleaned.remove(QChar(0xFFFB));
+
+    cleaned.replace(QRegularExpression("\\n{3,}"), "\n\n");
+    cleaned.replace(QRegularExpression("[ \\t]+"), " ");
+
+    if (pastedText) {
+        cleaned.remove(QChar(0x200B));
+        cleaned.remove(QChar(0xFEFF));
+        cleaned.replace(QRegularExpression("[""„]"), "\"");
+        cleaned.replace(QRegularExpression("['']"), "'");
+    }
+
+    return cleaned.trimmed();
+}
+
+// Inputs that exercise the awkward corners of the old rules
+QStringList edgeCases() {
+    return {
+        "",
+        "   \n\n\n  ",
+        "Line one\r\nLine two\rLine three\r\r\nend",
+        "Intro text Copyright 2021 Foo\nnext line\nlast",
+        "keep © gone\nThis joins © and this goes\nthen License here\nend",
+        "This paper\nis licensed under CC-BY\nThis work is licensed under MIT\nafter",
+        "All rights reserved.\nAll Rights Reserved\nall rights reserved stays\n",
+        "Licensed under Apache\nlicensed under stays\nLicenses stay\nunlicensed stays\n_License stays\nLICENSE goes\n",
+        "no newline at the end Copyright",
+        QStringLiteral("soft\u00ADhyphen  and\t\ttabs \u00AD  collapse\n\n\n\n\nparagraph"),
+        QStringLiteral("zero\u200B width \u200B space \uFEFF and \u201Equotes\u201C 'single'"),
+        QStringLiteral("Copy\u00ADright survives the rule\nCopyright\n\n\nLicense\n"),
+        "mixed\r\n\r\n\r\n\r\nblank\t \t lines\n \n \n",
+    };
+}
+
+QStringList defaultPdfs() {
+    QStringList files;
+    const QStringList dirs = { QDir::currentPath(), QCoreApplication::applicationDirPath() };
+    for (const QString& dirPath : dirs) {
+        QDir dir(dirPath);
+        for (const QString& name : dir.entryList(QStringList() << "*.pdf", QDir::Files, QDir::Name)) {
+            QString path = dir.absoluteFilePath(name);
+            if (!files.contains(path)) {
+                files << path;
+            }
+        }
+    }
+    return files;
+}
+
+QString extractPdf(const QString& path) {
+    QPdfDocument doc;
+    if (doc.load(path) != QPdfDocument::Error::None) {
+        return QString();
+    }
+    QString text;
+    for (int i = 0; i < doc.pageCount(); ++i) {
+        text += doc.getAllText(i).text();
+        text += "\n\n";
+    }
+    return text;
+}
+
+bool checkParity(const QString& name, const QString& text) {
+    bool ok = true;
+    for (bool pasted : {false, true}) {
+        const QString expected = legacyCleanup(text, pasted);
+        const QString actual = TextCleaner::clean(text, pasted ? TextCleaner::PastedText : TextCleaner::PdfText);
+        if (expected != actual) {
+            qsizetype at = 0;
+            while (at < expected.size() && at < actual.size() && expected[at] == actual[at]) {
+                ++at;
+            }
+            std::cout << "MISMATCH " << name.toStdString() << (pasted ? " (pasted)" : " (pdf)")
+                      << " at char " << at << "\n  expected: "
+                      << expected.mid(qMax<qsizetype>(0, at - 20), 60).toStdString()
+                      << "\n  actual:   " << actual.mid(qMax<qsizetype>(0, at - 20), 60).toStdString() << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments().mid(1);
+    int iterations = 20;
+    if (!args.isEmpty() && args.first().toInt() > 0) {
+        iterations = args.takeFirst().toInt();
+    }
+    const QStringList pdfs = args.isEmpty() ? defaultPdfs() : args;
+
+    bool allOk = true;
+
+    const QStringList cases = edgeCases();
+    for (int i = 0; i < cases.size(); ++i) {
+        allOk &= checkParity(QString("edge case %1").arg(i + 1), cases[i]);
+    }
+    std::cout << "Edge cases: " << cases.size() << (allOk ? " identical" : " with mismatches") << std::endl;
+
+    std::cout << "\nFile                              Chars   Legacy ms    New ms   Speedup" << std::endl;
+    qint64 totalLegacy = 0;
+    qint64 totalNew = 0;
+    for (const QString& path : pdfs) {
+        const QString text = extractPdf(path);
+        const QString name = QFileInfo(path).fileName();
+        if (text.isEmpty()) {
+            std::cout << name.toStdString() << ": no text extracted, skipped" << std::endl;
+            continue;
+        }
+
+        allOk &= checkParity(name, text);
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; ++i) {
+            legacyCleanup(text, false);
+        }
+        const qint64 legacyNs = timer.nsecsElapsed();
+
+        timer.restart();
+        for (int i = 0; i < iterations; ++i) {
+            TextCleaner::clean(text, TextCleaner::PdfText);
+        }
+        const qint64 newNs = timer.nsecsElapsed();
+
+        totalLegacy += legacyNs;
+        totalNew += newNs;
+        std::cout << QString("%1 %2 %3 %4 %5x")
+                         .arg(name.left(30), -30)
+                         .arg(text.size(), 9)
+                         .arg(legacyNs / 1e6 / iterations, 11, 'f', 3)
+                         .arg(newNs / 1e6 / iterations, 9, 'f', 3)
+                         .arg(newNs > 0 ? double(legacyNs) / newNs : 0.0, 8, 'f', 1)
+                         .toStdString() << std::endl;
+    }
+
+    if (totalNew > 0) {
+        std::cout << "\nOverall speedup: " << QString::number(double(totalLegacy) / totalNew, 'f', 1).toStdString()
+                  << "x over " << iterations << " iterations per file" << std::endl;
+    }
+    std::cout << (allOk ? "Output parity: OK" : "Output parity: FAILED") << std::endl;
+    return allOk ? 0 : 1;
+}
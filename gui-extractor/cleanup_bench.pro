@@ -0,0 +1,20 @@
+# Text cleanup benchmark - checks TextCleaner against the old regex cleanup
+# Build: qmake cleanup_bench.pro && make
+# Run from this directory to use the bundled paper*.pdf files
+
+QT += core pdf
+QT -= gui
+CONFIG += c++17 console release
+CONFIG -= app_bundle
+
+TARGET = cleanup_bench
+
+SOURCES += cleanup_bench.cpp \
+    textcleaner.cpp
+
+HEADERS += textcleaner.h
+
+DESTDIR = build/bench
+OBJECTS_DIR = $$DESTDIR/obj
+MOC_DIR = $$DESTDIR/moc
+QMAKE_CXXFLAGS_RELEASE += -O2
@@ -0,0 +1,182 @@
+#include "extractioncache.h"
+#include "structuredtext.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace {
+const quint32 CacheMagic = 0x50444643;  // "PDFC"
+const quint32 CacheVersion = 2;  // 2: page/line layout after the cleaned text
+const char* const CacheSuffix = ".cache";
+}
+
+ExtractionCache::ExtractionCache(const QString& directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+    , m_hits(0)
+    , m_misses(0)
+{
+    if (m_directory.isEmpty()) {
+        m_directory = QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("extraction_cache");
+    }
+    QDir().mkpath(m_directory);
+}
+
+QString ExtractionCache::makeKey(const QString& filePath, int firstPage, int lastPage, const QString& cleanupOptions) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    // Hash the contents, not the path - Zotero downloads land in a new temp file every time
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        return QString();
+    }
+    file.close();
+
+    return makeKeyForHash(hash.result(), firstPage, lastPage, cleanupOptions);
+}
+
+QString ExtractionCache::makeKey(const QByteArray& contents, int firstPage, int lastPage, const QString& cleanupOptions) {
+    if (contents.isEmpty()) {
+        return QString();
+    }
+
+    return makeKeyForHash(QCryptographicHash::hash(contents, QCryptographicHash::Sha256),
+                          firstPage, lastPage, cleanupOptions);
+}
+
+QString ExtractionCache::makeKeyForHash(const QByteArray& contentSha256, int firstPage, int lastPage,
+                                        const QString& cleanupOptions) {
+    if (contentSha256.isEmpty()) {
+        return QString();
+    }
+
+    // Keyed on the content digest rather than the contents, so a hash computed while
+    // downloading gives the same key without reading the file again
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(contentSha256);
+    hash.addData(QString("|pages=%1-%2|%3").arg(firstPage).arg(lastPage).arg(cleanupOptions).toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool ExtractionCache::lookup(const QString& key, QString& extractedText, QString& cleanedText,
+                             StructuredText* structure) {
+    if (key.isEmpty()) {
+        m_misses++;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QFile file(entryPath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_misses++;
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (magic != CacheMagic || version != CacheVersion) {
+        // Stale or foreign file - drop it
+        file.close();
+        file.remove();
+        m_misses++;
+        return false;
+    }
+
+    QByteArray layout;
+    in >> extractedText >> cleanedText >> layout;
+    file.close();
+
+    if (in.status() != QDataStream::Ok || extractedText.isEmpty()) {
+        QFile::remove(entryPath(key));
+        extractedText.clear();
+        cleanedText.clear();
+        m_misses++;
+        return false;
+    }
+
+    if (structure) {
+        *structure = StructuredText::fromLayout(extractedText, layout);
+    }
+
+    // Bump modification time so eviction is least-recently-used, not least-recently-written
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        file.close();
+    }
+
+    m_hits++;
+    return true;
+}
+
+void ExtractionCache::store(const QString& key, const QString& extractedText, const QString& cleanedText,
+                            const StructuredText* structure) {
+    if (key.isEmpty() || extractedText.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // QSaveFile writes to a temp file and renames, so a crash never leaves a torn entry
+    QSaveFile file(entryPath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "ExtractionCache: cannot write entry" << entryPath(key);
+        return;
+    }
+
+    QDataStream out(&file);
+    const bool hasLayout = structure && !structure->isEmpty() && structure->text() == extractedText;
+    out << CacheMagic << CacheVersion << extractedText << cleanedText
+        << (hasLayout ? structure->layout() : QByteArray());
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qDebug() << "ExtractionCache: failed to commit entry" << key;
+        return;
+    }
+
+    evictToFit();
+}
+
+qint64 ExtractionCache::sizeOnDisk() const {
+    qint64 total = 0;
+    const QFileInfoList entries = QDir(m_directory).entryInfoList(
+        QStringList() << QString("*%1").arg(CacheSuffix), QDir::Files);
+    for (const QFileInfo& info : entries) {
+        total += info.size();
+    }
+    return total;
+}
+
+QString ExtractionCache::entryPath(const QString& key) const {
+    return QDir(m_directory).absoluteFilePath(key + CacheSuffix);
+}
+
+void ExtractionCache::evictToFit() {
+    // Oldest first
+    QFileInfoList entries = QDir(m_directory).entryInfoList(
+        QStringList() << QString("*%1").arg(CacheSuffix), QDir::Files, QDir::Time | QDir::Reversed);
+
+    qint64 total = 0;
+    for (const QFileInfo& info : entries) {
+        total += info.size();
+    }
+
+    for (const QFileInfo& info : entries) {
+        if (total <= m_maxBytes.load()) {
+            break;
+        }
+        if (QFile::remove(info.absoluteFilePath())) {
+            total -= info.size();
+            qDebug() << "ExtractionCache: evicted" << info.fileName();
+        }
+    }
+}
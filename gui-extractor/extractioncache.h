@@ -0,0 +1,62 @@
+#ifndef EXTRACTIONCACHE_H
+#define EXTRACTIONCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QMutex>
+#include <atomic>
+
+class StructuredText;
+
+// Persistent, content-addressed cache of extracted (and cleaned) PDF text.
+// Entries are keyed by the SHA-256 of the file contents plus the page range and
+// cleanup options, so the same Zotero attachment analyzed with different prompts
+// skips QPdfDocument entirely. Total size is bounded with LRU eviction
+// (file modification time is bumped on every hit). lookup() and store() may be
+// called from any thread.
+class ExtractionCache {
+public:
+    explicit ExtractionCache(const QString& directory = QString(), qint64 maxBytes = DefaultMaxBytes);
+
+    // Build a cache key for a file. Returns an empty string if the file can't be read.
+    static QString makeKey(const QString& filePath, int firstPage, int lastPage, const QString& cleanupOptions);
+
+    // Same key from contents already in memory (e.g. MappedPdfFile::bytes()), without rereading the file
+    static QString makeKey(const QByteArray& contents, int firstPage, int lastPage, const QString& cleanupOptions);
+
+    // Same key from the raw SHA-256 of the contents (e.g. ZoteroDownloader's on-the-fly hash)
+    static QString makeKeyForHash(const QByteArray& contentSha256, int firstPage, int lastPage,
+                                  const QString& cleanupOptions);
+
+    // Look up an entry. cleanedText is empty if only the raw extraction was stored;
+    // structure (if given) is empty if the entry was stored without one.
+    bool lookup(const QString& key, QString& extractedText, QString& cleanedText,
+                StructuredText* structure = nullptr);
+
+    // Store or replace an entry, then evict least recently used entries over the size limit.
+    // structure, if not empty, must describe extractedText; only its layout is written.
+    void store(const QString& key, const QString& extractedText, const QString& cleanedText = QString(),
+               const StructuredText* structure = nullptr);
+
+    void setMaxBytes(qint64 maxBytes) { m_maxBytes.store(maxBytes); }
+    qint64 maxBytes() const { return m_maxBytes.load(); }
+
+    // Statistics
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+    qint64 sizeOnDisk() const;
+
+    static constexpr qint64 DefaultMaxBytes = 512LL * 1024 * 1024;  // 512MB
+
+private:
+    QString entryPath(const QString& key) const;
+    void evictToFit();
+
+    QString m_directory;
+    std::atomic<qint64> m_maxBytes;
+    std::atomic<int> m_hits;
+    std::atomic<int> m_misses;
+    QMutex m_mutex;  // Serializes entry reads/writes and eviction
+};
+
+#endif // EXTRACTIONCACHE_H
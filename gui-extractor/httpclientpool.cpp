@@ -0,0 +1,151 @@
+#include "httpclientpool.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkCookieJar>
+#include <QNetworkRequest>
+#include <memory>
+
+namespace {
+// Nothing we talk to needs cookies - never keep any between requests
+class DiscardingCookieJar : public QNetworkCookieJar {
+public:
+    using QNetworkCookieJar::QNetworkCookieJar;
+    bool setCookiesFromUrl(const QList<QNetworkCookie>&, const QUrl&) override { return false; }
+};
+}
+
+HttpClientPool::HttpClientPool(QObject* parent)
+    : QObject(parent)
+{
+}
+
+HttpClientPool* HttpClientPool::instance() {
+    // Parented to the application so managers go away before QCoreApplication does
+    static HttpClientPool* pool = new HttpClientPool(QCoreApplication::instance());
+    return pool;
+}
+
+QString HttpClientPool::endpointKey(const QUrl& url) {
+    int defaultPort = url.scheme() == "https" ? 443 : 80;
+    return QString("%1://%2:%3").arg(url.scheme(), url.host().toLower()).arg(url.port(defaultPort));
+}
+
+HttpClientPool::Endpoint& HttpClientPool::endpointFor(const QString& key) {
+    Endpoint& endpoint = m_endpoints[key];
+    if (!endpoint.manager) {
+        endpoint.manager = new QNetworkAccessManager(this);
+        endpoint.manager->setCookieJar(new DiscardingCookieJar(endpoint.manager));
+        qDebug() << "HttpClientPool: created client for" << key;
+    }
+    return endpoint;
+}
+
+QNetworkReply* HttpClientPool::get(const QNetworkRequest& request) {
+    QString key = endpointKey(request.url());
+    resetIfIdle(key);
+    return track(key, endpointFor(key).manager->get(request));
+}
+
+QNetworkReply* HttpClientPool::post(const QNetworkRequest& request, const QByteArray& data) {
+    QString key = endpointKey(request.url());
+    resetIfIdle(key);
+    return track(key, endpointFor(key).manager->post(request, data));
+}
+
+QNetworkReply* HttpClientPool::track(const QString& key, QNetworkReply* reply) {
+    if (!reply) {
+        return nullptr;
+    }
+
+    Endpoint& endpoint = endpointFor(key);
+    endpoint.stats.requests++;
+    endpoint.inFlight++;
+
+    // socketStartedConnecting only fires when no kept-alive socket was available
+    auto openedSocket = std::make_shared<bool>(false);
+    connect(reply, &QNetworkReply::socketStartedConnecting, this, [openedSocket]() {
+        *openedSocket = true;
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, key, reply, openedSocket]() {
+        Endpoint& endpoint = m_endpoints[key];
+        endpoint.inFlight = qMax(0, endpoint.inFlight - 1);
+
+        if (*openedSocket) {
+            endpoint.stats.newConnections++;
+        } else {
+            endpoint.stats.reusedConnections++;
+        }
+
+        QNetworkReply::NetworkError error = reply->error();
+        if (isTransportError(error)) {
+            endpoint.stats.failures++;
+            markUnhealthy(key);
+        } else if (error == QNetworkReply::OperationCanceledError) {
+            // Aborted mid-request: the server may still be writing to that socket
+            markUnhealthy(key);
+        }
+
+        resetIfIdle(key);
+    });
+
+    return reply;
+}
+
+void HttpClientPool::reportFailure(const QUrl& url) {
+    QString key = endpointKey(url);
+    endpointFor(key).stats.failures++;
+    markUnhealthy(key);
+}
+
+void HttpClientPool::markUnhealthy(const QString& key) {
+    m_endpoints[key].needsReset = true;
+}
+
+void HttpClientPool::resetIfIdle(const QString& key) {
+    auto it = m_endpoints.find(key);
+    if (it == m_endpoints.end() || !it->needsReset || it->inFlight > 0 || !it->manager) {
+        return;
+    }
+
+    // Drop idle sockets only; other requests on this endpoint are never interrupted
+    it->manager->clearConnectionCache();
+    it->needsReset = false;
+    it->stats.resets++;
+    qDebug() << "HttpClientPool: dropped idle connections for" << key;
+    emit endpointReset(key);
+}
+
+bool HttpClientPool::isTransportError(QNetworkReply::NetworkError error) {
+    switch (error) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::SslHandshakeFailedError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::UnknownNetworkError:
+        case QNetworkReply::ProxyConnectionClosedError:
+        case QNetworkReply::ProxyTimeoutError:
+            return true;
+        default:
+            return false;
+    }
+}
+
+HttpClientPool::EndpointStats HttpClientPool::stats(const QUrl& url) const {
+    return m_endpoints.value(endpointKey(url)).stats;
+}
+
+QString HttpClientPool::statsSummary(const QUrl& url) const {
+    EndpointStats s = stats(url);
+    return QString("%1: %2 requests, %3 reused, %4 new connections, %5 failures, %6 resets")
+        .arg(endpointKey(url))
+        .arg(s.requests)
+        .arg(s.reusedConnections)
+        .arg(s.newConnections)
+        .arg(s.failures)
+        .arg(s.resets);
+}
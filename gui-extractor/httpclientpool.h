@@ -0,0 +1,67 @@
+#ifndef HTTPCLIENTPOOL_H
+#define HTTPCLIENTPOOL_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QUrl>
+#include <QNetworkReply>
+
+class QNetworkAccessManager;
+class QNetworkRequest;
+
+// Shared HTTP clients, one QNetworkAccessManager per endpoint (scheme://host:port).
+// Connections are kept alive and reused across requests instead of paying a new
+// TCP/TLS handshake per stage. When a request fails at the transport level, is
+// aborted or times out, the endpoint is marked unhealthy and its idle connections
+// are dropped once nothing is in flight, so a wedged socket is never reused.
+//
+// Main thread only - QNetworkAccessManager has thread affinity.
+class HttpClientPool : public QObject {
+    Q_OBJECT
+
+public:
+    struct EndpointStats {
+        int requests = 0;
+        int newConnections = 0;     // Requests that had to open a socket
+        int reusedConnections = 0;  // Requests served on a kept-alive socket
+        int failures = 0;
+        int resets = 0;             // Times idle connections were dropped
+    };
+
+    static HttpClientPool* instance();
+
+    QNetworkReply* get(const QNetworkRequest& request);
+    QNetworkReply* post(const QNetworkRequest& request, const QByteArray& data);
+
+    // For failures the pool can't see itself (e.g. caller-side timeouts)
+    void reportFailure(const QUrl& url);
+
+    EndpointStats stats(const QUrl& url) const;
+    QString statsSummary(const QUrl& url) const;
+
+    static QString endpointKey(const QUrl& url);
+
+signals:
+    void endpointReset(const QString& endpoint);
+
+private:
+    struct Endpoint {
+        QNetworkAccessManager* manager = nullptr;
+        EndpointStats stats;
+        int inFlight = 0;
+        bool needsReset = false;
+    };
+
+    explicit HttpClientPool(QObject* parent = nullptr);
+
+    Endpoint& endpointFor(const QString& key);
+    QNetworkReply* track(const QString& key, QNetworkReply* reply);
+    void markUnhealthy(const QString& key);
+    void resetIfIdle(const QString& key);
+    static bool isTransportError(QNetworkReply::NetworkError error);
+
+    QHash<QString, Endpoint> m_endpoints;
+};
+
+#endif // HTTPCLIENTPOOL_H
@@ -0,0 +1,175 @@
+#include "jobstore.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+JobStore::JobStore()
+    : m_bypass(false)
+    , m_tablesReady(false)
+{
+}
+
+QString JobStore::makeKey(const QStringList& fields) {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    // Length-prefix each field so "ab"+"c" and "a"+"bc" hash differently
+    for (const QString& field : fields) {
+        QByteArray bytes = field.toUtf8();
+        hash.addData(QByteArray::number(bytes.size()) + ':');
+        hash.addData(bytes);
+    }
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool JobStore::begin(const QString& key, const QString& inputType) {
+    if (key.isEmpty() || !ensureTables()) {
+        return false;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("INSERT INTO pipeline_jobs (job_key, input_type, status, created_at, updated_at) "
+                  "VALUES (:key, :type, 'running', :now, :now) "
+                  "ON CONFLICT (job_key) DO UPDATE SET status = 'running', updated_at = excluded.updated_at");
+    query.bindValue(":key", key);
+    query.bindValue(":type", inputType);
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+
+    if (!query.exec()) {
+        qDebug() << "JobStore: failed to start job:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QMap<QString, QString> JobStore::checkpoints(const QString& key) const {
+    QMap<QString, QString> stages;
+    if (m_bypass || key.isEmpty() || !ensureTables()) {
+        return stages;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT stage, result FROM pipeline_stages WHERE job_key = :key");
+    query.bindValue(":key", key);
+    if (!query.exec()) {
+        qDebug() << "JobStore: failed to load checkpoints:" << query.lastError().text();
+        return stages;
+    }
+
+    while (query.next()) {
+        stages.insert(query.value("stage").toString(), query.value("result").toString());
+    }
+    return stages;
+}
+
+void JobStore::saveStage(const QString& key, const QString& stage, const QString& result) {
+    if (key.isEmpty() || !ensureTables()) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("INSERT OR REPLACE INTO pipeline_stages (job_key, stage, result, finished_at) "
+                  "VALUES (:key, :stage, :result, :now)");
+    query.bindValue(":key", key);
+    query.bindValue(":stage", stage);
+    query.bindValue(":result", result);
+    query.bindValue(":now", now);
+    if (!query.exec()) {
+        qDebug() << "JobStore: failed to save stage" << stage << ":" << query.lastError().text();
+        return;
+    }
+
+    query.prepare("UPDATE pipeline_jobs SET updated_at = :now WHERE job_key = :key");
+    query.bindValue(":now", now);
+    query.bindValue(":key", key);
+    query.exec();
+}
+
+void JobStore::markInterrupted(const QString& key) {
+    setStatus(key, "interrupted");
+}
+
+void JobStore::remove(const QString& key) {
+    if (key.isEmpty() || !ensureTables()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("DELETE FROM pipeline_stages WHERE job_key = :key");
+    query.bindValue(":key", key);
+    bool ok = query.exec();
+    query.prepare("DELETE FROM pipeline_jobs WHERE job_key = :key");
+    query.bindValue(":key", key);
+    ok = query.exec() && ok;
+
+    if (!ok) {
+        qDebug() << "JobStore: failed to remove job:" << query.lastError().text();
+    }
+}
+
+void JobStore::purgeExpired() {
+    if (!ensureTables()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("DELETE FROM pipeline_stages WHERE job_key IN "
+                  "(SELECT job_key FROM pipeline_jobs WHERE updated_at < :cutoff)");
+    query.bindValue(":cutoff", QDateTime::currentSecsSinceEpoch() - RetentionSeconds);
+    bool ok = query.exec();
+    query.prepare("DELETE FROM pipeline_jobs WHERE updated_at < :cutoff");
+    query.bindValue(":cutoff", QDateTime::currentSecsSinceEpoch() - RetentionSeconds);
+    ok = query.exec() && ok;
+
+    if (!ok) {
+        qDebug() << "JobStore: failed to purge expired jobs:" << query.lastError().text();
+    }
+}
+
+void JobStore::setStatus(const QString& key, const QString& status) {
+    if (key.isEmpty() || !ensureTables()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("UPDATE pipeline_jobs SET status = :status, updated_at = :now WHERE job_key = :key");
+    query.bindValue(":status", status);
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":key", key);
+    if (!query.exec()) {
+        qDebug() << "JobStore: failed to update job:" << query.lastError().text();
+    }
+}
+
+bool JobStore::ensureTables() const {
+    if (m_tablesReady) {
+        return true;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    const char* const statements[] = {
+        "CREATE TABLE IF NOT EXISTS pipeline_jobs ("
+        "job_key TEXT PRIMARY KEY, input_type TEXT, status TEXT, created_at INTEGER, updated_at INTEGER)",
+        "CREATE TABLE IF NOT EXISTS pipeline_stages ("
+        "job_key TEXT, stage TEXT, result TEXT, finished_at INTEGER, "
+        "PRIMARY KEY (job_key, stage))",
+    };
+    for (const char* sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "JobStore: could not create tables:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    m_tablesReady = true;
+    return true;
+}
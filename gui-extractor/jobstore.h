@@ -0,0 +1,54 @@
+#ifndef JOBSTORE_H
+#define JOBSTORE_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+// Checkpoints of a pipeline run, stored in the pipeline_jobs / pipeline_stages
+// tables of the settings database (like ResponseCache). A job is keyed by a hash
+// of everything that determines the LLM stages' output: the text sent to the
+// model and the model, prompt and budget settings. Each stage's result is saved
+// as soon as the stage finishes; a run that is aborted, fails or crashes leaves
+// its job behind, and the next run with the same key picks up the finished
+// stages instead of querying the model again. A completed run deletes its job.
+//
+// Unlike the response cache this is always on: it only ever replays results of
+// a run that didn't finish. Jobs untouched for RetentionSeconds are purged.
+//
+// Main thread only (uses the default database connection).
+class JobStore {
+public:
+    JobStore();
+
+    // Ignore saved stages for the next runs but keep saving new ones
+    void setBypass(bool bypass) { m_bypass = bypass; }
+    bool isBypassed() const { return m_bypass; }
+
+    static QString makeKey(const QStringList& fields);
+
+    // Create the job, or touch it if it already exists. Returns false if the database is unavailable.
+    bool begin(const QString& key, const QString& inputType);
+
+    // Stage name -> result saved by an earlier run; empty when bypassed
+    QMap<QString, QString> checkpoints(const QString& key) const;
+    void saveStage(const QString& key, const QString& stage, const QString& result);
+
+    // Run ended without completing; its stages stay available for the next run
+    void markInterrupted(const QString& key);
+    // Run completed; nothing left to resume
+    void remove(const QString& key);
+
+    void purgeExpired();
+
+    static constexpr qint64 RetentionSeconds = 14 * 24 * 60 * 60;  // Two weeks
+
+private:
+    bool ensureTables() const;
+    void setStatus(const QString& key, const QString& status);
+
+    bool m_bypass;
+    mutable bool m_tablesReady;
+};
+
+#endif // JOBSTORE_H
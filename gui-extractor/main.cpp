@@ -7,6 +7,7 @@
 #include <QGridLayout>
 #include <QPushButton>
 #include <QTextEdit>
+#include <QTextCursor>
 #include <QPlainTextEdit>
 #include <QLineEdit>
 #include <QComboBox>
@@ -60,8 +61,10 @@
 #include <dbghelp.h>
 #endif
 #include "queryrunner.h"
+#include "sectionsegmenter.h"
 #include "modellistfetcher.h"
 #include "zoteroinput.h"
+#include "asynclogger.h"
 #include <QFileInfo>
 #include <exception>
 #include <stdexcept>
@@ -143,20 +146,43 @@ struct DefaultSettings {
 
     // Text processing defaults
     static constexpr int TEXT_TRUNCATION_LIMIT = 100000;  // 100k characters
+    static constexpr int EXTRACTION_WORKERS = 0;  // 0 = one worker per CPU core
+    static constexpr int EXTRACTION_CACHE_MB = 512;  // On-disk extracted text cache
+
+    // LLM response cache defaults (opt-in)
+    static constexpr bool RESPONSE_CACHE_ENABLED = false;
+    static constexpr int RESPONSE_CACHE_TTL_HOURS = 168;  // One week
+
+    // Streaming defaults
+    static constexpr bool STREAMING_ENABLED = true;
+    static constexpr int STREAM_INACTIVITY_TIMEOUT = 120000;  // 2 minutes without tokens
+
+    // Pipeline defaults
+    static constexpr int MAX_CONCURRENT_REQUESTS = 1;  // 1 = stages run one after another
+    static constexpr bool SERVER_TOKENIZER_ENABLED = false;  // Local token estimates only
+    static constexpr int CONTEXT_WINDOW = TokenBudget::DefaultContextWindow;
+    static constexpr SectionSegmenter::Kinds EXCLUDED_SECTIONS = SectionSegmenter::DefaultExcluded;
+
+    // Logging defaults (log files are written by a background thread)
+    static constexpr const char* LOG_LEVEL = "debug";  // debug = full prompts and transcripts
+    static constexpr int LOG_FLUSH_INTERVAL = 200;  // ms between batched writes
 
     // Summary defaults
     static constexpr double SUMMARY_TEMPERATURE = 0.8;
-    static constexpr int SUMMARY_CONTEXT_LENGTH = 16000;  // 16k context
+    static constexpr int SUMMARY_CONTEXT_LENGTH = 16000;  // max_tokens
     static constexpr int SUMMARY_TIMEOUT = 1800000;  // 30 minutes
+    static constexpr bool SUMMARY_CHUNKING_ENABLED = false;
+    static constexpr int SUMMARY_CHUNK_TOKENS = 6000;
+    static constexpr int SUMMARY_CHUNK_OVERLAP = 200;  // Tokens shared between neighbouring chunks
 
     // Keyword defaults
     static constexpr double KEYWORD_TEMPERATURE = 0.8;
-    static constexpr int KEYWORD_CONTEXT_LENGTH = 16000;  // 16k context
+    static constexpr int KEYWORD_CONTEXT_LENGTH = 16000;  // max_tokens
     static constexpr int KEYWORD_TIMEOUT = 1800000;  // 30 minutes
 
     // Refinement defaults
     static constexpr double REFINEMENT_TEMPERATURE = 0.8;
-    static constexpr int REFINEMENT_CONTEXT_LENGTH = 16000;  // 16k context
+    static constexpr int REFINEMENT_CONTEXT_LENGTH = 16000;  // max_tokens
     static constexpr int REFINEMENT_TIMEOUT = 1800000;  // 30 minutes
 
     // Default prompts are defined in the functions below
@@ -300,6 +326,102 @@ private:
         m_overallTimeoutEdit->setValue(DefaultSettings::OVERALL_TIMEOUT);
         formLayout->addRow("Overall Timeout:", m_overallTimeoutEdit);
 
+        // Response cache
+        auto *cacheLayout = new QHBoxLayout();
+        m_responseCacheCheckBox = new QCheckBox("Reuse identical responses");
+        m_responseCacheCheckBox->setToolTip("Skip the LLM call when model, prompts, temperature and max tokens are unchanged");
+        cacheLayout->addWidget(m_responseCacheCheckBox);
+
+        cacheLayout->addWidget(new QLabel("Expire after:"));
+        m_responseCacheTtlEdit = new QSpinBox();
+        m_responseCacheTtlEdit->setRange(1, 24 * 365);
+        m_responseCacheTtlEdit->setSuffix(" h");
+        m_responseCacheTtlEdit->setValue(DefaultSettings::RESPONSE_CACHE_TTL_HOURS);
+        cacheLayout->addWidget(m_responseCacheTtlEdit);
+
+        auto *clearCacheButton = new QPushButton("Clear");
+        clearCacheButton->setToolTip("Delete all cached responses");
+        connect(clearCacheButton, &QPushButton::clicked, this, [this]() {
+            ResponseCache cache;
+            cache.clear();
+            qDebug() << "Response cache cleared";
+        });
+        cacheLayout->addWidget(clearCacheButton);
+        cacheLayout->addStretch();
+
+        formLayout->addRow("Response Cache:", cacheLayout);
+
+        // Streaming
+        auto *streamLayout = new QHBoxLayout();
+        m_streamingCheckBox = new QCheckBox("Stream tokens as they are generated");
+        m_streamingCheckBox->setToolTip("Show results while the model is still writing them");
+        streamLayout->addWidget(m_streamingCheckBox);
+
+        streamLayout->addWidget(new QLabel("Inactivity timeout:"));
+        m_streamInactivityTimeoutEdit = new QSpinBox();
+        m_streamInactivityTimeoutEdit->setRange(5000, INT_MAX);
+        m_streamInactivityTimeoutEdit->setSingleStep(5000);
+        m_streamInactivityTimeoutEdit->setSuffix(" ms");
+        m_streamInactivityTimeoutEdit->setValue(DefaultSettings::STREAM_INACTIVITY_TIMEOUT);
+        m_streamInactivityTimeoutEdit->setToolTip("Once streaming starts, abort only if no data arrives for this long");
+        streamLayout->addWidget(m_streamInactivityTimeoutEdit);
+        streamLayout->addStretch();
+
+        formLayout->addRow("Streaming:", streamLayout);
+
+        m_maxConcurrentRequestsEdit = new QSpinBox();
+        m_maxConcurrentRequestsEdit->setRange(1, 8);
+        m_maxConcurrentRequestsEdit->setValue(DefaultSettings::MAX_CONCURRENT_REQUESTS);
+        m_maxConcurrentRequestsEdit->setToolTip("Stages that don't need each other's results (e.g. keywords when the "
+                                                "keyword prompt has no {summary_result}) run in parallel. "
+                                                "Only useful if the server processes requests concurrently.");
+        formLayout->addRow("Parallel Requests:", m_maxConcurrentRequestsEdit);
+
+        m_serverTokenizerCheckBox = new QCheckBox("Calibrate token counts with the server's tokenizer");
+        m_serverTokenizerCheckBox->setToolTip("Prompts are fitted to each stage's context by a local token estimate. "
+                                              "If the server has a llama.cpp-style /tokenize endpoint, measure "
+                                              "the model's real tokenizer once and correct the estimate.");
+        formLayout->addRow("Token Counting:", m_serverTokenizerCheckBox);
+
+        m_contextWindowEdit = new QSpinBox();
+        m_contextWindowEdit->setRange(2048, 1048576);
+        m_contextWindowEdit->setSingleStep(4096);
+        m_contextWindowEdit->setSuffix(" tokens");
+        m_contextWindowEdit->setValue(DefaultSettings::CONTEXT_WINDOW);
+        m_contextWindowEdit->setToolTip("The model's context length as loaded on the server. Documents are trimmed "
+                                        "so each stage's prompt plus its maximum response fits.");
+        formLayout->addRow("Context Window:", m_contextWindowEdit);
+
+        auto *sectionsLayout = new QGridLayout();
+        for (int k = 0; k < SectionSegmenter::KindCount; ++k) {
+            auto *checkBox = new QCheckBox(SectionSegmenter::displayName(static_cast<SectionSegmenter::Kind>(k)));
+            checkBox->setToolTip("Unchecked sections are left out of the prompts when the paper's "
+                                 "section headings are recognized. Without headings the whole text is sent.");
+            sectionsLayout->addWidget(checkBox, k / 5, k % 5);
+            m_sectionCheckBoxes.append(checkBox);
+        }
+        formLayout->addRow("Send Sections:", sectionsLayout);
+
+        // Log files
+        auto *logLayout = new QHBoxLayout();
+        m_logLevelComboBox = new QComboBox();
+        m_logLevelComboBox->addItems({"debug", "info", "warning", "error", "off"});
+        m_logLevelComboBox->setCurrentText(DefaultSettings::LOG_LEVEL);
+        m_logLevelComboBox->setToolTip("debug writes full prompts and responses to lastrun.log and transcript.log; "
+                                       "info keeps only abort traces and Zotero activity");
+        logLayout->addWidget(m_logLevelComboBox);
+
+        logLayout->addWidget(new QLabel("Flush every:"));
+        m_logFlushIntervalEdit = new QSpinBox();
+        m_logFlushIntervalEdit->setRange(10, 10000);
+        m_logFlushIntervalEdit->setSingleStep(50);
+        m_logFlushIntervalEdit->setSuffix(" ms");
+        m_logFlushIntervalEdit->setValue(DefaultSettings::LOG_FLUSH_INTERVAL);
+        logLayout->addWidget(m_logFlushIntervalEdit);
+        logLayout->addStretch();
+
+        formLayout->addRow("Log Level:", logLayout);
+
         layout->addLayout(formLayout);
         layout->addStretch();
 
@@ -320,12 +442,13 @@ private:
         m_summaryTempEdit->setValue(0.8);
         settingsLayout->addWidget(m_summaryTempEdit);
 
-        settingsLayout->addWidget(new QLabel("Context:"));
+        settingsLayout->addWidget(new QLabel("Max Response:"));
         m_summaryContextEdit = new QSpinBox();
         m_summaryContextEdit->setRange(1000, 100000);
         m_summaryContextEdit->setSingleStep(1000);
         m_summaryContextEdit->setSuffix(" tokens");
-        m_summaryContextEdit->setValue(16000);
+        m_summaryContextEdit->setToolTip("Sent as max_tokens; lowered when the prompt leaves less room in the context window");
+        m_summaryContextEdit->setValue(DefaultSettings::SUMMARY_CONTEXT_LENGTH);
         settingsLayout->addWidget(m_summaryContextEdit);
 
         settingsLayout->addWidget(new QLabel("Timeout:"));
@@ -339,6 +462,35 @@ private:
         settingsLayout->addStretch();
         layout->addLayout(settingsLayout);
 
+        // Long documents: summarize in parts, then summarize the summaries
+        auto *chunkLayout = new QHBoxLayout();
+        m_summaryChunkingCheckBox = new QCheckBox("Summarize long documents in chunks");
+        m_summaryChunkingCheckBox->setChecked(DefaultSettings::SUMMARY_CHUNKING_ENABLED);
+        m_summaryChunkingCheckBox->setToolTip("Documents over the chunk size are split on page/paragraph boundaries, "
+                                              "each part is summarized (up to 'Parallel Requests' at once), and this "
+                                              "prompt is then run over the combined partial summaries instead of "
+                                              "truncated text.");
+        chunkLayout->addWidget(m_summaryChunkingCheckBox);
+
+        chunkLayout->addWidget(new QLabel("Chunk size:"));
+        m_summaryChunkTokensEdit = new QSpinBox();
+        m_summaryChunkTokensEdit->setRange(500, 100000);
+        m_summaryChunkTokensEdit->setSingleStep(500);
+        m_summaryChunkTokensEdit->setSuffix(" tokens");
+        m_summaryChunkTokensEdit->setValue(DefaultSettings::SUMMARY_CHUNK_TOKENS);
+        chunkLayout->addWidget(m_summaryChunkTokensEdit);
+
+        chunkLayout->addWidget(new QLabel("Overlap:"));
+        m_summaryChunkOverlapEdit = new QSpinBox();
+        m_summaryChunkOverlapEdit->setRange(0, 5000);
+        m_summaryChunkOverlapEdit->setSingleStep(50);
+        m_summaryChunkOverlapEdit->setSuffix(" tokens");
+        m_summaryChunkOverlapEdit->setValue(DefaultSettings::SUMMARY_CHUNK_OVERLAP);
+        chunkLayout->addWidget(m_summaryChunkOverlapEdit);
+
+        chunkLayout->addStretch();
+        layout->addLayout(chunkLayout);
+
         // Two equal-sized text areas
         auto *promptSplitter = new QSplitter(Qt::Vertical);
 
@@ -376,12 +528,13 @@ private:
         m_keywordTempEdit->setValue(0.5);
         settingsLayout->addWidget(m_keywordTempEdit);
 
-        settingsLayout->addWidget(new QLabel("Context:"));
+        settingsLayout->addWidget(new QLabel("Max Response:"));
         m_keywordContextEdit = new QSpinBox();
         m_keywordContextEdit->setRange(1000, 100000);
         m_keywordContextEdit->setSingleStep(1000);
         m_keywordContextEdit->setSuffix(" tokens");
-        m_keywordContextEdit->setValue(4000);
+        m_keywordContextEdit->setToolTip("Sent as max_tokens; lowered when the prompt leaves less room in the context window");
+        m_keywordContextEdit->setValue(DefaultSettings::KEYWORD_CONTEXT_LENGTH);
         settingsLayout->addWidget(m_keywordContextEdit);
 
         settingsLayout->addWidget(new QLabel("Timeout:"));
@@ -460,12 +613,13 @@ private:
         m_refinementTempEdit->setValue(0.8);
         settingsLayout->addWidget(m_refinementTempEdit);
 
-        settingsLayout->addWidget(new QLabel("Context:"));
+        settingsLayout->addWidget(new QLabel("Max Response:"));
         m_refinementContextEdit = new QSpinBox();
         m_refinementContextEdit->setRange(1000, 100000);
         m_refinementContextEdit->setSingleStep(1000);
         m_refinementContextEdit->setSuffix(" tokens");
-        m_refinementContextEdit->setValue(16000);
+        m_refinementContextEdit->setToolTip("Sent as max_tokens; lowered when the prompt leaves less room in the context window");
+        m_refinementContextEdit->setValue(DefaultSettings::REFINEMENT_CONTEXT_LENGTH);
         settingsLayout->addWidget(m_refinementContextEdit);
 
         settingsLayout->addWidget(new QLabel("Timeout:"));
@@ -519,11 +673,42 @@ public:
             m_urlEdit->setText(query.value("url").toString());
             m_modelComboBox->setCurrentText(query.value("model_name").toString());
             m_overallTimeoutEdit->setValue(query.value("overall_timeout").toString().toInt());
+            m_responseCacheCheckBox->setChecked(query.value("response_cache_enabled").toString() == "true");
+            if (!query.value("response_cache_ttl_hours").isNull()) {
+                m_responseCacheTtlEdit->setValue(query.value("response_cache_ttl_hours").toString().toInt());
+            }
+            m_streamingCheckBox->setChecked(query.value("streaming_enabled").toString() != "false");
+            if (!query.value("max_concurrent_requests").isNull()) {
+                m_maxConcurrentRequestsEdit->setValue(query.value("max_concurrent_requests").toString().toInt());
+            }
+            m_serverTokenizerCheckBox->setChecked(query.value("server_tokenizer_enabled").toString() == "true");
+            if (!query.value("context_window").isNull()) {
+                m_contextWindowEdit->setValue(query.value("context_window").toString().toInt());
+            }
+            setExcludedSections(query.value("excluded_sections").isNull()
+                                ? DefaultSettings::EXCLUDED_SECTIONS
+                                : SectionSegmenter::parseKinds(query.value("excluded_sections").toString()));
+            if (!query.value("stream_inactivity_timeout").isNull()) {
+                m_streamInactivityTimeoutEdit->setValue(query.value("stream_inactivity_timeout").toString().toInt());
+            }
+            if (!query.value("log_level").isNull()) {
+                m_logLevelComboBox->setCurrentText(query.value("log_level").toString());
+            }
+            if (!query.value("log_flush_interval").isNull()) {
+                m_logFlushIntervalEdit->setValue(query.value("log_flush_interval").toString().toInt());
+            }
 
             // Summary settings
             m_summaryTempEdit->setValue(query.value("summary_temperature").toString().toDouble());
             m_summaryContextEdit->setValue(query.value("summary_context_length").toString().toInt());
             m_summaryTimeoutEdit->setValue(query.value("summary_timeout").toString().toInt());
+            m_summaryChunkingCheckBox->setChecked(query.value("summary_chunking_enabled").toString() == "true");
+            if (!query.value("summary_chunk_tokens").isNull()) {
+                m_summaryChunkTokensEdit->setValue(query.value("summary_chunk_tokens").toString().toInt());
+            }
+            if (!query.value("summary_chunk_overlap").isNull()) {
+                m_summaryChunkOverlapEdit->setValue(query.value("summary_chunk_overlap").toString().toInt());
+            }
             m_summaryPrepromptEdit->setPlainText(query.value("summary_preprompt").toString());
             m_summaryPromptEdit->setPlainText(query.value("summary_prompt").toString());
 
@@ -558,9 +743,22 @@ public:
                      "url = :url, "
                      "model_name = :model_name, "
                      "overall_timeout = :overall_timeout, "
+                     "response_cache_enabled = :response_cache_enabled, "
+                     "response_cache_ttl_hours = :response_cache_ttl_hours, "
+                     "streaming_enabled = :streaming_enabled, "
+                     "stream_inactivity_timeout = :stream_inactivity_timeout, "
+                     "max_concurrent_requests = :max_concurrent_requests, "
+                     "server_tokenizer_enabled = :server_tokenizer_enabled, "
+                     "context_window = :context_window, "
+                     "excluded_sections = :excluded_sections, "
+                     "log_level = :log_level, "
+                     "log_flush_interval = :log_flush_interval, "
                      "summary_temperature = :summary_temperature, "
                      "summary_context_length = :summary_context_length, "
                      "summary_timeout = :summary_timeout, "
+                     "summary_chunking_enabled = :summary_chunking_enabled, "
+                     "summary_chunk_tokens = :summary_chunk_tokens, "
+                     "summary_chunk_overlap = :summary_chunk_overlap, "
                      "summary_preprompt = :summary_preprompt, "
                      "summary_prompt = :summary_prompt, "
                      "keyword_temperature = :keyword_temperature, "
@@ -581,11 +779,24 @@ public:
         query.bindValue(":url", m_urlEdit->text());
         query.bindValue(":model_name", m_modelComboBox->currentText());
         query.bindValue(":overall_timeout", QString::number(m_overallTimeoutEdit->value()));
+        query.bindValue(":response_cache_enabled", m_responseCacheCheckBox->isChecked() ? "true" : "false");
+        query.bindValue(":response_cache_ttl_hours", QString::number(m_responseCacheTtlEdit->value()));
+        query.bindValue(":streaming_enabled", m_streamingCheckBox->isChecked() ? "true" : "false");
+        query.bindValue(":stream_inactivity_timeout", QString::number(m_streamInactivityTimeoutEdit->value()));
+        query.bindValue(":max_concurrent_requests", QString::number(m_maxConcurrentRequestsEdit->value()));
+        query.bindValue(":server_tokenizer_enabled", m_serverTokenizerCheckBox->isChecked() ? "true" : "false");
+        query.bindValue(":context_window", QString::number(m_contextWindowEdit->value()));
+        query.bindValue(":excluded_sections", SectionSegmenter::formatKinds(excludedSections()));
+        query.bindValue(":log_level", m_logLevelComboBox->currentText());
+        query.bindValue(":log_flush_interval", QString::number(m_logFlushIntervalEdit->value()));
 
         // Summary settings
         query.bindValue(":summary_temperature", QString::number(m_summaryTempEdit->value()));
         query.bindValue(":summary_context_length", QString::number(m_summaryContextEdit->value()));
         query.bindValue(":summary_timeout", QString::number(m_summaryTimeoutEdit->value()));
+        query.bindValue(":summary_chunking_enabled", m_summaryChunkingCheckBox->isChecked() ? "true" : "false");
+        query.bindValue(":summary_chunk_tokens", QString::number(m_summaryChunkTokensEdit->value()));
+        query.bindValue(":summary_chunk_overlap", QString::number(m_summaryChunkOverlapEdit->value()));
         query.bindValue(":summary_preprompt", m_summaryPrepromptEdit->toPlainText());
         query.bindValue(":summary_prompt", m_summaryPromptEdit->toPlainText());
 
@@ -679,11 +890,24 @@ public:
         m_urlEdit->setText(DefaultSettings::URL);
         m_modelComboBox->setCurrentText(DefaultSettings::MODEL_NAME);
         m_overallTimeoutEdit->setValue(DefaultSettings::OVERALL_TIMEOUT);
+        m_responseCacheCheckBox->setChecked(DefaultSettings::RESPONSE_CACHE_ENABLED);
+        m_responseCacheTtlEdit->setValue(DefaultSettings::RESPONSE_CACHE_TTL_HOURS);
+        m_streamingCheckBox->setChecked(DefaultSettings::STREAMING_ENABLED);
+        m_streamInactivityTimeoutEdit->setValue(DefaultSettings::STREAM_INACTIVITY_TIMEOUT);
+        m_maxConcurrentRequestsEdit->setValue(DefaultSettings::MAX_CONCURRENT_REQUESTS);
+        m_serverTokenizerCheckBox->setChecked(DefaultSettings::SERVER_TOKENIZER_ENABLED);
+        m_contextWindowEdit->setValue(DefaultSettings::CONTEXT_WINDOW);
+        setExcludedSections(DefaultSettings::EXCLUDED_SECTIONS);
+        m_logLevelComboBox->setCurrentText(DefaultSettings::LOG_LEVEL);
+        m_logFlushIntervalEdit->setValue(DefaultSettings::LOG_FLUSH_INTERVAL);
 
         // Summary defaults
         m_summaryTempEdit->setValue(DefaultSettings::SUMMARY_TEMPERATURE);
         m_summaryContextEdit->setValue(DefaultSettings::SUMMARY_CONTEXT_LENGTH);
         m_summaryTimeoutEdit->setValue(DefaultSettings::SUMMARY_TIMEOUT);
+        m_summaryChunkingCheckBox->setChecked(DefaultSettings::SUMMARY_CHUNKING_ENABLED);
+        m_summaryChunkTokensEdit->setValue(DefaultSettings::SUMMARY_CHUNK_TOKENS);
+        m_summaryChunkOverlapEdit->setValue(DefaultSettings::SUMMARY_CHUNK_OVERLAP);
         m_summaryPrepromptEdit->setPlainText(DefaultSettings::getSummaryPreprompt());
         m_summaryPromptEdit->setPlainText(DefaultSettings::getSummaryPrompt());
 
@@ -707,17 +931,46 @@ public:
     }
 
 private:
+    SectionSegmenter::Kinds excludedSections() const {
+        SectionSegmenter::Kinds kinds = 0;
+        for (int k = 0; k < m_sectionCheckBoxes.size(); ++k) {
+            if (!m_sectionCheckBoxes[k]->isChecked()) {
+                kinds |= SectionSegmenter::kindBit(static_cast<SectionSegmenter::Kind>(k));
+            }
+        }
+        return kinds;
+    }
+
+    void setExcludedSections(SectionSegmenter::Kinds kinds) {
+        for (int k = 0; k < m_sectionCheckBoxes.size(); ++k) {
+            m_sectionCheckBoxes[k]->setChecked(!(kinds & SectionSegmenter::kindBit(static_cast<SectionSegmenter::Kind>(k))));
+        }
+    }
+
     // Connection tab widgets
     QLineEdit *m_urlEdit;
     QComboBox *m_modelComboBox;
     QPushButton *m_refreshModelsButton;
     ModelListFetcher *m_modelFetcher;
     QSpinBox *m_overallTimeoutEdit;
+    QCheckBox *m_responseCacheCheckBox;
+    QSpinBox *m_responseCacheTtlEdit;
+    QCheckBox *m_streamingCheckBox;
+    QSpinBox *m_streamInactivityTimeoutEdit;
+    QSpinBox *m_maxConcurrentRequestsEdit;
+    QCheckBox *m_serverTokenizerCheckBox;
+    QSpinBox *m_contextWindowEdit;
+    QVector<QCheckBox*> m_sectionCheckBoxes;  // Indexed by SectionSegmenter::Kind
+    QComboBox *m_logLevelComboBox;
+    QSpinBox *m_logFlushIntervalEdit;
 
     // Summary tab widgets
     QDoubleSpinBox *m_summaryTempEdit;
     QSpinBox *m_summaryContextEdit;
     QSpinBox *m_summaryTimeoutEdit;
+    QCheckBox *m_summaryChunkingCheckBox;
+    QSpinBox *m_summaryChunkTokensEdit;
+    QSpinBox *m_summaryChunkOverlapEdit;
     QTextEdit *m_summaryPrepromptEdit;
     QTextEdit *m_summaryPromptEdit;
 
@@ -791,6 +1044,7 @@ private:
 
     QPushButton *m_settingsButton;
     QPushButton *m_abortButton;
+    QCheckBox *m_bypassCacheCheckBox;
     QLabel *m_statusLabel;
     QLabel *m_spinnerLabel;
     QTimer *m_spinnerTimer;
@@ -813,6 +1067,9 @@ private:
     // Core objects
     QueryRunner *m_queryRunner;
 
+    // Stages whose output edit has been cleared for streamed text this run
+    QSet<int> m_streamedStages;
+
 private:
     void initDatabase() {
         // Always use the executable directory for the database
@@ -884,10 +1141,25 @@ private:
                 model_name TEXT,
                 overall_timeout TEXT,
                 text_truncation_limit TEXT,
+                extraction_workers TEXT,
+                extraction_cache_mb TEXT,
+                response_cache_enabled TEXT,
+                response_cache_ttl_hours TEXT,
+                streaming_enabled TEXT,
+                stream_inactivity_timeout TEXT,
+                max_concurrent_requests TEXT,
+                server_tokenizer_enabled TEXT,
+                context_window TEXT,
+                excluded_sections TEXT,
+                log_level TEXT,
+                log_flush_interval TEXT,
 
                 summary_temperature TEXT,
                 summary_context_length TEXT,
                 summary_timeout TEXT,
+                summary_chunking_enabled TEXT,
+                summary_chunk_tokens TEXT,
+                summary_chunk_overlap TEXT,
                 summary_preprompt TEXT,
                 summary_prompt TEXT,
 
@@ -919,6 +1191,21 @@ private:
         QSqlQuery alterQuery(db);
         alterQuery.exec("ALTER TABLE settings ADD COLUMN zotero_user_id TEXT");
         alterQuery.exec("ALTER TABLE settings ADD COLUMN zotero_api_key TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN extraction_workers TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN extraction_cache_mb TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN response_cache_enabled TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN response_cache_ttl_hours TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN streaming_enabled TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN stream_inactivity_timeout TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN max_concurrent_requests TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN server_tokenizer_enabled TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN context_window TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN excluded_sections TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN log_level TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN log_flush_interval TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN summary_chunking_enabled TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN summary_chunk_tokens TEXT");
+        alterQuery.exec("ALTER TABLE settings ADD COLUMN summary_chunk_overlap TEXT");
         // Ignore errors as columns may already exist
 
         // Check if skip_refinement column exists (for migration from older versions)
@@ -950,8 +1237,12 @@ private:
         if (count == 0) {
             QString insertDefaults = R"(
                 INSERT INTO settings (
-                    url, model_name, overall_timeout, text_truncation_limit,
+                    url, model_name, overall_timeout, text_truncation_limit, extraction_workers, extraction_cache_mb,
+                    response_cache_enabled, response_cache_ttl_hours,
+                    streaming_enabled, stream_inactivity_timeout, max_concurrent_requests, server_tokenizer_enabled,
+                    context_window, excluded_sections, log_level, log_flush_interval,
                     summary_temperature, summary_context_length, summary_timeout,
+                    summary_chunking_enabled, summary_chunk_tokens, summary_chunk_overlap,
                     summary_preprompt, summary_prompt,
                     keyword_temperature, keyword_context_length, keyword_timeout,
                     keyword_preprompt, keyword_prompt,
@@ -959,8 +1250,12 @@ private:
                     keyword_refinement_preprompt, preprompt_refinement_prompt,
                     zotero_user_id, zotero_api_key
                 ) VALUES (
-                    :url, :model_name, :overall_timeout, :text_truncation_limit,
+                    :url, :model_name, :overall_timeout, :text_truncation_limit, :extraction_workers, :extraction_cache_mb,
+                    :response_cache_enabled, :response_cache_ttl_hours,
+                    :streaming_enabled, :stream_inactivity_timeout, :max_concurrent_requests, :server_tokenizer_enabled,
+                    :context_window, :excluded_sections, :log_level, :log_flush_interval,
                     :summary_temperature, :summary_context_length, :summary_timeout,
+                    :summary_chunking_enabled, :summary_chunk_tokens, :summary_chunk_overlap,
                     :summary_preprompt, :summary_prompt,
                     :keyword_temperature, :keyword_context_length, :keyword_timeout,
                     :keyword_preprompt, :keyword_prompt,
@@ -975,11 +1270,26 @@ private:
             query.bindValue(":model_name", DefaultSettings::MODEL_NAME);
             query.bindValue(":overall_timeout", QString::number(DefaultSettings::OVERALL_TIMEOUT));
             query.bindValue(":text_truncation_limit", QString::number(DefaultSettings::TEXT_TRUNCATION_LIMIT));
+            query.bindValue(":extraction_workers", QString::number(DefaultSettings::EXTRACTION_WORKERS));
+            query.bindValue(":extraction_cache_mb", QString::number(DefaultSettings::EXTRACTION_CACHE_MB));
+            query.bindValue(":response_cache_enabled", DefaultSettings::RESPONSE_CACHE_ENABLED ? "true" : "false");
+            query.bindValue(":response_cache_ttl_hours", QString::number(DefaultSettings::RESPONSE_CACHE_TTL_HOURS));
+            query.bindValue(":streaming_enabled", DefaultSettings::STREAMING_ENABLED ? "true" : "false");
+            query.bindValue(":stream_inactivity_timeout", QString::number(DefaultSettings::STREAM_INACTIVITY_TIMEOUT));
+            query.bindValue(":max_concurrent_requests", QString::number(DefaultSettings::MAX_CONCURRENT_REQUESTS));
+            query.bindValue(":server_tokenizer_enabled", DefaultSettings::SERVER_TOKENIZER_ENABLED ? "true" : "false");
+            query.bindValue(":context_window", QString::number(DefaultSettings::CONTEXT_WINDOW));
+            query.bindValue(":excluded_sections", SectionSegmenter::formatKinds(DefaultSettings::EXCLUDED_SECTIONS));
+            query.bindValue(":log_level", DefaultSettings::LOG_LEVEL);
+            query.bindValue(":log_flush_interval", QString::number(DefaultSettings::LOG_FLUSH_INTERVAL));
 
             // Summary settings
             query.bindValue(":summary_temperature", QString::number(DefaultSettings::SUMMARY_TEMPERATURE));
             query.bindValue(":summary_context_length", QString::number(DefaultSettings::SUMMARY_CONTEXT_LENGTH));
             query.bindValue(":summary_timeout", QString::number(DefaultSettings::SUMMARY_TIMEOUT));
+            query.bindValue(":summary_chunking_enabled", DefaultSettings::SUMMARY_CHUNKING_ENABLED ? "true" : "false");
+            query.bindValue(":summary_chunk_tokens", QString::number(DefaultSettings::SUMMARY_CHUNK_TOKENS));
+            query.bindValue(":summary_chunk_overlap", QString::number(DefaultSettings::SUMMARY_CHUNK_OVERLAP));
             query.bindValue(":summary_preprompt", DefaultSettings::getSummaryPreprompt());
             query.bindValue(":summary_prompt", DefaultSettings::getSummaryPrompt());
 
@@ -1023,6 +1333,13 @@ private:
 
         toolbar->addStretch();
 
+        // Bypass the response cache and saved stage results for the next runs
+        m_bypassCacheCheckBox = new QCheckBox("Fresh responses");
+        m_bypassCacheCheckBox->setToolTip("Ignore cached LLM responses and results saved by interrupted runs, "
+                                          "and always query the model");
+        toolbar->addWidget(m_bypassCacheCheckBox);
+        toolbar->addSpacing(10);
+
         // Abort button (stop sign) - only enabled during processing
         m_abortButton = new QPushButton("🛑");  // Red stop sign emoji
         m_abortButton->setFixedSize(28, 28);
@@ -1354,6 +1671,10 @@ private:
         });
         connect(m_textAnalyzeButton, &QPushButton::clicked, this, &PDFExtractorGUI::analyzeText);
 
+        connect(m_bypassCacheCheckBox, &QCheckBox::toggled, [this](bool checked) {
+            m_queryRunner->setBypassResponseCache(checked);
+        });
+
         // Connect Zotero widget signals - use the SAME analyzePDF path
         connect(m_zoteroInputWidget, &ZoteroInputWidget::analyzeRequested, [this]() {
             QString pdfPath = m_zoteroInputWidget->getPdfPath();
@@ -1375,6 +1696,9 @@ private:
         connect(m_queryRunner, &QueryRunner::stageChanged, this, &PDFExtractorGUI::handleStageChanged);
         connect(m_queryRunner, &QueryRunner::progressMessage, this, &PDFExtractorGUI::log);
         connect(m_queryRunner, &QueryRunner::errorOccurred, this, &PDFExtractorGUI::handleError);
+        connect(m_queryRunner, &QueryRunner::extractionProgress, this, [this](int pagesDone, int pageCount) {
+            updateStatus(QString("Extracting text... page %1 of %2").arg(pagesDone).arg(pageCount));
+        });
 
         // Connect result signals
         connect(m_queryRunner, &QueryRunner::textExtracted, [this](const QString& text) {
@@ -1382,6 +1706,30 @@ private:
             m_resultsTabWidget->setCurrentWidget(m_extractedTextEdit);
         });
 
+        connect(m_queryRunner, &QueryRunner::partialResult,
+                [this](QueryRunner::ProcessingStage stage, const QString& delta) {
+            QTextEdit* target = nullptr;
+            switch (stage) {
+                case QueryRunner::GeneratingSummary: target = m_summaryTextEdit; break;
+                case QueryRunner::ExtractingKeywords: target = m_keywordsTextEdit; break;
+                case QueryRunner::RefiningPrompt: target = m_promptSuggestionsEdit; break;
+                case QueryRunner::ExtractingRefinedKeywords: target = m_refinedKeywordsEdit; break;
+                default: return;
+            }
+
+            // First chunk of a stage replaces the previous result
+            // (stages may stream concurrently, so track each one)
+            if (!m_streamedStages.contains(stage)) {
+                m_streamedStages.insert(stage);
+                target->clear();
+            }
+
+            // Append without disturbing the user's selection or scroll position
+            QTextCursor cursor(target->document());
+            cursor.movePosition(QTextCursor::End);
+            cursor.insertText(delta);
+        });
+
         connect(m_queryRunner, &QueryRunner::summaryGenerated, [this](const QString& summary) {
             QString cleanedSummary = stripAIArtifacts(summary);
             m_summaryTextEdit->setMarkdown(cleanedSummary);
@@ -1403,6 +1751,7 @@ private:
         });
 
         connect(m_queryRunner, &QueryRunner::processingComplete, [this]() {
+            m_streamedStages.clear();
             setUIEnabled(true);
             stopSpinner();
             updateStatus("Processing complete");
@@ -1416,22 +1765,13 @@ private:
             qDebug() << "Abort button clicked";
 
             // Write to abort log file
-            QFile abortLog("abort_debug.log");
-            if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                QTextStream stream(&abortLog);
-                stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-                       << " - ABORT BUTTON CLICKED" << Qt::endl;
-                abortLog.close();
-            }
+            AsyncLogger::instance()->lineNow("abort_debug.log", "ABORT BUTTON CLICKED",
+                                             AsyncLogger::Info, AsyncLogger::DateTimeStamp);
 
             if (m_queryRunner->isProcessing()) {
                 qDebug() << "QueryRunner is processing, calling abort...";
-                if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                    QTextStream stream(&abortLog);
-                    stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-                           << " - QueryRunner is processing, calling abort..." << Qt::endl;
-                    abortLog.close();
-                }
+                AsyncLogger::instance()->lineNow("abort_debug.log", "QueryRunner is processing, calling abort...",
+                                                 AsyncLogger::Info, AsyncLogger::DateTimeStamp);
 
                 m_queryRunner->abort();
                 updateStatus("Processing cancelled");
@@ -1440,12 +1780,8 @@ private:
                 m_abortButton->setEnabled(false);
 
                 qDebug() << "Abort button handler complete";
-                if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                    QTextStream stream(&abortLog);
-                    stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-                           << " - Abort button handler complete" << Qt::endl;
-                    abortLog.close();
-                }
+                AsyncLogger::instance()->lineNow("abort_debug.log", "Abort button handler complete",
+                                                 AsyncLogger::Info, AsyncLogger::DateTimeStamp);
             } else {
                 qDebug() << "QueryRunner not processing, ignoring abort";
             }
@@ -1627,8 +1963,14 @@ private slots:
         // Clear previous results
         clearResults();
 
+        // Zotero downloads were hashed on the way in; reuse that for the extraction cache key
+        QByteArray contentHash;
+        if (m_zoteroInputWidget && pathToUse == m_zoteroInputWidget->getPdfPath()) {
+            contentHash = m_zoteroInputWidget->getPdfHash();
+        }
+
         // Start processing with QueryRunner - ALL safety checks are now in processPDF
-        m_queryRunner->processPDF(pathToUse);
+        m_queryRunner->processPDF(pathToUse, contentHash);
     }
 
     void analyzeText() {
@@ -1715,6 +2057,7 @@ private slots:
         // Log error to the output log
         log("ERROR: " + error);
         qDebug() << "handleError called with:" << error;
+        m_streamedStages.clear();
 
         // Always re-enable UI
         setUIEnabled(true);
@@ -1785,6 +2128,10 @@ private:
 // Windows exception handler
 LONG WINAPI UnhandledExceptionHandler(EXCEPTION_POINTERS* pExceptionInfo)
 {
+    // Get the queued log records (the trail leading up to the crash) onto disk,
+    // but don't hang here if the writer thread is the one that crashed
+    AsyncLogger::instance()->flush(AsyncLogger::SyncTimeoutMs);
+
     // Create crash log directory if it doesn't exist
     QString appDir = QCoreApplication::applicationDirPath();
     QString crashDir = appDir + "/logs";
@@ -1903,10 +2250,16 @@ int safeMain(int argc, char *argv[])
     }
 
     try {
-        PDFExtractorGUI window;
-        window.show();
+        int result = 0;
+        {
+            PDFExtractorGUI window;
+            window.show();
 
-        return app.exec();
+            result = app.exec();
+        }
+        // Window is gone (its widgets log on destruction) - write out whatever is still queued
+        AsyncLogger::instance()->shutdown();
+        return result;
     }
     catch (const std::exception& e) {
         QMessageBox::critical(nullptr, "Fatal Error",
@@ -0,0 +1,88 @@
+#include "mappedpdffile.h"
+#include <QDebug>
+#include <QFileInfo>
+
+MappedPdfFile::~MappedPdfFile() {
+    close();
+}
+
+bool MappedPdfFile::open(const QString& path, QString& errorMsg, qint64 maxSizeBytes) {
+    close();
+
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists()) {
+        errorMsg = "PDF file does not exist";
+        return false;
+    }
+    if (!fileInfo.isFile()) {
+        errorMsg = "Path is not a file";
+        return false;
+    }
+    if (!fileInfo.isReadable()) {
+        errorMsg = "PDF file is not readable (check permissions)";
+        return false;
+    }
+    if (fileInfo.size() > maxSizeBytes) {
+        errorMsg = QString("PDF file is too large (>%1MB)").arg(maxSizeBytes / (1024 * 1024));
+        return false;
+    }
+    if (fileInfo.size() < 5) {
+        errorMsg = "File does not appear to be a PDF (invalid header)";
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        errorMsg = "Cannot open file for validation";
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        qDebug() << "MappedPdfFile: cannot map" << path << "-" << m_file.errorString() << "- reading instead";
+        m_fallback = m_file.readAll();
+        if (m_fallback.size() != m_size) {
+            errorMsg = QString("Cannot read file: %1").arg(m_file.errorString());
+            close();
+            return false;
+        }
+    }
+    m_path = path;
+
+    // Header check straight off the mapping - this is the first page the parser touches anyway
+    if (qstrncmp(data(), "%PDF", 4) != 0) {
+        errorMsg = "File does not appear to be a PDF (invalid header)";
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedPdfFile::close() {
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_fallback.clear();
+    m_size = 0;
+    m_path.clear();
+}
+
+const char* MappedPdfFile::data() const {
+    if (m_data) {
+        return reinterpret_cast<const char*>(m_data);
+    }
+    return m_fallback.isEmpty() ? nullptr : m_fallback.constData();
+}
+
+QByteArray MappedPdfFile::bytes() const {
+    if (!m_data) {
+        return m_fallback;
+    }
+    return QByteArray::fromRawData(data(), static_cast<qsizetype>(m_size));
+}
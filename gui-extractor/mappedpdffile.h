@@ -0,0 +1,47 @@
+#ifndef MAPPEDPDFFILE_H
+#define MAPPEDPDFFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// Read-only memory mapping of a PDF file. Validation, content hashing and
+// QPdfDocument parsing all read the same mapped pages instead of each opening
+// the file (and the parser buffering its own copy). bytes() wraps the mapping
+// without copying, so it and any QBuffer built on it are only valid while the
+// MappedPdfFile is alive - keep it around for as long as a document loaded
+// from it is open.
+class MappedPdfFile {
+public:
+    MappedPdfFile() = default;
+    ~MappedPdfFile();
+
+    MappedPdfFile(const MappedPdfFile&) = delete;
+    MappedPdfFile& operator=(const MappedPdfFile&) = delete;
+
+    // Map path and run the same checks as SafePdfLoader::validatePdfFile on the
+    // mapped bytes. Returns false (with errorMsg set) if the file is unusable.
+    // If the filesystem doesn't support mapping the file is read into memory
+    // instead, which is slower but otherwise behaves the same.
+    bool open(const QString& path, QString& errorMsg, qint64 maxSizeBytes = 500 * 1024 * 1024);
+    void close();
+
+    bool isOpen() const { return data() != nullptr; }
+    bool isMapped() const { return m_data != nullptr; }
+    QString path() const { return m_path; }
+    qint64 size() const { return m_size; }
+    const char* data() const;
+
+    // Zero-copy view of the mapping. Copies of the returned array share the
+    // mapped pages until one of them is modified.
+    QByteArray bytes() const;
+
+private:
+    QFile m_file;  // Must stay open: closing it unmaps
+    QString m_path;
+    uchar* m_data = nullptr;
+    QByteArray m_fallback;  // Only used when mapping fails
+    qint64 m_size = 0;
+};
+
+#endif // MAPPEDPDFFILE_H
@@ -1,4 +1,5 @@
 #include "modellistfetcher.h"
+#include "httpclientpool.h"
 #include <QNetworkRequest>
 #include <QUrl>
 #include <QJsonDocument>
@@ -8,7 +9,6 @@
 
 ModelListFetcher::ModelListFetcher(QObject *parent)
     : QObject(parent)
-    , m_networkManager(new QNetworkAccessManager(this))
     , m_currentReply(nullptr)
     , m_timeoutTimer(new QTimer(this))
     , m_timeout(10000) // 10 seconds default
@@ -54,7 +54,7 @@ void ModelListFetcher::fetchModels(const QString& baseUrl) {
     request.setRawHeader("User-Agent", "PDFExtractor/1.0");
 
     // Send GET request
-    m_currentReply = m_networkManager->get(request);
+    m_currentReply = HttpClientPool::instance()->get(request);
 
     // Connect signals
     connect(m_currentReply, &QNetworkReply::finished,
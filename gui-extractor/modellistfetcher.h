@@ -4,7 +4,6 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
 
@@ -37,7 +36,6 @@ private slots:
     void handleTimeout();
 
 private:
-    QNetworkAccessManager* m_networkManager;
     QNetworkReply* m_currentReply;
     QTimer* m_timeoutTimer;
 
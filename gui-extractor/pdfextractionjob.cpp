@@ -0,0 +1,167 @@
+#include "pdfextractionjob.h"
+#include "boilerplatefilter.h"
+#include "extractioncache.h"
+#include "mappedpdffile.h"
+#include "safepdfloader.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QPdfDocument>
+#include <QThread>
+#include <exception>
+#include <memory>
+
+PdfExtractionJob::PdfExtractionJob(const QString& filePath, ExtractionCache* cache, const QString& cleanupOptions,
+                                   int extractionWorkers, QObject *parent)
+    : QObject(parent)
+    , m_filePath(filePath)
+    , m_cache(cache)
+    , m_cleanupOptions(cleanupOptions)
+    , m_extractionWorkers(extractionWorkers)
+    , m_cancelled(false)
+    , m_thread(nullptr)
+{
+}
+
+PdfExtractionJob::~PdfExtractionJob() {
+    if (m_thread) {
+        cancel();
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void PdfExtractionJob::start() {
+    if (m_thread) {
+        return;
+    }
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("PdfExtraction");
+    connect(m_thread, &QThread::finished, this, &QObject::deleteLater);
+    m_thread->start();
+}
+
+bool PdfExtractionJob::wait(int timeoutMs) {
+    if (!m_thread) {
+        return true;
+    }
+    return timeoutMs < 0 ? m_thread->wait() : m_thread->wait(static_cast<unsigned long>(timeoutMs));
+}
+
+void PdfExtractionJob::run() {
+    QString errorMsg;
+    QString cacheKey;
+    QString extractedText;
+    QString cachedCleanedText;
+    StructuredText structure;
+    bool fromCache = false;
+
+    // One mapping serves validation, hashing and parsing
+    MappedPdfFile mapped;
+
+    try {
+        QString openError;
+        if (!mapped.open(m_filePath, openError)) {
+            errorMsg = "Failed to load PDF: " + openError;
+        } else {
+            // Hashing a large file is itself slow, so the cache lookup happens here too
+            cacheKey = m_contentHash.isEmpty()
+                ? ExtractionCache::makeKey(mapped.bytes(), 0, -1, m_cleanupOptions)
+                : ExtractionCache::makeKeyForHash(m_contentHash, 0, -1, m_cleanupOptions);
+            if (m_cache && m_cache->lookup(cacheKey, extractedText, cachedCleanedText, &structure)) {
+                fromCache = true;
+                emit progressMessage(QString("Extraction cache hit (%1 hits, %2 misses)")
+                                     .arg(m_cache->hits()).arg(m_cache->misses()));
+            } else {
+                if (m_cache) {
+                    emit progressMessage(QString("Extraction cache miss (%1 hits, %2 misses)")
+                                         .arg(m_cache->hits()).arg(m_cache->misses()));
+                }
+                structure = extract(mapped, errorMsg);
+                extractedText = structure.text();
+                if (!extractedText.isEmpty() && !isCancelled() && m_cache) {
+                    // Cleaned text is added once the pipeline has produced it
+                    m_cache->store(cacheKey, extractedText, QString(), &structure);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        errorMsg = QString("Exception during PDF extraction: %1").arg(e.what());
+        extractedText.clear();
+    } catch (...) {
+        errorMsg = "Unknown exception during PDF extraction";
+        extractedText.clear();
+    }
+
+    if (isCancelled()) {
+        qDebug() << "PdfExtractionJob: cancelled, discarding result for" << m_filePath;
+        return;
+    }
+
+    if (extractedText.isEmpty()) {
+        emit failed(errorMsg.isEmpty() ? QString("No text could be extracted from PDF") : errorMsg);
+        return;
+    }
+
+    emit progressMessage("PDF extraction completed successfully");
+    emit finished(extractedText, cachedCleanedText, cacheKey, fromCache, structure);
+}
+
+StructuredText PdfExtractionJob::extract(const MappedPdfFile& mapped, QString& errorMsg) {
+    emit progressMessage("Loading PDF file...");
+
+    // The document lives on this thread; PDFium handles must not cross threads.
+    // The buffer reads the mapping directly, so the file isn't opened a second time.
+    QBuffer buffer;
+    buffer.setData(mapped.bytes());
+    buffer.open(QIODevice::ReadOnly);
+    auto doc = std::make_unique<QPdfDocument>();
+    QString loadError;
+    if (!SafePdfLoader::loadPdf(doc.get(), &buffer, loadError, 60000)) {
+        errorMsg = "Failed to load PDF: " + loadError;
+        return StructuredText();
+    }
+    if (isCancelled()) {
+        return StructuredText();
+    }
+
+    const int pageCount = doc->pageCount();
+    emit documentLoaded(pageCount);
+
+    QString extractError;
+    StructuredText structure;
+    auto onProgress = [this](int pagesDone, int total) {
+        emit pageProgress(pagesDone, total);
+        return !isCancelled();
+    };
+
+    // Large documents are sharded across worker threads
+    if (m_extractionWorkers != 1 && pageCount >= ParallelExtractionMinPages) {
+        doc->close();
+        emit progressMessage(QString("Extracting text from %1 pages in parallel...").arg(pageCount));
+        structure = SafePdfLoader::extractStructuredParallel(mapped, extractError, m_extractionWorkers, onProgress);
+    } else {
+        emit progressMessage(QString("Extracting text from %1 pages...").arg(pageCount));
+        // Progress is reported per page so it is visible on long documents
+        SafePdfLoader::extractStructured(doc.get(), structure, extractError, 0, -1, onProgress);
+        doc->close();
+    }
+
+    if (isCancelled()) {
+        return StructuredText();
+    }
+
+    if (structure.isEmpty()) {
+        errorMsg = "Failed to extract text: "
+                   + (extractError.isEmpty() ? QString("No text could be extracted from PDF") : extractError);
+        return StructuredText();
+    }
+
+    // Running heads, footers and page numbers repeat on every page; drop them once here
+    const BoilerplateFilter::Stats removed = BoilerplateFilter::apply(structure);
+    if (removed.lines > 0) {
+        emit progressMessage(QString("Removed %1 repeated header/footer lines: %2 characters, ~%3 tokens saved")
+                             .arg(removed.lines).arg(removed.chars).arg(removed.tokens));
+    }
+    return structure;
+}
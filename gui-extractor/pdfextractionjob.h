@@ -0,0 +1,69 @@
+#ifndef PDFEXTRACTIONJOB_H
+#define PDFEXTRACTIONJOB_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include "structuredtext.h"
+
+class QThread;
+class ExtractionCache;
+class MappedPdfFile;
+
+// Loads a PDF and extracts its text on a dedicated thread, so a slow load or a
+// long getAllText loop never blocks the GUI. Signals are emitted from the worker
+// thread and arrive queued on the receiver's thread. cancel() is checked between
+// pages (a QPdfDocument::load in progress can't be interrupted - the job finishes
+// the load, notices the flag and exits without emitting a result).
+//
+// The job deletes itself once the worker thread has finished, so callers only
+// need to disconnect from it when they lose interest.
+class PdfExtractionJob : public QObject {
+    Q_OBJECT
+
+public:
+    PdfExtractionJob(const QString& filePath, ExtractionCache* cache, const QString& cleanupOptions,
+                     int extractionWorkers, QObject *parent = nullptr);
+    ~PdfExtractionJob();
+
+    // Content SHA-256 already known to the caller (e.g. hashed while downloading).
+    // Skips hashing the file for the cache key. Must be set before start().
+    void setContentHash(const QByteArray& sha256) { m_contentHash = sha256; }
+
+    void start();
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+    // Block until the worker thread exits (returns immediately if it never started).
+    // timeoutMs < 0 waits indefinitely.
+    bool wait(int timeoutMs = -1);
+
+    // Below this page count thread startup costs more than it saves
+    static constexpr int ParallelExtractionMinPages = 32;
+
+signals:
+    void progressMessage(const QString& message);
+    void documentLoaded(int pageCount);
+    void pageProgress(int pagesDone, int pageCount);
+
+    // Exactly one of these is emitted, unless the job was cancelled. structure.text()
+    // equals extractedText; it is empty for cache entries stored without a layout.
+    void finished(const QString& extractedText, const QString& cachedCleanedText, const QString& cacheKey,
+                  bool fromCache, const StructuredText& structure);
+    void failed(const QString& error);
+
+private:
+    void run();
+    StructuredText extract(const MappedPdfFile& mapped, QString& errorMsg);
+
+    QString m_filePath;
+    ExtractionCache* m_cache;
+    QString m_cleanupOptions;
+    QByteArray m_contentHash;
+    int m_extractionWorkers;  // 0 = one per core, 1 = serial extraction
+    std::atomic<bool> m_cancelled;
+    QThread* m_thread;
+};
+
+#endif // PDFEXTRACTIONJOB_H
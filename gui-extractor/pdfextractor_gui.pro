@@ -15,14 +15,50 @@ SOURCES += main.cpp \
     queryrunner.cpp \
     modellistfetcher.cpp \
     zoteroinput.cpp \
-    safepdfloader.cpp
+    safepdfloader.cpp \
+    extractioncache.cpp \
+    responsecache.cpp \
+    httpclientpool.cpp \
+    ssestream.cpp \
+    textcleaner.cpp \
+    asynclogger.cpp \
+    pdfextractionjob.cpp \
+    pipelinemetrics.cpp \
+    mappedpdffile.cpp \
+    zoterodownloader.cpp \
+    zoterocache.cpp \
+    zoteroprefetcher.cpp \
+    bulkanalysisqueue.cpp \
+    tokenbudget.cpp \
+    boilerplatefilter.cpp \
+    structuredtext.cpp \
+    sectionsegmenter.cpp \
+    jobstore.cpp
 #    inputmethod.cpp  # REMOVED: Unused - all PDF processing unified in QueryRunner::processPDF
 
 HEADERS += promptquery.h \
     queryrunner.h \
     modellistfetcher.h \
     zoteroinput.h \
-    safepdfloader.h
+    safepdfloader.h \
+    extractioncache.h \
+    responsecache.h \
+    httpclientpool.h \
+    ssestream.h \
+    textcleaner.h \
+    asynclogger.h \
+    pdfextractionjob.h \
+    pipelinemetrics.h \
+    mappedpdffile.h \
+    zoterodownloader.h \
+    zoterocache.h \
+    zoteroprefetcher.h \
+    bulkanalysisqueue.h \
+    tokenbudget.h \
+    boilerplatefilter.h \
+    structuredtext.h \
+    sectionsegmenter.h \
+    jobstore.h
 #    inputmethod.h  # REMOVED: Unused - all PDF processing unified in QueryRunner::processPDF
 
 # Windows specific settings
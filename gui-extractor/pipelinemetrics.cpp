@@ -0,0 +1,117 @@
+#include "pipelinemetrics.h"
+#include "asynclogger.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QJsonDocument>
+
+double PipelineMetrics::Span::tokensPerSecond() const {
+    if (completionTokens <= 0 || requestMs <= 0 || cacheHit) {
+        return 0.0;
+    }
+    // Time spent waiting for the first token is prompt processing, not generation
+    qint64 generationMs = requestMs;
+    if (timeToFirstTokenMs > 0 && timeToFirstTokenMs < requestMs) {
+        generationMs -= timeToFirstTokenMs;
+    }
+    return completionTokens * 1000.0 / generationMs;
+}
+
+QJsonObject PipelineMetrics::Span::toJson() const {
+    QJsonObject obj;
+    obj["run"] = runId;
+    obj["span"] = name;
+    if (!stage.isEmpty()) {
+        obj["stage"] = stage;
+    }
+    obj["start"] = QDateTime::fromMSecsSinceEpoch(startedAt).toString(Qt::ISODateWithMs);
+    obj["duration_ms"] = durationMs;
+    obj["status"] = status;
+
+    auto addIfSet = [&obj](const char* key, qint64 value) {
+        if (value >= 0) {
+            obj[key] = value;
+        }
+    };
+    addIfSet("bytes_in", bytesIn);
+    addIfSet("bytes_out", bytesOut);
+    addIfSet("chars_in", charsIn);
+    addIfSet("chars_out", charsOut);
+    addIfSet("pages", pages);
+    addIfSet("request_ms", requestMs);
+    addIfSet("ttft_ms", timeToFirstTokenMs);
+    addIfSet("parse_ms", parseMs);
+    addIfSet("prompt_tokens", promptTokens);
+    addIfSet("completion_tokens", completionTokens);
+
+    const double rate = tokensPerSecond();
+    if (rate > 0.0) {
+        obj["tokens_per_s"] = qRound(rate * 10.0) / 10.0;
+    }
+    if (cacheHit) {
+        obj["cache_hit"] = true;
+    }
+    return obj;
+}
+
+PipelineMetrics::PipelineMetrics()
+    : m_runStartedAt(0)
+    , m_promptTokens(0)
+    , m_completionTokens(0)
+    , m_requests(0)
+{
+}
+
+void PipelineMetrics::beginRun(const QString& inputType) {
+    m_runStartedAt = QDateTime::currentMSecsSinceEpoch();
+    m_runId = QDateTime::fromMSecsSinceEpoch(m_runStartedAt).toString("yyyyMMdd-hhmmss-zzz");
+    m_inputType = inputType;
+    m_promptTokens = 0;
+    m_completionTokens = 0;
+    m_requests = 0;
+    m_runTimer.start();
+}
+
+PipelineMetrics::Span PipelineMetrics::finishRun(const QString& status) {
+    Span span;
+    span.name = "pipeline";
+    span.stage = m_inputType;
+    span.status = status;
+    if (m_promptTokens > 0) {
+        span.promptTokens = m_promptTokens;
+    }
+    if (m_completionTokens > 0) {
+        span.completionTokens = m_completionTokens;
+    }
+    record(span, m_runTimer);
+    m_runTimer.invalidate();
+    return span;
+}
+
+void PipelineMetrics::record(Span& span, const QElapsedTimer& timer) {
+    span.durationMs = timer.isValid() ? timer.elapsed() : 0;
+    span.startedAt = 0;
+    record(span);
+}
+
+void PipelineMetrics::record(Span& span) {
+    span.runId = m_runId;
+    if (span.startedAt == 0) {
+        span.startedAt = QDateTime::currentMSecsSinceEpoch() - span.durationMs;
+    }
+
+    if (span.name == "request") {
+        m_requests++;
+        if (!span.cacheHit) {
+            m_promptTokens += qMax(0, span.promptTokens);
+            m_completionTokens += qMax(0, span.completionTokens);
+        }
+    }
+
+    AsyncLogger::instance()->data(metricsPath(),
+                                  QString::fromUtf8(QJsonDocument(span.toJson()).toJson(QJsonDocument::Compact)));
+}
+
+QString PipelineMetrics::metricsPath() {
+    return QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("metrics.jsonl");
+}
@@ -0,0 +1,76 @@
+#ifndef PIPELINEMETRICS_H
+#define PIPELINEMETRICS_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QMetaType>
+
+// Structured timings for one analysis run. QueryRunner records a span for PDF
+// extraction, cleanup, every LLM request and the pipeline as a whole; each span
+// is appended as one JSON object per line to metrics.jsonl (next to the
+// executable) through the AsyncLogger writer thread.
+class PipelineMetrics {
+public:
+    struct Span {
+        QString runId;
+        QString name;          // "extraction", "cleanup", "request", "pipeline"
+        QString stage;         // Pipeline stage or query type, empty for whole-run spans
+        qint64 startedAt = 0;  // ms since epoch
+        qint64 durationMs = 0;
+        QString status = "ok"; // "ok", "error", "aborted", "failed"
+
+        // Sizes (-1 = not applicable). Text stages count characters, I/O counts bytes.
+        qint64 bytesIn = -1;
+        qint64 bytesOut = -1;
+        qint64 charsIn = -1;
+        qint64 charsOut = -1;
+        int pages = -1;
+
+        // LLM requests only
+        qint64 requestMs = -1;
+        qint64 timeToFirstTokenMs = -1;
+        qint64 parseMs = -1;
+        int promptTokens = -1;
+        int completionTokens = -1;
+        bool cacheHit = false;
+
+        // Completion tokens per second of generation time (after the first token when streamed)
+        double tokensPerSecond() const;
+        QJsonObject toJson() const;
+    };
+
+    PipelineMetrics();
+
+    // Start a new run; every span recorded until the next beginRun carries its id
+    void beginRun(const QString& inputType);
+    bool isRunning() const { return m_runTimer.isValid(); }
+    QString runId() const { return m_runId; }
+
+    // Span covering the whole run, from beginRun to now. Also ends the run.
+    Span finishRun(const QString& status);
+
+    // Fill in runId/startedAt and append the span to the metrics file
+    void record(Span& span, const QElapsedTimer& timer);
+    void record(Span& span);
+
+    // Accumulated over the current run, for the end-of-run summary
+    int promptTokens() const { return m_promptTokens; }
+    int completionTokens() const { return m_completionTokens; }
+    int requests() const { return m_requests; }
+
+    static QString metricsPath();
+
+private:
+    QString m_runId;
+    QString m_inputType;
+    qint64 m_runStartedAt;
+    QElapsedTimer m_runTimer;
+    int m_promptTokens;
+    int m_completionTokens;
+    int m_requests;
+};
+
+Q_DECLARE_METATYPE(PipelineMetrics::Span)
+
+#endif // PIPELINEMETRICS_H
@@ -1,13 +1,16 @@
 #include "promptquery.h"
+#include "responsecache.h"
+#include "tokenbudget.h"
+#include "httpclientpool.h"
+#include "asynclogger.h"
 #include <QNetworkRequest>
-#include <QNetworkCookieJar>
 #include <QUrl>
 #include <QDebug>
-#include <QFile>
 #include <QTextStream>
 #include <QDateTime>
 #include <QCoreApplication>
 #include <QDir>
+#include <QRegularExpression>
 
 // ===== BASE CLASS IMPLEMENTATION =====
 
@@ -16,9 +19,14 @@ PromptQuery::PromptQuery(QObject *parent)
     , m_temperature(0.8)
     , m_contextLength(8000)
     , m_timeout(120000)
-    , m_networkManager(nullptr)  // Don't create here - we'll create fresh one for each request
+    , m_maxTokens(8000)
     , m_currentReply(nullptr)
     , m_timeoutTimer(new QTimer(this))
+    , m_responseCache(nullptr)
+    , m_tokenBudget(nullptr)
+    , m_streaming(false)
+    , m_inactivityTimeout(DefaultInactivityTimeout)
+    , m_timeToFirstTokenMs(-1)
 {
     m_timeoutTimer->setSingleShot(true);
     connect(m_timeoutTimer, &QTimer::timeout, this, &PromptQuery::handleTimeout);
@@ -31,14 +39,6 @@ PromptQuery::~PromptQuery() {
         m_currentReply->deleteLater();
         m_currentReply = nullptr;
     }
-
-    // Explicitly delete the network manager
-    // (even though it's parented to this, be explicit for safety)
-    if (m_networkManager) {
-        m_networkManager->disconnect();
-        delete m_networkManager;
-        m_networkManager = nullptr;
-    }
 }
 
 void PromptQuery::setConnectionSettings(const QString& url, const QString& modelName) {
@@ -60,97 +60,117 @@ void PromptQuery::setPrompt(const QString& prompt) {
     m_prompt = prompt;
 }
 
+void PromptQuery::setResponseCache(ResponseCache* cache) {
+    m_responseCache = cache;
+}
+
+void PromptQuery::setTokenBudget(TokenBudget* budget) {
+    m_tokenBudget = budget;
+}
+
+void PromptQuery::setStreaming(bool enabled, int inactivityTimeout) {
+    m_streaming = enabled;
+    m_inactivityTimeout = inactivityTimeout;
+}
+
 void PromptQuery::execute(const QString& inputText) {
+    m_executeTimer.start();
+    m_stats = RequestStats();
+
     emit progressUpdate("Preparing " + getQueryType() + " request...");
 
-    QString fullPrompt = buildFullPrompt(inputText);
+    QString text = inputText;
+    m_maxTokens = m_contextLength;
+    if (m_tokenBudget && !inputText.isEmpty()) {
+        // Build the prompt around a marker to measure everything except the input
+        const QString userPrompt = buildFullPrompt(QString(TokenBudget::InputMarker));
+        const TokenBudget::Plan plan = m_tokenBudget->plan(m_preprompt, userPrompt, inputText, m_contextLength);
+        if (!plan.fits) {
+            emit errorOccurred(QString("Prompt does not fit the %1 token context window (~%2 tokens without the document)")
+                               .arg(m_tokenBudget->contextWindow()).arg(plan.promptTokens));
+            return;
+        }
+        if (plan.droppedTokens > 0) {
+            emit progressUpdate(QString("Input trimmed by ~%1 tokens to fit the %2 token context window")
+                               .arg(plan.droppedTokens).arg(m_tokenBudget->contextWindow()));
+        }
+        emit progressUpdate(QString("Prompt ~%1 tokens, %2 left for the response")
+                           .arg(plan.promptTokens).arg(plan.maxTokens));
+        text = plan.input;
+        m_maxTokens = plan.maxTokens;
+    }
+
+    QString fullPrompt = buildFullPrompt(text);
 
     if (fullPrompt.isEmpty()) {
         emit errorOccurred("Failed to build prompt");
         return;
     }
 
+    m_pendingCacheKey.clear();
+    m_cachedResponse.clear();
+
+    if (m_responseCache && m_responseCache->isEnabled()) {
+        m_pendingCacheKey = ResponseCache::makeKey(m_modelName, m_preprompt, fullPrompt,
+                                                   m_temperature, m_maxTokens);
+        QByteArray cached;
+        if (m_responseCache->lookup(m_pendingCacheKey, cached)) {
+            emit progressUpdate(QString("Response cache hit for %1 (%2 hits, %3 misses)")
+                               .arg(getQueryType())
+                               .arg(m_responseCache->hits())
+                               .arg(m_responseCache->misses()));
+            m_cachedResponse = cached;
+            // Deliver on the next event loop pass, same as a network reply would
+            QTimer::singleShot(0, this, &PromptQuery::deliverCachedResponse);
+            return;
+        }
+
+        if (m_responseCache->isBypassed()) {
+            emit progressUpdate("Response cache bypassed, sending fresh request");
+        } else {
+            emit progressUpdate(QString("Response cache miss for %1 (%2 hits, %3 misses)")
+                               .arg(getQueryType())
+                               .arg(m_responseCache->hits())
+                               .arg(m_responseCache->misses()));
+        }
+    }
+
     sendRequest(fullPrompt);
 }
 
+void PromptQuery::deliverCachedResponse() {
+    // Cleared by abort() if the user cancelled before delivery
+    if (m_cachedResponse.isEmpty()) {
+        return;
+    }
+
+    QByteArray response = m_cachedResponse;
+    m_cachedResponse.clear();
+    handleResponseData(response, true);
+}
+
 void PromptQuery::abort() {
     QString queryType = getQueryType();
     qDebug() << "PromptQuery::abort() called for" << queryType;
 
     // Write to abort log file
-    QFile abortLog("abort_debug.log");
-    if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&abortLog);
-        stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-               << " - PromptQuery::abort() called for " << queryType << Qt::endl;
-        abortLog.close();
-    }
+    AsyncLogger::instance()->lineNow("abort_debug.log", "PromptQuery::abort() called for " + queryType,
+                                     AsyncLogger::Info, AsyncLogger::DateTimeStamp);
+
+    // Drop any cached response that hasn't been delivered yet
+    m_cachedResponse.clear();
 
     // Force close the connection to stop LM Studio from continuing
     cleanupNetworkReply(true);
 
     qDebug() << "PromptQuery::abort() complete for" << queryType;
-    if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&abortLog);
-        stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-               << " - PromptQuery::abort() complete for " << queryType << Qt::endl;
-        abortLog.close();
-    }
+    AsyncLogger::instance()->lineNow("abort_debug.log", "PromptQuery::abort() complete for " + queryType,
+                                     AsyncLogger::Info, AsyncLogger::DateTimeStamp);
 }
 
 void PromptQuery::sendRequest(const QString& fullPrompt) {
-    // AGGRESSIVE CLEANUP: Create fresh QNetworkAccessManager for each request
-    // This nuclear option ensures NO state persists between operations
-    //
-    // RESOURCE MANAGEMENT GUARANTEE:
-    // 1. m_networkManager: Always deleted before creating new one
-    // 2. newManager: Deleted on any exception before assignment to m_networkManager
-    // 3. freshCookieJar: Parented to newManager, auto-deleted with manager
-    // 4. m_currentReply: Cleaned up via cleanupNetworkReply() and deleteLater()
-    // 5. On destruction: Destructor explicitly cleans up all resources
-
-    // First, clean up any existing manager
-    if (m_networkManager) {
-        m_networkManager->disconnect();
-        delete m_networkManager;
-        m_networkManager = nullptr;
-    }
-
-    // Create new manager with proper error handling
-    QNetworkAccessManager* newManager = nullptr;
-    try {
-        newManager = new QNetworkAccessManager(this);
-        if (!newManager) {
-            emit errorOccurred("Failed to create network manager");
-            return;
-        }
-
-        // AGGRESSIVE CLEANUP: Set a fresh cookie jar to ensure no cookie persistence
-        // Cookie jar is parented to newManager, so it will be auto-deleted
-        QNetworkCookieJar* freshCookieJar = new QNetworkCookieJar(newManager);
-        newManager->setCookieJar(freshCookieJar);
-
-        // Only assign to member after successful setup
-        m_networkManager = newManager;
-        newManager = nullptr; // Clear local pointer since ownership transferred
-        qDebug() << "Created fresh QNetworkAccessManager with clean cookie jar";
-
-    } catch (const std::exception& e) {
-        // Clean up the partially created manager
-        if (newManager) {
-            delete newManager;
-        }
-        emit errorOccurred(QString("Network manager creation failed: %1").arg(e.what()));
-        return;
-    } catch (...) {
-        // Clean up the partially created manager
-        if (newManager) {
-            delete newManager;
-        }
-        emit errorOccurred("Network manager creation failed: Unknown error");
-        return;
-    }
-
+    // Requests go through the shared HttpClientPool, which keeps connections to the
+    // endpoint alive between stages and drops them after failures or aborts
     QJsonArray messages;
 
     // If we have a preprompt, send it as a system message
@@ -171,7 +191,12 @@ void PromptQuery::sendRequest(const QString& fullPrompt) {
     requestBody["model"] = m_modelName;
     requestBody["messages"] = messages;
     requestBody["temperature"] = m_temperature;
-    requestBody["max_tokens"] = m_contextLength;
+    requestBody["max_tokens"] = m_maxTokens;
+    if (m_streaming) {
+        requestBody["stream"] = true;
+        // Without this the server sends no usage block and token metrics stay at -1
+        requestBody["stream_options"] = QJsonObject{ { "include_usage", true } };
+    }
 
     QJsonDocument doc(requestBody);
     QByteArray requestData = doc.toJson();
@@ -208,18 +233,18 @@ void PromptQuery::sendRequest(const QString& fullPrompt) {
     // Log the request summary (not full prompt to UI)
     emit progressUpdate(QString("=== %1 REQUEST SENT ===").arg(getQueryType().toUpper()));
     emit progressUpdate(QString("Model: %1, Temp: %2, Max Tokens: %3")
-                       .arg(m_modelName).arg(m_temperature).arg(m_contextLength));
+                       .arg(m_modelName).arg(m_temperature).arg(m_maxTokens));
 
-    // Write to lastrun.log
-    QFile logFile("lastrun.log");
-    if (logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&logFile);
+    // Write to lastrun.log (queued - the writer thread does the disk I/O)
+    {
+        QString entry;
+        QTextStream stream(&entry);
         stream << "\n=== " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
                << " - " << getQueryType() << " ===\n";
         stream << "URL: " << m_url << "\n";
         stream << "Model: " << m_modelName << "\n";
         stream << "Temperature: " << m_temperature << "\n";
-        stream << "Max Tokens: " << m_contextLength << "\n";
+        stream << "Max Tokens: " << m_maxTokens << "\n";
         if (!m_preprompt.isEmpty()) {
             stream << "--- System Message (Preprompt) ---\n";
             stream << m_preprompt << "\n";
@@ -228,19 +253,16 @@ void PromptQuery::sendRequest(const QString& fullPrompt) {
         stream << "--- User Message (Prompt) ---\n";
         stream << fullPrompt << "\n";
         stream << "--- End User Message ---\n";
-        logFile.close();
+        stream.flush();
+        AsyncLogger::instance()->append("lastrun.log", entry);
     }
 
     emit progressUpdate("Sending request to LM Studio...");
 
-    // Write complete request to transcript.log
-    QString appDir = QCoreApplication::applicationDirPath();
-    QString transcriptPath = QDir(appDir).absoluteFilePath("transcript.log");
-    QFile transcriptFile(transcriptPath);
-
-    // Open in append mode (will be truncated at start of new analysis)
-    if (transcriptFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&transcriptFile);
+    // Write complete request to transcript.log (truncated at start of new analysis)
+    {
+        QString entry;
+        QTextStream stream(&entry);
         stream << "\n" << QString("=").repeated(80) << "\n";
         stream << "REQUEST: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz") << "\n";
         stream << "Type: " << getQueryType() << "\n";
@@ -249,7 +271,8 @@ void PromptQuery::sendRequest(const QString& fullPrompt) {
         stream << "\n--- REQUEST BODY (RAW JSON) ---\n";
         stream << requestData << "\n";  // This is the actual JSON being sent
         stream << "--- END REQUEST BODY ---\n";
-        transcriptFile.close();
+        stream.flush();
+        AsyncLogger::instance()->append(QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("transcript.log"), entry);
     }
 
     // Log if the final prompt contains summary data
@@ -270,15 +293,17 @@ void PromptQuery::sendRequest(const QString& fullPrompt) {
         emit progressUpdate("✗ Final prompt does NOT contain 'Summary:' keyword");
     }
 
-    // AGGRESSIVE CLEANUP: Clear any global Qt network state before posting
-    // Note: QNetworkAccessManager doesn't have a static clearConnectionCache,
-    // but we can ensure our instance is clean
-    if (m_networkManager) {
-        m_networkManager->clearConnectionCache();
-        m_networkManager->clearAccessCache();
-    }
-
-    m_currentReply = m_networkManager->post(request, requestData);
+    // Reset streaming state for this request
+    m_sseParser.reset();
+    m_streamFilter.reset();
+    m_streamRaw.clear();
+    m_streamContent.clear();
+    m_streamReasoning.clear();
+    m_timeToFirstTokenMs = -1;
+    m_stats.bytesOut = requestData.size();
+    m_requestTimer.start();
+
+    m_currentReply = HttpClientPool::instance()->post(request, requestData);
     if (!m_currentReply) {
         emit errorOccurred("Failed to create network request");
         return;
@@ -286,6 +311,10 @@ void PromptQuery::sendRequest(const QString& fullPrompt) {
 
     connect(m_currentReply, &QNetworkReply::finished,
             this, &PromptQuery::handleNetworkReply);
+    if (m_streaming) {
+        connect(m_currentReply, &QNetworkReply::readyRead,
+                this, &PromptQuery::handleStreamData);
+    }
 
     m_timeoutTimer->start(m_timeout);
 }
@@ -315,25 +344,119 @@ void PromptQuery::handleNetworkReply() {
         return;
     }
 
-    QByteArray response = m_currentReply->readAll();
+    QByteArray response;
+    if (m_streaming) {
+        // Drain whatever arrived after the last readyRead
+        handleStreamData();
+        response = m_streamRaw;
+    } else {
+        response = m_currentReply->readAll();
+    }
     m_currentReply->deleteLater();
     m_currentReply = nullptr;
 
-    // Write complete response to transcript.log
-    QString appDir = QCoreApplication::applicationDirPath();
-    QString transcriptPath = QDir(appDir).absoluteFilePath("transcript.log");
-    QFile transcriptFile(transcriptPath);
+    m_stats.requestMs = m_requestTimer.elapsed();
+    m_stats.timeToFirstTokenMs = m_timeToFirstTokenMs;
+    m_stats.bytesIn = response.size();
+
+    emit progressUpdate("Connection pool: " + HttpClientPool::instance()->statsSummary(QUrl(m_url)));
 
-    if (transcriptFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&transcriptFile);
+    // Write complete response to transcript.log
+    {
+        QString entry;
+        QTextStream stream(&entry);
         stream << "\nRESPONSE: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz") << "\n";
         stream << "Type: " << getQueryType() << "\n";
         stream << "\n--- RESPONSE BODY (RAW JSON) ---\n";
         stream << response << "\n";  // This is the actual JSON received
         stream << "--- END RESPONSE BODY ---\n";
         stream << QString("=").repeated(80) << "\n";
-        transcriptFile.close();
+        stream.flush();
+        AsyncLogger::instance()->append(QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("transcript.log"), entry);
+    }
+
+    if (m_streaming) {
+        QString tail = m_streamFilter.finish();
+        if (!tail.isEmpty()) {
+            emit partialResult(tail);
+        }
+        emit progressUpdate(QString("Stream finished after %1 ms (first token after %2 ms, %3 chars)")
+                           .arg(m_requestTimer.elapsed())
+                           .arg(m_timeToFirstTokenMs)
+                           .arg(m_streamContent.length()));
+        response = buildResponseFromStream();
+    }
+
+    handleResponseData(response, false);
+}
+
+void PromptQuery::handleStreamData() {
+    if (!m_currentReply) {
+        return;
+    }
+
+    QByteArray bytes = m_currentReply->readAll();
+    if (bytes.isEmpty()) {
+        return;
     }
+    m_streamRaw.append(bytes);
+
+    // Data is flowing - from now on only inactivity counts
+    m_timeoutTimer->start(m_inactivityTimeout);
+
+    const QList<SseStreamParser::Delta> deltas = m_sseParser.feed(bytes);
+    for (const SseStreamParser::Delta& delta : deltas) {
+        if (m_timeToFirstTokenMs < 0) {
+            m_timeToFirstTokenMs = m_requestTimer.elapsed();
+            emit progressUpdate(QString("Time to first token: %1 ms").arg(m_timeToFirstTokenMs));
+        }
+
+        m_streamReasoning += delta.reasoning;
+        if (!delta.content.isEmpty()) {
+            m_streamContent += delta.content;
+            QString visible = m_streamFilter.feed(delta.content);
+            if (!visible.isEmpty()) {
+                emit partialResult(visible);
+            }
+        }
+    }
+}
+
+QByteArray PromptQuery::buildResponseFromStream() const {
+    // Server ignored "stream": true and sent a normal response
+    if (!m_sseParser.isDone() && m_streamContent.isEmpty() && m_streamReasoning.isEmpty()) {
+        return m_streamRaw;
+    }
+
+    // Reassemble the non-streaming shape so caching and parsing stay identical
+    QJsonObject message;
+    message["role"] = "assistant";
+    message["content"] = m_streamContent;
+    if (!m_streamReasoning.isEmpty()) {
+        message["reasoning"] = m_streamReasoning;
+    }
+
+    QJsonObject choice;
+    choice["index"] = 0;
+    choice["message"] = message;
+    choice["finish_reason"] = m_sseParser.finishReason();
+
+    QJsonObject obj;
+    obj["choices"] = QJsonArray{choice};
+    if (!m_sseParser.usage().isEmpty()) {
+        obj["usage"] = m_sseParser.usage();
+    }
+
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+void PromptQuery::handleResponseData(const QByteArray& response, bool fromCache) {
+    QElapsedTimer parseTimer;
+    parseTimer.start();
+    if (fromCache) {
+        m_stats.bytesIn = response.size();
+    }
+    m_stats.fromCache = fromCache;
 
     QJsonDocument doc = QJsonDocument::fromJson(response);
     if (doc.isNull()) {
@@ -382,8 +505,15 @@ void PromptQuery::handleNetworkReply() {
     QString thinkReasoning;
     content = extractThinkTags(content, thinkReasoning);
 
+    // Token counts as reported by the server (cached responses keep the original usage)
+    const QJsonObject usage = obj["usage"].toObject();
+    m_stats.promptTokens = usage.contains("prompt_tokens") ? usage["prompt_tokens"].toInt() : -1;
+    m_stats.completionTokens = usage.contains("completion_tokens") ? usage["completion_tokens"].toInt() : -1;
+    m_stats.parseMs = parseTimer.elapsed();
+
     // Log the response to UI (simplified)
-    emit progressUpdate(QString("=== %1 RESPONSE RECEIVED ===").arg(getQueryType().toUpper()));
+    emit progressUpdate(QString("=== %1 RESPONSE %2 ===")
+                       .arg(getQueryType().toUpper(), fromCache ? "FROM CACHE" : "RECEIVED"));
 
     // Show reasoning from both sources (gpt-oss reasoning field and <think> tags)
     bool hasReasoning = false;
@@ -416,9 +546,9 @@ void PromptQuery::handleNetworkReply() {
     }
 
     // Write full response to lastrun.log (content and all reasoning)
-    QFile logFile("lastrun.log");
-    if (logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&logFile);
+    {
+        QString entry;
+        QTextStream stream(&entry);
         stream << "--- Response Content (after think tag removal) ---\n";
         stream << content << "\n";
         stream << "--- End Content ---\n";
@@ -432,13 +562,20 @@ void PromptQuery::handleNetworkReply() {
             stream << thinkReasoning << "\n";
             stream << "--- End Reasoning ---\n";
         }
-        logFile.close();
+        stream.flush();
+        AsyncLogger::instance()->append("lastrun.log", entry);
     }
 
     emit progressUpdate("Processing response...");
 
     // Process with the content field (not reasoning)
     if (!content.isEmpty()) {
+        // Only cache usable responses, and before processResponse kicks off the next stage
+        if (!fromCache && m_responseCache) {
+            m_responseCache->store(m_pendingCacheKey, response);
+        }
+        m_stats.totalMs = m_executeTimer.elapsed();
+        emit requestFinished(getQueryType(), m_stats);
         processResponse(content);
     } else {
         emit errorOccurred("No content in response to process");
@@ -446,7 +583,12 @@ void PromptQuery::handleNetworkReply() {
 }
 
 void PromptQuery::handleTimeout() {
-    emit errorOccurred("Request timeout after " + QString::number(m_timeout/1000) + " seconds");
+    HttpClientPool::instance()->reportFailure(QUrl(m_url));
+    if (m_streaming && !m_streamRaw.isEmpty()) {
+        emit errorOccurred("Request timeout: no data for " + QString::number(m_inactivityTimeout/1000) + " seconds");
+    } else {
+        emit errorOccurred("Request timeout after " + QString::number(m_timeout/1000) + " seconds");
+    }
     // Use centralized cleanup but don't force close for timeouts
     cleanupNetworkReply(false);
 }
@@ -468,13 +610,8 @@ QString PromptQuery::removeHarmonyArtifacts(const QString& text) {
             emit progressUpdate(QString("Removed Harmony artifact: %1").arg(removedSequence));
 
             // Also log to file for debugging
-            QFile logFile("harmony_artifacts.log");
-            if (logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                QTextStream stream(&logFile);
-                stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << " - ";
-                stream << "Removed: " << removedSequence << Qt::endl;
-                logFile.close();
-            }
+            AsyncLogger::instance()->line("harmony_artifacts.log", "Removed: " + removedSequence,
+                                          AsyncLogger::Debug, AsyncLogger::DateTimeStamp);
         }
     }
 
@@ -502,13 +639,8 @@ QString PromptQuery::removeHarmonyArtifacts(const QString& text) {
             emit progressUpdate(QString("Removed incomplete Harmony sequence at end: %1").arg(removedSequence));
 
             // Log this too
-            QFile logFile("harmony_artifacts.log");
-            if (logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                QTextStream stream(&logFile);
-                stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << " - ";
-                stream << "Removed incomplete: " << removedSequence << Qt::endl;
-                logFile.close();
-            }
+            AsyncLogger::instance()->line("harmony_artifacts.log", "Removed incomplete: " + removedSequence,
+                                          AsyncLogger::Debug, AsyncLogger::DateTimeStamp);
         }
     }
 
@@ -553,15 +685,9 @@ QString PromptQuery::extractThinkTags(const QString& text, QString& reasoning) {
             emit progressUpdate(QString("Found and extracted <think> block (%1 characters)").arg(reasoning.length()));
 
             // Also log to file for debugging
-            QFile logFile("think_tags.log");
-            if (logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                QTextStream stream(&logFile);
-                stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << " - ";
-                stream << getQueryType() << " - Extracted think content:\n";
-                stream << reasoning << "\n";
-                stream << "--- End Think Content ---\n";
-                logFile.close();
-            }
+            AsyncLogger::instance()->line("think_tags.log",
+                                          getQueryType() + " - Extracted think content:\n" + reasoning + "\n--- End Think Content ---",
+                                          AsyncLogger::Debug, AsyncLogger::DateTimeStamp);
         } else {
             // Found opening <think> but no closing tag
             emit progressUpdate("Warning: Found <think> tag without closing </think>");
@@ -571,9 +697,263 @@ QString PromptQuery::extractThinkTags(const QString& text, QString& reasoning) {
     return cleaned.trimmed();
 }
 
+// ===== CHUNK SUMMARY QUERY IMPLEMENTATION =====
+
+ChunkSummaryQuery::ChunkSummaryQuery(QObject *parent)
+    : PromptQuery(parent)
+    , m_partIndex(0)
+    , m_partCount(1)
+{}
+
+void ChunkSummaryQuery::setPart(int index, int count) {
+    m_partIndex = index;
+    m_partCount = count;
+}
+
+QString ChunkSummaryQuery::buildFullPrompt(const QString& text) {
+    if (text.isEmpty()) {
+        return QString();
+    }
+
+    return QString("This is part %1 of %2 of a longer scientific document. "
+                   "Summarize this part on its own, keeping the key findings, methods, organisms, "
+                   "chemicals, quantitative results and conclusions it contains. "
+                   "Do not speculate about the other parts.\n\nText:\n%3")
+        .arg(m_partIndex + 1).arg(m_partCount).arg(text);
+}
+
+void ChunkSummaryQuery::processResponse(const QString& response) {
+    emit resultReady(removeHarmonyArtifacts(response));
+}
+
+QString ChunkSummaryQuery::getQueryType() const {
+    return QString("Summary Chunk %1/%2").arg(m_partIndex + 1).arg(m_partCount);
+}
+
 // ===== SUMMARY QUERY IMPLEMENTATION =====
 
-SummaryQuery::SummaryQuery(QObject *parent) : PromptQuery(parent) {}
+SummaryQuery::SummaryQuery(QObject *parent)
+    : PromptQuery(parent)
+    , m_chunkingEnabled(false)
+    , m_chunkTokens(DefaultChunkTokens)
+    , m_chunkOverlapTokens(DefaultChunkOverlapTokens)
+    , m_maxParallelChunks(1)
+    , m_nextChunk(0)
+    , m_chunksDone(0)
+    , m_mapRound(0)
+    , m_roundInputLength(0)
+{}
+
+void SummaryQuery::setChunking(bool enabled, int chunkTokens, int overlapTokens, int maxParallel) {
+    m_chunkingEnabled = enabled;
+    m_chunkTokens = qMax(500, chunkTokens);
+    // Overlap beyond half a chunk would make every chunk mostly repeat the previous one
+    m_chunkOverlapTokens = qBound(0, overlapTokens, m_chunkTokens / 2);
+    m_maxParallelChunks = qMax(1, maxParallel);
+}
+
+int SummaryQuery::estimateTokens(const QString& text) {
+    return TokenBudget::estimateTokens(text);
+}
+
+int SummaryQuery::countTokens(const QString& text) const {
+    return tokenBudget() ? tokenBudget()->countTokens(text) : estimateTokens(text);
+}
+
+QString SummaryQuery::takeTokens(const QString& text, int maxTokens) const {
+    if (tokenBudget()) {
+        return tokenBudget()->trimToTokens(text, maxTokens);
+    }
+    // Same fallback as TokenBudget: scale by this text's own characters per token
+    const double charsPerToken = static_cast<double>(text.size()) / qMax(1, estimateTokens(text));
+    return TokenBudget::trimToChars(text, static_cast<int>(maxTokens * charsPerToken));
+}
+
+void SummaryQuery::execute(const QString& inputText) {
+    if (!m_chunks.isEmpty()) {
+        abortChunks();
+    }
+    m_mapRound = 0;
+
+    if (!m_chunkingEnabled || countTokens(inputText) <= m_chunkTokens) {
+        PromptQuery::execute(inputText);
+        return;
+    }
+
+    startMapRound(inputText);
+}
+
+void SummaryQuery::abort() {
+    abortChunks();
+    PromptQuery::abort();
+}
+
+void SummaryQuery::abortChunks() {
+    // Clearing m_chunks first makes late results from aborted workers no-ops
+    m_chunks.clear();
+    m_partialSummaries.clear();
+    for (ChunkSummaryQuery* worker : m_chunkQueries) {
+        worker->abort();
+    }
+}
+
+QStringList SummaryQuery::splitIntoChunks(const QString& text, int chunkTokens, int overlapTokens) const {
+    // Pages are joined with blank lines, so paragraph boundaries cover page boundaries too
+    static const QRegularExpression paragraphBreak("\\n\\s*\\n");
+    QStringList units;
+    QList<int> unitTokens;
+    for (const QString& part : text.split(paragraphBreak, Qt::SkipEmptyParts)) {
+        QString paragraph = part.trimmed();
+        int tokens = countTokens(paragraph);
+        // A paragraph larger than a whole chunk is cut at a sentence or word boundary
+        while (tokens > chunkTokens) {
+            QString head = takeTokens(paragraph, chunkTokens);
+            if (head.isEmpty() || head.size() >= paragraph.size()) {
+                head = paragraph.left(qMax<qsizetype>(1, paragraph.size() / 2));
+            }
+            units << head;
+            unitTokens << countTokens(head);
+            paragraph = paragraph.mid(head.size()).trimmed();
+            tokens = countTokens(paragraph);
+        }
+        if (!paragraph.isEmpty()) {
+            units << paragraph;
+            unitTokens << tokens;
+        }
+    }
+
+    QStringList chunks;
+    QString current;
+    int currentTokens = 0;
+    int overlapCount = 0;  // Tokens at the start of current that repeat the previous chunk
+    for (int i = 0; i < units.size(); ++i) {
+        // The paragraph separator counts as one token
+        if (currentTokens > overlapCount && currentTokens + 1 + unitTokens[i] > chunkTokens) {
+            chunks << current;
+
+            // Carry the tail of the finished chunk over, starting at a word boundary
+            QString tail;
+            if (overlapTokens > 0) {
+                const double charsPerToken = static_cast<double>(current.size()) / qMax(1, currentTokens);
+                tail = current.right(static_cast<qsizetype>(overlapTokens * charsPerToken));
+                const qsizetype space = tail.indexOf(' ');
+                tail = (space >= 0 && space < tail.size() - 1) ? tail.mid(space + 1) : QString();
+            }
+            current = tail;
+            currentTokens = overlapCount = tail.isEmpty() ? 0 : countTokens(tail);
+        }
+        if (!current.isEmpty()) {
+            current += "\n\n";
+            currentTokens++;
+        }
+        current += units[i];
+        currentTokens += unitTokens[i];
+    }
+    if (currentTokens > overlapCount) {
+        chunks << current;
+    }
+
+    return chunks;
+}
+
+void SummaryQuery::startMapRound(const QString& text) {
+    m_mapRound++;
+    m_roundInputLength = text.length();
+    m_chunks = splitIntoChunks(text, m_chunkTokens, m_chunkOverlapTokens);
+    m_partialSummaries = QStringList();
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        m_partialSummaries << QString();
+    }
+    m_nextChunk = 0;
+    m_chunksDone = 0;
+
+    emit progressUpdate(QString("Document is ~%1 tokens, over the %2 token chunk size - summarizing %3 parts (round %4, %5 at a time)")
+                       .arg(countTokens(text))
+                       .arg(m_chunkTokens)
+                       .arg(m_chunks.size())
+                       .arg(m_mapRound)
+                       .arg(qMin(m_maxParallelChunks, static_cast<int>(m_chunks.size()))));
+
+    // Workers are kept between runs; each one works through chunks until none are left
+    while (m_chunkQueries.size() < qMin(m_maxParallelChunks, static_cast<int>(m_chunks.size()))) {
+        ChunkSummaryQuery* worker = new ChunkSummaryQuery(this);
+        connect(worker, &PromptQuery::resultReady, this, [this, worker](const QString& result) {
+            handleChunkResult(worker, result);
+        });
+        connect(worker, &PromptQuery::errorOccurred, this, [this, worker](const QString& error) {
+            handleChunkError(worker, error);
+        });
+        connect(worker, &PromptQuery::progressUpdate, this, &PromptQuery::progressUpdate);
+        connect(worker, &PromptQuery::requestFinished, this, &PromptQuery::requestFinished);
+        m_chunkQueries.append(worker);
+    }
+
+    const int workers = qMin(m_maxParallelChunks, static_cast<int>(m_chunks.size()));
+    for (int i = 0; i < workers; ++i) {
+        ChunkSummaryQuery* worker = m_chunkQueries[i];
+        // Same model, sampling and system prompt as the final summary; partials aren't streamed
+        worker->setConnectionSettings(m_url, m_modelName);
+        worker->setPromptSettings(m_temperature, m_contextLength, m_timeout);
+        worker->setPreprompt(m_preprompt);
+        worker->setResponseCache(responseCache());
+        worker->setTokenBudget(tokenBudget());
+        worker->setStreaming(false, inactivityTimeout());
+        startNextChunk(worker);
+    }
+}
+
+void SummaryQuery::startNextChunk(ChunkSummaryQuery* worker) {
+    const int index = m_nextChunk++;
+    worker->setPart(index, m_chunks.size());
+    worker->execute(m_chunks[index]);
+}
+
+void SummaryQuery::handleChunkResult(ChunkSummaryQuery* worker, const QString& result) {
+    if (m_chunks.isEmpty()) {
+        return;  // Aborted
+    }
+
+    m_partialSummaries[worker->partIndex()] = result;
+    m_chunksDone++;
+    emit progressUpdate(QString("Summarized part %1 of %2 (%3 done)")
+                       .arg(worker->partIndex() + 1).arg(m_chunks.size()).arg(m_chunksDone));
+
+    if (m_nextChunk < m_chunks.size()) {
+        startNextChunk(worker);
+    } else if (m_chunksDone == m_chunks.size()) {
+        reducePartialSummaries();
+    }
+}
+
+void SummaryQuery::handleChunkError(ChunkSummaryQuery* worker, const QString& error) {
+    if (m_chunks.isEmpty()) {
+        return;
+    }
+
+    const QString part = QString("part %1 of %2").arg(worker->partIndex() + 1).arg(m_chunks.size());
+    abortChunks();
+    emit errorOccurred(QString("Summary of %1 failed: %2").arg(part, error));
+}
+
+void SummaryQuery::reducePartialSummaries() {
+    QString combined;
+    for (int i = 0; i < m_partialSummaries.size(); ++i) {
+        combined += QString("[Part %1 of %2]\n%3\n\n").arg(i + 1).arg(m_partialSummaries.size()).arg(m_partialSummaries[i]);
+    }
+    combined = combined.trimmed();
+    m_chunks.clear();
+    m_partialSummaries.clear();
+
+    // Partial summaries can still be too long for one request - reduce again, as long as that shrinks them
+    if (countTokens(combined) > m_chunkTokens && combined.length() < m_roundInputLength) {
+        startMapRound(combined);
+        return;
+    }
+
+    emit progressUpdate(QString("Combining partial summaries (~%1 tokens) into the final summary")
+                       .arg(countTokens(combined)));
+    PromptQuery::execute(combined);
+}
 
 QString SummaryQuery::buildFullPrompt(const QString& text) {
     if (text.isEmpty()) {
@@ -739,21 +1119,15 @@ void PromptQuery::cleanupNetworkReply(bool forceClose) {
     if (m_currentReply) {
         qDebug() << "cleanupNetworkReply() - forceClose:" << forceClose;
 
-        // CRITICAL: Disconnect all signals first to prevent any callbacks
-        m_currentReply->disconnect();
+        // CRITICAL: Disconnect our slots first to prevent any callbacks
+        // (the pool's own connections stay so it sees the abort)
+        m_currentReply->disconnect(this);
         qDebug() << "  - Disconnected all signals";
 
         if (m_currentReply->isRunning()) {
-            if (forceClose && m_networkManager) {
-                // Force close the underlying socket to stop server processing
-                // This is more aggressive than abort() and tells the server we're done
-                // Clear all connections to force socket closure
-                m_networkManager->clearConnectionCache();
-                m_networkManager->clearAccessCache();
-                qDebug() << "  - Cleared connection cache to force socket closure";
-            }
-
-            // Now abort the request
+            // Aborting closes this request's socket, which stops server processing
+            // (forceClose is kept for callers; the pool now drops the endpoint's
+            // idle connections after any abort)
             m_currentReply->abort();
             qDebug() << "  - Aborted network reply";
         }
@@ -3,12 +3,30 @@
 
 #include <QObject>
 #include <QString>
-#include <QNetworkAccessManager>
+#include <QStringList>
 #include <QNetworkReply>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QTimer>
+#include <QElapsedTimer>
+#include "ssestream.h"
+
+class ResponseCache;
+class TokenBudget;
+
+// Timing and size of one completed request, reported with PromptQuery::requestFinished
+struct RequestStats {
+    qint64 totalMs = 0;             // execute() to parsed response
+    qint64 requestMs = 0;           // Request sent to last byte received (0 for cache hits)
+    qint64 timeToFirstTokenMs = -1; // Streaming only
+    qint64 parseMs = 0;             // JSON decoding and content/reasoning extraction
+    qint64 bytesOut = 0;            // Request body
+    qint64 bytesIn = 0;             // Response body
+    int promptTokens = -1;          // From the response "usage" field, -1 if not reported
+    int completionTokens = -1;
+    bool fromCache = false;
+};
 
 // Base class for all prompt queries
 class PromptQuery : public QObject {
@@ -23,12 +41,25 @@ public:
     void setPromptSettings(double temperature, int contextLength, int timeout);
     void setPreprompt(const QString& preprompt);
     void setPrompt(const QString& prompt);
+    void setResponseCache(ResponseCache* cache);  // Not owned; nullptr disables caching
+    // Not owned. contextLength is always the response limit (max_tokens). With a
+    // budget, the input is also trimmed to fit the budget's context window and
+    // max_tokens is lowered to what the prompt leaves over.
+    void setTokenBudget(TokenBudget* budget);
+
+    // Streaming ("stream": true). Once tokens flow, the timeout becomes an
+    // inactivity timeout instead of a limit on total duration.
+    void setStreaming(bool enabled, int inactivityTimeout = DefaultInactivityTimeout);
+    bool isStreaming() const { return m_streaming; }
+    qint64 timeToFirstTokenMs() const { return m_timeToFirstTokenMs; }  // -1 if not streamed
+
+    static constexpr int DefaultInactivityTimeout = 120000;  // 2 minutes
 
     // Execute the query
-    void execute(const QString& inputText);
+    virtual void execute(const QString& inputText);
 
     // Control methods
-    void abort();  // Cancel current request
+    virtual void abort();  // Cancel current request
 
     // Virtual methods for customization
     virtual QString buildFullPrompt(const QString& text) = 0;
@@ -39,14 +70,22 @@ signals:
     void resultReady(const QString& result);
     void errorOccurred(const QString& error);
     void progressUpdate(const QString& status);
+    void partialResult(const QString& delta);  // Visible text as it streams in
+    void requestFinished(const QString& queryType, const RequestStats& stats);  // Before resultReady
 
 protected:
     // Common implementation
     void sendRequest(const QString& fullPrompt);
     void handleNetworkReply();
+    void handleStreamData();
+    QByteArray buildResponseFromStream() const;
+    void handleResponseData(const QByteArray& response, bool fromCache);
     void handleTimeout();
     QString removeHarmonyArtifacts(const QString& text);
     QString extractThinkTags(const QString& text, QString& reasoning);
+    ResponseCache* responseCache() const { return m_responseCache; }
+    TokenBudget* tokenBudget() const { return m_tokenBudget; }
+    int inactivityTimeout() const { return m_inactivityTimeout; }
 
     // Settings
     QString m_url;
@@ -54,6 +93,7 @@ protected:
     double m_temperature;
     int m_contextLength;
     int m_timeout;
+    int m_maxTokens;  // Sent as max_tokens for the request in flight
 
     // Prompt components (needed by derived classes)
     QString m_preprompt;
@@ -61,13 +101,54 @@ protected:
 
 private:
     void cleanupNetworkReply(bool forceClose = false);
+    void deliverCachedResponse();
+
+    // Response cache
+    ResponseCache* m_responseCache;
+    TokenBudget* m_tokenBudget;
+    QString m_pendingCacheKey;
+    QByteArray m_cachedResponse;
+
+    // Streaming state
+    bool m_streaming;
+    int m_inactivityTimeout;
+    SseStreamParser m_sseParser;
+    StreamTextFilter m_streamFilter;
+    QByteArray m_streamRaw;
+    QString m_streamContent;
+    QString m_streamReasoning;
+    QElapsedTimer m_requestTimer;
+    qint64 m_timeToFirstTokenMs;
 
-    // Network handling
-    QNetworkAccessManager* m_networkManager;
+    // Metrics for the request in flight
+    QElapsedTimer m_executeTimer;
+    RequestStats m_stats;
+
+    // Network handling (connections are owned by HttpClientPool)
     QNetworkReply* m_currentReply;
     QTimer* m_timeoutTimer;
 };
 
+// Summarizes one part of a long document (map step of chunked summarization)
+class ChunkSummaryQuery : public PromptQuery {
+    Q_OBJECT
+
+public:
+    explicit ChunkSummaryQuery(QObject *parent = nullptr);
+    ~ChunkSummaryQuery() override = default;
+
+    void setPart(int index, int count);
+    int partIndex() const { return m_partIndex; }
+
+    QString buildFullPrompt(const QString& text) override;
+    void processResponse(const QString& response) override;
+    QString getQueryType() const override;
+
+private:
+    int m_partIndex;
+    int m_partCount;
+};
+
 // Query for extracting summaries
 class SummaryQuery : public PromptQuery {
     Q_OBJECT
@@ -76,9 +157,52 @@ public:
     explicit SummaryQuery(QObject *parent = nullptr);
     ~SummaryQuery() override = default;
 
+    // Chunked (map-reduce) mode: text over chunkTokens is split on paragraph/page
+    // boundaries, each part summarized separately (up to maxParallel at once),
+    // then the user's summary prompt runs over the combined partial summaries.
+    void setChunking(bool enabled, int chunkTokens, int overlapTokens, int maxParallel);
+    bool isChunking() const { return m_chunkingEnabled; }
+
+    void execute(const QString& inputText) override;
+    void abort() override;
+
     QString buildFullPrompt(const QString& text) override;
     void processResponse(const QString& response) override;
     QString getQueryType() const override;
+
+    // Local token estimate (TokenBudget::estimateTokens)
+    static int estimateTokens(const QString& text);
+    // Chunks of at most chunkTokens, counted like the prompt plan (with the
+    // budget's calibration, if a budget is set), each starting with about
+    // overlapTokens from the end of the previous one
+    QStringList splitIntoChunks(const QString& text, int chunkTokens, int overlapTokens) const;
+
+    static constexpr int DefaultChunkTokens = 6000;
+    static constexpr int DefaultChunkOverlapTokens = 200;
+
+private:
+    int countTokens(const QString& text) const;
+    QString takeTokens(const QString& text, int maxTokens) const;
+    void startMapRound(const QString& text);
+    void startNextChunk(ChunkSummaryQuery* worker);
+    void handleChunkResult(ChunkSummaryQuery* worker, const QString& result);
+    void handleChunkError(ChunkSummaryQuery* worker, const QString& error);
+    void reducePartialSummaries();
+    void abortChunks();
+
+    bool m_chunkingEnabled;
+    int m_chunkTokens;
+    int m_chunkOverlapTokens;
+    int m_maxParallelChunks;
+
+    // Map state for the current round
+    QList<ChunkSummaryQuery*> m_chunkQueries;
+    QStringList m_chunks;
+    QStringList m_partialSummaries;
+    int m_nextChunk;
+    int m_chunksDone;
+    int m_mapRound;
+    qsizetype m_roundInputLength;
 };
 
 // Query for extracting keywords
@@ -1,18 +1,40 @@
 #include "queryrunner.h"
 #include "safepdfloader.h"
+#include "pdfextractionjob.h"
+#include "sectionsegmenter.h"
+#include "textcleaner.h"
+#include "asynclogger.h"
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QRegularExpression>
 #include <QDebug>
-#include <QFile>
 #include <QFileInfo>
-#include <QTextStream>
 #include <QDateTime>
 #include <QCoreApplication>
 #include <QDir>
 #include <memory>
 #include <exception>
 
+namespace {
+// Pipeline order - also the start order when several stages are ready at once
+const QList<QueryRunner::ProcessingStage> PipelineStages = {
+    QueryRunner::GeneratingSummary,
+    QueryRunner::ExtractingKeywords,
+    QueryRunner::RefiningPrompt,
+    QueryRunner::ExtractingRefinedKeywords
+};
+
+// Stage names in the pipeline_stages table
+QString checkpointName(QueryRunner::ProcessingStage stage) {
+    switch (stage) {
+        case QueryRunner::GeneratingSummary: return "summary";
+        case QueryRunner::ExtractingKeywords: return "keywords";
+        case QueryRunner::RefiningPrompt: return "refinement";
+        case QueryRunner::ExtractingRefinedKeywords: return "refined_keywords";
+        default: return QString();
+    }
+}
+}
+
 QueryRunner::QueryRunner(QObject *parent)
     : QObject(parent)
     , m_currentStage(Idle)
@@ -21,9 +43,23 @@ QueryRunner::QueryRunner(QObject *parent)
     , m_keywordsQuery(new KeywordsQuery(this))
     , m_refineQuery(new RefineKeywordsQuery(this))
     , m_refinedKeywordsQuery(new KeywordsWithRefinementQuery(this))
-    , m_pdfDocument(new QPdfDocument(this))
+    , m_extractionWatchdog(new QTimer(this))
+    , m_extractionPages(-1)
+    , m_awaitingCalibration(false)
     , m_singleStepMode(false)
 {
+    // QPdfDocument::load can't be interrupted, so a stuck load is abandoned instead
+    m_extractionWatchdog->setSingleShot(true);
+    m_extractionWatchdog->setInterval(PdfLoadTimeoutMs);
+    connect(m_extractionWatchdog, &QTimer::timeout, this, [this]() {
+        cancelExtraction();
+        finishRun("error");
+        m_currentStage = Idle;
+        emit stageChanged(m_currentStage);
+        emit errorOccurred(QString("Failed to load PDF: loading timed out after %1 seconds")
+                           .arg(PdfLoadTimeoutMs / 1000));
+    });
+
     // Connect query signals
     connect(m_summaryQuery, &PromptQuery::resultReady,
             this, &QueryRunner::handleSummaryResult);
@@ -53,6 +89,41 @@ QueryRunner::QueryRunner(QObject *parent)
     connect(m_refinedKeywordsQuery, &PromptQuery::progressUpdate,
             this, &QueryRunner::progressMessage);
 
+    // Forward streamed text tagged with the stage it belongs to
+    // (stages may stream concurrently, so m_currentStage isn't enough)
+    for (ProcessingStage stage : PipelineStages) {
+        connect(queryForStage(stage), &PromptQuery::partialResult, this, [this, stage](const QString& delta) {
+            emit partialResult(stage, delta);
+        });
+        connect(queryForStage(stage), &PromptQuery::requestFinished, this, &QueryRunner::recordRequest);
+    }
+
+    // All queries share one response cache
+    m_summaryQuery->setResponseCache(&m_responseCache);
+    m_keywordsQuery->setResponseCache(&m_responseCache);
+    m_refineQuery->setResponseCache(&m_responseCache);
+    m_refinedKeywordsQuery->setResponseCache(&m_responseCache);
+
+    // All queries budget prompts with the same (possibly server-calibrated) counter
+    m_summaryQuery->setTokenBudget(&m_tokenBudget);
+    m_keywordsQuery->setTokenBudget(&m_tokenBudget);
+    m_refineQuery->setTokenBudget(&m_tokenBudget);
+    m_refinedKeywordsQuery->setTokenBudget(&m_tokenBudget);
+
+    // Either way the pipeline goes on; without calibration the local estimate is used
+    connect(&m_tokenBudget, &TokenBudget::calibrated, this, [this](double ratio) {
+        if (m_awaitingCalibration) {
+            emit progressMessage(QString("Server tokenizer counts %1 tokens per estimated token").arg(ratio, 0, 'f', 2));
+            startStages();
+        }
+    });
+    connect(&m_tokenBudget, &TokenBudget::calibrationFailed, this, [this](const QString& error) {
+        if (m_awaitingCalibration) {
+            emit progressMessage(QString("Server tokenizer unavailable (%1), using local token estimates").arg(error));
+            startStages();
+        }
+    });
+
     // Connect abort signal to all queries
     connect(this, &QueryRunner::abortRequested, m_summaryQuery, &PromptQuery::abort);
     connect(this, &QueryRunner::abortRequested, m_keywordsQuery, &PromptQuery::abort);
@@ -64,20 +135,35 @@ QueryRunner::QueryRunner(QObject *parent)
 }
 
 QueryRunner::~QueryRunner() {
-    // Ensure PDF document is closed before destruction
-    if (m_pdfDocument) {
-        m_pdfDocument->close();
+    // The worker uses m_extractionCache, so it must be gone before we are
+    if (m_extractionJob) {
+        PdfExtractionJob* job = m_extractionJob;
+        cancelExtraction();
+        job->wait();
     }
     // Other cleanup handled by QObject parent-child relationships
 }
 
 void QueryRunner::reset() {
+    cancelExtraction();
+    m_awaitingCalibration = false;
+    m_tokenBudget.cancelCalibration();
+    finishRun("aborted");  // No-op unless a run was interrupted
     m_currentStage = Idle;
+    m_stageStates.clear();
     emit stageChanged(m_currentStage);
 
+    // Stages finished so far stay saved for the next run of the same document
+    if (!m_jobKey.isEmpty()) {
+        m_jobStore.markInterrupted(m_jobKey);
+        m_jobKey.clear();
+    }
+
     // Clear ALL persistent state from previous runs
     m_extractedText.clear();
+    m_structuredText.clear();
     m_cleanedText.clear();
+    m_fullCleanedText.clear();
     m_summary.clear();
     m_originalKeywords.clear();
     m_suggestedPrompt.clear();
@@ -97,13 +183,8 @@ void QueryRunner::abort() {
     qDebug() << "QueryRunner::abort() called at stage:" << stage;
 
     // Write to abort log file for debugging hangs
-    QFile abortLog("abort_debug.log");
-    if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&abortLog);
-        stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-               << " - QueryRunner::abort() called at stage: " << stage << Qt::endl;
-        abortLog.close();
-    }
+    AsyncLogger::instance()->lineNow("abort_debug.log", "QueryRunner::abort() called at stage: " + stage,
+                                     AsyncLogger::Info, AsyncLogger::DateTimeStamp);
 
     emit progressMessage("Aborting current operation...");
 
@@ -117,12 +198,8 @@ void QueryRunner::abort() {
     reset();
 
     qDebug() << "QueryRunner::abort() complete";
-    if (abortLog.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        QTextStream stream(&abortLog);
-        stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-               << " - QueryRunner::abort() complete" << Qt::endl;
-        abortLog.close();
-    }
+    AsyncLogger::instance()->lineNow("abort_debug.log", "QueryRunner::abort() complete",
+                                     AsyncLogger::Info, AsyncLogger::DateTimeStamp);
 }
 
 void QueryRunner::processKeywordsOnly() {
@@ -147,6 +224,7 @@ void QueryRunner::processKeywordsOnly() {
     m_singleStepMode = true;
 
     // Run keyword extraction with fresh database settings
+    m_metrics.beginRun("keywords");
     runKeywordExtraction();
 }
 
@@ -160,6 +238,7 @@ void QueryRunner::processKeywordsOnly(const QString& extractedText, const QStrin
     // Set the text from UI (source of truth)
     m_cleanedText = extractedText;
     m_extractedText = extractedText;
+    m_structuredText.clear();
     m_summary = summaryText;
 
     // Check prerequisites after setting text
@@ -182,10 +261,11 @@ void QueryRunner::processKeywordsOnly(const QString& extractedText, const QStrin
     m_singleStepMode = true;
 
     // Run keyword extraction with fresh database settings and UI text
+    m_metrics.beginRun("keywords");
     runKeywordExtraction();
 }
 
-void QueryRunner::processPDF(const QString& filePath) {
+void QueryRunner::processPDF(const QString& filePath, const QByteArray& contentHash) {
     // SAFETY CHECKS FIRST - Apply to ALL PDFs, not just Zotero
     try {
         if (filePath.isEmpty()) {
@@ -231,29 +311,30 @@ void QueryRunner::processPDF(const QString& filePath) {
         reset();
     }
 
+    m_metrics.beginRun("pdf");
     m_currentStage = ExtractingText;
     m_currentInputType = PDFFile;
+    m_extractionCacheKey.clear();
+    m_cachedCleanedText.clear();
     emit stageChanged(m_currentStage);
     emit progressMessage("Opening PDF file...");
 
-    QString extractedText = extractTextFromPDF(filePath);
-
-    qDebug() << "PDF extraction result length:" << extractedText.length();
+    startExtraction(filePath, contentHash);
+}
 
-    if (extractedText.isEmpty()) {
-        // Ensure PDF is closed on error (though extractTextFromPDF should have already closed it)
-        m_pdfDocument->close();
-        m_currentStage = Idle;
-        emit stageChanged(m_currentStage);
-        emit errorOccurred("Failed to extract text from PDF");
-        return;
+void QueryRunner::processExtractedText(const QString& extractedText, const QString& cachedCleanedText,
+                                       const QString& cacheKey, const StructuredText& structure) {
+    if (m_currentStage != Idle) {
+        emit progressMessage("Note: Resetting from previous incomplete operation");
+        reset();
     }
 
-    m_extractedText = extractedText;
-    emit textExtracted(m_extractedText);
+    m_metrics.beginRun("pdf");
+    m_currentStage = ExtractingText;
+    m_currentInputType = PDFFile;
+    emit stageChanged(m_currentStage);
 
-    qDebug() << "Starting pipeline with" << extractedText.length() << "characters";
-    startPipeline(extractedText, PDFFile);
+    handleExtractionFinished(extractedText, cachedCleanedText, cacheKey, structure);
 }
 
 void QueryRunner::processText(const QString& text) {
@@ -267,180 +348,249 @@ void QueryRunner::processText(const QString& text) {
         return;
     }
 
+    m_metrics.beginRun("text");
     m_currentStage = ExtractingText;
     m_currentInputType = PastedText;
     emit stageChanged(m_currentStage);
     emit progressMessage("Processing pasted text...");
 
     m_extractedText = text;
+    m_structuredText.clear();
     emit textExtracted(m_extractedText);
 
     startPipeline(text, PastedText);
 }
 
-QString QueryRunner::extractTextFromPDF(const QString& filePath) {
-    try {
-        // Close any previously open document first
-        try {
-            m_pdfDocument->close();
-        } catch (...) {
-            // Ignore cleanup exceptions
-        }
+PdfExtractionJob* QueryRunner::createExtractionJob(const QString& filePath, const QByteArray& contentHash) {
+    PdfExtractionJob* job = new PdfExtractionJob(filePath, &m_extractionCache, cleanupOptionsKey(),
+                                                 m_settings.extractionWorkers);
+    job->setContentHash(contentHash);
+    return job;
+}
 
-        // Use SafePdfLoader for safe loading and extraction
-        QString loadError;
-        auto tempDoc = std::make_unique<QPdfDocument>();
+void QueryRunner::startExtraction(const QString& filePath, const QByteArray& contentHash) {
+    cancelExtraction();
 
-        emit progressMessage("Loading PDF file...");
+    // Load and extract on a worker thread; results come back through the handlers below
+    PdfExtractionJob* job = createExtractionJob(filePath, contentHash);
+    m_extractionJob = job;
+    m_extractionTimer.start();
+    m_extractionPages = -1;
 
-        if (!SafePdfLoader::loadPdf(tempDoc.get(), filePath, loadError, 60000)) { // 60 second timeout
-            emit errorOccurred("Failed to load PDF: " + loadError);
-            return QString();
+    connect(job, &PdfExtractionJob::progressMessage, this, &QueryRunner::progressMessage);
+    connect(job, &PdfExtractionJob::documentLoaded, this, [this, job](int pageCount) {
+        if (job != m_extractionJob) {
+            return;
         }
-
-        emit progressMessage("Extracting text from PDF...");
-
-        // Extract text safely
-        QString extractError;
-        QString extractedText = SafePdfLoader::extractTextSafely(tempDoc.get(), extractError);
-
-        if (extractedText.isEmpty()) {
-            emit errorOccurred("Failed to extract text: " + extractError);
-            return QString();
+        m_extractionWatchdog->stop();
+        m_extractionPages = pageCount;
+        emit extractionProgress(0, pageCount);
+    });
+    connect(job, &PdfExtractionJob::pageProgress, this, [this, job](int pagesDone, int pageCount) {
+        if (job == m_extractionJob) {
+            emit extractionProgress(pagesDone, pageCount);
         }
+    });
+    connect(job, &PdfExtractionJob::finished, this,
+            [this, job, filePath](const QString& extractedText, const QString& cachedCleanedText,
+                                  const QString& cacheKey, bool fromCache, const StructuredText& structure) {
+        // Queued results can still arrive after the job was cancelled
+        if (job != m_extractionJob) {
+            return;
+        }
+        PipelineMetrics::Span span;
+        span.name = "extraction";
+        span.bytesIn = QFileInfo(filePath).size();
+        span.charsOut = extractedText.size();
+        span.pages = m_extractionPages;
+        span.cacheHit = fromCache;
+        recordSpan(span, m_extractionTimer);
+
+        handleExtractionFinished(extractedText, cachedCleanedText, cacheKey, structure);
+    });
+    connect(job, &PdfExtractionJob::failed, this, [this, job, filePath](const QString& error) {
+        if (job != m_extractionJob) {
+            return;
+        }
+        PipelineMetrics::Span span;
+        span.name = "extraction";
+        span.status = "error";
+        span.bytesIn = QFileInfo(filePath).size();
+        span.pages = m_extractionPages;
+        recordSpan(span, m_extractionTimer);
+
+        handleExtractionFailed(error);
+    });
+
+    m_extractionWatchdog->start();
+    job->start();
+}
 
-        // Document is automatically cleaned up when tempDoc goes out of scope
-        emit progressMessage("PDF extraction completed successfully");
-
-        return extractedText;
-
-    } catch (const std::exception& e) {
-        QString errorMsg = QString("Exception during PDF extraction: %1").arg(e.what());
-        emit errorOccurred(errorMsg);
-        qDebug() << errorMsg;
-        return QString();
-    } catch (...) {
-        emit errorOccurred("Unknown exception during PDF extraction");
-        qDebug() << "Unknown exception in QueryRunner::extractTextFromPDF";
-        return QString();
+void QueryRunner::cancelExtraction() {
+    m_extractionWatchdog->stop();
+    if (!m_extractionJob) {
+        return;
     }
-}
 
-QString QueryRunner::cleanupText(const QString& text, InputType type) {
-    QString cleaned = text;
+    qDebug() << "QueryRunner: cancelling PDF extraction";
+    // The job stops at its next page and deletes itself once its thread exits
+    m_extractionJob->disconnect(this);
+    m_extractionJob->cancel();
+    m_extractionJob.clear();
+}
 
-    // Normalize line endings FIRST (Windows \r\n to Unix \n)
-    cleaned.replace("\r\n", "\n");
-    cleaned.replace("\r", "\n");
+void QueryRunner::handleExtractionFinished(const QString& extractedText, const QString& cachedCleanedText,
+                                           const QString& cacheKey, const StructuredText& structure) {
+    m_extractionWatchdog->stop();
+    m_extractionJob.clear();
 
-    // Always remove copyright notices for LLM processing
-    cleaned = removeCopyrightNotices(cleaned);
+    qDebug() << "PDF extraction result length:" << extractedText.length();
 
-    // Remove problematic Unicode characters that confuse LLMs
-    // Remove soft hyphens and other invisible formatting characters
-    cleaned.remove(QChar(0x00AD)); // Soft hyphen
-    cleaned.remove(QChar(0xFFFD)); // Replacement character
-    cleaned.remove(QChar(0xFFF9)); // Interlinear annotation anchor
-    cleaned.remove(QChar(0xFFFA)); // Interlinear annotation separator
-    cleaned.remove(QChar(0xFFFB)); // Interlinear annotation terminator
+    m_extractionCacheKey = cacheKey;
+    m_cachedCleanedText = cachedCleanedText;
+    m_extractedText = extractedText;
+    m_structuredText = structure;
+    emit textExtracted(m_extractedText);
 
-    // Remove excessive whitespace
-    cleaned.replace(QRegularExpression("\\n{3,}"), "\n\n");
-    cleaned.replace(QRegularExpression("[ \\t]+"), " ");
+    qDebug() << "Starting pipeline with" << extractedText.length() << "characters";
+    startPipeline(extractedText, PDFFile);
+}
 
-    // Handle special characters based on input type
-    if (type == PastedText) {
-        // Pasted text might have formatting artifacts
-        // Remove zero-width characters
-        cleaned.remove(QChar(0x200B)); // Zero-width space
-        cleaned.remove(QChar(0xFEFF)); // Zero-width no-break space
+void QueryRunner::handleExtractionFailed(const QString& error) {
+    m_extractionWatchdog->stop();
+    m_extractionJob.clear();
+    finishRun("error");
 
-        // Normalize quotes
-        cleaned.replace(QRegularExpression("[""„]"), "\"");
-        cleaned.replace(QRegularExpression("['']"), "'");
-    }
+    m_currentStage = Idle;
+    emit stageChanged(m_currentStage);
+    emit errorOccurred(error);
+}
 
-    // Trim leading/trailing whitespace
-    cleaned = cleaned.trimmed();
+QString QueryRunner::cleanupText(const QString& text, InputType type) {
+    // Line endings, copyright/license lines, invisible characters and whitespace
+    // are all handled in one scan - see TextCleaner for the exact rules
+    return TextCleaner::clean(text, type == PastedText ? TextCleaner::PastedText : TextCleaner::PdfText);
+}
 
-    // Ensure text isn't too long for the model
-    if (cleaned.length() > m_settings.textTruncationLimit) {
-        emit progressMessage(QString("Text truncated to %1 characters").arg(m_settings.textTruncationLimit));
-        cleaned = cleaned.left(m_settings.textTruncationLimit);
+QString QueryRunner::truncateForModel(const QString& text) {
+    // Hard cap only; each request trims the text again to fit its own token budget
+    if (text.length() > m_settings.textTruncationLimit) {
+        emit progressMessage(QString("Text capped at %1 characters").arg(m_settings.textTruncationLimit));
+        return TokenBudget::trimToChars(text, m_settings.textTruncationLimit);
     }
-
-    return cleaned;
+    return text;
 }
 
-QString QueryRunner::removeCopyrightNotices(const QString& text) {
-    QString result = text;
-
-    // Remove copyright lines
-    result.remove(QRegularExpression("Copyright.*\\n", QRegularExpression::CaseInsensitiveOption));
-    result.remove(QRegularExpression("©.*\\n"));
+void QueryRunner::selectSections() {
+    if (m_settings.excludedSections == 0) {
+        return;
+    }
 
-    // Remove All Rights Reserved variations
-    result.remove(QRegularExpression("All [Rr]ights [Rr]eserved.*\\n"));
+    QElapsedTimer timer;
+    timer.start();
+    const SectionSegmenter::Selection selection = SectionSegmenter::select(m_fullCleanedText,
+                                                                           m_settings.excludedSections);
+    if (selection.droppedChars == 0) {
+        if (!selection.segmented) {
+            emit progressMessage("No section headings found, sending the whole text");
+        }
+        return;
+    }
 
-    // Remove license headers (common patterns)
-    result.remove(QRegularExpression("Licensed under.*\\n"));
-    result.remove(QRegularExpression("This .* is licensed.*\\n"));
+    PipelineMetrics::Span span;
+    span.name = "sections";
+    span.charsIn = m_fullCleanedText.length();
+    span.charsOut = selection.text.length();
+    recordSpan(span, timer);
 
-    // Remove standalone license lines
-    result.remove(QRegularExpression("\\bLicense\\b.*\\n", QRegularExpression::CaseInsensitiveOption));
+    const int droppedTokens = TokenBudget::estimateTokens(m_fullCleanedText) - TokenBudget::estimateTokens(selection.text);
+    emit progressMessage(QString("Left out %1: %2 characters, ~%3 tokens")
+                         .arg(selection.droppedHeadings.join(", ")).arg(selection.droppedChars).arg(droppedTokens));
+    m_fullCleanedText = selection.text;
+}
 
-    return result;
+QString QueryRunner::cleanupOptionsKey() const {
+    // Anything that changes cleanupText output for a PDF must be part of the cache key
+    // (truncation happens after the cache, so the limit isn't part of it).
+    // Cached extractions are stored with page boilerplate already removed.
+    return QString("cleanup=v2;type=pdf;boilerplate=v1");
 }
 
 void QueryRunner::startPipeline(const QString& text, InputType type) {
+    const QString inputType = (type == PDFFile ? "PDF File" : "Pasted Text");
+
     // Clear the lastrun.log file at the start of each run
-    QFile logFile("lastrun.log");
-    if (logFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        QTextStream stream(&logFile);
-        stream << "=== PDF EXTRACTOR RUN LOG ===" << Qt::endl;
-        stream << "Started: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << Qt::endl;
-        stream << "Input Type: " << (type == PDFFile ? "PDF File" : "Pasted Text") << Qt::endl;
-        stream << Qt::endl;
-        logFile.close();
-    }
+    AsyncLogger::instance()->truncate("lastrun.log",
+        QString("=== PDF EXTRACTOR RUN LOG ===\nStarted: %1\nInput Type: %2\n\n")
+            .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"), inputType));
 
     // Clear the transcript.log file at the start of each run
-    QString appDir = QCoreApplication::applicationDirPath();
-    QString transcriptPath = QDir(appDir).absoluteFilePath("transcript.log");
-    QFile transcriptFile(transcriptPath);
-    if (transcriptFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        QTextStream stream(&transcriptFile);
-        stream << "=== NETWORK TRANSCRIPT LOG ===" << Qt::endl;
-        stream << "Started: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz") << Qt::endl;
-        stream << "This log contains complete request/response JSON for all API calls" << Qt::endl;
-        stream << "Input Type: " << (type == PDFFile ? "PDF File" : "Pasted Text") << Qt::endl;
-        transcriptFile.close();
-    }
+    AsyncLogger::instance()->truncate(QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("transcript.log"),
+        QString("=== NETWORK TRANSCRIPT LOG ===\nStarted: %1\n"
+                "This log contains complete request/response JSON for all API calls\nInput Type: %2\n")
+            .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz"), inputType));
 
     // Clean up the text
     qDebug() << "Text before cleanup:" << text.length() << "characters";
     qDebug() << "First 200 chars before cleanup:" << text.left(200);
-    m_cleanedText = cleanupText(text, type);
-    qDebug() << "Text after cleanup:" << m_cleanedText.length() << "characters";
-    qDebug() << "First 200 chars after cleanup:" << m_cleanedText.left(200);
+    QElapsedTimer cleanupTimer;
+    cleanupTimer.start();
+    PipelineMetrics::Span cleanupSpan;
+    cleanupSpan.name = "cleanup";
+    cleanupSpan.charsIn = text.length();
+    if (type == PDFFile && !m_cachedCleanedText.isEmpty()) {
+        m_fullCleanedText = m_cachedCleanedText;
+        cleanupSpan.cacheHit = true;
+        cleanupSpan.charsOut = m_fullCleanedText.length();
+        recordSpan(cleanupSpan, cleanupTimer);
+        emit progressMessage("Using cached cleaned text");
+    } else {
+        m_fullCleanedText = cleanupText(text, type);
+        cleanupSpan.charsOut = m_fullCleanedText.length();
+        recordSpan(cleanupSpan, cleanupTimer);
+        if (type == PDFFile) {
+            m_extractionCache.store(m_extractionCacheKey, text, m_fullCleanedText, &m_structuredText);
+        }
+    }
+    qDebug() << "Text after cleanup:" << m_fullCleanedText.length() << "characters";
+    qDebug() << "First 200 chars after cleanup:" << m_fullCleanedText.left(200);
 
-    if (m_cleanedText.length() < text.length() / 2) {
+    if (m_fullCleanedText.length() < text.length() / 2) {
         qDebug() << "WARNING: Cleanup removed more than half the text!";
     }
 
+    // After the cache, so changing the selection doesn't invalidate cleaned text
+    selectSections();
+    m_cleanedText = truncateForModel(m_fullCleanedText);
+
     if (m_cleanedText.isEmpty()) {
-        // Ensure PDF is closed if we're processing a PDF
-        if (type == PDFFile) {
-            m_pdfDocument->close();
-        }
+        finishRun("error");
         m_currentStage = Idle;
         emit stageChanged(m_currentStage);
         emit errorOccurred("No text remaining after cleanup");
         return;
     }
 
-    // Start with summary extraction
-    runSummaryExtraction();
+    // Measure the server's tokenizer once per endpoint before the first prompt is budgeted
+    if (m_tokenBudget.needsCalibration()) {
+        m_awaitingCalibration = true;
+        emit progressMessage("Measuring the server's tokenizer...");
+        m_tokenBudget.calibrate(m_fullCleanedText);
+        return;
+    }
+
+    startStages();
+}
+
+void QueryRunner::startStages() {
+    m_awaitingCalibration = false;
+
+    // Start every stage whose inputs are ready (summary first),
+    // after taking the ones an interrupted run already finished
+    initPipelineGraph();
+    beginJob();
+    resumeFromCheckpoints();
+    schedulePipeline();
 }
 
 void QueryRunner::runSummaryExtraction() {
@@ -454,8 +604,14 @@ void QueryRunner::runSummaryExtraction() {
                                       m_settings.summaryTimeout);
     m_summaryQuery->setPreprompt(m_settings.summaryPreprompt);
     m_summaryQuery->setPrompt(m_settings.summaryPrompt);
-
-    m_summaryQuery->execute(m_cleanedText);
+    m_summaryQuery->setChunking(m_settings.summaryChunkingEnabled,
+                                m_settings.summaryChunkTokens,
+                                m_settings.summaryChunkOverlap,
+                                m_settings.maxConcurrentRequests);
+
+    // Chunking covers the whole document instead of cutting it at the truncation limit
+    m_summaryQuery->execute(m_settings.summaryChunkingEnabled && !m_fullCleanedText.isEmpty()
+                            ? m_fullCleanedText : m_cleanedText);
 }
 
 void QueryRunner::runKeywordExtraction() {
@@ -538,15 +694,14 @@ void QueryRunner::handleSummaryResult(const QString& result) {
     if (m_summary.isEmpty() ||
         m_summary.compare("Not Evaluated", Qt::CaseInsensitive) == 0) {
         emit progressMessage("Summary not successful - ending process");
-        m_currentStage = Complete;
-        emit stageChanged(m_currentStage);
-        emit processingComplete();
-        emit progressMessage("Processing ended due to summary failure");
-        m_currentStage = Idle;
+        m_stageStates[GeneratingSummary] = StageDone;
+        cancelRunningStages();
+        finishRun("failed");
+        completePipeline("Processing ended due to summary failure");
         return;
     }
 
-    advanceToNextStage();
+    finishStage(GeneratingSummary);
 }
 
 void QueryRunner::handleKeywordsResult(const QString& result) {
@@ -556,6 +711,7 @@ void QueryRunner::handleKeywordsResult(const QString& result) {
     if (m_singleStepMode) {
         // Single-step keyword extraction - don't advance
         m_singleStepMode = false;  // Reset flag
+        finishRun("ok");
         m_currentStage = Complete;
         emit stageChanged(m_currentStage);
         emit processingComplete();  // This triggers UI re-enable
@@ -563,7 +719,7 @@ void QueryRunner::handleKeywordsResult(const QString& result) {
         m_currentStage = Idle;
     } else {
         // Part of full pipeline - continue normally
-        advanceToNextStage();
+        finishStage(ExtractingKeywords);
     }
 }
 
@@ -576,65 +732,262 @@ void QueryRunner::handleRefinementResult(const QString& result) {
     if (m_suggestedPrompt.isEmpty() ||
         m_suggestedPrompt.compare("Not Evaluated", Qt::CaseInsensitive) == 0) {
         emit progressMessage("Refinement not successful - completing process");
-        m_currentStage = Complete;
-        emit stageChanged(m_currentStage);
-        emit processingComplete();
-        emit progressMessage("All processing complete");
-        m_currentStage = Idle;
+        if (m_stageStates.contains(ExtractingRefinedKeywords)) {
+            m_stageStates[ExtractingRefinedKeywords] = StageSkipped;
+        }
+        finishStage(RefiningPrompt);
         return;
     }
 
-    emit progressMessage(QString("Current stage before advance: %1").arg(m_currentStage));
-    advanceToNextStage();
-    emit progressMessage(QString("Current stage after advance: %1").arg(m_currentStage));
+    finishStage(RefiningPrompt);
 }
 
 void QueryRunner::handleRefinedKeywordsResult(const QString& result) {
     m_refinedKeywords = result;
     emit progressMessage(QString("Refined keywords result (first 100 chars): %1").arg(result.left(100)));
     emit refinedKeywordsExtracted(m_refinedKeywords);
-    advanceToNextStage();
+    finishStage(ExtractingRefinedKeywords);
 }
 
-void QueryRunner::advanceToNextStage() {
-    switch (m_currentStage) {
+void QueryRunner::initPipelineGraph() {
+    m_stageStates.clear();
+    for (ProcessingStage stage : PipelineStages) {
+        m_stageStates[stage] = StagePending;
+    }
+
+    if (m_settings.skipRefinement) {
+        emit progressMessage("Skipping keyword refinement as per settings");
+        m_stageStates[RefiningPrompt] = StageSkipped;
+        m_stageStates[ExtractingRefinedKeywords] = StageSkipped;
+    }
+}
+
+bool QueryRunner::stageInputsReady(ProcessingStage stage) const {
+    auto isDone = [this](ProcessingStage dependency) {
+        return m_stageStates.value(dependency) == StageDone;
+    };
+
+    // Dependencies come from the placeholders each prompt actually uses
+    switch (stage) {
         case GeneratingSummary:
-            runKeywordExtraction();
-            break;
+            return true;
+        case ExtractingKeywords:
+            return !m_settings.keywordPrompt.contains("{summary_result}") || isDone(GeneratingSummary);
+        case RefiningPrompt:
+            return !m_settings.prepromptRefinementPrompt.contains("{keywords}") || isDone(ExtractingKeywords);
+        case ExtractingRefinedKeywords:
+            // The refined prompt only exists once refinement is done
+            return isDone(RefiningPrompt) &&
+                   (!m_suggestedPrompt.contains("{summary_result}") || isDone(GeneratingSummary));
+        default:
+            return false;
+    }
+}
+
+void QueryRunner::startStage(ProcessingStage stage) {
+    m_stageStates[stage] = StageRunning;
 
+    switch (stage) {
+        case GeneratingSummary:
+            runSummaryExtraction();
+            break;
         case ExtractingKeywords:
-            if (m_settings.skipRefinement) {
-                // Skip refinement stages and complete the process
-                emit progressMessage("Skipping keyword refinement as per settings");
-                m_currentStage = Complete;
-                emit stageChanged(m_currentStage);
-                emit processingComplete();
-                emit progressMessage("All processing complete");
-                m_currentStage = Idle;
-            } else {
-                runPromptRefinement();
-            }
+            runKeywordExtraction();
             break;
-
         case RefiningPrompt:
+            runPromptRefinement();
+            break;
+        case ExtractingRefinedKeywords:
             runRefinedKeywordExtraction();
             break;
+        default:
+            break;
+    }
+}
 
-        case ExtractingRefinedKeywords:
-            m_currentStage = Complete;
-            emit stageChanged(m_currentStage);
-            emit processingComplete();
-            emit progressMessage("All processing complete");
+void QueryRunner::finishStage(ProcessingStage stage) {
+    // Ignore late results from a pipeline that was reset or aborted
+    if (m_stageStates.value(stage, StageSkipped) != StageRunning) {
+        return;
+    }
+    m_stageStates[stage] = StageDone;
+    saveCheckpoint(stage);
 
-            // Reset to idle after completion
-            m_currentStage = Idle;
+    // Point the UI at a stage that is still running, if any
+    for (ProcessingStage other : PipelineStages) {
+        if (m_stageStates.value(other) == StageRunning) {
+            m_currentStage = other;
+            emit stageChanged(m_currentStage);
             break;
+        }
+    }
 
-        default:
+    schedulePipeline();
+}
+
+void QueryRunner::schedulePipeline() {
+    int running = 0;
+    for (ProcessingStage stage : PipelineStages) {
+        if (m_stageStates.value(stage) == StageRunning) {
+            running++;
+        }
+    }
+
+    int limit = qMax(1, m_settings.maxConcurrentRequests);
+    for (ProcessingStage stage : PipelineStages) {
+        if (running >= limit) {
             break;
+        }
+        if (m_stageStates.value(stage) != StagePending || !stageInputsReady(stage)) {
+            continue;
+        }
+
+        if (running > 0) {
+            emit progressMessage(QString("Starting %1 concurrently (%2 request(s) in flight)")
+                                 .arg(getStageString(stage)).arg(running));
+        }
+        startStage(stage);
+        running++;
+
+        // execute() can fail synchronously, which resets the pipeline
+        if (m_stageStates.isEmpty()) {
+            return;
+        }
+    }
+
+    // Nothing in flight and nothing startable - the pipeline is finished
+    if (running == 0) {
+        completePipeline("All processing complete");
+    }
+}
+
+void QueryRunner::cancelRunningStages() {
+    for (ProcessingStage stage : PipelineStages) {
+        if (m_stageStates.value(stage) == StageRunning) {
+            m_stageStates[stage] = StageSkipped;
+            queryForStage(stage)->abort();
+        }
     }
 }
 
+void QueryRunner::completePipeline(const QString& message) {
+    finishRun("ok");  // Already recorded if the run ended early
+    m_stageStates.clear();
+    m_jobStore.remove(m_jobKey);
+    m_jobKey.clear();
+    m_currentStage = Complete;
+    emit stageChanged(m_currentStage);
+    emit processingComplete();
+    emit progressMessage(message);
+
+    // Reset to idle after completion
+    m_currentStage = Idle;
+}
+
+PromptQuery* QueryRunner::queryForStage(ProcessingStage stage) const {
+    switch (stage) {
+        case GeneratingSummary: return m_summaryQuery;
+        case ExtractingKeywords: return m_keywordsQuery;
+        case RefiningPrompt: return m_refineQuery;
+        case ExtractingRefinedKeywords: return m_refinedKeywordsQuery;
+        default: return nullptr;
+    }
+}
+
+QueryRunner::ProcessingStage QueryRunner::stageForQuery(const QObject* query) const {
+    for (ProcessingStage stage : PipelineStages) {
+        if (queryForStage(stage) == query) {
+            return stage;
+        }
+    }
+    return m_currentStage;
+}
+
+void QueryRunner::beginJob() {
+    // Everything that changes what the model is asked; timeouts and concurrency don't
+    auto number = [](double value) { return QString::number(value, 'g', 6); };
+    m_jobKey = JobStore::makeKey({
+        m_settings.modelName, m_fullCleanedText, number(m_settings.textTruncationLimit),
+        number(m_settings.contextWindow),
+        m_settings.summaryChunkingEnabled ? "chunked" : "single",
+        number(m_settings.summaryChunkTokens), number(m_settings.summaryChunkOverlap),
+        number(m_settings.summaryTemp), number(m_settings.summaryContext),
+        m_settings.summaryPreprompt, m_settings.summaryPrompt,
+        number(m_settings.keywordTemp), number(m_settings.keywordContext),
+        m_settings.keywordPreprompt, m_settings.keywordPrompt,
+        number(m_settings.refinementTemp), number(m_settings.refinementContext),
+        m_settings.keywordRefinementPreprompt, m_settings.prepromptRefinementPrompt
+    });
+
+    if (!m_jobStore.begin(m_jobKey, m_currentInputType == PDFFile ? "pdf" : "text")) {
+        m_jobKey.clear();  // Run without checkpoints
+    }
+}
+
+void QueryRunner::resumeFromCheckpoints() {
+    const QMap<QString, QString> saved = m_jobStore.checkpoints(m_jobKey);
+    if (saved.isEmpty()) {
+        return;
+    }
+
+    // Restored stages count as done, so their dependents start right away
+    QStringList resumed;
+    for (ProcessingStage stage : PipelineStages) {
+        const QString name = checkpointName(stage);
+        if (m_stageStates.value(stage) != StagePending || !saved.contains(name)) {
+            continue;
+        }
+        const QString result = saved.value(name);
+        switch (stage) {
+            case GeneratingSummary:
+                m_summary = result;
+                emit summaryGenerated(m_summary);
+                break;
+            case ExtractingKeywords:
+                m_originalKeywords = result;
+                emit keywordsExtracted(m_originalKeywords);
+                break;
+            case RefiningPrompt:
+                m_suggestedPrompt = result;
+                emit promptRefined(m_suggestedPrompt);
+                break;
+            case ExtractingRefinedKeywords:
+                m_refinedKeywords = result;
+                emit refinedKeywordsExtracted(m_refinedKeywords);
+                break;
+            default:
+                continue;
+        }
+        m_stageStates[stage] = StageDone;
+        resumed.append(getStageString(stage));
+    }
+
+    if (!resumed.isEmpty()) {
+        emit progressMessage(QString("Resuming interrupted run, reusing saved results: %1").arg(resumed.join(", ")));
+    }
+}
+
+void QueryRunner::saveCheckpoint(ProcessingStage stage) {
+    if (m_jobKey.isEmpty()) {
+        return;
+    }
+
+    QString result;
+    switch (stage) {
+        case GeneratingSummary: result = m_summary; break;
+        case ExtractingKeywords: result = m_originalKeywords; break;
+        case RefiningPrompt: result = m_suggestedPrompt; break;
+        case ExtractingRefinedKeywords: result = m_refinedKeywords; break;
+        default: return;
+    }
+
+    // Failed stages are run again next time
+    if (result.isEmpty() || result.compare("Not Evaluated", Qt::CaseInsensitive) == 0) {
+        return;
+    }
+    m_jobStore.saveStage(m_jobKey, checkpointName(stage), result);
+}
+
 void QueryRunner::loadSettingsFromDatabase() {
     QSqlDatabase db = QSqlDatabase::database();
     QSqlQuery query(db);
@@ -652,6 +1005,62 @@ void QueryRunner::loadSettingsFromDatabase() {
     m_settings.textTruncationLimit = query.value("text_truncation_limit").isNull()
         ? 100000
         : query.value("text_truncation_limit").toString().toInt();
+    // Extraction worker count - 0 (one per core) if not in database
+    m_settings.extractionWorkers = query.value("extraction_workers").isNull()
+        ? 0
+        : query.value("extraction_workers").toString().toInt();
+    m_settings.extractionCacheMB = query.value("extraction_cache_mb").isNull()
+        ? static_cast<int>(ExtractionCache::DefaultMaxBytes / (1024 * 1024))
+        : query.value("extraction_cache_mb").toString().toInt();
+    m_extractionCache.setMaxBytes(static_cast<qint64>(m_settings.extractionCacheMB) * 1024 * 1024);
+    // Response cache is opt-in
+    m_settings.responseCacheEnabled = (query.value("response_cache_enabled").toString() == "true");
+    m_settings.responseCacheTtlHours = query.value("response_cache_ttl_hours").isNull()
+        ? static_cast<int>(ResponseCache::DefaultTtlSeconds / 3600)
+        : query.value("response_cache_ttl_hours").toString().toInt();
+    m_responseCache.setEnabled(m_settings.responseCacheEnabled);
+    m_responseCache.setTtlSeconds(static_cast<qint64>(m_settings.responseCacheTtlHours) * 3600);
+    if (m_settings.responseCacheEnabled) {
+        m_responseCache.purgeExpired();
+    }
+    m_jobStore.purgeExpired();
+    // Streaming - on unless explicitly disabled
+    m_settings.streamingEnabled = (query.value("streaming_enabled").toString() != "false");
+    m_settings.streamInactivityTimeout = query.value("stream_inactivity_timeout").isNull()
+        ? PromptQuery::DefaultInactivityTimeout
+        : query.value("stream_inactivity_timeout").toString().toInt();
+    m_summaryQuery->setStreaming(m_settings.streamingEnabled, m_settings.streamInactivityTimeout);
+    m_keywordsQuery->setStreaming(m_settings.streamingEnabled, m_settings.streamInactivityTimeout);
+    m_refineQuery->setStreaming(m_settings.streamingEnabled, m_settings.streamInactivityTimeout);
+    m_refinedKeywordsQuery->setStreaming(m_settings.streamingEnabled, m_settings.streamInactivityTimeout);
+    // Concurrent LLM requests - serial unless configured
+    m_settings.maxConcurrentRequests = query.value("max_concurrent_requests").isNull()
+        ? 1
+        : qMax(1, query.value("max_concurrent_requests").toString().toInt());
+    // Sections left out of the prompts - references and appendices unless configured
+    m_settings.excludedSections = query.value("excluded_sections").isNull()
+        ? SectionSegmenter::DefaultExcluded
+        : SectionSegmenter::parseKinds(query.value("excluded_sections").toString());
+    // Server tokenizer - local estimates unless enabled
+    m_settings.serverTokenizerEnabled = (query.value("server_tokenizer_enabled").toString() == "true");
+    m_tokenBudget.setServerTokenizer(m_settings.serverTokenizerEnabled, m_settings.url, m_settings.modelName);
+    m_settings.contextWindow = query.value("context_window").isNull()
+        ? TokenBudget::DefaultContextWindow
+        : query.value("context_window").toString().toInt();
+    m_tokenBudget.setContextWindow(m_settings.contextWindow);
+    // Log files - everything, batched every 200 ms, unless configured
+    AsyncLogger::instance()->setMinimumLevel(AsyncLogger::levelFromString(query.value("log_level").toString()));
+    AsyncLogger::instance()->setFlushInterval(query.value("log_flush_interval").isNull()
+        ? AsyncLogger::DefaultFlushIntervalMs
+        : query.value("log_flush_interval").toString().toInt());
+    // Chunked summarization - off unless enabled
+    m_settings.summaryChunkingEnabled = (query.value("summary_chunking_enabled").toString() == "true");
+    m_settings.summaryChunkTokens = query.value("summary_chunk_tokens").isNull()
+        ? SummaryQuery::DefaultChunkTokens
+        : query.value("summary_chunk_tokens").toString().toInt();
+    m_settings.summaryChunkOverlap = query.value("summary_chunk_overlap").isNull()
+        ? SummaryQuery::DefaultChunkOverlapTokens
+        : query.value("summary_chunk_overlap").toString().toInt();
 
     // Summary settings
     m_settings.summaryTemp = query.value("summary_temperature").toString().toDouble();
@@ -686,12 +1095,15 @@ void QueryRunner::setManualSettings(const QVariantMap& settings) {
         m_settings.url = settings["url"].toString();
     if (settings.contains("modelName"))
         m_settings.modelName = settings["modelName"].toString();
+    m_tokenBudget.setServerTokenizer(m_settings.serverTokenizerEnabled, m_settings.url, m_settings.modelName);
     // ... etc for other settings as needed
 }
 
 void QueryRunner::handleQueryError(const QString& error) {
+    // With concurrent stages the failing query isn't necessarily m_currentStage
+    ProcessingStage errorStage = sender() ? stageForQuery(sender()) : m_currentStage;
     QString contextError = QString("[%1] %2")
-        .arg(getStageString(m_currentStage))
+        .arg(getStageString(errorStage))
         .arg(error);
 
     // Check if it's a timeout - these are expected for large docs
@@ -704,6 +1116,13 @@ void QueryRunner::handleQueryError(const QString& error) {
         emit progressMessage("You can retry with a shorter document or adjust timeout in settings");
     }
 
+    // Stop any other stage still talking to the server
+    if (m_stageStates.contains(errorStage)) {
+        m_stageStates[errorStage] = StageSkipped;
+    }
+    cancelRunningStages();
+    finishRun("error");
+
     // ALWAYS emit errorOccurred so UI gets re-enabled
     emit errorOccurred(contextError);
 
@@ -711,6 +1130,46 @@ void QueryRunner::handleQueryError(const QString& error) {
     reset();
 }
 
+void QueryRunner::recordSpan(PipelineMetrics::Span& span, const QElapsedTimer& timer) {
+    m_metrics.record(span, timer);
+    emit metricsRecorded(span);
+}
+
+void QueryRunner::recordRequest(const QString& queryType, const RequestStats& stats) {
+    PipelineMetrics::Span span;
+    span.name = "request";
+    span.stage = queryType;
+    span.durationMs = stats.totalMs;
+    span.requestMs = stats.requestMs;
+    span.timeToFirstTokenMs = stats.timeToFirstTokenMs;
+    span.parseMs = stats.parseMs;
+    span.bytesOut = stats.bytesOut;
+    span.bytesIn = stats.bytesIn;
+    span.promptTokens = stats.promptTokens;
+    span.completionTokens = stats.completionTokens;
+    span.cacheHit = stats.fromCache;
+    m_metrics.record(span);
+    emit metricsRecorded(span);
+
+    if (span.tokensPerSecond() > 0.0) {
+        emit progressMessage(QString("%1: %2 completion tokens in %3 ms (%4 tokens/s)")
+                             .arg(queryType).arg(span.completionTokens).arg(span.requestMs)
+                             .arg(span.tokensPerSecond(), 0, 'f', 1));
+    }
+}
+
+void QueryRunner::finishRun(const QString& status) {
+    if (!m_metrics.isRunning()) {
+        return;
+    }
+
+    PipelineMetrics::Span span = m_metrics.finishRun(status);
+    emit metricsRecorded(span);
+    emit progressMessage(QString("Run %1 (%2): %3 ms, %4 request(s), %5 prompt + %6 completion tokens")
+                         .arg(span.runId, status).arg(span.durationMs).arg(m_metrics.requests())
+                         .arg(m_metrics.promptTokens()).arg(m_metrics.completionTokens()));
+}
+
 QString QueryRunner::getStageString(ProcessingStage stage) const {
     switch (stage) {
         case Idle: return "Idle";
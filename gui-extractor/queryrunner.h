@@ -3,9 +3,19 @@
 
 #include <QObject>
 #include <QString>
-#include <QPdfDocument>
 #include <QSqlDatabase>
+#include <QMap>
+#include <QPointer>
+#include <QTimer>
 #include "promptquery.h"
+#include "extractioncache.h"
+#include "responsecache.h"
+#include "jobstore.h"
+#include "pipelinemetrics.h"
+#include "tokenbudget.h"
+#include "structuredtext.h"
+
+class PdfExtractionJob;
 
 // Single runner class that manages the entire pipeline
 class QueryRunner : public QObject {
@@ -31,12 +41,25 @@ public:
     ~QueryRunner();
 
     // Main entry points
-    void processPDF(const QString& filePath);
+    // contentHash: SHA-256 of the file if the caller already has it (Zotero downloads)
+    void processPDF(const QString& filePath, const QByteArray& contentHash = QByteArray());
     void processText(const QString& text);
+    // Run the LLM stages on a PDF extracted elsewhere (e.g. by a createExtractionJob job)
+    void processExtractedText(const QString& extractedText, const QString& cachedCleanedText,
+                              const QString& cacheKey, const StructuredText& structure = StructuredText());
+
+    // Pages and line positions of the current PDF; empty for pasted text and for
+    // cache entries stored without a layout
+    const StructuredText& structuredText() const { return m_structuredText; }
+
+    // Unstarted extraction job configured like processPDF's (cache, cleanup options, workers)
+    PdfExtractionJob* createExtractionJob(const QString& filePath, const QByteArray& contentHash = QByteArray());
 
     // Configuration
     void loadSettingsFromDatabase();
     void setManualSettings(const QVariantMap& settings);
+    // Also ignores stages saved by an interrupted run of the same document
+    void setBypassResponseCache(bool bypass) { m_responseCache.setBypass(bypass); m_jobStore.setBypass(bypass); }
 
     // State queries
     ProcessingStage currentStage() const { return m_currentStage; }
@@ -59,7 +82,10 @@ signals:
     // Progress signals
     void stageChanged(ProcessingStage stage);
     void progressMessage(const QString& message);
+    void partialResult(ProcessingStage stage, const QString& delta);  // Streamed text for the current stage
     void errorOccurred(const QString& error);
+    void extractionProgress(int pagesDone, int pageCount);  // Per page while a PDF is extracted
+    void metricsRecorded(const PipelineMetrics::Span& span);  // Also appended to metrics.jsonl
 
     // Control signals
     void abortRequested();  // Signal to cancel operations
@@ -82,18 +108,56 @@ private slots:
     void handleQueryError(const QString& error);  // Centralized error handler
 
 private:
+    // A load that takes longer than this is abandoned (the worker thread is left to finish on its own)
+    static constexpr int PdfLoadTimeoutMs = 60000;
+
+    // PDF extraction runs on a PdfExtractionJob worker thread
+    void startExtraction(const QString& filePath, const QByteArray& contentHash);
+    void cancelExtraction();
+    void handleExtractionFinished(const QString& extractedText, const QString& cachedCleanedText,
+                                  const QString& cacheKey, const StructuredText& structure);
+    void handleExtractionFailed(const QString& error);
+
+    // Metrics
+    void recordSpan(PipelineMetrics::Span& span, const QElapsedTimer& timer);
+    void recordRequest(const QString& queryType, const RequestStats& stats);
+    void finishRun(const QString& status);
+
     // Text preparation
-    QString extractTextFromPDF(const QString& filePath);
     QString cleanupText(const QString& text, InputType type);
-    QString removeCopyrightNotices(const QString& text);
+    QString truncateForModel(const QString& text);
+    void selectSections();  // Drops excluded sections from m_fullCleanedText
 
     // Pipeline management
     void startPipeline(const QString& text, InputType type);
+    void startStages();
     void runSummaryExtraction();
     void runKeywordExtraction();
     void runPromptRefinement();
     void runRefinedKeywordExtraction();
-    void advanceToNextStage();
+
+    // Stage dependency graph: a stage starts as soon as the results its prompt
+    // references are available, up to maxConcurrentRequests at a time
+    enum StageState {
+        StagePending,
+        StageRunning,
+        StageDone,
+        StageSkipped
+    };
+    void initPipelineGraph();
+    bool stageInputsReady(ProcessingStage stage) const;
+    void startStage(ProcessingStage stage);
+    void finishStage(ProcessingStage stage);
+    void schedulePipeline();
+    void cancelRunningStages();
+    void completePipeline(const QString& message);
+    PromptQuery* queryForStage(ProcessingStage stage) const;
+    ProcessingStage stageForQuery(const QObject* query) const;
+
+    // Stage checkpoints, so an interrupted run resumes after its last finished stage
+    void beginJob();
+    void resumeFromCheckpoints();
+    void saveCheckpoint(ProcessingStage stage);
 
     // Settings management
     void loadConnectionSettings();
@@ -101,6 +165,7 @@ private:
 
     // Helper methods
     QString getStageString(ProcessingStage stage) const;
+    QString cleanupOptionsKey() const;
 
     // State
     ProcessingStage m_currentStage;
@@ -108,7 +173,9 @@ private:
 
     // Intermediate results
     QString m_extractedText;
-    QString m_cleanedText;
+    StructuredText m_structuredText;  // text() == m_extractedText for PDFs
+    QString m_cleanedText;      // Capped at textTruncationLimit; each request trims further to its token budget
+    QString m_fullCleanedText;  // Untruncated, for chunked summarization
     QString m_summary;
     QString m_originalKeywords;
     QString m_suggestedPrompt;
@@ -120,12 +187,37 @@ private:
     RefineKeywordsQuery* m_refineQuery;
     KeywordsWithRefinementQuery* m_refinedKeywordsQuery;
 
-    // PDF handling
-    QPdfDocument* m_pdfDocument;
+    // PDF handling (null when no extraction is running)
+    QPointer<PdfExtractionJob> m_extractionJob;
+    QTimer* m_extractionWatchdog;  // Load timeout, stopped once the document is open
+    QElapsedTimer m_extractionTimer;
+    int m_extractionPages;
+
+    // Timing spans for the current run
+    PipelineMetrics m_metrics;
+
+    // Extracted text cache (keyed by file content hash)
+    ExtractionCache m_extractionCache;
+    QString m_extractionCacheKey;
+    QString m_cachedCleanedText;
+
+    // LLM response cache shared by all query objects
+    ResponseCache m_responseCache;
+
+    // Finished stages of the current run (m_jobKey is empty when no pipeline is running)
+    JobStore m_jobStore;
+    QString m_jobKey;
+
+    // Prompt token counting shared by all query objects
+    TokenBudget m_tokenBudget;
+    bool m_awaitingCalibration;  // Pipeline waits for the server tokenizer measurement
 
     // Single-step mode flag
     bool m_singleStepMode;
 
+    // Pipeline graph state (empty when no pipeline is running)
+    QMap<ProcessingStage, StageState> m_stageStates;
+
     // Settings cache
     struct Settings {
         // Connection
@@ -133,6 +225,21 @@ private:
         QString modelName;
         int overallTimeout;
         int textTruncationLimit;
+        int extractionWorkers;  // 0 = one per core, 1 = serial extraction
+        int extractionCacheMB;
+        bool responseCacheEnabled;
+        int responseCacheTtlHours;
+        bool streamingEnabled;
+        int streamInactivityTimeout;
+        int maxConcurrentRequests;  // 1 = stages run strictly one after another
+        bool serverTokenizerEnabled;  // Calibrate token estimates with the server's /tokenize
+        int contextWindow;            // Model context in tokens; each stage's context is its max_tokens
+        quint32 excludedSections;     // SectionSegmenter::Kinds left out of the prompts
+
+        // Chunked summarization of documents over the context limit
+        bool summaryChunkingEnabled;
+        int summaryChunkTokens;
+        int summaryChunkOverlap;    // Tokens repeated from the end of the previous chunk
 
         // Summary
         double summaryTemp;
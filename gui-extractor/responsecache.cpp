@@ -0,0 +1,132 @@
+#include "responsecache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+ResponseCache::ResponseCache()
+    : m_enabled(false)
+    , m_bypass(false)
+    , m_tableReady(false)
+    , m_ttlSeconds(DefaultTtlSeconds)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+QString ResponseCache::makeKey(const QString& modelName, const QString& preprompt, const QString& fullPrompt,
+                               double temperature, int maxTokens) {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    // Length-prefix each field so "ab"+"c" and "a"+"bc" hash differently
+    auto addField = [&hash](const QString& value) {
+        QByteArray bytes = value.toUtf8();
+        hash.addData(QByteArray::number(bytes.size()) + ':');
+        hash.addData(bytes);
+    };
+
+    addField(modelName);
+    addField(preprompt);
+    addField(fullPrompt);
+    addField(QString::number(temperature, 'g', 6));
+    addField(QString::number(maxTokens));
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool ResponseCache::lookup(const QString& key, QByteArray& response) {
+    if (!m_enabled || m_bypass || key.isEmpty() || !ensureTable()) {
+        return false;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT response, created_at FROM response_cache WHERE cache_key = :key");
+    query.bindValue(":key", key);
+
+    if (!query.exec() || !query.next()) {
+        m_misses++;
+        return false;
+    }
+
+    qint64 createdAt = query.value("created_at").toLongLong();
+    if (m_ttlSeconds > 0 && QDateTime::currentSecsSinceEpoch() - createdAt > m_ttlSeconds) {
+        qDebug() << "ResponseCache: entry expired" << key.left(12);
+        m_misses++;
+        return false;
+    }
+
+    response = query.value("response").toByteArray();
+    if (response.isEmpty()) {
+        m_misses++;
+        return false;
+    }
+
+    m_hits++;
+    return true;
+}
+
+void ResponseCache::store(const QString& key, const QByteArray& response) {
+    if (!m_enabled || key.isEmpty() || response.isEmpty() || !ensureTable()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("INSERT OR REPLACE INTO response_cache (cache_key, response, created_at) "
+                  "VALUES (:key, :response, :created_at)");
+    query.bindValue(":key", key);
+    query.bindValue(":response", response);
+    query.bindValue(":created_at", QDateTime::currentSecsSinceEpoch());
+
+    if (!query.exec()) {
+        qDebug() << "ResponseCache: failed to store entry:" << query.lastError().text();
+    }
+}
+
+void ResponseCache::clear() {
+    if (!ensureTable()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    if (!query.exec("DELETE FROM response_cache")) {
+        qDebug() << "ResponseCache: failed to clear:" << query.lastError().text();
+    }
+}
+
+void ResponseCache::purgeExpired() {
+    if (m_ttlSeconds <= 0 || !ensureTable()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("DELETE FROM response_cache WHERE created_at < :cutoff");
+    query.bindValue(":cutoff", QDateTime::currentSecsSinceEpoch() - m_ttlSeconds);
+    if (!query.exec()) {
+        qDebug() << "ResponseCache: failed to purge expired entries:" << query.lastError().text();
+    }
+}
+
+bool ResponseCache::ensureTable() {
+    if (m_tableReady) {
+        return true;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS response_cache ("
+                    "cache_key TEXT PRIMARY KEY, "
+                    "response BLOB, "
+                    "created_at INTEGER)")) {
+        qDebug() << "ResponseCache: could not create table:" << query.lastError().text();
+        return false;
+    }
+
+    m_tableReady = true;
+    return true;
+}
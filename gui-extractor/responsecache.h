@@ -0,0 +1,54 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QByteArray>
+#include <QString>
+
+// Opt-in cache of raw chat completion responses, stored in the response_cache
+// table of the settings database. Entries are keyed by a hash of everything that
+// determines the model output (model, preprompt, full prompt, temperature,
+// max_tokens) and expire after a configurable TTL.
+class ResponseCache {
+public:
+    ResponseCache();
+
+    // Enable/disable caching entirely (disabled by default)
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+
+    // Skip lookups for the next requests but still store fresh responses
+    void setBypass(bool bypass) { m_bypass = bypass; }
+    bool isBypassed() const { return m_bypass; }
+
+    void setTtlSeconds(qint64 ttlSeconds) { m_ttlSeconds = ttlSeconds; }
+    qint64 ttlSeconds() const { return m_ttlSeconds; }
+
+    static QString makeKey(const QString& modelName, const QString& preprompt, const QString& fullPrompt,
+                           double temperature, int maxTokens);
+
+    // Returns false on miss, expired entry, bypass or disabled cache
+    bool lookup(const QString& key, QByteArray& response);
+    void store(const QString& key, const QByteArray& response);
+
+    // Remove all entries, or only the expired ones
+    void clear();
+    void purgeExpired();
+
+    // Statistics (for this session)
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+    static constexpr qint64 DefaultTtlSeconds = 7 * 24 * 60 * 60;  // One week
+
+private:
+    bool ensureTable();
+
+    bool m_enabled;
+    bool m_bypass;
+    bool m_tableReady;
+    qint64 m_ttlSeconds;
+    int m_hits;
+    int m_misses;
+};
+
+#endif // RESPONSECACHE_H
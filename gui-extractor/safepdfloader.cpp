@@ -1,10 +1,20 @@
 #include "safepdfloader.h"
+#include "mappedpdffile.h"
+#include "structuredtext.h"
+#include <QBuffer>
 #include <QFileInfo>
 #include <QStorageInfo>
 #include <QDir>
 #include <QDebug>
 #include <QEventLoop>
+#include <QPair>
+#include <QPdfSelection>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
 #include <exception>
+#include <optional>
 #include <stdexcept>
 
 SafePdfLoader::SafePdfLoader(QObject *parent) : QObject(parent) {
@@ -56,22 +66,7 @@ bool SafePdfLoader::loadPdf(QPdfDocument* doc, const QString& path, QString& err
         }
 
         if (result != QPdfDocument::Error::None) {
-            switch (result) {
-                case QPdfDocument::Error::FileNotFound:
-                    errorMsg = "PDF file not found";
-                    break;
-                case QPdfDocument::Error::InvalidFileFormat:
-                    errorMsg = "Invalid PDF file format";
-                    break;
-                case QPdfDocument::Error::IncorrectPassword:
-                    errorMsg = "PDF is password protected";
-                    break;
-                case QPdfDocument::Error::UnsupportedSecurityScheme:
-                    errorMsg = "PDF has unsupported security scheme";
-                    break;
-                default:
-                    errorMsg = QString("Failed to load PDF (error code: %1)").arg(static_cast<int>(result));
-            }
+            errorMsg = describeLoadError(result);
             return false;
         }
 
@@ -105,6 +100,55 @@ bool SafePdfLoader::loadPdf(QPdfDocument* doc, const QString& path, QString& err
     }
 }
 
+bool SafePdfLoader::loadPdf(QPdfDocument* doc, QIODevice* device, QString& errorMsg, int timeoutMs) {
+    if (!doc || !device) {
+        errorMsg = "Invalid QPdfDocument pointer or device";
+        return false;
+    }
+
+    try {
+        QPdfDocument::Error result = tryLoadPdf(doc, device, timeoutMs);
+
+        if (doc->status() == QPdfDocument::Status::Loading) {
+            errorMsg = QString("PDF loading timed out after %1ms").arg(timeoutMs);
+            doc->close();
+            return false;
+        }
+
+        if (result != QPdfDocument::Error::None) {
+            errorMsg = describeLoadError(result);
+            return false;
+        }
+
+        if (doc->pageCount() == 0) {
+            errorMsg = "PDF has no pages";
+            doc->close();
+            return false;
+        }
+
+        return true;
+
+    } catch (const std::exception& e) {
+        errorMsg = QString("Exception loading PDF: %1").arg(e.what());
+        logError("loadPdf", errorMsg);
+        try {
+            doc->close();
+        } catch (...) {
+            // Ignore cleanup exceptions
+        }
+        return false;
+    } catch (...) {
+        errorMsg = "Unknown exception loading PDF";
+        logError("loadPdf", errorMsg);
+        try {
+            doc->close();
+        } catch (...) {
+            // Ignore cleanup exceptions
+        }
+        return false;
+    }
+}
+
 bool SafePdfLoader::validatePdfFile(const QString& path, QString& errorMsg) {
     try {
         QFileInfo fileInfo(path);
@@ -161,71 +205,290 @@ bool SafePdfLoader::validatePdfFile(const QString& path, QString& errorMsg) {
 }
 
 QString SafePdfLoader::extractTextSafely(QPdfDocument* doc, QString& errorMsg) {
+    QString allText;
+
+    // Built on the streaming API; callers that don't need the whole document at once
+    // should use extractPages directly
+    bool ok = extractPages(doc, [&allText](int, const QString& pageText) {
+        allText += pageText;
+        allText += "\n\n";
+        return true;
+    }, errorMsg);
+
+    if (!ok) {
+        return QString();
+    }
+
+    if (allText.isEmpty()) {
+        errorMsg = "No text could be extracted from PDF";
+        return QString();
+    }
+
+    return allText;
+}
+
+bool SafePdfLoader::extractPages(QPdfDocument* doc, const PageCallback& callback, QString& errorMsg,
+                                 int firstPage, int lastPage) {
+    return forEachPage(doc, [&callback](int pageIndex, const QPdfSelection&, const QString& pageText) {
+        return callback(pageIndex, pageText);
+    }, errorMsg, firstPage, lastPage);
+}
+
+bool SafePdfLoader::forEachPage(QPdfDocument* doc, const SelectionCallback& callback, QString& errorMsg,
+                                int firstPage, int lastPage) {
     if (!doc) {
         errorMsg = "Invalid QPdfDocument pointer";
-        return QString();
+        return false;
     }
 
     try {
-        QString allText;
-        int pageCount = doc->pageCount();
+        const int pageCount = doc->pageCount();
 
         if (pageCount == 0) {
             errorMsg = "PDF has no pages";
-            return QString();
+            return false;
         }
 
-        // Limit pages to prevent excessive memory usage
-        const int maxPages = 1000;
-        if (pageCount > maxPages) {
-            pageCount = maxPages;
-            qDebug() << QString("Limiting text extraction to first %1 pages").arg(maxPages);
-        }
+        firstPage = qMax(0, firstPage);
+        lastPage = (lastPage < 0) ? pageCount - 1 : qMin(lastPage, pageCount - 1);
 
-        for (int i = 0; i < pageCount; ++i) {
+        for (int i = firstPage; i <= lastPage; ++i) {
+            std::optional<QPdfSelection> selection;  // No default constructor
+            QString pageText;
             try {
-                QString pageText = doc->getAllText(i).text();
+                selection.emplace(doc->getAllText(i));
+                pageText = selection->text();
 
                 // Check for excessive page text size
-                if (pageText.length() > 1000000) { // 1MB per page limit
-                    pageText = pageText.left(1000000);
+                if (pageText.length() > MaxPageChars) {
+                    pageText = pageText.left(MaxPageChars);
                     qDebug() << QString("Truncated page %1 text to 1MB").arg(i);
                 }
-
-                allText += pageText;
-                allText += "\n\n";
-
-                // Check total text size
-                if (allText.length() > 10000000) { // 10MB total limit
-                    allText = allText.left(10000000);
-                    qDebug() << "Total text exceeded 10MB, truncating";
-                    break;
-                }
-
             } catch (const std::exception& e) {
                 qDebug() << QString("Exception extracting page %1: %2").arg(i).arg(e.what());
-                // Continue with other pages
+                continue;  // Continue with other pages
             } catch (...) {
                 qDebug() << QString("Unknown exception extracting page %1").arg(i);
-                // Continue with other pages
+                continue;  // Continue with other pages
+            }
+
+            if (!callback(i, *selection, pageText)) {
+                errorMsg = QString("Extraction stopped at page %1").arg(i + 1);
+                return false;
+            }
+        }
+
+        return true;
+
+    } catch (const std::exception& e) {
+        errorMsg = QString("Exception extracting text: %1").arg(e.what());
+        logError("extractPages", errorMsg);
+        return false;
+    } catch (...) {
+        errorMsg = "Unknown exception extracting text";
+        logError("extractPages", errorMsg);
+        return false;
+    }
+}
+
+QVector<QRectF> SafePdfLoader::lineBounds(QPdfDocument* doc, int pageIndex, const QPdfSelection& selection,
+                                          const QString& pageText) {
+    // Non-empty lines, split the way StructuredText::appendPage splits them
+    QVector<QPair<qsizetype, qsizetype>> lines;
+    qsizetype start = 0;
+    while (start <= pageText.size()) {
+        qsizetype end = pageText.indexOf(u'\n', start);
+        if (end < 0) {
+            end = pageText.size();
+        }
+        const qsizetype lineEnd = (end > start && pageText.at(end - 1) == u'\r') ? end - 1 : end;
+        if (!QStringView(pageText).mid(start, lineEnd - start).trimmed().isEmpty()) {
+            lines.append(qMakePair(start, lineEnd - start));
+        }
+        start = end + 1;
+    }
+
+    // PDFium reports the selection's boxes in character order, one or more per
+    // line: boxes that overlap vertically and keep moving right are one line
+    QVector<QRectF> rows;
+    for (const QPolygonF& polygon : selection.bounds()) {
+        const QRectF rect = polygon.boundingRect();
+        if (rect.isEmpty()) {
+            continue;
+        }
+        if (!rows.isEmpty()) {
+            QRectF& row = rows.last();
+            const bool sameRow = rect.top() < row.bottom() && rect.bottom() > row.top();
+            if (sameRow && rect.left() >= row.right() - rect.height()) {
+                row = row.united(rect);
+                continue;
+            }
+        }
+        rows.append(rect);
+    }
+    if (rows.size() == lines.size()) {
+        return rows;
+    }
+
+    // Unusual layouts (rotated text, drop caps) don't group cleanly; ask for each line instead
+    if (lines.size() > MaxLineQueries) {
+        return QVector<QRectF>();
+    }
+    QVector<QRectF> bounds;
+    bounds.reserve(lines.size());
+    try {
+        for (const auto& line : std::as_const(lines)) {
+            bounds.append(doc->getSelectionAtIndex(pageIndex, static_cast<int>(line.first),
+                                                   static_cast<int>(line.second)).boundingRectangle());
+        }
+    } catch (...) {
+        qDebug() << QString("Exception reading line positions on page %1").arg(pageIndex);
+        return QVector<QRectF>();
+    }
+    return bounds;
+}
+
+bool SafePdfLoader::extractStructured(QPdfDocument* doc, StructuredText& result, QString& errorMsg,
+                                      int firstPage, int lastPage, const ProgressCallback& progress, bool lineBoxes) {
+    const int pageCount = doc ? doc->pageCount() : 0;
+    int pagesDone = 0;
+    return forEachPage(doc, [&](int pageIndex, const QPdfSelection& selection, const QString& pageText) {
+        QSizeF size;
+        QVector<QRectF> bounds;
+        try {
+            size = doc->pagePointSize(pageIndex);
+            if (lineBoxes) {
+                bounds = lineBounds(doc, pageIndex, selection, pageText);
+            }
+        } catch (...) {
+            // Positions are optional; the text is kept either way
+            qDebug() << QString("Exception reading layout of page %1").arg(pageIndex);
+        }
+        result.appendPage(pageIndex, pageText, size, bounds);
+        return !progress || progress(++pagesDone, pageCount);
+    }, errorMsg, firstPage, lastPage);
+}
+
+QString SafePdfLoader::extractTextParallel(const QString& path, QString& errorMsg, int workerCount,
+                                          const ProgressCallback& progress) {
+    MappedPdfFile mapped;
+    if (!mapped.open(path, errorMsg)) {
+        return QString();
+    }
+    return extractTextParallel(mapped, errorMsg, workerCount, progress);
+}
+
+QString SafePdfLoader::extractTextParallel(const MappedPdfFile& mapped, QString& errorMsg, int workerCount,
+                                          const ProgressCallback& progress) {
+    // Without line boxes the structure is only the text split at line breaks; no extra PDFium calls
+    return extractStructuredParallel(mapped, errorMsg, workerCount, progress, false).text();
+}
+
+StructuredText SafePdfLoader::extractStructuredParallel(const MappedPdfFile& mapped, QString& errorMsg,
+                                                        int workerCount, const ProgressCallback& progress,
+                                                        bool lineBoxes) {
+    try {
+        // Open once on the calling thread to validate and learn the page count
+        QBuffer probeBuffer;
+        probeBuffer.setData(mapped.bytes());
+        probeBuffer.open(QIODevice::ReadOnly);
+        QPdfDocument probe;
+        if (!loadPdf(&probe, &probeBuffer, errorMsg)) {
+            return StructuredText();
+        }
+
+        const int pageCount = probe.pageCount();
+        probe.close();
+
+        if (workerCount <= 0) {
+            workerCount = QThread::idealThreadCount();
+        }
+        workerCount = qBound(1, workerCount, pageCount);
+
+        // Contiguous shards so stitching is a plain concatenation in shard order
+        const int shardSize = (pageCount + workerCount - 1) / workerCount;
+        const int shardCount = (pageCount + shardSize - 1) / shardSize;
+        QVector<StructuredText> shardText(shardCount);
+        QVector<QString> shardErrors(shardCount);
+        std::atomic<int> pagesDone(0);
+        std::atomic<bool> stopped(false);
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(shardCount);
+
+        for (int shard = 0; shard < shardCount; ++shard) {
+            const int firstPage = shard * shardSize;
+            const int lastPage = qMin(firstPage + shardSize, pageCount) - 1;
+
+            pool.start([&, shard, firstPage, lastPage]() {
+                try {
+                    // PDFium handles are not shareable across threads - one document per worker,
+                    // each reading the shared mapping through its own buffer
+                    QBuffer workerBuffer;
+                    workerBuffer.setData(mapped.bytes());
+                    workerBuffer.open(QIODevice::ReadOnly);
+                    QPdfDocument workerDoc;
+                    QPdfDocument::Error result = tryLoadPdf(&workerDoc, &workerBuffer, 30000);
+                    if (result != QPdfDocument::Error::None) {
+                        shardErrors[shard] = QString("Worker failed to load PDF (error code: %1)")
+                                                 .arg(static_cast<int>(result));
+                        return;
+                    }
+
+                    extractStructured(&workerDoc, shardText[shard], shardErrors[shard], firstPage, lastPage,
+                                      [&](int, int) {
+                        if (stopped.load(std::memory_order_relaxed)) {
+                            return false;
+                        }
+                        if (progress && !progress(pagesDone.fetch_add(1) + 1, pageCount)) {
+                            // Stop the other shards at their next page too
+                            stopped.store(true, std::memory_order_relaxed);
+                            return false;
+                        }
+                        return true;
+                    }, lineBoxes);
+                    workerDoc.close();
+                } catch (const std::exception& e) {
+                    shardErrors[shard] = QString("Exception in extraction worker: %1").arg(e.what());
+                } catch (...) {
+                    shardErrors[shard] = "Unknown exception in extraction worker";
+                }
+            });
+        }
+
+        pool.waitForDone();
+
+        if (stopped.load()) {
+            errorMsg = "Extraction stopped";
+            return StructuredText();
+        }
+
+        StructuredText all;
+        for (int shard = 0; shard < shardCount; ++shard) {
+            if (!shardErrors[shard].isEmpty()) {
+                errorMsg = shardErrors[shard];
+                logError("extractStructuredParallel", errorMsg);
+                return StructuredText();
             }
+            all.append(shardText[shard]);
+            shardText[shard].clear();
         }
 
-        if (allText.isEmpty()) {
+        if (all.isEmpty()) {
             errorMsg = "No text could be extracted from PDF";
-            return QString();
+            return StructuredText();
         }
 
-        return allText;
+        return all;
 
     } catch (const std::exception& e) {
         errorMsg = QString("Exception extracting text: %1").arg(e.what());
-        logError("extractTextSafely", errorMsg);
-        return QString();
+        logError("extractStructuredParallel", errorMsg);
+        return StructuredText();
     } catch (...) {
         errorMsg = "Unknown exception extracting text";
-        logError("extractTextSafely", errorMsg);
-        return QString();
+        logError("extractStructuredParallel", errorMsg);
+        return StructuredText();
     }
 }
 
@@ -250,6 +513,50 @@ QPdfDocument::Error SafePdfLoader::tryLoadPdf(QPdfDocument* doc, const QString&
     }
 }
 
+QPdfDocument::Error SafePdfLoader::tryLoadPdf(QPdfDocument* doc, QIODevice* device, int timeoutMs) {
+    try {
+        doc->load(device);
+
+        // A fully buffered device normally loads synchronously; wait in case PDFium asks for more
+        if (doc->status() == QPdfDocument::Status::Loading) {
+            QEventLoop loop;
+            QTimer timeoutTimer;
+            timeoutTimer.setSingleShot(true);
+            QObject::connect(&timeoutTimer, &QTimer::timeout, &loop, &QEventLoop::quit);
+            QObject::connect(doc, &QPdfDocument::statusChanged, &loop, [&loop](QPdfDocument::Status status) {
+                if (status != QPdfDocument::Status::Loading) {
+                    loop.quit();
+                }
+            });
+            timeoutTimer.start(timeoutMs);
+            loop.exec();
+        }
+
+        return doc->error();
+    } catch (const std::exception& e) {
+        qDebug() << "Exception in QPdfDocument::load:" << e.what();
+        return QPdfDocument::Error::InvalidFileFormat;
+    } catch (...) {
+        qDebug() << "Unknown exception in QPdfDocument::load";
+        return QPdfDocument::Error::InvalidFileFormat;
+    }
+}
+
+QString SafePdfLoader::describeLoadError(QPdfDocument::Error error) {
+    switch (error) {
+        case QPdfDocument::Error::FileNotFound:
+            return "PDF file not found";
+        case QPdfDocument::Error::InvalidFileFormat:
+            return "Invalid PDF file format";
+        case QPdfDocument::Error::IncorrectPassword:
+            return "PDF is password protected";
+        case QPdfDocument::Error::UnsupportedSecurityScheme:
+            return "PDF has unsupported security scheme";
+        default:
+            return QString("Failed to load PDF (error code: %1)").arg(static_cast<int>(error));
+    }
+}
+
 void SafePdfLoader::logError(const QString& context, const QString& error) {
     qDebug() << QString("[SafePdfLoader::%1] %2").arg(context).arg(error);
 }
\ No newline at end of file
@@ -3,10 +3,18 @@
 
 #include <QObject>
 #include <QString>
+#include <QVector>
+#include <QRectF>
 #include <QPdfDocument>
 #include <QTimer>
+#include <functional>
 #include <memory>
 
+class QIODevice;
+class MappedPdfFile;
+class QPdfSelection;
+class StructuredText;
+
 class SafePdfLoader : public QObject {
     Q_OBJECT
 
@@ -17,18 +25,80 @@ public:
     // Safe PDF loading with exception handling and timeouts
     static bool loadPdf(QPdfDocument* doc, const QString& path, QString& errorMsg, int timeoutMs = 30000);
 
+    // Load from an open device, typically a QBuffer over a MappedPdfFile so the parser
+    // reads the mapped pages directly. The device must outlive the document.
+    static bool loadPdf(QPdfDocument* doc, QIODevice* device, QString& errorMsg, int timeoutMs = 30000);
+
     // Validate PDF file before loading
     static bool validatePdfFile(const QString& path, QString& errorMsg);
 
-    // Extract text with safety checks
+    // Called once per page, in page order. Return false to stop extraction early.
+    using PageCallback = std::function<bool(int pageIndex, const QString& pageText)>;
+
+    // Streaming extraction: hands each page of [firstPage, lastPage] to callback without
+    // accumulating the document, so memory is bounded by the largest page.
+    // lastPage < 0 means the last page of the document.
+    static bool extractPages(QPdfDocument* doc, const PageCallback& callback, QString& errorMsg,
+                             int firstPage = 0, int lastPage = -1);
+
+    // Extract the whole document into one string (pages separated by blank lines)
     static QString extractTextSafely(QPdfDocument* doc, QString& errorMsg);
 
+    // Reports how many pages are done so far. Return false to stop extraction early.
+    using ProgressCallback = std::function<bool(int pagesDone, int pageCount)>;
+
+    // Parallel variant of extractTextSafely: shards the page range across a thread pool
+    // (each worker opens its own QPdfDocument on path) and stitches the shards back in
+    // page order. Output is identical to the serial path. workerCount <= 0 means
+    // QThread::idealThreadCount(). progress is called after every page from the
+    // worker threads, so it must be thread-safe; pages finish out of order.
+    static QString extractTextParallel(const QString& path, QString& errorMsg, int workerCount = 0,
+                                       const ProgressCallback& progress = ProgressCallback());
+
+    // Same, but every worker parses from the one mapping instead of reopening the file
+    static QString extractTextParallel(const MappedPdfFile& mapped, QString& errorMsg, int workerCount = 0,
+                                       const ProgressCallback& progress = ProgressCallback());
+
+    // Structured extraction: page text split into pages and lines (see StructuredText).
+    // text() of the result is identical to extractTextSafely's output for the same pages.
+    // Line positions cost extra PDFium calls per page (see lineBounds), so they are
+    // only read with lineBoxes; otherwise blocks have no position.
+    static bool extractStructured(QPdfDocument* doc, StructuredText& result, QString& errorMsg,
+                                  int firstPage = 0, int lastPage = -1,
+                                  const ProgressCallback& progress = ProgressCallback(), bool lineBoxes = false);
+
+    // Parallel variant of extractStructured over the one mapping, sharded like extractTextParallel
+    static StructuredText extractStructuredParallel(const MappedPdfFile& mapped, QString& errorMsg,
+                                                    int workerCount = 0,
+                                                    const ProgressCallback& progress = ProgressCallback(),
+                                                    bool lineBoxes = false);
+
     // Check if file size is acceptable (default max 500MB)
     static bool checkFileSize(const QString& path, qint64 maxSizeBytes = 500 * 1024 * 1024);
 
 private:
     // Helper to safely attempt PDF load with exception handling
     static QPdfDocument::Error tryLoadPdf(QPdfDocument* doc, const QString& path);
+    static QPdfDocument::Error tryLoadPdf(QPdfDocument* doc, QIODevice* device, int timeoutMs);
+
+    static QString describeLoadError(QPdfDocument::Error error);
+
+    // Both extraction flavours walk pages through this; each page's text is read once
+    using SelectionCallback = std::function<bool(int pageIndex, const QPdfSelection& selection,
+                                                 const QString& pageText)>;
+    static bool forEachPage(QPdfDocument* doc, const SelectionCallback& callback, QString& errorMsg,
+                            int firstPage, int lastPage);
+
+    // One box per non-empty line of pageText, or empty if they can't be matched up
+    static QVector<QRectF> lineBounds(QPdfDocument* doc, int pageIndex, const QPdfSelection& selection,
+                                      const QString& pageText);
+
+    // Guard against pathological pages (e.g. embedded data rendered as text)
+    static constexpr int MaxPageChars = 1000000;     // 1MB per page
+
+    // Lines queried one by one when the page's boxes don't line up with its text;
+    // every query reloads the page's text in PDFium
+    static constexpr int MaxLineQueries = 200;
 
     // Logging helper
     static void logError(const QString& context, const QString& error);
@@ -0,0 +1,243 @@
+#include "sectionsegmenter.h"
+#include <QRegularExpression>
+
+namespace {
+
+// "3", "2.1", "III", "B", followed by "." or ")" and a space
+const QString NumberPrefix = QStringLiteral("^(?:(?:\\d{1,2}(?:\\.\\d{1,2})*|[ivxIVX]{1,5}|[a-hA-H])[.)]?\\s+)?");
+
+// After an appendix name: nothing, a label ("A", "B.2", "S1", "IV") optionally
+// followed by a title, or a title after a colon. The label is upper case, so
+// "Appendix is ..." in running text doesn't count.
+const QString AppendixTail = QStringLiteral(
+    "(?:\\s+(?:[A-Z]\\d{0,2}|[IVX]{1,5}|\\d{1,2})(?:\\.\\d{1,2})*(?:\\s*[.:]?|\\s*[.:\\x{2014}\\x{2013}-]\\s*\\S.*)"
+    "|\\s*:\\s*\\S.*"
+    "|\\s*[.:]?)$");
+
+struct HeadingPattern {
+    SectionSegmenter::Kind kind;
+    QRegularExpression expression;
+};
+
+// Headings are written in Title Case, sentence case or ALL CAPS; a line starting
+// lower case is wrapped running text ("...is given in the\nappendix."). names is
+// written in lower case and expanded to the accepted forms:
+// "materials and methods" -> "Materials (?:and|And) (?:methods|Methods)|MATERIALS AND METHODS"
+QString caseForms(const QString& names) {
+    QString mixed;
+    int depth = 0;
+    qsizetype i = 0;
+    while (i < names.size()) {
+        const QChar c = names.at(i);
+        if (!c.isLetter()) {
+            depth += (c == u'(') - (c == u')');
+            mixed += c;
+            ++i;
+            continue;
+        }
+
+        qsizetype end = i;
+        while (end < names.size() && names.at(end).isLetter()) {
+            ++end;
+        }
+        const QString word = names.mid(i, end - i);
+        const QString capitalized = word.left(1).toUpper() + word.mid(1);
+        const QChar before = i > 0 ? names.at(i - 1) : QChar(u'|');
+
+        if (depth == 0 && before == u'|') {
+            mixed += capitalized;  // First word of a heading
+        } else if (before == u' ' || before == u'|' || before == u':') {
+            mixed += "(?:" + word + "|" + capitalized + ")";
+        } else {
+            mixed += word;  // Rest of a word, e.g. "ments" in "acknowledge?ments?"
+        }
+        i = end;
+    }
+    return mixed + "|" + names.toUpper();
+}
+
+QRegularExpression heading(const QString& names, const QString& tail = QStringLiteral("\\s*[.:]?$")) {
+    return QRegularExpression(NumberPrefix + "(?:" + caseForms(names) + ")" + tail);
+}
+
+const QVector<HeadingPattern>& patterns() {
+    static const QVector<HeadingPattern> list = {
+        { SectionSegmenter::Abstract, heading("abstract") },
+        { SectionSegmenter::Introduction, heading("introduction|background|related work|literature review") },
+        // "Experimental setup" is how the work was done; "Experiments" usually reports it
+        { SectionSegmenter::Methods, heading("methods?|materials and methods|methods and materials|methodology"
+                                             "|patients and methods|data and methods|study design|materials"
+                                             "|experimental(?: section| setup| design| procedures?| methods?)?") },
+        { SectionSegmenter::Results, heading("results|results and discussion|findings|experiments"
+                                             "|experimental results|evaluation") },
+        { SectionSegmenter::Discussion, heading("discussion|general discussion|limitations") },
+        { SectionSegmenter::Conclusion, heading("conclusions?|concluding remarks|summary and conclusions?"
+                                                "|conclusions? and future work|future work") },
+        { SectionSegmenter::Acknowledgments, heading("acknowledge?ments?|funding|author contributions"
+                                                     "|competing interests|conflicts? of interest"
+                                                     "|declaration of competing interest"
+                                                     "|data availability(?: statement)?") },
+        { SectionSegmenter::References, heading("references|bibliography|literature cited|works cited"
+                                                "|references and notes|cited literature") },
+        // Appendix headings may carry a label and title ("Appendix A. Proofs"), but
+        // "Supplementary material is available online." is a sentence, not a heading
+        { SectionSegmenter::Appendix, heading("appendix|appendices|supplementary (?:material|materials|information|data)"
+                                              "|supplemental (?:material|information)|supporting information",
+                                              AppendixTail) },
+    };
+    return list;
+}
+
+// Abstract running on from its heading: "Abstract—We present ...", "ABSTRACT: ..."
+const QRegularExpression InlineAbstract(QStringLiteral("^(?:Abstract|ABSTRACT)\\s*[:.\\x{2014}\\x{2013}-]\\s*\\S"));
+
+bool isBackMatter(SectionSegmenter::Kind kind) {
+    return kind == SectionSegmenter::Acknowledgments || kind == SectionSegmenter::References
+        || kind == SectionSegmenter::Appendix;
+}
+
+// Kind of the heading on this line, or -1
+int headingKind(QStringView line, qsizetype offset, qsizetype textSize) {
+    line = line.trimmed();
+    if (line.isEmpty()) {
+        return -1;
+    }
+    if (InlineAbstract.matchView(line).hasMatch()) {
+        return SectionSegmenter::Abstract;
+    }
+    if (line.size() > SectionSegmenter::MaxHeadingChars) {
+        return -1;
+    }
+
+    for (const HeadingPattern& pattern : patterns()) {
+        if (!pattern.expression.matchView(line).hasMatch()) {
+            continue;
+        }
+        if (isBackMatter(pattern.kind) && offset < textSize * SectionSegmenter::BackMatterMinPercent / 100) {
+            return -1;
+        }
+        return pattern.kind;
+    }
+    return -1;
+}
+
+} // namespace
+
+QVector<SectionSegmenter::Section> SectionSegmenter::segment(const QString& text) {
+    QVector<Section> sections;
+    sections.append({ Front, 0, 0, QString() });
+
+    qsizetype start = 0;
+    while (start < text.size()) {
+        qsizetype end = text.indexOf(u'\n', start);
+        if (end < 0) {
+            end = text.size();
+        }
+        const QStringView line = QStringView(text).mid(start, end - start);
+        const int kind = headingKind(line, start, text.size());
+        if (kind >= 0 && kind != sections.last().kind) {
+            sections.last().length = start - sections.last().offset;
+            sections.append({ static_cast<Kind>(kind), start, 0, line.trimmed().left(MaxHeadingChars).toString() });
+        }
+        start = end + 1;
+    }
+    sections.last().length = text.size() - sections.last().offset;
+
+    if (sections.size() > 1 && sections.first().length == 0) {
+        sections.removeFirst();
+    }
+    return sections;
+}
+
+SectionSegmenter::Selection SectionSegmenter::select(const QString& text, Kinds excluded) {
+    Selection result;
+    result.text = text;
+
+    const QVector<Section> sections = segment(text);
+    result.segmented = sections.size() > 1 || sections.first().kind != Front;
+    if (!result.segmented || (excluded & AllKinds) == 0) {
+        return result;
+    }
+
+    QString kept;
+    kept.reserve(text.size());
+    Selection selected;
+    selected.segmented = true;
+    for (const Section& section : sections) {
+        const QString label = section.heading.isEmpty() ? displayName(section.kind) : section.heading;
+        if (excluded & kindBit(section.kind)) {
+            selected.droppedChars += section.length;
+            selected.droppedHeadings.append(label);
+        } else {
+            kept += QStringView(text).mid(section.offset, section.length);
+            selected.keptHeadings.append(label);
+        }
+    }
+
+    // Better to send too much than nothing
+    if (selected.droppedChars == 0 || kept.trimmed().isEmpty()) {
+        return result;
+    }
+    selected.text = kept;
+    return selected;
+}
+
+QString SectionSegmenter::kindName(Kind kind) {
+    switch (kind) {
+    case Front: return "front";
+    case Abstract: return "abstract";
+    case Introduction: return "introduction";
+    case Methods: return "methods";
+    case Results: return "results";
+    case Discussion: return "discussion";
+    case Conclusion: return "conclusion";
+    case Acknowledgments: return "acknowledgments";
+    case References: return "references";
+    case Appendix: return "appendix";
+    case KindCount: break;
+    }
+    return QString();
+}
+
+QString SectionSegmenter::displayName(Kind kind) {
+    if (kind == Front) {
+        return "Front matter";
+    }
+    const QString name = kindName(kind);
+    return name.left(1).toUpper() + name.mid(1);
+}
+
+SectionSegmenter::Kinds SectionSegmenter::parseKinds(const QString& names, bool* ok) {
+    Kinds kinds = 0;
+    bool allKnown = true;
+    for (const QString& part : names.split(',', Qt::SkipEmptyParts)) {
+        const QString name = part.trimmed().toLower();
+        if (name == "all") {
+            kinds |= AllKinds;
+            continue;
+        }
+        bool found = false;
+        for (int k = 0; k < KindCount; ++k) {
+            if (kindName(static_cast<Kind>(k)) == name) {
+                kinds |= kindBit(static_cast<Kind>(k));
+                found = true;
+                break;
+            }
+        }
+        allKnown = allKnown && (found || name.isEmpty());
+    }
+    if (ok) {
+        *ok = allKnown;
+    }
+    return kinds;
+}
+
+QString SectionSegmenter::formatKinds(Kinds kinds) {
+    QStringList names;
+    for (int k = 0; k < KindCount; ++k) {
+        if (kinds & kindBit(static_cast<Kind>(k))) {
+            names.append(kindName(static_cast<Kind>(k)));
+        }
+    }
+    return names.join(',');
+}
@@ -0,0 +1,79 @@
+#ifndef SECTIONSEGMENTER_H
+#define SECTIONSEGMENTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Splits a paper's text at its standard section headings so the prompts can
+// leave out the parts that only cost tokens (references are often a quarter of
+// a paper). A heading is a short line on its own, optionally numbered
+// ("3.", "III.", "B"), naming one of the sections below in Title Case, sentence
+// case or ALL CAPS, e.g. "2 Materials and Methods" or "REFERENCES". A line that
+// starts in lower case is running text, so the end of a wrapped sentence
+// ("appendix.") doesn't start a section. "Abstract" also counts when the
+// abstract starts on the same line ("Abstract—We present ..."). Text before the
+// first heading is the front matter (title, authors, affiliations); headings
+// that aren't recognized stay part of the section they appear in.
+//
+// Back matter headings (acknowledgments, references, appendix) are only taken
+// in the later part of the document, so a table of contents or a sentence
+// starting with "References" near the top doesn't cut the paper short.
+//
+// Plain text in, plain text out; used by QueryRunner and the command line tool.
+class SectionSegmenter {
+public:
+    enum Kind {
+        Front,
+        Abstract,
+        Introduction,
+        Methods,
+        Results,
+        Discussion,
+        Conclusion,
+        Acknowledgments,
+        References,
+        Appendix,
+        KindCount
+    };
+
+    // Bit set of kinds
+    using Kinds = quint32;
+    static constexpr Kinds kindBit(Kind kind) { return Kinds(1) << kind; }
+    static constexpr Kinds AllKinds = (Kinds(1) << KindCount) - 1;
+    static constexpr Kinds DefaultExcluded = (Kinds(1) << References) | (Kinds(1) << Appendix);
+
+    struct Section {
+        Kind kind;
+        qsizetype offset;   // Into the segmented text, at the heading
+        qsizetype length;
+        QString heading;    // Empty for the front matter
+    };
+
+    struct Selection {
+        QString text;            // Kept sections, or the input if nothing was removed
+        bool segmented = false;  // At least one heading was found
+        qsizetype droppedChars = 0;
+        QStringList keptHeadings;
+        QStringList droppedHeadings;
+    };
+
+    // Consecutive sections of the same kind are merged
+    static QVector<Section> segment(const QString& text);
+
+    // Remove the excluded kinds. Falls back to the whole text when no heading is
+    // found or nothing would be left.
+    static Selection select(const QString& text, Kinds excluded);
+
+    // Names as used in settings and on the command line ("references")
+    static QString kindName(Kind kind);
+    static QString displayName(Kind kind);   // "References"
+    // Comma-separated names; unknown names are reported through ok and ignored
+    static Kinds parseKinds(const QString& names, bool* ok = nullptr);
+    static QString formatKinds(Kinds kinds);
+
+    static constexpr int MaxHeadingChars = 80;
+    static constexpr int BackMatterMinPercent = 30;  // Back matter headings only after this share of the text
+};
+
+#endif // SECTIONSEGMENTER_H
@@ -0,0 +1,209 @@
+#include "ssestream.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStringList>
+
+namespace {
+const QString HarmonyStartTag = "<|start|>";
+const QString HarmonyMessageTag = "<|message|>";
+const QString ThinkStartTag = "<think>";
+const QString ThinkEndTag = "</think>";
+const int HarmonyHeaderMaxLength = 60;  // Same limit as removeHarmonyArtifacts
+}
+
+// ===== SSE PARSER =====
+
+SseStreamParser::SseStreamParser()
+    : m_done(false)
+{
+}
+
+void SseStreamParser::reset() {
+    m_buffer.clear();
+    m_done = false;
+    m_usage = QJsonObject();
+    m_finishReason.clear();
+}
+
+QList<SseStreamParser::Delta> SseStreamParser::feed(const QByteArray& bytes) {
+    QList<Delta> deltas;
+    m_buffer.append(bytes);
+
+    qsizetype lineStart = 0;
+    qsizetype newline;
+    while ((newline = m_buffer.indexOf('\n', lineStart)) != -1) {
+        QByteArray line = m_buffer.mid(lineStart, newline - lineStart);
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        parseLine(line, deltas);
+        lineStart = newline + 1;
+    }
+
+    // Keep the incomplete tail for the next chunk
+    m_buffer.remove(0, lineStart);
+    return deltas;
+}
+
+void SseStreamParser::parseLine(const QByteArray& line, QList<Delta>& deltas) {
+    // Blank lines separate events, ':' lines are keep-alive comments
+    if (line.isEmpty() || line.startsWith(':') || !line.startsWith("data:")) {
+        return;
+    }
+
+    QByteArray payload = line.mid(5).trimmed();
+    if (payload == "[DONE]") {
+        m_done = true;
+        return;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(payload);
+    if (!doc.isObject()) {
+        return;
+    }
+
+    QJsonObject obj = doc.object();
+    if (obj.contains("usage") && obj["usage"].isObject()) {
+        m_usage = obj["usage"].toObject();
+    }
+
+    QJsonArray choices = obj["choices"].toArray();
+    if (choices.isEmpty() || !choices[0].isObject()) {
+        return;
+    }
+
+    QJsonObject choice = choices[0].toObject();
+    if (choice["finish_reason"].isString()) {
+        m_finishReason = choice["finish_reason"].toString();
+    }
+
+    QJsonObject delta = choice["delta"].toObject();
+    Delta result;
+    result.content = delta["content"].toString();
+    result.reasoning = delta.contains("reasoning")
+        ? delta["reasoning"].toString()
+        : delta["reasoning_content"].toString();
+
+    if (!result.content.isEmpty() || !result.reasoning.isEmpty()) {
+        deltas.append(result);
+    }
+}
+
+// ===== STREAM TEXT FILTER =====
+
+StreamTextFilter::StreamTextFilter()
+    : m_state(Header)
+    , m_skipNewline(false)
+{
+}
+
+void StreamTextFilter::reset() {
+    m_state = Header;
+    m_pending.clear();
+    m_reasoning.clear();
+    m_skipNewline = false;
+}
+
+int StreamTextFilter::heldBackLength(const QString& text, const QStringList& tags) {
+    // Longest suffix of text that is a proper prefix of one of the tags
+    int longest = 0;
+    for (const QString& tag : tags) {
+        for (int len = qMin<int>(tag.length() - 1, text.length()); len > longest; --len) {
+            if (text.endsWith(tag.left(len))) {
+                longest = len;
+                break;
+            }
+        }
+    }
+    return longest;
+}
+
+QString StreamTextFilter::feed(const QString& text) {
+    m_pending += text;
+    QString visible;
+
+    while (!m_pending.isEmpty()) {
+        if (m_state == Header) {
+            if (m_pending.length() < HarmonyStartTag.length() && HarmonyStartTag.startsWith(m_pending)) {
+                break;  // Could still become a Harmony header
+            }
+            if (m_pending.startsWith(HarmonyStartTag)) {
+                qsizetype messagePos = m_pending.indexOf(HarmonyMessageTag);
+                if (messagePos != -1 && messagePos <= HarmonyHeaderMaxLength) {
+                    m_pending.remove(0, messagePos + HarmonyMessageTag.length());
+                } else if (messagePos == -1 && m_pending.length() <= HarmonyHeaderMaxLength + HarmonyMessageTag.length()) {
+                    break;  // Header not complete yet
+                }
+            }
+            m_state = Body;
+            continue;
+        }
+
+        if (m_skipNewline) {
+            if (m_pending.startsWith("\r\n")) {
+                m_pending.remove(0, 2);
+            } else if (m_pending.startsWith('\n')) {
+                m_pending.remove(0, 1);
+            } else if (m_pending == "\r") {
+                break;
+            }
+            m_skipNewline = false;
+        }
+
+        if (m_state == Body) {
+            qsizetype thinkPos = m_pending.indexOf(ThinkStartTag);
+            if (thinkPos != -1) {
+                visible += m_pending.left(thinkPos);
+                m_pending.remove(0, thinkPos + ThinkStartTag.length());
+                m_state = InThink;
+                continue;
+            }
+
+            int hold = heldBackLength(m_pending, QStringList() << ThinkStartTag << "<|end|>" << "<|return|>");
+            if (m_pending.endsWith("<|end|>") || m_pending.endsWith("<|return|>")) {
+                // Only dropped if nothing follows, so wait for the next chunk
+                hold = m_pending.endsWith("<|end|>") ? 7 : 10;
+            }
+            visible += m_pending.left(m_pending.length() - hold);
+            m_pending = m_pending.right(hold);
+            break;
+        }
+
+        // InThink
+        qsizetype endPos = m_pending.indexOf(ThinkEndTag);
+        if (endPos != -1) {
+            m_reasoning += m_pending.left(endPos);
+            m_pending.remove(0, endPos + ThinkEndTag.length());
+            m_state = Body;
+            m_skipNewline = true;
+            continue;
+        }
+
+        int hold = heldBackLength(m_pending, QStringList() << ThinkEndTag);
+        m_reasoning += m_pending.left(m_pending.length() - hold);
+        m_pending = m_pending.right(hold);
+        break;
+    }
+
+    return visible;
+}
+
+QString StreamTextFilter::finish() {
+    if (m_state == InThink) {
+        // Unterminated think block - the final non-streaming pass decides what it is
+        m_reasoning += m_pending;
+        m_pending.clear();
+        return QString();
+    }
+
+    QString rest = m_pending;
+    m_pending.clear();
+
+    // Orphaned end tags at the very end, as in removeHarmonyArtifacts
+    if (rest.endsWith("<|end|>")) {
+        rest.chop(7);
+    } else if (rest.endsWith("<|return|>")) {
+        rest.chop(10);
+    }
+    return rest;
+}
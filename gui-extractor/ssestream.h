@@ -0,0 +1,72 @@
+#ifndef SSESTREAM_H
+#define SSESTREAM_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+// Incremental parser for OpenAI-compatible "stream": true responses.
+// Bytes can be fed in arbitrary network-sized pieces; only complete
+// "data:" lines are decoded.
+class SseStreamParser {
+public:
+    struct Delta {
+        QString content;
+        QString reasoning;  // gpt-oss "reasoning" / "reasoning_content" deltas
+    };
+
+    SseStreamParser();
+
+    void reset();
+
+    // Returns one delta per complete event that carried text
+    QList<Delta> feed(const QByteArray& bytes);
+
+    bool isDone() const { return m_done; }  // Saw "data: [DONE]"
+    QJsonObject usage() const { return m_usage; }
+    QString finishReason() const { return m_finishReason; }
+
+private:
+    void parseLine(const QByteArray& line, QList<Delta>& deltas);
+
+    QByteArray m_buffer;
+    bool m_done;
+    QJsonObject m_usage;
+    QString m_finishReason;
+};
+
+// Streaming counterpart of PromptQuery::removeHarmonyArtifacts and
+// extractThinkTags, for live display only. Text that might be the start of a
+// tag is held back until the next chunk decides it; the final result still
+// goes through the regular non-streaming cleanup.
+class StreamTextFilter {
+public:
+    StreamTextFilter();
+
+    void reset();
+
+    // Returns the newly visible text (may be empty)
+    QString feed(const QString& text);
+
+    // Flush anything held back at the end of the stream
+    QString finish();
+
+    QString reasoning() const { return m_reasoning; }
+
+private:
+    enum State {
+        Header,   // Deciding whether the stream opens with a Harmony header
+        Body,
+        InThink
+    };
+
+    static int heldBackLength(const QString& text, const QStringList& tags);
+
+    State m_state;
+    QString m_pending;
+    QString m_reasoning;
+    bool m_skipNewline;
+};
+
+#endif // SSESTREAM_H
@@ -0,0 +1,218 @@
+#include "structuredtext.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<StructuredText::Block>, "blocks are stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<StructuredText::Page>, "pages are stored as raw bytes");
+
+namespace {
+const quint32 LayoutVersion = 1;
+}
+
+void StructuredText::appendPage(int pageIndex, const QString& pageText, const QSizeF& pageSize,
+                                const QVector<QRectF>& lineBounds) {
+    Page page;
+    page.pageIndex = pageIndex;
+    page.offset = static_cast<qint32>(m_text.size());
+    page.length = static_cast<qint32>(pageText.size());
+    page.firstBlock = static_cast<qint32>(m_blocks.size());
+    page.width = static_cast<float>(pageSize.width());
+    page.height = static_cast<float>(pageSize.height());
+
+    // One block per non-empty line; a trailing \r (PDFium ends lines with \r\n) isn't part of it
+    qsizetype start = 0;
+    while (start <= pageText.size()) {
+        qsizetype end = pageText.indexOf(u'\n', start);
+        if (end < 0) {
+            end = pageText.size();
+        }
+        qsizetype lineEnd = end;
+        if (lineEnd > start && pageText.at(lineEnd - 1) == u'\r') {
+            --lineEnd;
+        }
+        if (!QStringView(pageText).mid(start, lineEnd - start).trimmed().isEmpty()) {
+            Block block;
+            block.offset = static_cast<qint32>(page.offset + start);
+            block.length = static_cast<qint32>(lineEnd - start);
+            block.x = block.y = block.width = block.height = 0;
+            m_blocks.append(block);
+        }
+        start = end + 1;
+    }
+    page.blockCount = static_cast<qint32>(m_blocks.size()) - page.firstBlock;
+
+    if (lineBounds.size() == page.blockCount) {
+        for (int i = 0; i < page.blockCount; ++i) {
+            Block& block = m_blocks[page.firstBlock + i];
+            const QRectF& rect = lineBounds[i];
+            block.x = static_cast<float>(rect.x());
+            block.y = static_cast<float>(rect.y());
+            block.width = static_cast<float>(rect.width());
+            block.height = static_cast<float>(rect.height());
+        }
+    }
+
+    m_pages.append(page);
+    m_text += pageText;
+    m_text += QLatin1String("\n\n");
+}
+
+void StructuredText::append(const StructuredText& other) {
+    const qint32 textShift = static_cast<qint32>(m_text.size());
+    const qint32 blockShift = static_cast<qint32>(m_blocks.size());
+
+    m_text += other.m_text;
+    m_pages.reserve(m_pages.size() + other.m_pages.size());
+    for (Page page : other.m_pages) {
+        page.offset += textShift;
+        page.firstBlock += blockShift;
+        m_pages.append(page);
+    }
+    m_blocks.reserve(m_blocks.size() + other.m_blocks.size());
+    for (Block block : other.m_blocks) {
+        block.offset += textShift;
+        m_blocks.append(block);
+    }
+}
+
+void StructuredText::clear() {
+    m_text.clear();
+    m_pages.clear();
+    m_blocks.clear();
+}
+
+QStringView StructuredText::pageText(int i) const {
+    return QStringView(m_text).mid(m_pages[i].offset, m_pages[i].length);
+}
+
+QStringList StructuredText::pageTexts() const {
+    QStringList pages;
+    pages.reserve(m_pages.size());
+    for (int i = 0; i < m_pages.size(); ++i) {
+        pages.append(pageText(i).toString());
+    }
+    return pages;
+}
+
+QStringView StructuredText::blockText(int i) const {
+    return QStringView(m_text).mid(m_blocks[i].offset, m_blocks[i].length);
+}
+
+int StructuredText::pageAt(qsizetype offset) const {
+    if (offset < 0 || offset >= m_text.size()) {
+        return -1;
+    }
+    // Last page starting at or before offset; the blank line after a page belongs to it
+    auto it = std::upper_bound(m_pages.cbegin(), m_pages.cend(), offset, [](qsizetype value, const Page& page) {
+        return value < page.offset;
+    });
+    return static_cast<int>(it - m_pages.cbegin()) - 1;
+}
+
+void StructuredText::removeBlocks(const QVector<bool>& drop) {
+    QString text;
+    text.reserve(m_text.size());
+    QVector<Block> blocks;
+    blocks.reserve(m_blocks.size());
+    const QStringView old(m_text);
+
+    for (Page& page : m_pages) {
+        const qsizetype pageEnd = page.offset + page.length;
+        const int first = page.firstBlock;
+        const int last = page.firstBlock + page.blockCount;
+        qsizetype copied = page.offset;
+
+        page.offset = static_cast<qint32>(text.size());
+        page.firstBlock = static_cast<qint32>(blocks.size());
+
+        for (int b = first; b < last; ++b) {
+            const Block& block = m_blocks[b];
+            if (b < drop.size() && drop[b]) {
+                // A line goes with the line break after it; the page's last line
+                // with the one before it
+                text += old.mid(copied, block.offset - copied);
+                const qsizetype newline = m_text.indexOf(u'\n', block.offset);
+                if (newline >= 0 && newline < pageEnd) {
+                    copied = newline + 1;
+                } else {
+                    copied = pageEnd;
+                    if (text.size() > page.offset && text.endsWith(u'\n')) {
+                        text.chop(1);
+                        if (text.size() > page.offset && text.endsWith(u'\r')) {
+                            text.chop(1);
+                        }
+                    }
+                }
+            } else {
+                text += old.mid(copied, block.offset - copied);
+                copied = block.offset;
+                Block moved = block;
+                moved.offset = static_cast<qint32>(text.size());
+                blocks.append(moved);
+            }
+        }
+        text += old.mid(copied, pageEnd - copied);
+
+        page.length = static_cast<qint32>(text.size()) - page.offset;
+        page.blockCount = static_cast<qint32>(blocks.size()) - page.firstBlock;
+        text += QLatin1String("\n\n");
+    }
+
+    m_text = text;
+    m_blocks = blocks;
+}
+
+QByteArray StructuredText::layout() const {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << LayoutVersion << quint32(m_pages.size()) << quint32(m_blocks.size());
+    out.writeRawData(reinterpret_cast<const char*>(m_pages.constData()),
+                     static_cast<int>(m_pages.size() * sizeof(Page)));
+    out.writeRawData(reinterpret_cast<const char*>(m_blocks.constData()),
+                     static_cast<int>(m_blocks.size() * sizeof(Block)));
+    return data;
+}
+
+StructuredText StructuredText::fromLayout(const QString& text, const QByteArray& layout) {
+    StructuredText result;
+    QDataStream in(layout);
+    quint32 version = 0;
+    quint32 pageCount = 0;
+    quint32 blockCount = 0;
+    in >> version >> pageCount >> blockCount;
+    const qint64 expected = 3 * sizeof(quint32) + qint64(pageCount) * sizeof(Page) + qint64(blockCount) * sizeof(Block);
+    if (in.status() != QDataStream::Ok || version != LayoutVersion || pageCount == 0 || layout.size() != expected) {
+        return result;
+    }
+
+    result.m_pages.resize(pageCount);
+    result.m_blocks.resize(blockCount);
+    in.readRawData(reinterpret_cast<char*>(result.m_pages.data()), static_cast<int>(pageCount * sizeof(Page)));
+    in.readRawData(reinterpret_cast<char*>(result.m_blocks.data()), static_cast<int>(blockCount * sizeof(Block)));
+
+    // The layout must fit this text exactly: pages back to back, blocks inside their page
+    qsizetype offset = 0;
+    qint32 nextBlock = 0;
+    for (const Page& page : std::as_const(result.m_pages)) {
+        if (page.offset != offset || page.length < 0 || page.firstBlock != nextBlock || page.blockCount < 0
+            || page.firstBlock + page.blockCount > qint32(blockCount)) {
+            return StructuredText();
+        }
+        for (int b = page.firstBlock; b < page.firstBlock + page.blockCount; ++b) {
+            const Block& block = result.m_blocks[b];
+            if (block.offset < page.offset || block.length < 0 || block.offset + block.length > page.offset + page.length) {
+                return StructuredText();
+            }
+        }
+        offset = page.offset + page.length + 2;
+        nextBlock = page.firstBlock + page.blockCount;
+    }
+    if (offset != text.size() || nextBlock != qint32(blockCount)) {
+        return StructuredText();
+    }
+
+    result.m_text = text;
+    return result;
+}
@@ -0,0 +1,89 @@
+#ifndef STRUCTUREDTEXT_H
+#define STRUCTUREDTEXT_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+// Extracted text that keeps its page structure. text() is exactly the flat
+// string extraction has always produced (every page followed by a blank line);
+// pages and blocks index into it, so chunking, boilerplate removal and section
+// detection can ask which page a passage is on or where a line sat without
+// parsing the PDF again.
+//
+// A block is one non-empty line of a page, with its bounding box in page points
+// (origin top-left) from QPdfSelection when the extraction asked for line boxes
+// (the pipeline doesn't: boilerplate and section detection only need the lines).
+// QtPdf exposes no font names or sizes; the box height is the closest proxy for
+// the type size.
+//
+// Pages and blocks are two flat arrays of small PODs next to the text (24 bytes
+// per line), which keeps the overhead small and makes layout() a plain copy.
+class StructuredText {
+public:
+    struct Block {
+        qint32 offset;   // Into text()
+        qint32 length;   // Line without its line break
+        float x;
+        float y;
+        float width;     // 0 when the position is unknown
+        float height;
+
+        QRectF bounds() const { return QRectF(x, y, width, height); }
+    };
+
+    struct Page {
+        qint32 pageIndex;   // In the document
+        qint32 offset;      // Into text()
+        qint32 length;      // Without the blank line that follows
+        qint32 firstBlock;
+        qint32 blockCount;
+        float width;        // Page size in points
+        float height;
+    };
+
+    // Append the next page. lineBounds holds one box per non-empty line of
+    // pageText; if the count doesn't match, the blocks get no position.
+    void appendPage(int pageIndex, const QString& pageText, const QSizeF& pageSize = QSizeF(),
+                    const QVector<QRectF>& lineBounds = QVector<QRectF>());
+    void append(const StructuredText& other);
+    void clear();
+
+    const QString& text() const { return m_text; }
+    bool isEmpty() const { return m_pages.isEmpty(); }
+
+    int pageCount() const { return static_cast<int>(m_pages.size()); }
+    const Page& page(int i) const { return m_pages[i]; }
+    QStringView pageText(int i) const;
+    QStringList pageTexts() const;
+
+    int blockCount() const { return static_cast<int>(m_blocks.size()); }
+    const Block& block(int i) const { return m_blocks[i]; }
+    QStringView blockText(int i) const;
+
+    // Page (index into pages, not the document) containing a character of text(); -1 if none
+    int pageAt(qsizetype offset) const;
+
+    // Remove the marked blocks together with their line breaks and shift every
+    // offset behind them. drop is indexed like the blocks.
+    void removeBlocks(const QVector<bool>& drop);
+
+    // Pages and blocks without the text, for caching next to it
+    QByteArray layout() const;
+    // Empty result if layout doesn't describe text
+    static StructuredText fromLayout(const QString& text, const QByteArray& layout);
+
+private:
+    QString m_text;
+    QVector<Page> m_pages;
+    QVector<Block> m_blocks;
+};
+
+Q_DECLARE_METATYPE(StructuredText)
+
+#endif // STRUCTUREDTEXT_H
@@ -0,0 +1,202 @@
+#include "textcleaner.h"
+
+namespace {
+// \b in QRegularExpression (without UseUnicodePropertiesOption) only knows ASCII word characters
+bool isAsciiWordChar(QChar c) {
+    const char16_t u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_';
+}
+
+// "Copyright.*\n", case-insensitive
+qsizetype matchCopyright(QStringView line) {
+    return line.indexOf(u"copyright", 0, Qt::CaseInsensitive);
+}
+
+// "©.*\n"
+qsizetype matchCopyrightSign(QStringView line) {
+    return line.indexOf(QChar(0x00A9));
+}
+
+// "All [Rr]ights [Rr]eserved.*\n"
+qsizetype matchAllRightsReserved(QStringView line) {
+    for (qsizetype pos = line.indexOf(u"All "); pos >= 0; pos = line.indexOf(u"All ", pos + 1)) {
+        QStringView rest = line.mid(pos + 4);
+        if (rest.size() >= 15
+            && (rest[0] == u'R' || rest[0] == u'r') && rest.mid(1, 6) == u"ights "
+            && (rest[7] == u'R' || rest[7] == u'r') && rest.mid(8, 7) == u"eserved") {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+// "Licensed under.*\n"
+qsizetype matchLicensedUnder(QStringView line) {
+    return line.indexOf(u"Licensed under");
+}
+
+// "This .* is licensed.*\n" - the leftmost "This " works if any " is licensed" follows it
+qsizetype matchThisIsLicensed(QStringView line) {
+    const qsizetype pos = line.indexOf(u"This ");
+    if (pos < 0) {
+        return -1;
+    }
+    return line.lastIndexOf(u" is licensed") >= pos + 5 ? pos : -1;
+}
+
+// "\bLicense\b.*\n", case-insensitive
+qsizetype matchLicenseWord(QStringView line) {
+    const qsizetype length = 7;
+    for (qsizetype pos = line.indexOf(u"license", 0, Qt::CaseInsensitive); pos >= 0;
+         pos = line.indexOf(u"license", pos + 1, Qt::CaseInsensitive)) {
+        const bool startsWord = (pos == 0) || !isAsciiWordChar(line[pos - 1]);
+        const bool endsWord = (pos + length >= line.size()) || !isAsciiWordChar(line[pos + length]);
+        if (startsWord && endsWord) {
+            return pos;
+        }
+    }
+    return -1;
+}
+}
+
+const TextCleaner::LineRule TextCleaner::Rules[RuleCount] = {
+    matchCopyright,
+    matchCopyrightSign,
+    matchAllRightsReserved,
+    matchLicensedUnder,
+    matchThisIsLicensed,
+    matchLicenseWord
+};
+
+TextCleaner::TextCleaner(Source source, qsizetype sizeHint)
+    : m_source(source)
+    , m_pendingNewlines(0)
+    , m_pendingSpace(false)
+{
+    m_out.reserve(sizeHint);
+}
+
+QString TextCleaner::clean(const QString& text, Source source) {
+    TextCleaner cleaner(source, text.size());
+
+    // Split into lines, treating CRLF and lone CR as LF
+    const QChar* data = text.constData();
+    const qsizetype size = text.size();
+    qsizetype lineStart = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const QChar c = data[i];
+        if (c == u'\n' || c == u'\r') {
+            cleaner.feedLine(0, QStringView(data + lineStart, i - lineStart), true);
+            if (c == u'\r' && i + 1 < size && data[i + 1] == u'\n') {
+                ++i;
+            }
+            lineStart = i + 1;
+        }
+    }
+    cleaner.feedLine(0, QStringView(data + lineStart, size - lineStart), false);
+    cleaner.finish();
+
+    return std::move(cleaner.m_out).trimmed();
+}
+
+void TextCleaner::feedLine(int stage, QStringView piece, bool hasNewline) {
+    if (stage == RuleCount) {
+        emitChars(piece);
+        if (hasNewline) {
+            emitChar(u'\n');
+        }
+        return;
+    }
+
+    // A rule only sees complete lines; a cut line (no newline) joins the next one
+    if (!hasNewline) {
+        m_carry[stage].append(piece);
+        return;
+    }
+
+    QString joined;
+    QStringView line = piece;
+    if (!m_carry[stage].isEmpty()) {
+        joined.swap(m_carry[stage]);
+        joined.append(piece);
+        line = joined;
+    }
+
+    const qsizetype cut = Rules[stage](line);
+    if (cut < 0) {
+        feedLine(stage + 1, line, true);
+    } else {
+        feedLine(stage + 1, line.left(cut), false);
+    }
+}
+
+void TextCleaner::finish() {
+    // Text after the last newline never matched a rule (they all need the newline)
+    for (int stage = 0; stage < RuleCount; ++stage) {
+        QString rest;
+        rest.swap(m_carry[stage]);
+        if (!rest.isEmpty()) {
+            feedLine(stage + 1, rest, false);
+        }
+    }
+    flushRuns();
+}
+
+void TextCleaner::emitChars(QStringView text) {
+    for (QChar c : text) {
+        emitChar(c);
+    }
+}
+
+void TextCleaner::emitChar(QChar c) {
+    switch (c.unicode()) {
+    case 0x00AD:  // Soft hyphen
+    case 0xFFFD:  // Replacement character
+    case 0xFFF9:  // Interlinear annotation anchor
+    case 0xFFFA:  // Interlinear annotation separator
+    case 0xFFFB:  // Interlinear annotation terminator
+        return;   // Dropped before whitespace is collapsed, so they never split a run
+    case u' ':
+    case u'\t':
+        if (m_pendingNewlines > 0) {
+            flushRuns();
+        }
+        m_pendingSpace = true;
+        return;
+    case u'\n':
+        if (m_pendingSpace) {
+            flushRuns();
+        }
+        m_pendingNewlines++;
+        return;
+    default:
+        break;
+    }
+
+    flushRuns();
+
+    if (m_source == PastedText) {
+        // Removed after whitespace is collapsed, so these do split a run
+        if (c.unicode() == 0x200B || c.unicode() == 0xFEFF) {  // Zero-width space, BOM
+            return;
+        }
+        if (c.unicode() == 0x201E) {  // Low double quote
+            m_out.append(u'"');
+            return;
+        }
+    }
+
+    m_out.append(c);
+}
+
+void TextCleaner::flushRuns() {
+    if (m_pendingSpace) {
+        m_out.append(u' ');
+        m_pendingSpace = false;
+    }
+    if (m_pendingNewlines > 0) {
+        // 1 or 2 newlines are kept, 3 or more become 2
+        m_out.append(m_pendingNewlines == 1 ? QStringView(u"\n") : QStringView(u"\n\n"));
+        m_pendingNewlines = 0;
+    }
+}
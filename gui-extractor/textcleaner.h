@@ -0,0 +1,51 @@
+#ifndef TEXTCLEANER_H
+#define TEXTCLEANER_H
+
+#include <QString>
+#include <QStringView>
+
+// Single-pass text cleanup for LLM input. Produces exactly the same output as the
+// old chain of QString::replace/remove calls in QueryRunner::cleanupText:
+//   - CRLF and CR normalized to LF
+//   - copyright/license lines cut from the match to the end of the line
+//     (the newline goes too, so the rest of the line joins the next one)
+//   - soft hyphens and replacement/annotation characters removed
+//   - runs of 3+ newlines collapsed to 2, runs of spaces/tabs to one space
+//   - pasted text: zero-width spaces/BOMs removed and „ replaced by "
+//   - leading/trailing whitespace trimmed
+//
+// The old code ran each copyright rule as its own pass over the joined output of
+// the previous one; here the rules are chained line filters fed in one scan of
+// the input, which keeps that behaviour without copying the whole string per rule.
+class TextCleaner {
+public:
+    enum Source {
+        PdfText,
+        PastedText
+    };
+
+    static QString clean(const QString& text, Source source);
+
+private:
+    // Copyright/license rules, in the order the old passes ran. Each returns the
+    // position the line is cut at, or -1 if the rule doesn't match.
+    using LineRule = qsizetype (*)(QStringView line);
+    static constexpr int RuleCount = 6;
+    static const LineRule Rules[RuleCount];
+
+    explicit TextCleaner(Source source, qsizetype sizeHint);
+
+    void feedLine(int stage, QStringView piece, bool hasNewline);
+    void finish();
+    void emitChars(QStringView text);
+    void emitChar(QChar c);
+    void flushRuns();
+
+    Source m_source;
+    QString m_carry[RuleCount];  // Partial line held by each rule stage
+    QString m_out;
+    int m_pendingNewlines;
+    bool m_pendingSpace;
+};
+
+#endif // TEXTCLEANER_H
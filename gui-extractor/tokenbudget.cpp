@@ -0,0 +1,299 @@
+#include "tokenbudget.h"
+#include "httpclientpool.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QUrl>
+#include <cmath>
+
+namespace {
+
+// Latin script including accented letters; other scripts cost about a token per character
+bool isLatinLetter(QChar c) {
+    return c.isLetter() && c.unicode() < 0x0250;
+}
+
+} // namespace
+
+TokenBudget::TokenBudget(QObject *parent)
+    : QObject(parent)
+    , m_contextWindow(DefaultContextWindow)
+    , m_serverTokenizer(false)
+    , m_ratio(1.0)
+    , m_sampleEstimate(0)
+{
+}
+
+TokenBudget::~TokenBudget() {
+    cancelCalibration();
+}
+
+int TokenBudget::estimateTokens(const QString& text) {
+    // Split the way GPT/Llama pre-tokenizers do, then charge each piece what BPE
+    // usually needs for it: short words merge into one token (with their leading
+    // space), longer ones split every ~4 characters, digits go in groups of three
+    // and punctuation is close to a token per character. Errs slightly high.
+    int tokens = 0;
+    const qsizetype n = text.size();
+    qsizetype i = 0;
+    while (i < n) {
+        const QChar c = text.at(i);
+        qsizetype j = i + 1;
+
+        if (isLatinLetter(c)) {
+            while (j < n && isLatinLetter(text.at(j))) {
+                ++j;
+            }
+            const qsizetype length = j - i;
+            tokens += length <= 5 ? 1 : 1 + static_cast<int>((length - 2) / 4);
+        } else if (c.isDigit()) {
+            while (j < n && text.at(j).isDigit()) {
+                ++j;
+            }
+            tokens += static_cast<int>((j - i + 2) / 3);
+        } else if (c == ' ') {
+            // A single space belongs to the next word
+            while (j < n && text.at(j) == ' ') {
+                ++j;
+            }
+            if (j - i > 1) {
+                tokens++;
+            }
+        } else if (c.isSpace()) {
+            while (j < n && text.at(j).isSpace()) {
+                ++j;
+            }
+            tokens++;
+        } else if (c.isHighSurrogate()) {
+            // Emoji and rare symbols are usually split into several byte tokens
+            if (j < n && text.at(j).isLowSurrogate()) {
+                ++j;
+            }
+            tokens += 2;
+        } else if (c.isLetter()) {
+            tokens++;
+        } else {
+            while (j < n && text.at(j).isPunct() && text.at(j) == c) {
+                ++j;
+            }
+            // Repeated punctuation ("...", "----") merges pairwise
+            tokens += static_cast<int>((j - i + 1) / 2);
+        }
+        i = j;
+    }
+    return tokens;
+}
+
+int TokenBudget::countTokens(const QString& text) const {
+    return static_cast<int>(std::ceil(estimateTokens(text) * m_ratio));
+}
+
+TokenBudget::Plan TokenBudget::plan(const QString& systemPrompt, const QString& userPrompt, const QString& input,
+                                    int maxResponseTokens) const {
+    const int contextTokens = m_contextWindow;
+    Plan result;
+    result.input = input;
+
+    // The input may be substituted more than once ({text} used twice)
+    const int occurrences = static_cast<int>(userPrompt.count(InputMarker));
+    QString fixedPart = userPrompt;
+    fixedPart.remove(InputMarker);
+
+    int fixedTokens = countTokens(fixedPart) + MessageOverheadTokens;
+    if (!systemPrompt.isEmpty()) {
+        fixedTokens += countTokens(systemPrompt) + MessageOverheadTokens;
+    }
+    const int inputTokens = occurrences > 0 ? countTokens(input) : 0;
+
+    // Room kept for the answer: the stage's maximum, but never most of the window
+    const int reserve = qMax(qMin(MinResponseTokens, maxResponseTokens),
+                             qMin(maxResponseTokens, contextTokens * ResponseSharePercent / 100));
+    result.promptTokens = fixedTokens + occurrences * inputTokens;
+
+    if (result.promptTokens + reserve > contextTokens && occurrences > 0) {
+        const int inputBudget = (contextTokens - reserve - fixedTokens) / occurrences;
+        if (inputBudget <= 0) {
+            result.fits = false;
+            result.input.clear();
+            result.droppedTokens = inputTokens;
+            result.promptTokens = fixedTokens;
+            result.maxTokens = qBound(0, contextTokens - fixedTokens, maxResponseTokens);
+            return result;
+        }
+        result.input = trimToTokens(input, inputBudget);
+        const int keptTokens = countTokens(result.input);
+        result.droppedTokens = inputTokens - keptTokens;
+        result.promptTokens = fixedTokens + occurrences * keptTokens;
+    }
+
+    result.maxTokens = qMin(maxResponseTokens, contextTokens - result.promptTokens);
+    if (result.maxTokens <= 0) {
+        result.fits = false;
+        result.maxTokens = 0;
+    }
+    return result;
+}
+
+QString TokenBudget::trimToTokens(const QString& text, int maxTokens) const {
+    if (maxTokens <= 0) {
+        return QString();
+    }
+    if (countTokens(text) <= maxTokens) {
+        return text;
+    }
+
+    // Sentence ends (with closing quotes/brackets) and paragraph breaks; the
+    // whitespace after them goes with the next sentence so the counts add up
+    static const QRegularExpression sentenceEnd(QStringLiteral("[.!?][\"')\\]]*(?=\\s)|\\n\\s*\\n"));
+
+    int used = 0;
+    qsizetype kept = 0;
+    qsizetype start = 0;
+    QRegularExpressionMatchIterator it = sentenceEnd.globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const qsizetype end = match.capturedEnd();
+        used += countTokens(text.mid(start, end - start));
+        if (used > maxTokens) {
+            break;
+        }
+        kept = end;
+        start = end;
+    }
+    if (kept > 0) {
+        return text.left(kept);
+    }
+
+    // No sentence fits (one enormous run-on "sentence"): cut at a word instead,
+    // scaling the character count by this text's own tokens-per-character
+    const double charsPerToken = static_cast<double>(text.size()) / qMax(1, countTokens(text));
+    return trimToChars(text, static_cast<int>(maxTokens * charsPerToken));
+}
+
+QString TokenBudget::trimToChars(const QString& text, int maxChars) {
+    if (text.size() <= maxChars) {
+        return text;
+    }
+    if (maxChars <= 0) {
+        return QString();
+    }
+
+    // Prefer the last sentence end in the final quarter, then the last space
+    const QString head = text.left(maxChars);
+    static const QRegularExpression sentenceEnd(QStringLiteral("[.!?][\"')\\]]*\\s"));
+    qsizetype cut = -1;
+    QRegularExpressionMatchIterator it = sentenceEnd.globalMatch(head, maxChars * 3 / 4);
+    while (it.hasNext()) {
+        cut = it.next().capturedEnd() - 1;
+    }
+    if (cut < 0) {
+        cut = head.lastIndexOf(' ');
+    }
+    if (cut < maxChars / 2) {
+        cut = maxChars;
+    }
+    return text.left(cut).trimmed();
+}
+
+void TokenBudget::setServerTokenizer(bool enabled, const QString& chatUrl, const QString& modelName) {
+    // llama.cpp serves /tokenize next to /v1/chat/completions
+    QUrl url(chatUrl);
+    url.setPath("/tokenize");
+    url.setQuery(QString());
+    const QString tokenizeUrl = url.toString();
+
+    if (tokenizeUrl != m_tokenizeUrl || modelName != m_modelName) {
+        cancelCalibration();
+    }
+    m_serverTokenizer = enabled;
+    m_tokenizeUrl = tokenizeUrl;
+    m_modelName = modelName;
+
+    // A ratio measured on another model's tokenizer doesn't carry over
+    if (!enabled || m_calibratedFor != endpointKey()) {
+        m_ratio = 1.0;
+        m_calibratedFor.clear();
+    }
+}
+
+bool TokenBudget::needsCalibration() const {
+    return m_serverTokenizer && !m_tokenizeUrl.isEmpty()
+        && m_calibratedFor != endpointKey() && !m_unsupported.contains(endpointKey());
+}
+
+void TokenBudget::calibrate(const QString& sample) {
+    cancelCalibration();
+
+    const QString text = trimToChars(sample, CalibrationSampleChars);
+    m_sampleEstimate = estimateTokens(text);
+    if (m_sampleEstimate < 100) {
+        // Too little text for a meaningful ratio; try again with the next document
+        emit calibrationFailed("sample too short");
+        return;
+    }
+
+    QNetworkRequest request{QUrl(m_tokenizeUrl)};
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setTransferTimeout(CalibrationTimeoutMs);
+
+    QJsonObject body;
+    body["content"] = text;
+    QNetworkReply* reply = HttpClientPool::instance()->post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
+    if (!reply) {
+        emit calibrationFailed("could not create request");
+        return;
+    }
+    m_reply = reply;
+    connect(reply, &QNetworkReply::finished, this, &TokenBudget::handleCalibrationReply);
+}
+
+void TokenBudget::cancelCalibration() {
+    if (m_reply) {
+        QNetworkReply* reply = m_reply;
+        m_reply = nullptr;
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void TokenBudget::handleCalibrationReply() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || reply != m_reply) {
+        return;
+    }
+    m_reply = nullptr;
+    reply->deleteLater();
+
+    QString error;
+    int serverTokens = -1;
+    if (reply->error() != QNetworkReply::NoError) {
+        error = reply->errorString();
+    } else {
+        const QJsonArray tokens = QJsonDocument::fromJson(reply->readAll()).object().value("tokens").toArray();
+        if (tokens.isEmpty()) {
+            error = "no tokens in /tokenize response";
+        } else {
+            serverTokens = static_cast<int>(tokens.size());
+        }
+    }
+
+    if (serverTokens < 0) {
+        // Don't ask this endpoint again this session
+        m_unsupported.insert(endpointKey());
+        qDebug() << "TokenBudget: server tokenizer unavailable at" << m_tokenizeUrl << "-" << error;
+        emit calibrationFailed(error);
+        return;
+    }
+
+    // A wildly different count means the endpoint isn't what we think it is
+    m_ratio = qBound(0.5, static_cast<double>(serverTokens) / m_sampleEstimate, 2.0);
+    m_calibratedFor = endpointKey();
+    qDebug() << "TokenBudget: server counted" << serverTokens << "tokens, estimate was" << m_sampleEstimate
+             << "- ratio" << m_ratio;
+    emit calibrated(m_ratio);
+}
@@ -0,0 +1,95 @@
+#ifndef TOKENBUDGET_H
+#define TOKENBUDGET_H
+
+#include <QObject>
+#include <QChar>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+
+class QNetworkReply;
+
+// Fits each request into the model's context window (one setting for all
+// stages). Prompt tokens (system message, user prompt and every
+// {text}/{summary_result} substitution) are counted first. The input is trimmed
+// at a sentence boundary if the prompt would leave less than the stage's
+// maximum response (capped at a quarter of the window) for the answer, and
+// max_tokens is the stage's maximum or whatever the prompt leaves, if less.
+//
+// Counting uses a local estimator that follows how BPE tokenizers split text,
+// so it costs one scan and needs no vocabulary. Optionally the server's own
+// tokenizer (llama.cpp-style POST /tokenize) measures a sample of the first
+// document once per endpoint and model; local estimates are then scaled by the
+// measured ratio. Servers without the endpoint keep the plain estimate.
+//
+// Main thread only.
+class TokenBudget : public QObject {
+    Q_OBJECT
+
+public:
+    struct Plan {
+        QString input;          // Trimmed to fit; unchanged if it already did
+        int promptTokens = 0;   // Estimated tokens of all messages
+        int maxTokens = 0;      // Left for the response
+        int droppedTokens = 0;  // Estimated input tokens cut off
+        bool fits = true;       // false: the prompt without any input already leaves no room
+    };
+
+    explicit TokenBudget(QObject *parent = nullptr);
+    ~TokenBudget();
+
+    // Local estimate, no calibration applied
+    static int estimateTokens(const QString& text);
+
+    // Estimate scaled to the server's tokenizer when calibrated
+    int countTokens(const QString& text) const;
+
+    // Model context window in tokens, shared by all stages
+    void setContextWindow(int tokens) { m_contextWindow = qMax(MinResponseTokens, tokens); }
+    int contextWindow() const { return m_contextWindow; }
+
+    // userPrompt is the full user message with each occurrence of the input
+    // replaced by InputMarker (see PromptQuery::execute)
+    Plan plan(const QString& systemPrompt, const QString& userPrompt, const QString& input,
+              int maxResponseTokens) const;
+
+    // Longest prefix of text within maxTokens, ending at a sentence (or failing
+    // that, word) boundary
+    QString trimToTokens(const QString& text, int maxTokens) const;
+    static QString trimToChars(const QString& text, int maxChars);
+
+    // Server tokenizer calibration
+    void setServerTokenizer(bool enabled, const QString& chatUrl, const QString& modelName);
+    bool needsCalibration() const;
+    void calibrate(const QString& sample);
+    void cancelCalibration();
+    double ratio() const { return m_ratio; }
+
+    static constexpr QChar InputMarker = QChar(0xE000);  // Private use; never in extracted text
+    static constexpr int MessageOverheadTokens = 4;      // Role and separator tokens per chat message
+    static constexpr int DefaultContextWindow = 131072;  // gpt-oss and most current local models
+    static constexpr int MinResponseTokens = 512;
+    static constexpr int ResponseSharePercent = 25;      // Most of the window the answer reserve may take
+    static constexpr int CalibrationSampleChars = 16000;
+    static constexpr int CalibrationTimeoutMs = 10000;
+
+signals:
+    void calibrated(double ratio);
+    void calibrationFailed(const QString& error);
+
+private:
+    void handleCalibrationReply();
+    QString endpointKey() const { return m_tokenizeUrl + "|" + m_modelName; }
+
+    int m_contextWindow;
+    bool m_serverTokenizer;
+    QString m_tokenizeUrl;
+    QString m_modelName;
+    double m_ratio;              // Server tokens per estimated token (1.0 = uncalibrated)
+    QString m_calibratedFor;     // endpointKey() the ratio was measured on
+    QSet<QString> m_unsupported; // Endpoints whose /tokenize failed this session
+    QPointer<QNetworkReply> m_reply;
+    int m_sampleEstimate;
+};
+
+#endif // TOKENBUDGET_H
@@ -0,0 +1,513 @@
+#include "zoterocache.h"
+#include "httpclientpool.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUrl>
+#include <QUrlQuery>
+
+ZoteroCache::ZoteroCache(QObject *parent)
+    : QObject(parent)
+    , m_syncing(false)
+    , m_generation(0)
+    , m_outstanding(0)
+    , m_sinceVersion(0)
+    , m_newVersion(-1)
+    , m_notModified(true)
+    , m_pagesFetched(0)
+    , m_tablesReady(false)
+{
+}
+
+ZoteroCache::~ZoteroCache() {
+    cancelSync();
+}
+
+void ZoteroCache::setLibrary(const QString& userId, const QString& apiKey) {
+    if (userId != m_userId || apiKey != m_apiKey) {
+        cancelSync();
+    }
+    m_userId = userId;
+    m_apiKey = apiKey;
+}
+
+bool ZoteroCache::hasData() const {
+    return !m_userId.isEmpty() && libraryVersion() > 0;
+}
+
+qint64 ZoteroCache::libraryVersion() const {
+    if (m_userId.isEmpty() || !ensureTables()) {
+        return 0;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT version FROM zotero_sync WHERE library = :library");
+    query.bindValue(":library", libraryId());
+    if (!query.exec() || !query.next()) {
+        return 0;
+    }
+    return query.value(0).toLongLong();
+}
+
+QList<ZoteroCollection> ZoteroCache::collections() const {
+    QList<ZoteroCollection> result;
+    if (m_userId.isEmpty() || !ensureTables()) {
+        return result;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT key, name, parent_key FROM zotero_collections WHERE library = :library");
+    query.bindValue(":library", libraryId());
+    if (!query.exec()) {
+        qDebug() << "ZoteroCache: failed to read collections:" << query.lastError().text();
+        return result;
+    }
+
+    while (query.next()) {
+        ZoteroCollection collection;
+        collection.key = query.value(0).toString();
+        collection.name = query.value(1).toString();
+        collection.parentKey = query.value(2).toString();
+        result.append(collection);
+    }
+    return result;
+}
+
+QList<ZoteroItem> ZoteroCache::itemsInCollection(const QString& collectionKey) const {
+    QList<ZoteroItem> result;
+    if (m_userId.isEmpty() || !ensureTables()) {
+        return result;
+    }
+
+    // Linked files live on the owner's disk, not on the Zotero server, so only stored
+    // attachments count as downloadable PDFs
+    QSqlQuery query(QSqlDatabase::database());
+    query.prepare("SELECT i.key, i.title, i.authors, i.year, a.key, a.version "
+                  "FROM zotero_items i "
+                  "JOIN zotero_item_collections c ON c.library = i.library AND c.item_key = i.key "
+                  "LEFT JOIN zotero_attachments a ON a.library = i.library AND a.key = "
+                  "  (SELECT p.key FROM zotero_attachments p "
+                  "   WHERE p.library = i.library AND p.parent_key = i.key "
+                  "     AND p.content_type = 'application/pdf' AND COALESCE(p.link_mode, '') != 'linked_file' "
+                  "   ORDER BY p.key LIMIT 1) "
+                  "WHERE i.library = :library AND c.collection_key = :collection");
+    query.bindValue(":library", libraryId());
+    query.bindValue(":collection", collectionKey);
+    if (!query.exec()) {
+        qDebug() << "ZoteroCache: failed to read items:" << query.lastError().text();
+        return result;
+    }
+
+    while (query.next()) {
+        ZoteroItem item;
+        item.key = query.value(0).toString();
+        item.title = query.value(1).toString();
+        item.authors = query.value(2).toString();
+        item.year = query.value(3).toString();
+        item.pdfAttachmentKey = query.value(4).toString();
+        item.pdfAttachmentVersion = query.value(5).toLongLong();
+        item.hasPdf = !item.pdfAttachmentKey.isEmpty();
+        result.append(item);
+    }
+    return result;
+}
+
+void ZoteroCache::sync() {
+    if (m_syncing || m_userId.isEmpty() || m_apiKey.isEmpty()) {
+        return;
+    }
+    if (!ensureTables()) {
+        emit syncFailed("Zotero cache database is not available");
+        return;
+    }
+
+    m_syncing = true;
+    m_sinceVersion = libraryVersion();
+    m_newVersion = -1;
+    m_notModified = true;
+    m_pagesFetched = 0;
+    m_collectionObjects.clear();
+    m_itemObjects.clear();
+    m_deletedCollections.clear();
+    m_deletedItems.clear();
+
+    emit syncProgress(m_sinceVersion > 0
+                      ? QString("Checking Zotero for changes since version %1...").arg(m_sinceVersion)
+                      : QString("Downloading Zotero library..."));
+
+    requestPage(Collections, 0);
+    requestPage(Items, 0);
+    if (m_sinceVersion > 0) {
+        // Nothing can have been deleted from an empty mirror
+        requestPage(Deleted, 0);
+    }
+}
+
+void ZoteroCache::cancelSync() {
+    m_generation++;
+    m_syncing = false;
+    m_outstanding = 0;
+    for (const QPointer<QNetworkReply>& reply : m_replies) {
+        if (reply) {
+            reply->disconnect(this);
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+    m_replies.clear();
+}
+
+void ZoteroCache::clear() {
+    if (m_userId.isEmpty() || !ensureTables()) {
+        return;
+    }
+
+    QSqlQuery query(QSqlDatabase::database());
+    for (const char* table : {"zotero_collections", "zotero_items", "zotero_item_collections",
+                              "zotero_attachments", "zotero_sync"}) {
+        query.prepare(QString("DELETE FROM %1 WHERE library = :library").arg(table));
+        query.bindValue(":library", libraryId());
+        if (!query.exec()) {
+            qDebug() << "ZoteroCache: failed to clear" << table << ":" << query.lastError().text();
+        }
+    }
+}
+
+void ZoteroCache::requestPage(Resource resource, int start) {
+    QString path;
+    QUrlQuery params;
+    switch (resource) {
+        case Collections:
+            path = "collections";
+            break;
+        case Items:
+            // Trashed items are included so moving something to the trash removes it here too
+            path = "items";
+            params.addQueryItem("includeTrashed", "1");
+            break;
+        case Deleted:
+            path = "deleted";
+            break;
+    }
+
+    params.addQueryItem("since", QString::number(m_sinceVersion));
+    if (resource != Deleted) {
+        params.addQueryItem("format", "json");
+        params.addQueryItem("limit", QString::number(PageSize));
+        params.addQueryItem("start", QString::number(start));
+    }
+
+    QUrl url(QString("https://api.zotero.org/users/%1/%2").arg(m_userId, path));
+    url.setQuery(params);
+
+    QNetworkRequest request{url};
+    request.setRawHeader("Zotero-API-Version", "3");
+    request.setRawHeader("Authorization", QString("Bearer %1").arg(m_apiKey).toUtf8());
+    if (m_sinceVersion > 0 && start == 0) {
+        request.setRawHeader("If-Modified-Since-Version", QByteArray::number(m_sinceVersion));
+    }
+
+    m_outstanding++;
+    QNetworkReply* reply = HttpClientPool::instance()->get(request);
+    m_replies.append(reply);
+
+    const int generation = m_generation;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, resource, start, generation]() {
+        handlePage(reply, resource, start, generation);
+    });
+}
+
+void ZoteroCache::handlePage(QNetworkReply* reply, Resource resource, int start, int generation) {
+    reply->deleteLater();
+    m_replies.removeAll(reply);
+    if (generation != m_generation || !m_syncing) {
+        return;
+    }
+
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const qint64 version = reply->rawHeader("Last-Modified-Version").toLongLong();
+    if (version > 0) {
+        // The library may move on while pages are in flight; settle on the oldest
+        // version seen so the next sync picks up anything that changed meanwhile
+        m_newVersion = (m_newVersion < 0) ? version : qMin(m_newVersion, version);
+    }
+
+    if (statusCode == 304) {
+        finishRequest();
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        QString error = QString("Zotero sync failed: %1 (HTTP %2)").arg(reply->errorString()).arg(statusCode);
+        if (statusCode == 403) {
+            error = "Authentication failed. Please check your Zotero credentials in Settings.";
+        } else if (statusCode == 429) {
+            error = "Zotero is rate limiting requests. Please try again in a minute.";
+        }
+        failSync(error);
+        return;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+    m_notModified = false;
+    m_pagesFetched++;
+
+    if (resource == Deleted) {
+        const QJsonObject deleted = doc.object();
+        for (const auto& key : deleted["collections"].toArray()) {
+            m_deletedCollections.append(key.toString());
+        }
+        for (const auto& key : deleted["items"].toArray()) {
+            m_deletedItems.append(key.toString());
+        }
+        finishRequest();
+        return;
+    }
+
+    if (!doc.isArray()) {
+        failSync("Invalid response format from Zotero API");
+        return;
+    }
+
+    QVector<QJsonObject>& objects = (resource == Collections) ? m_collectionObjects : m_itemObjects;
+    for (const auto& value : doc.array()) {
+        objects.append(value.toObject());
+    }
+
+    // The first page says how many there are; fetch the rest side by side
+    if (start == 0) {
+        const int total = reply->rawHeader("Total-Results").toInt();
+        for (int next = PageSize; next < total; next += PageSize) {
+            requestPage(resource, next);
+        }
+        if (total > PageSize) {
+            emit syncProgress(QString("Downloading %1 Zotero %2...")
+                              .arg(total).arg(resource == Collections ? "collections" : "items"));
+        }
+    }
+
+    finishRequest();
+}
+
+void ZoteroCache::finishRequest() {
+    if (--m_outstanding > 0) {
+        return;
+    }
+
+    m_syncing = false;
+    m_replies.clear();
+
+    if (m_notModified) {
+        qDebug() << "ZoteroCache: library unchanged at version" << m_sinceVersion;
+        emit syncFinished(false);
+        return;
+    }
+
+    if (!commitSync()) {
+        emit syncFailed("Failed to update the local Zotero cache");
+        return;
+    }
+
+    qDebug() << "ZoteroCache: synced" << m_collectionObjects.size() << "collections and"
+             << m_itemObjects.size() << "items in" << m_pagesFetched << "pages, version"
+             << m_sinceVersion << "->" << m_newVersion;
+    m_collectionObjects.clear();
+    m_itemObjects.clear();
+    emit syncFinished(true);
+}
+
+bool ZoteroCache::commitSync() {
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction()) {
+        qDebug() << "ZoteroCache: could not start transaction:" << db.lastError().text();
+        return false;
+    }
+
+    const QString library = libraryId();
+    QSqlQuery query(db);
+    bool ok = true;
+    auto exec = [&query, &ok]() {
+        if (ok && !query.exec()) {
+            qDebug() << "ZoteroCache: query failed:" << query.lastError().text();
+            ok = false;
+        }
+    };
+
+    auto deleteCollection = [&](const QString& key) {
+        query.prepare("DELETE FROM zotero_collections WHERE library = :library AND key = :key");
+        query.bindValue(":library", library);
+        query.bindValue(":key", key);
+        exec();
+        query.prepare("DELETE FROM zotero_item_collections WHERE library = :library AND collection_key = :key");
+        query.bindValue(":library", library);
+        query.bindValue(":key", key);
+        exec();
+    };
+
+    // Items and attachments share one key space, so a deleted key is removed from both
+    auto deleteItem = [&](const QString& key) {
+        for (const char* sql : {"DELETE FROM zotero_items WHERE library = :library AND key = :key",
+                                "DELETE FROM zotero_item_collections WHERE library = :library AND item_key = :key",
+                                "DELETE FROM zotero_attachments WHERE library = :library AND key = :key"}) {
+            query.prepare(sql);
+            query.bindValue(":library", library);
+            query.bindValue(":key", key);
+            exec();
+        }
+    };
+
+    for (const QString& key : m_deletedCollections) {
+        deleteCollection(key);
+    }
+    for (const QString& key : m_deletedItems) {
+        deleteItem(key);
+    }
+
+    for (const QJsonObject& obj : m_collectionObjects) {
+        const QString key = obj["key"].toString();
+        const QJsonObject data = obj["data"].toObject();
+        if (key.isEmpty()) {
+            continue;
+        }
+        if (data["deleted"].toVariant().toBool()) {
+            deleteCollection(key);
+            continue;
+        }
+
+        query.prepare("INSERT OR REPLACE INTO zotero_collections (library, key, name, parent_key, version) "
+                      "VALUES (:library, :key, :name, :parent_key, :version)");
+        query.bindValue(":library", library);
+        query.bindValue(":key", key);
+        query.bindValue(":name", data["name"].toString());
+        // parentCollection is false (not a string) for top-level collections
+        query.bindValue(":parent_key", data["parentCollection"].toString());
+        query.bindValue(":version", obj["version"].toVariant().toLongLong());
+        exec();
+    }
+
+    for (const QJsonObject& obj : m_itemObjects) {
+        const QString key = obj["key"].toString();
+        const QJsonObject data = obj["data"].toObject();
+        const QString itemType = data["itemType"].toString();
+        if (key.isEmpty()) {
+            continue;
+        }
+
+        // Replace whatever was stored under this key
+        deleteItem(key);
+        if (data["deleted"].toVariant().toBool() || itemType == "note" || itemType == "annotation") {
+            continue;
+        }
+
+        if (itemType == "attachment") {
+            query.prepare("INSERT INTO zotero_attachments (library, key, parent_key, content_type, link_mode, version) "
+                          "VALUES (:library, :key, :parent_key, :content_type, :link_mode, :version)");
+            query.bindValue(":library", library);
+            query.bindValue(":key", key);
+            query.bindValue(":parent_key", data["parentItem"].toString());
+            query.bindValue(":content_type", data["contentType"].toString());
+            query.bindValue(":link_mode", data["linkMode"].toString());
+            query.bindValue(":version", obj["version"].toVariant().toLongLong());
+            exec();
+            continue;
+        }
+
+        QStringList authorsList;
+        for (const auto& creator : data["creators"].toArray()) {
+            const QString lastName = creator.toObject()["lastName"].toString();
+            if (!lastName.isEmpty()) {
+                authorsList.append(lastName);
+            }
+        }
+
+        query.prepare("INSERT INTO zotero_items (library, key, title, authors, year, item_type, version) "
+                      "VALUES (:library, :key, :title, :authors, :year, :item_type, :version)");
+        query.bindValue(":library", library);
+        query.bindValue(":key", key);
+        query.bindValue(":title", data["title"].toString());
+        query.bindValue(":authors", authorsList.join(", "));
+        query.bindValue(":year", data["date"].toString().left(4));
+        query.bindValue(":item_type", itemType);
+        query.bindValue(":version", obj["version"].toVariant().toLongLong());
+        exec();
+
+        for (const auto& collectionKey : data["collections"].toArray()) {
+            query.prepare("INSERT OR IGNORE INTO zotero_item_collections (library, item_key, collection_key) "
+                          "VALUES (:library, :item_key, :collection_key)");
+            query.bindValue(":library", library);
+            query.bindValue(":item_key", key);
+            query.bindValue(":collection_key", collectionKey.toString());
+            exec();
+        }
+    }
+
+    if (m_newVersion > 0) {
+        query.prepare("INSERT OR REPLACE INTO zotero_sync (library, version, synced_at) "
+                      "VALUES (:library, :version, :synced_at)");
+        query.bindValue(":library", library);
+        query.bindValue(":version", m_newVersion);
+        query.bindValue(":synced_at", QDateTime::currentSecsSinceEpoch());
+        exec();
+    }
+
+    if (!ok || !db.commit()) {
+        qDebug() << "ZoteroCache: rolling back sync:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+void ZoteroCache::failSync(const QString& error) {
+    qDebug() << "ZoteroCache:" << error;
+    cancelSync();
+    m_collectionObjects.clear();
+    m_itemObjects.clear();
+    emit syncFailed(error);
+}
+
+bool ZoteroCache::ensureTables() const {
+    if (m_tablesReady) {
+        return true;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    const char* const statements[] = {
+        "CREATE TABLE IF NOT EXISTS zotero_sync ("
+        "library TEXT PRIMARY KEY, version INTEGER, synced_at INTEGER)",
+        "CREATE TABLE IF NOT EXISTS zotero_collections ("
+        "library TEXT, key TEXT, name TEXT, parent_key TEXT, version INTEGER, "
+        "PRIMARY KEY (library, key))",
+        "CREATE TABLE IF NOT EXISTS zotero_items ("
+        "library TEXT, key TEXT, title TEXT, authors TEXT, year TEXT, item_type TEXT, version INTEGER, "
+        "PRIMARY KEY (library, key))",
+        "CREATE TABLE IF NOT EXISTS zotero_item_collections ("
+        "library TEXT, item_key TEXT, collection_key TEXT, "
+        "PRIMARY KEY (library, collection_key, item_key))",
+        "CREATE TABLE IF NOT EXISTS zotero_attachments ("
+        "library TEXT, key TEXT, parent_key TEXT, content_type TEXT, link_mode TEXT, version INTEGER, "
+        "PRIMARY KEY (library, key))",
+        "CREATE INDEX IF NOT EXISTS zotero_item_collections_item ON zotero_item_collections (library, item_key)",
+        "CREATE INDEX IF NOT EXISTS zotero_attachments_parent ON zotero_attachments (library, parent_key)",
+    };
+    for (const char* sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "ZoteroCache: could not create tables:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    m_tablesReady = true;
+    return true;
+}
@@ -0,0 +1,112 @@
+#ifndef ZOTEROCACHE_H
+#define ZOTEROCACHE_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QNetworkReply;
+
+// Represents a Zotero collection
+struct ZoteroCollection {
+    QString key;
+    QString name;
+    QString parentKey;
+    int level = 0;  // For indentation in display
+};
+
+// Represents a Zotero item (paper)
+struct ZoteroItem {
+    QString key;
+    QString title;
+    QString authors;
+    QString year;
+    bool hasPdf = false;
+    QString pdfAttachmentKey;
+    qint64 pdfAttachmentVersion = 0;  // Bumped by Zotero whenever the file changes
+};
+
+// Local mirror of a Zotero library's collections, items and PDF attachment keys,
+// stored in zotero_* tables of the settings database (like ResponseCache). Reads
+// are plain SQLite queries, so the combo boxes fill instantly; sync() brings the
+// mirror up to date in the background.
+//
+// Sync is incremental: every object carries a library version, and the mirror
+// remembers the version it last synced to. sync() asks for collections and items
+// modified since then (?since=V with If-Modified-Since-Version, so an unchanged
+// library costs three 304s) plus /deleted for removals. Results are paged with
+// start/limit; once the first page reports Total-Results the remaining pages
+// are requested in parallel. Nothing is written until every page has arrived,
+// and then everything goes in one transaction, so a failed sync leaves the
+// previous mirror intact.
+//
+// Main thread only - requests go through HttpClientPool and the default
+// database connection.
+class ZoteroCache : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ZoteroCache(QObject *parent = nullptr);
+    ~ZoteroCache();
+
+    // Switch library. Cancels a sync in progress for the previous one.
+    void setLibrary(const QString& userId, const QString& apiKey);
+
+    // Served from the mirror; empty until the first sync has completed
+    bool hasData() const;
+    QList<ZoteroCollection> collections() const;
+    QList<ZoteroItem> itemsInCollection(const QString& collectionKey) const;
+    qint64 libraryVersion() const;
+
+    void sync();
+    void cancelSync();
+    bool isSyncing() const { return m_syncing; }
+
+    // Drop everything mirrored for the current library (next sync is a full one)
+    void clear();
+
+    static constexpr int PageSize = 100;  // Zotero API maximum
+
+signals:
+    void syncProgress(const QString& message);
+    // changed is false when the library was already up to date
+    void syncFinished(bool changed);
+    void syncFailed(const QString& error);
+
+private:
+    enum Resource { Collections, Items, Deleted };
+
+    void requestPage(Resource resource, int start);
+    void handlePage(QNetworkReply* reply, Resource resource, int start, int generation);
+    void finishRequest();
+    bool commitSync();
+    void failSync(const QString& error);
+
+    bool ensureTables() const;
+    QString libraryId() const { return "users/" + m_userId; }
+
+    QString m_userId;
+    QString m_apiKey;
+
+    // In-flight sync state
+    bool m_syncing;
+    int m_generation;          // Bumped on cancel so stale replies are ignored
+    int m_outstanding;
+    qint64 m_sinceVersion;
+    qint64 m_newVersion;
+    bool m_notModified;
+    int m_pagesFetched;
+    QVector<QJsonObject> m_collectionObjects;
+    QVector<QJsonObject> m_itemObjects;
+    QStringList m_deletedCollections;
+    QStringList m_deletedItems;
+    QList<QPointer<QNetworkReply>> m_replies;
+
+    mutable bool m_tablesReady;
+};
+
+#endif // ZOTEROCACHE_H
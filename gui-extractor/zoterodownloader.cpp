@@ -0,0 +1,251 @@
+#include "zoterodownloader.h"
+#include "httpclientpool.h"
+#include <QDebug>
+#include <QFileDevice>
+#include <QRegularExpression>
+#include <QTimer>
+
+ZoteroDownloader::ZoteroDownloader(QObject *parent)
+    : QObject(parent)
+    , m_file(nullptr)
+    , m_hash(QCryptographicHash::Sha256)
+    , m_written(0)
+    , m_total(-1)
+    , m_rangeStart(0)
+    , m_redirects(0)
+    , m_resumeAttempts(0)
+    , m_bodyChecked(false)
+    , m_bodyAccepted(false)
+    , m_running(false)
+{
+}
+
+ZoteroDownloader::~ZoteroDownloader() {
+    abort();
+}
+
+void ZoteroDownloader::start(const QNetworkRequest& request, QFileDevice* file) {
+    abort();
+
+    m_file = file;
+    m_request = request;
+    m_request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+    m_request.setTransferTimeout(StallTimeoutMs);
+    m_redirects = 0;
+    m_resumeAttempts = 0;
+    m_total = -1;
+    m_running = true;
+
+    restartFile();
+    sendRequest();
+}
+
+void ZoteroDownloader::abort() {
+    m_running = false;
+    if (m_reply) {
+        QNetworkReply* reply = m_reply;
+        m_reply = nullptr;
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void ZoteroDownloader::sendRequest() {
+    QNetworkRequest request = m_request;
+    m_rangeStart = m_written;
+    if (m_rangeStart > 0) {
+        request.setRawHeader("Range", QString("bytes=%1-").arg(m_rangeStart).toLatin1());
+    }
+
+    m_bodyChecked = false;
+    m_bodyAccepted = false;
+    m_reply = HttpClientPool::instance()->get(request);
+    connect(m_reply, &QNetworkReply::readyRead, this, &ZoteroDownloader::handleReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &ZoteroDownloader::handleFinished);
+}
+
+bool ZoteroDownloader::acceptBody(QNetworkReply* reply) {
+    if (m_bodyChecked) {
+        return m_bodyAccepted;
+    }
+    m_bodyChecked = true;
+
+    // Redirect and error bodies are not part of the file
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError || statusCode < 200 || statusCode >= 300) {
+        return false;
+    }
+
+    if (statusCode == 206) {
+        // Content-Range: bytes <first>-<last>/<total or *>
+        static const QRegularExpression contentRange(QStringLiteral("^bytes\\s+(\\d+)-\\d+/(\\d+|\\*)$"));
+        const QRegularExpressionMatch match = contentRange.match(QString::fromLatin1(reply->rawHeader("Content-Range")).trimmed());
+        if (!match.hasMatch() || match.captured(1).toLongLong() != m_written) {
+            // Not the bytes we asked for - throw away what we have rather than splice the wrong data
+            qDebug() << "ZoteroDownloader: unexpected Content-Range" << reply->rawHeader("Content-Range");
+            restartFile();
+            return false;
+        }
+        if (match.captured(2) != "*") {
+            m_total = match.captured(2).toLongLong();
+        }
+    } else {
+        if (m_rangeStart > 0) {
+            // Server ignored the Range header and is sending the whole file again
+            qDebug() << "ZoteroDownloader: range not honoured, restarting from byte 0";
+            restartFile();
+        }
+        const QVariant length = reply->header(QNetworkRequest::ContentLengthHeader);
+        if (length.isValid()) {
+            m_total = length.toLongLong();
+        }
+    }
+
+    m_bodyAccepted = true;
+    return true;
+}
+
+void ZoteroDownloader::handleReadyRead() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || reply != m_reply || !acceptBody(reply)) {
+        return;
+    }
+
+    if (!writeChunk(reply->readAll())) {
+        fail(QString("Failed to write PDF: %1").arg(m_file->errorString()));
+        return;
+    }
+    emit progress(m_written, m_total);
+}
+
+void ZoteroDownloader::handleFinished() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || reply != m_reply) {
+        return;
+    }
+    m_reply = nullptr;
+    reply->disconnect(this);
+    reply->deleteLater();
+
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const QNetworkReply::NetworkError error = reply->error();
+
+    // Whatever arrived before a drop is still good data; keep it so the resume starts after it
+    if (acceptBody(reply)) {
+        if (!writeChunk(reply->readAll())) {
+            fail(QString("Failed to write PDF: %1").arg(m_file->errorString()));
+            return;
+        }
+    }
+
+    if (statusCode >= 300 && statusCode < 400) {
+        const QUrl target = m_request.url().resolved(reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl());
+        if (!target.isValid() || ++m_redirects > MaxRedirects) {
+            fail(QString("Failed to download PDF: too many or invalid redirects (HTTP %1)").arg(statusCode));
+            return;
+        }
+        qDebug() << "ZoteroDownloader: following redirect to" << target.host();
+
+        // The storage backend gets a plain request - Zotero credentials stay with Zotero
+        QNetworkRequest redirectRequest{target};
+        redirectRequest.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+        redirectRequest.setTransferTimeout(StallTimeoutMs);
+        m_request = redirectRequest;
+        sendRequest();
+        return;
+    }
+
+    if (error == QNetworkReply::NoError && m_bodyAccepted) {
+        if (m_total >= 0 && m_written != m_total) {
+            scheduleResume(QString("short read (%1 of %2 bytes)").arg(m_written).arg(m_total));
+            return;
+        }
+        m_file->flush();
+        m_running = false;
+        emit progress(m_written, m_written);
+        emit finished(m_written, m_hash.result());
+        return;
+    }
+
+    if (error == QNetworkReply::NoError && statusCode >= 200 && statusCode < 300) {
+        // Body was rejected for answering a different range than requested
+        scheduleResume("unexpected Content-Range");
+        return;
+    }
+
+    if (statusCode == 416 && m_rangeStart > 0) {
+        // Our offset is past what the server has; start over
+        restartFile();
+        scheduleResume("range not satisfiable");
+        return;
+    }
+
+    if (isResumable(error)) {
+        scheduleResume(reply->errorString());
+        return;
+    }
+
+    fail(QString("Failed to download PDF: %1 (HTTP %2)").arg(reply->errorString()).arg(statusCode));
+}
+
+bool ZoteroDownloader::writeChunk(const QByteArray& chunk) {
+    if (chunk.isEmpty()) {
+        return true;
+    }
+    if (!m_file || m_file->write(chunk) != chunk.size()) {
+        return false;
+    }
+    m_hash.addData(chunk);
+    m_written += chunk.size();
+    return true;
+}
+
+void ZoteroDownloader::restartFile() {
+    m_hash.reset();
+    m_written = 0;
+    if (m_file) {
+        m_file->seek(0);
+        m_file->resize(0);
+    }
+}
+
+void ZoteroDownloader::scheduleResume(const QString& reason) {
+    if (++m_resumeAttempts > MaxResumeAttempts) {
+        fail(QString("Failed to download PDF: %1 (gave up after %2 attempts)").arg(reason).arg(MaxResumeAttempts));
+        return;
+    }
+
+    qDebug() << "ZoteroDownloader:" << reason << "- resuming at byte" << m_written
+             << "attempt" << m_resumeAttempts;
+    emit resumed(m_written, m_resumeAttempts);
+
+    // Back off a little; a dropped connection is often a brief network blip
+    QTimer::singleShot(1000 * m_resumeAttempts, this, [this]() {
+        if (m_running && !m_reply) {
+            sendRequest();
+        }
+    });
+}
+
+void ZoteroDownloader::fail(const QString& error) {
+    abort();
+    emit failed(error);
+}
+
+bool ZoteroDownloader::isResumable(QNetworkReply::NetworkError error) {
+    switch (error) {
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::OperationCanceledError:  // Transfer timeout; our own abort() disconnects first
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::ProxyConnectionClosedError:
+        case QNetworkReply::UnknownNetworkError:
+        case QNetworkReply::InternalServerError:
+        case QNetworkReply::ServiceUnavailableError:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef ZOTERODOWNLOADER_H
+#define ZOTERODOWNLOADER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+
+class QFileDevice;
+
+// Downloads a Zotero attachment straight into a file. Each readyRead chunk is
+// written to disk and folded into a SHA-256 as it arrives, so memory use is
+// bounded by the network buffer and the content hash is ready the moment the
+// transfer ends (see ExtractionCache::makeKeyForHash). Redirects (Zotero hands
+// file downloads off to S3) are followed without the Zotero headers. A transfer
+// that drops or stalls part way is resumed with a Range request from the last
+// byte written; if the server ignores the range the file is restarted.
+//
+// Main thread only - requests go through HttpClientPool.
+class ZoteroDownloader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ZoteroDownloader(QObject *parent = nullptr);
+    ~ZoteroDownloader();
+
+    // Download request into file, which must be open for writing. The file is
+    // not owned and must outlive the download.
+    void start(const QNetworkRequest& request, QFileDevice* file);
+
+    // Stop without emitting finished() or failed()
+    void abort();
+
+    bool isRunning() const { return m_running; }
+    qint64 bytesWritten() const { return m_written; }
+
+    static constexpr int MaxResumeAttempts = 3;
+    static constexpr int MaxRedirects = 5;
+    static constexpr int StallTimeoutMs = 30000;  // No bytes for this long counts as a dropped transfer
+
+signals:
+    // total is -1 until the server has said how large the file is
+    void progress(qint64 bytesReceived, qint64 bytesTotal);
+    void resumed(qint64 offset, int attempt);
+    void finished(qint64 bytes, const QByteArray& sha256);
+    void failed(const QString& error);
+
+private slots:
+    void handleReadyRead();
+    void handleFinished();
+
+private:
+    void sendRequest();
+    bool acceptBody(QNetworkReply* reply);
+    bool writeChunk(const QByteArray& chunk);
+    void restartFile();
+    void scheduleResume(const QString& reason);
+    void fail(const QString& error);
+    static bool isResumable(QNetworkReply::NetworkError error);
+
+    QPointer<QNetworkReply> m_reply;
+    QFileDevice* m_file;
+    QNetworkRequest m_request;   // Current target (after redirects)
+    QCryptographicHash m_hash;
+    qint64 m_written;
+    qint64 m_total;
+    qint64 m_rangeStart;         // Offset requested for the current reply, 0 = whole file
+    int m_redirects;
+    int m_resumeAttempts;
+    bool m_bodyChecked;          // Status/range of the current reply have been validated
+    bool m_bodyAccepted;         // Current reply's body is file data
+    bool m_running;
+};
+
+#endif // ZOTERODOWNLOADER_H
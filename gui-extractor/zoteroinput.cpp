@@ -1,11 +1,16 @@
 #include "zoteroinput.h"
+#include "asynclogger.h"
+#include "bulkanalysisqueue.h"
 #include "safepdfloader.h"
+#include "mappedpdffile.h"
+#include "httpclientpool.h"
+#include "zoterodownloader.h"
+#include "zoteroprefetcher.h"
 #include <QComboBox>
 #include <QPushButton>
 #include <QLabel>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QJsonDocument>
@@ -14,6 +19,7 @@
 #include <QJsonParseError>
 #include <QMessageBox>
 #include <QTemporaryFile>
+#include <QBuffer>
 #include <QFile>
 #include <QDir>
 #include <QPdfDocument>
@@ -28,29 +34,94 @@
 #include <QCoreApplication>
 #include <QStorageInfo>
 #include <QScopeGuard>
+#include <QSignalBlocker>
 #include <exception>
 #include <memory>
 
 ZoteroInputWidget::ZoteroInputWidget(QWidget *parent)
     : QWidget(parent)
-    , m_networkManager(new QNetworkAccessManager(this))
     , m_currentReply(nullptr)
+    , m_zoteroCache(new ZoteroCache(this))
+    , m_prefetcher(new ZoteroPrefetcher(this))
+    , m_downloader(new ZoteroDownloader(this))
+    , m_bulkQueue(new BulkAnalysisQueue(this))
     , m_isLoading(false)
-    , m_logFile(nullptr)
     , m_currentState(NoCredentials) {
 
     setupUI();
 
-    // Initialize log file
-    QString logPath = QCoreApplication::applicationDirPath() + "/zotero.log";
-    m_logFile = new QFile(logPath);
+    connect(m_zoteroCache, &ZoteroCache::syncProgress, this, [this](const QString& message) {
+        logToFile(message);
+        m_statusLabel->setText(message);
+    });
+    connect(m_zoteroCache, &ZoteroCache::syncFinished, this, &ZoteroInputWidget::handleSyncFinished);
+    connect(m_zoteroCache, &ZoteroCache::syncFailed, this, &ZoteroInputWidget::handleSyncFailed);
+    connect(m_prefetcher, &ZoteroPrefetcher::progress, this, [this](int done, int total) {
+        if (!m_isLoading && m_awaitingPrefetchKey.isEmpty() && total > 0) {
+            m_statusLabel->setText(QString("Loaded %1 papers (%2 of %3 PDFs ready)").arg(m_items.size()).arg(done).arg(total));
+        }
+    });
+    connect(m_prefetcher, &ZoteroPrefetcher::prefetched, this, [this](const QString& attachmentKey) {
+        if (attachmentKey == m_awaitingPrefetchKey) {
+            m_awaitingPrefetchKey.clear();
+            usePrefetchedPdf();
+        }
+    });
+    connect(m_prefetcher, &ZoteroPrefetcher::prefetchFailed, this, [this](const QString& attachmentKey) {
+        if (attachmentKey == m_awaitingPrefetchKey) {
+            // Fall back to a foreground download, which reports its own errors
+            m_awaitingPrefetchKey.clear();
+            downloadPdf(m_currentItem.key, m_currentItem.pdfAttachmentKey);
+        }
+    });
+    connect(m_downloader, &ZoteroDownloader::progress, this, &ZoteroInputWidget::handlePdfDownloadProgress);
+    connect(m_downloader, &ZoteroDownloader::resumed, this, [this](qint64 offset, int attempt) {
+        logToFile(QString("PDF download interrupted - resuming at byte %1 (attempt %2)").arg(offset).arg(attempt));
+        m_statusLabel->setText(QString("Connection dropped, resuming download (attempt %1)...").arg(attempt));
+    });
+    connect(m_downloader, &ZoteroDownloader::finished, this, &ZoteroInputWidget::handlePdfDownloadFinished);
+    connect(m_downloader, &ZoteroDownloader::failed, this, &ZoteroInputWidget::handlePdfDownloadFailed);
 
-    // Open in append mode to preserve previous logs
-    if (m_logFile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
-        logToFile("========================================");
-        logToFile(QString("Zotero Integration Started - %1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")));
-        logToFile("========================================");
-    }
+    connect(m_bulkQueue, &BulkAnalysisQueue::statusMessage, this, [this](const QString& message) {
+        logToFile(message);
+        m_statusLabel->setText(message);
+        emit statusMessage(message);
+    });
+    connect(m_bulkQueue, &BulkAnalysisQueue::itemFinished, this,
+            [this](const QString&, const QString& title, bool ok, const QString& error) {
+        const QString message = ok ? QString("Analyzed: %1").arg(title)
+                                   : QString("Failed: %1 - %2").arg(title, error);
+        logToFile(message);
+        emit statusMessage(message);
+    });
+    connect(m_bulkQueue, &BulkAnalysisQueue::progress, this, [this](int done, int failed, int total) {
+        m_statusLabel->setText(QString("%1: %2 of %3 papers analyzed%4")
+                               .arg(m_bulkQueue->collectionName()).arg(done).arg(total)
+                               .arg(failed > 0 ? QString(", %1 failed").arg(failed) : QString()));
+    });
+    connect(m_bulkQueue, &BulkAnalysisQueue::finished, this,
+            [this](int done, int failed, const QString& resultsPath) {
+        updateCollectionButton();
+        const QString message = QString("Finished %1: %2 papers analyzed, %3 failed")
+                                .arg(m_bulkQueue->collectionName()).arg(done).arg(failed);
+        logToFile(message);
+        m_statusLabel->setText(message);
+        emit statusMessage(message);
+        QMessageBox::information(this, "Collection Analysis",
+                                 QString("%1.\n\nResults were saved to:\n%2").arg(message, resultsPath));
+    });
+    connect(m_bulkQueue, &BulkAnalysisQueue::stopped, this, [this](const QString& reason) {
+        updateCollectionButton();
+        logToFile(reason);
+        m_statusLabel->setText(reason);
+        emit statusMessage(reason);
+    });
+
+    // Log file is appended to, preserving previous logs
+    m_logPath = QCoreApplication::applicationDirPath() + "/zotero.log";
+    logToFile("========================================");
+    logToFile(QString("Zotero Integration Started - %1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")));
+    logToFile("========================================");
 
     // Load credentials from database on creation
     QSqlDatabase db = QSqlDatabase::database();
@@ -76,17 +147,17 @@ ZoteroInputWidget::ZoteroInputWidget(QWidget *parent)
     } else {
         setState(NoCredentials);
     }
+
+    // Ask about collection analyses left unfinished once the window is up
+    m_bulkQueue->setLibrary(m_userId, m_apiKey);
+    QTimer::singleShot(0, this, &ZoteroInputWidget::offerToResumeCollectionAnalysis);
 }
 
 ZoteroInputWidget::~ZoteroInputWidget() {
     // Safe cleanup of network reply
     safeCleanupReply();
 
-    if (m_logFile) {
-        logToFile("Zotero Integration Shutting Down");
-        m_logFile->close();
-        delete m_logFile;
-    }
+    logToFile("Zotero Integration Shutting Down");
 }
 
 void ZoteroInputWidget::setupUI() {
@@ -132,6 +203,11 @@ void ZoteroInputWidget::setupUI() {
     auto* buttonLayout = new QHBoxLayout();
     buttonLayout->addStretch();
 
+    m_analyzeCollectionButton = new QPushButton("Analyze Collection", this);
+    m_analyzeCollectionButton->setEnabled(false);
+    m_analyzeCollectionButton->setToolTip("Analyze every paper with a PDF in this collection");
+    buttonLayout->addWidget(m_analyzeCollectionButton);
+
     m_analyzeButton = new QPushButton("Analyze", this);
     m_analyzeButton->setEnabled(false);
     // Match the style of other Analyze buttons
@@ -147,6 +223,7 @@ void ZoteroInputWidget::setupUI() {
     connect(m_papersCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &ZoteroInputWidget::onPaperChanged);
     connect(m_analyzeButton, &QPushButton::clicked, this, &ZoteroInputWidget::onAnalyzeClicked);
+    connect(m_analyzeCollectionButton, &QPushButton::clicked, this, &ZoteroInputWidget::onAnalyzeCollectionClicked);
 }
 
 void ZoteroInputWidget::setCredentials(const QString& userId, const QString& apiKey) {
@@ -155,11 +232,20 @@ void ZoteroInputWidget::setCredentials(const QString& userId, const QString& api
         apiKey.isEmpty() ? "EMPTY" : "***" + apiKey.right(4)));
     m_userId = userId;
     m_apiKey = apiKey;
+    m_zoteroCache->setLibrary(userId, apiKey);
+    m_prefetcher->setLibrary(userId, apiKey);
+    m_bulkQueue->setLibrary(userId, apiKey);
 
     // Update the status to reflect credentials are loaded
     if (!userId.isEmpty() && !apiKey.isEmpty()) {
-        m_statusLabel->setText("Credentials loaded. Click refresh to load your Zotero collections");
-        setState(ReadyToFetch);
+        // A previously synced library is usable straight away; refresh brings it up to date
+        if (showCollectionsFromCache()) {
+            m_statusLabel->setText(QString("Loaded %1 collections from cache. Click refresh to sync with Zotero")
+                                   .arg(m_collections.size()));
+        } else {
+            m_statusLabel->setText("Credentials loaded. Click refresh to load your Zotero collections");
+            setState(ReadyToFetch);
+        }
     } else {
         setState(NoCredentials);
     }
@@ -185,6 +271,9 @@ void ZoteroInputWidget::reset() {
     clearCollections();
     clearPapers();
     m_downloadedPdfPath.clear();
+    m_downloadedPdfHash.clear();
+    m_awaitingPrefetchKey.clear();
+    m_prefetcher->cancel();
 
     // Safe cleanup of temp file
     try {
@@ -263,63 +352,210 @@ void ZoteroInputWidget::onAnalyzeClicked() {
         return;
     }
 
+    // Prefetched in the background - go straight to analysis
+    if (usePrefetchedPdf()) {
+        return;
+    }
+
+    if (m_prefetcher->isDownloading(m_currentItem)) {
+        // Already on its way; a second download would only compete with it
+        m_awaitingPrefetchKey = m_currentItem.pdfAttachmentKey;
+        setUIEnabled(false);
+        m_isLoading = true;
+        setState(Analyzing);
+        m_statusLabel->setText("Finishing background download...");
+        return;
+    }
+
     // Download the PDF
     downloadPdf(m_currentItem.key, m_currentItem.pdfAttachmentKey);
 }
 
-void ZoteroInputWidget::fetchCollections() {
-    // Safe cleanup of any existing reply
-    safeCleanupReply();
+bool ZoteroInputWidget::usePrefetchedPdf() {
+    const QString path = m_prefetcher->cachedPath(m_currentItem);
+    if (path.isEmpty()) {
+        return false;
+    }
 
-    setUIEnabled(false);
-    m_isLoading = true;
-    m_statusLabel->setText("Loading collections...");
-    emit statusMessage("Fetching Zotero collections...");
+    logToFile(QString("Using prefetched PDF: %1").arg(path));
+    m_downloadedPdfPath = path;
+    m_downloadedPdfHash = m_prefetcher->cachedHash(m_currentItem);
 
-    // Clear existing data
-    clearCollections();
-    clearPapers();
+    m_statusLabel->setText("PDF ready (prefetched)");
+    emit statusMessage("PDF ready for analysis");
+    emit pdfReady(m_downloadedPdfPath);
+    emit analyzeRequested();
 
-    // API endpoint for user's collections
-    QString url = QString("https://api.zotero.org/users/%1/collections").arg(m_userId);
-    logToFile(QString("==== Fetching Collections - User ID: %1 ====").arg(m_userId));
+    setUIEnabled(true);
+    m_isLoading = false;
+    setState(ReadyToFetch);  // Same end state as a foreground download
+    return true;
+}
 
-    QNetworkRequest request{QUrl(url)};
-    request.setRawHeader("Zotero-API-Version", "3");
-    request.setRawHeader("Authorization", QString("Bearer %1").arg(m_apiKey).toUtf8());
+void ZoteroInputWidget::onAnalyzeCollectionClicked() {
+    if (m_bulkQueue->isRunning()) {
+        m_bulkQueue->stop();
+        return;
+    }
 
-    // Log request details
-    QString headers = QString("Zotero-API-Version: 3\nAuthorization: Bearer ***%1").arg(
-        m_apiKey.isEmpty() ? "EMPTY" : m_apiKey.right(4));
-    logRequest("GET", url, headers.toUtf8());
+    int pdfCount = 0;
+    for (const ZoteroItem& item : m_items) {
+        if (item.hasPdf && !item.pdfAttachmentKey.isEmpty()) {
+            pdfCount++;
+        }
+    }
 
-    m_currentReply = m_networkManager->get(request);
-    connect(m_currentReply, &QNetworkReply::finished, this, &ZoteroInputWidget::handleCollectionsReply);
+    QString collectionName;
+    for (const ZoteroCollection& collection : m_collections) {
+        if (collection.key == m_currentCollectionKey) {
+            collectionName = collection.name;
+            break;
+        }
+    }
+
+    if (QMessageBox::question(this, "Analyze Collection",
+            QString("Analyze all %1 papers with PDFs in \"%2\"?\n\n"
+                    "Papers already analyzed in an earlier run are skipped. "
+                    "Progress is saved, so the analysis can be resumed if it is interrupted.")
+            .arg(pdfCount).arg(collectionName)) != QMessageBox::Yes) {
+        return;
+    }
+
+    logToFile(QString("==== Analyzing collection %1 (%2 PDFs) ====").arg(collectionName).arg(pdfCount));
+    m_bulkQueue->start(m_currentCollectionKey, collectionName, m_items);
+    updateCollectionButton();
 }
 
-void ZoteroInputWidget::fetchItemsForCollection(const QString& collectionKey) {
+void ZoteroInputWidget::offerToResumeCollectionAnalysis() {
+    const QList<BulkAnalysisQueue::JobSummary> jobs = m_bulkQueue->unfinishedJobs();
+    if (jobs.isEmpty() || m_bulkQueue->isRunning()) {
+        return;
+    }
+
+    // One job runs at a time; offer the oldest
+    const BulkAnalysisQueue::JobSummary& job = jobs.first();
+    if (QMessageBox::question(this, "Resume Collection Analysis",
+            QString("The analysis of \"%1\" did not finish (%2 of %3 papers left).\n\nResume it now?")
+            .arg(job.collectionName).arg(job.remaining).arg(job.total)) == QMessageBox::Yes) {
+        logToFile(QString("==== Resuming analysis of collection %1 ====").arg(job.collectionName));
+        m_bulkQueue->resume(job.collectionKey);
+        updateCollectionButton();
+    }
+}
+
+void ZoteroInputWidget::updateCollectionButton() {
+    if (m_bulkQueue->isRunning()) {
+        m_analyzeCollectionButton->setText("Stop Collection Analysis");
+        m_analyzeCollectionButton->setEnabled(true);
+        return;
+    }
+
+    bool hasPdfs = false;
+    for (const ZoteroItem& item : m_items) {
+        if (item.hasPdf && !item.pdfAttachmentKey.isEmpty()) {
+            hasPdfs = true;
+            break;
+        }
+    }
+    m_analyzeCollectionButton->setText("Analyze Collection");
+    m_analyzeCollectionButton->setEnabled(hasPdfs && !m_isLoading
+                                          && m_currentState != FetchingData && m_currentState != Analyzing);
+}
+
+void ZoteroInputWidget::fetchCollections() {
     // Safe cleanup of any existing reply
     safeCleanupReply();
 
-    setUIEnabled(false);
-    m_isLoading = true;
-    m_statusLabel->setText("Loading papers...");
-    emit statusMessage("Fetching papers from collection...");
+    logToFile(QString("==== Syncing Zotero library - User ID: %1, cached version %2 ====")
+              .arg(m_userId).arg(m_zoteroCache->libraryVersion()));
+    m_zoteroCache->setLibrary(m_userId, m_apiKey);
+    m_prefetcher->setLibrary(m_userId, m_apiKey);
+
+    // Serve what we have immediately and sync in the background; only an empty
+    // mirror has to wait for the network
+    if (!showCollectionsFromCache()) {
+        setUIEnabled(false);
+        m_isLoading = true;
+        setState(FetchingData);
+        m_statusLabel->setText("Loading collections...");
+        clearCollections();
+        clearPapers();
+    }
+    emit statusMessage("Syncing Zotero library...");
+    m_zoteroCache->sync();
+}
 
-    clearPapers();
+void ZoteroInputWidget::fetchItemsForCollection(const QString& collectionKey) {
+    populateItems(m_zoteroCache->itemsInCollection(collectionKey));
+    m_statusLabel->setText(QString("Loaded %1 papers").arg(m_items.size()));
+    setState(CollectionsLoaded);
 
-    // API endpoint for items in a collection
-    QString url = QString("https://api.zotero.org/users/%1/collections/%2/items")
-                    .arg(m_userId)
-                    .arg(collectionKey);
+    // Start fetching the first few PDFs so Analyze doesn't have to wait for a download
+    m_prefetcher->prefetch(m_items);
+}
 
-    QNetworkRequest request{QUrl(url)};
-    request.setRawHeader("Zotero-API-Version", "3");
-    request.setRawHeader("Authorization", QString("Bearer %1").arg(m_apiKey).toUtf8());
-    request.setRawHeader("Content-Type", "application/json");
+bool ZoteroInputWidget::showCollectionsFromCache() {
+    if (!m_zoteroCache->hasData()) {
+        return false;
+    }
+
+    // Rebuild without triggering onCollectionChanged, then restore the selection
+    const QString selectedCollection = m_currentCollectionKey;
+    const QString selectedItem = m_currentItem.key;
+    {
+        QSignalBlocker blockCollections(m_collectionsCombo);
+        QSignalBlocker blockPapers(m_papersCombo);
+        populateCollections(m_zoteroCache->collections());
+        clearPapers();
+
+        for (int i = 0; i < m_collections.size(); ++i) {
+            if (m_collections[i].key == selectedCollection) {
+                m_collectionsCombo->setCurrentIndex(i + 1);
+                populateItems(m_zoteroCache->itemsInCollection(selectedCollection));
+                m_prefetcher->prefetch(m_items);
+                for (int j = 0; j < m_items.size(); ++j) {
+                    if (m_items[j].key == selectedItem) {
+                        m_papersCombo->setCurrentIndex(j + 1);
+                        m_currentItem = m_items[j];
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    setUIEnabled(true);
+    m_isLoading = false;
+    setState(m_papersCombo->currentIndex() > 0 ? PaperSelected : CollectionsLoaded);
+    return true;
+}
 
-    m_currentReply = m_networkManager->get(request);
-    connect(m_currentReply, &QNetworkReply::finished, this, &ZoteroInputWidget::handleItemsReply);
+void ZoteroInputWidget::handleSyncFinished(bool changed) {
+    logToFile(QString("Zotero sync finished - %1, library version %2")
+              .arg(changed ? "changes applied" : "no changes").arg(m_zoteroCache->libraryVersion()));
+
+    if (changed || m_isLoading) {
+        showCollectionsFromCache();
+    }
+    m_statusLabel->setText(QString("Zotero library up to date (%1 collections)").arg(m_collections.size()));
+    emit statusMessage("Zotero library synced");
+}
+
+void ZoteroInputWidget::handleSyncFailed(const QString& error) {
+    logError(error);
+
+    // With a usable mirror a failed sync is not fatal - keep working from the cache
+    if (m_zoteroCache->hasData()) {
+        showCollectionsFromCache();
+        m_statusLabel->setText(QString("Using cached library (sync failed: %1)").arg(error));
+        emit statusMessage("Zotero sync failed; using cached library");
+        return;
+    }
+
+    showError(error);
+    m_isLoading = false;
+    setUIEnabled(true);
+    setState(ReadyToFetch);
 }
 
 void ZoteroInputWidget::fetchChildrenForItem(const QString& itemKey) {
@@ -349,7 +585,7 @@ void ZoteroInputWidget::fetchChildrenForItem(const QString& itemKey) {
         m_apiKey.isEmpty() ? "EMPTY" : m_apiKey.right(4));
     logRequest("GET", url, headers.toUtf8());
 
-    m_currentReply = m_networkManager->get(request);
+    m_currentReply = HttpClientPool::instance()->get(request);
     connect(m_currentReply, &QNetworkReply::finished, this, &ZoteroInputWidget::handleChildrenReply);
 }
 
@@ -383,246 +619,57 @@ void ZoteroInputWidget::downloadPdf(const QString& itemKey, const QString& attac
     QNetworkRequest request{QUrl(url)};
     request.setRawHeader("Zotero-API-Version", "3");
     request.setRawHeader("Authorization", QString("Bearer %1").arg(m_apiKey).toUtf8());
-    // Don't follow redirects automatically - we'll handle it manually
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                        QNetworkRequest::ManualRedirectPolicy);
+    // Redirects to the storage backend are followed by ZoteroDownloader, without these headers
 
     // Log the request
     QString headers = QString("Zotero-API-Version: 3\nAuthorization: Bearer ***%1").arg(
         m_apiKey.isEmpty() ? "EMPTY" : m_apiKey.right(4));
     logRequest("GET", url, headers.toUtf8());
 
-    m_currentReply = m_networkManager->get(request);
-    connect(m_currentReply, &QNetworkReply::finished, this, &ZoteroInputWidget::handlePdfDownloadReply);
+    m_downloadedPdfHash.clear();
+    m_downloader->start(request, m_tempPdfFile.get());
 }
 
-void ZoteroInputWidget::handleCollectionsReply() {
-    logToFile("==== handleCollectionsReply() called ====");
-    if (!m_currentReply) {
-        logError("No current reply object");
-        return;
-    }
-
-    // Take ownership and clear member immediately
-    QNetworkReply* reply = m_currentReply;
-    m_currentReply = nullptr;
-
-    // Ensure cleanup on all paths
-    auto cleanup = qScopeGuard([&reply]() {
-        if (reply) {
-            reply->disconnect();
-            reply->deleteLater();
-        }
-    });
-
-    // Log response status and data
-    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    QByteArray data = reply->readAll();
-    logResponse(statusCode, data);
-
-    if (reply->error() != QNetworkReply::NoError) {
-        QString errorMsg = QString("Failed to fetch collections: %1 (HTTP %2)")
-                            .arg(reply->errorString())
-                            .arg(statusCode);
-
-        logError(errorMsg);
-
-        if (statusCode == 403) {
-            errorMsg = "Authentication failed. Please check your Zotero credentials in Settings.";
-        } else if (statusCode == 404) {
-            errorMsg = "User ID not found. Please check your Zotero User ID in Settings (should be numeric).";
-        }
-
-        showError(errorMsg);
-        m_isLoading = false;
-        setUIEnabled(true);
-        setState(ReadyToFetch);
-        return;
-    }
-
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isArray()) {
-        parseCollections(doc.array());
-        m_statusLabel->setText(QString("Loaded %1 collections").arg(m_collections.size()));
-        setState(CollectionsLoaded);
+void ZoteroInputWidget::handlePdfDownloadProgress(qint64 bytesReceived, qint64 bytesTotal) {
+    const double receivedMb = bytesReceived / (1024.0 * 1024.0);
+    if (bytesTotal > 0) {
+        m_statusLabel->setText(QString("Downloading PDF... %1 of %2 MB (%3%)")
+                               .arg(receivedMb, 0, 'f', 1)
+                               .arg(bytesTotal / (1024.0 * 1024.0), 0, 'f', 1)
+                               .arg(bytesReceived * 100 / bytesTotal));
     } else {
-        showError("Invalid response format from Zotero API");
-        setState(ReadyToFetch);
+        m_statusLabel->setText(QString("Downloading PDF... %1 MB").arg(receivedMb, 0, 'f', 1));
     }
-
-    setUIEnabled(true);
-    m_isLoading = false;
 }
 
-void ZoteroInputWidget::handleItemsReply() {
-    logToFile("==== handleItemsReply() called ====");
-    if (!m_currentReply) {
-        logError("No current reply object");
-        return;
-    }
-
-    // Take ownership and clear member immediately
-    QNetworkReply* reply = m_currentReply;
-    m_currentReply = nullptr;
-
-    // Ensure cleanup on all paths
-    auto cleanup = qScopeGuard([&reply]() {
-        if (reply) {
-            reply->disconnect();
-            reply->deleteLater();
-        }
-    });
-
-    // Log response status and data
-    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    QByteArray data = reply->readAll();
-    logResponse(statusCode, data);
-
-    if (reply->error() != QNetworkReply::NoError) {
-        QString errorMsg = QString("Failed to fetch items: %1 (HTTP %2)")
-                            .arg(reply->errorString())
-                            .arg(statusCode);
-        logError(errorMsg);
-        showError(errorMsg);
-        setState(CollectionsLoaded);  // Go back to collections loaded state
-        return;
-    }
-
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isArray()) {
-        parseItems(doc.array());
-
-        // After parsing items, check each for PDF attachments
-        for (auto& item : m_items) {
-            checkItemAttachments(item);
-        }
-
-        m_statusLabel->setText(QString("Loaded %1 papers").arg(m_items.size()));
-        m_papersCombo->setEnabled(m_items.size() > 0);
-        setState(CollectionsLoaded);
-    } else {
-        showError("Invalid response format from Zotero API");
-        setState(CollectionsLoaded);
-    }
-
+void ZoteroInputWidget::handlePdfDownloadFailed(const QString& error) {
+    logError(error);
+    showError(error);
+    m_downloadedPdfPath.clear();
     setUIEnabled(true);
     m_isLoading = false;
+    setState(PaperSelected);  // Go back to paper selected state
 }
 
-void ZoteroInputWidget::handlePdfDownloadReply() {
-    logToFile("==== handlePdfDownloadReply() called ====");
-    if (!m_currentReply) {
-        logError("No current reply object");
-        return;
-    }
-
-    // Take ownership and clear member immediately
-    QNetworkReply* reply = m_currentReply;
-    m_currentReply = nullptr;
-
-    // Ensure cleanup on all paths
-    auto cleanup = qScopeGuard([&reply]() {
-        if (reply) {
-            reply->disconnect();
-            reply->deleteLater();
-        }
-    });
-
-    // Log response status
-    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    logToFile(QString("PDF Download Response: Status Code %1").arg(statusCode));
-
-    // Check for redirect (3xx status codes)
-    if (statusCode >= 300 && statusCode < 400) {
-        QUrl redirectUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-        if (redirectUrl.isValid()) {
-            logToFile(QString("Following redirect to: %1").arg(redirectUrl.toString()));
-
-            // AGGRESSIVE CLEANUP: Ensure old reply is fully cleaned before redirect
-            // The qScopeGuard will still clean up 'reply', but we need to ensure
-            // no contamination occurs when creating the new request
-            try {
-                // Clear any network caches before redirect
-                if (m_networkManager) {
-                    m_networkManager->clearConnectionCache();
-                    m_networkManager->clearAccessCache();
-                    logToFile("Cleared network caches before redirect");
-                }
-
-                // Follow the redirect without Zotero headers
-                QNetworkRequest redirectRequest{redirectUrl};
-                // Don't add Zotero headers for S3
-                redirectRequest.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
-
-                m_currentReply = m_networkManager->get(redirectRequest);
-                if (!m_currentReply) {
-                    throw std::runtime_error("Failed to create redirect request");
-                }
-
-                connect(m_currentReply, &QNetworkReply::finished, this, &ZoteroInputWidget::handlePdfDownloadReply);
-                return;
-            } catch (const std::exception& e) {
-                logError(QString("Redirect failed: %1").arg(e.what()));
-                showError(QString("Failed to follow redirect: %1").arg(e.what()));
-                m_downloadedPdfPath.clear();
-                setUIEnabled(true);
-                m_isLoading = false;
-                setState(PaperSelected);
-                return;
-            }
-        }
-    }
-
-    if (reply->error() != QNetworkReply::NoError) {
-        QString errorMsg = QString("Failed to download PDF: %1 (HTTP %2)")
-                            .arg(reply->errorString())
-                            .arg(statusCode);
-        logError(errorMsg);
-        showError(errorMsg);
-        m_downloadedPdfPath.clear();
-        setUIEnabled(true);
-        m_isLoading = false;
-        setState(PaperSelected);  // Go back to paper selected state
-        return;
-    }
-
-    // Write PDF data to temporary file
-    QByteArray pdfData = reply->readAll();
-
-    logToFile(QString("PDF Data Size: %1 bytes").arg(pdfData.size()));
+void ZoteroInputWidget::handlePdfDownloadFinished(qint64 bytes, const QByteArray& sha256) {
+    logToFile(QString("==== PDF download finished: %1 bytes, sha256 %2 ====")
+              .arg(bytes).arg(QString::fromLatin1(sha256.toHex())));
 
-    if (pdfData.isEmpty()) {
-        logError("Downloaded PDF is empty");
-        showError("Downloaded PDF is empty");
-        m_downloadedPdfPath.clear();
-        setUIEnabled(true);
-        m_isLoading = false;
-        setState(PaperSelected);  // Go back to paper selected state
+    if (bytes == 0) {
+        handlePdfDownloadFailed("Downloaded PDF is empty");
         return;
     }
 
-    // Write to temp file with exception handling
-    try {
-        if (m_tempPdfFile && m_tempPdfFile->isOpen()) {
-            m_tempPdfFile->write(pdfData);
-            m_tempPdfFile->flush();
-            m_tempPdfFile->close();
-        } else {
-            throw std::runtime_error("Temp file not open");
-        }
-    } catch (const std::exception& e) {
-        showError(QString("Failed to write PDF: %1").arg(e.what()));
-        m_downloadedPdfPath.clear();
-        setUIEnabled(true);
-        m_isLoading = false;
-        setState(PaperSelected);  // Go back to paper selected state
-        return;
+    if (m_tempPdfFile && m_tempPdfFile->isOpen()) {
+        m_tempPdfFile->close();
     }
+    m_downloadedPdfHash = sha256;
 
     // Verify the PDF is valid using safe loader
     if (!validateDownloadedPdf()) {
         // Error already shown by validateDownloadedPdf
         m_downloadedPdfPath.clear();
+        m_downloadedPdfHash.clear();
         setUIEnabled(true);
         m_isLoading = false;
         setState(PaperSelected);  // Go back to paper selected state
@@ -639,6 +686,7 @@ void ZoteroInputWidget::handlePdfDownloadReply() {
     setState(ReadyToFetch);  // Reset to initial state after analysis starts
 }
 
+
 void ZoteroInputWidget::handleChildrenReply() {
     logToFile("==== handleChildrenReply() called ====");
     if (!m_currentReply) {
@@ -708,26 +756,12 @@ void ZoteroInputWidget::handleChildrenReply() {
     m_isLoading = false;
 }
 
-void ZoteroInputWidget::checkItemAttachments(const ZoteroItem& item) {
-    // Note: A more complete implementation would fetch children via API
-    // For now, we'll need to fetch children when the user selects an item
-    // This is called after parsing items but doesn't have attachment info yet
-}
-
-void ZoteroInputWidget::parseCollections(const QJsonArray& data) {
+void ZoteroInputWidget::populateCollections(const QList<ZoteroCollection>& collections) {
     m_collections.clear();
     m_collectionsCombo->clear();
     m_collectionsCombo->addItem("Select a collection...");
 
-    for (const auto& value : data) {
-        QJsonObject obj = value.toObject();
-        QJsonObject dataObj = obj["data"].toObject();
-
-        ZoteroCollection collection;
-        collection.key = obj["key"].toString();
-        collection.name = dataObj["name"].toString();
-        collection.parentKey = dataObj["parentCollection"].toString();
-
+    for (const auto& collection : collections) {
         if (!collection.key.isEmpty() && !collection.name.isEmpty()) {
             m_collections.append(collection);
         }
@@ -745,46 +779,12 @@ void ZoteroInputWidget::parseCollections(const QJsonArray& data) {
     }
 }
 
-void ZoteroInputWidget::parseItems(const QJsonArray& data) {
+void ZoteroInputWidget::populateItems(const QList<ZoteroItem>& items) {
     m_items.clear();
     m_papersCombo->clear();
     m_papersCombo->addItem("Select a paper...");
 
-    for (const auto& value : data) {
-        QJsonObject obj = value.toObject();
-        QJsonObject dataObj = obj["data"].toObject();
-
-        // Skip non-document items
-        QString itemType = dataObj["itemType"].toString();
-        if (itemType == "attachment" || itemType == "note") {
-            continue;
-        }
-
-        ZoteroItem item;
-        item.key = obj["key"].toString();
-        item.title = dataObj["title"].toString();
-        item.year = dataObj["date"].toString().left(4); // Extract year
-
-        // Build authors string
-        QJsonArray creators = dataObj["creators"].toArray();
-        QStringList authorsList;
-        for (const auto& creator : creators) {
-            QJsonObject creatorObj = creator.toObject();
-            QString lastName = creatorObj["lastName"].toString();
-            if (!lastName.isEmpty()) {
-                authorsList.append(lastName);
-            }
-        }
-        item.authors = authorsList.join(", ");
-
-        // Check for PDF attachments (simplified - would need children API call)
-        QJsonObject meta = obj["meta"].toObject();
-        int numChildren = meta["numChildren"].toInt();
-        item.hasPdf = (numChildren > 0); // Assume at least one child might be PDF
-
-        // Leave pdfAttachmentKey empty - we'll fetch it when needed
-        // item.pdfAttachmentKey will be populated when we fetch children
-
+    for (const auto& item : items) {
         if (!item.key.isEmpty() && !item.title.isEmpty()) {
             m_items.append(item);
         }
@@ -803,6 +803,7 @@ void ZoteroInputWidget::parseItems(const QJsonArray& data) {
     for (const auto& item : m_items) {
         m_papersCombo->addItem(formatPaperDisplay(item));
     }
+    updateCollectionButton();
 }
 
 QString ZoteroInputWidget::formatCollectionName(const ZoteroCollection& collection) const {
@@ -833,6 +834,7 @@ void ZoteroInputWidget::setUIEnabled(bool enabled) {
     m_collectionsCombo->setEnabled(enabled && m_collections.size() > 0);
     m_papersCombo->setEnabled(enabled && m_items.size() > 0);
     m_analyzeButton->setEnabled(enabled && m_papersCombo->currentIndex() > 0);
+    updateCollectionButton();
 }
 
 void ZoteroInputWidget::showError(const QString& error) {
@@ -863,6 +865,7 @@ void ZoteroInputWidget::clearPapers() {
     m_papersCombo->addItem("Select a paper...");
     m_papersCombo->setEnabled(false);
     m_analyzeButton->setEnabled(false);
+    updateCollectionButton();
 }
 
 void ZoteroInputWidget::fetchUserIdFromApiKey() {
@@ -890,7 +893,7 @@ void ZoteroInputWidget::fetchUserIdFromApiKey() {
         m_apiKey.isEmpty() ? "EMPTY" : m_apiKey.right(4));
     logRequest("GET", url, headers.toUtf8());
 
-    m_currentReply = m_networkManager->get(request);
+    m_currentReply = HttpClientPool::instance()->get(request);
     connect(m_currentReply, &QNetworkReply::finished, this, &ZoteroInputWidget::handleKeyInfoReply);
 }
 
@@ -975,14 +978,8 @@ void ZoteroInputWidget::handleKeyInfoReply() {
 
 // Logging implementation
 void ZoteroInputWidget::logToFile(const QString& message) {
-    if (!m_logFile || !m_logFile->isOpen()) {
-        return;
-    }
-
-    QTextStream stream(m_logFile);
-    stream << QDateTime::currentDateTime().toString("[hh:mm:ss.zzz] ")
-           << message << Qt::endl;
-    stream.flush();
+    // Queued; the logger thread writes it
+    AsyncLogger::instance()->line(m_logPath, message, AsyncLogger::Info, AsyncLogger::TimeStamp);
 }
 
 void ZoteroInputWidget::logRequest(const QString& method, const QString& url, const QByteArray& headers) {
@@ -1050,11 +1047,12 @@ void ZoteroInputWidget::logError(const QString& error) {
 
 // Safe cleanup methods
 void ZoteroInputWidget::safeCleanupReply() {
+    m_downloader->abort();
     if (!m_currentReply) return;
 
     try {
-        // Disconnect all signals first
-        m_currentReply->disconnect();
+        // Disconnect our slots first (HttpClientPool still needs to see the abort)
+        m_currentReply->disconnect(this);
 
         // Abort if still running
         if (m_currentReply->isRunning()) {
@@ -1113,16 +1111,20 @@ bool ZoteroInputWidget::validateDownloadedPdf() {
     try {
         QString errorMsg;
 
-        // First validate the file exists and is readable
-        if (!SafePdfLoader::validatePdfFile(m_downloadedPdfPath, errorMsg)) {
+        // Map the file once: the header/size checks and the test load below share it
+        MappedPdfFile mapped;
+        if (!mapped.open(m_downloadedPdfPath, errorMsg)) {
             logError(QString("PDF validation failed: %1").arg(errorMsg));
             showError(errorMsg);
             return false;
         }
 
         // Try to load it to ensure it's a valid PDF
+        QBuffer buffer;
+        buffer.setData(mapped.bytes());
+        buffer.open(QIODevice::ReadOnly);
         auto testDoc = std::make_unique<QPdfDocument>();
-        if (!SafePdfLoader::loadPdf(testDoc.get(), m_downloadedPdfPath, errorMsg, 10000)) { // 10 second timeout
+        if (!SafePdfLoader::loadPdf(testDoc.get(), &buffer, errorMsg, 10000)) { // 10 second timeout
             logError(QString("PDF load test failed: %1").arg(errorMsg));
             showError(QString("Downloaded file is not a valid PDF: %1").arg(errorMsg));
             return false;
@@ -1193,4 +1195,5 @@ void ZoteroInputWidget::updateUIState() {
             m_analyzeButton->setEnabled(false);
             break;
     }
+    updateCollectionButton();
 }
\ No newline at end of file
@@ -8,32 +8,17 @@
 #include <QJsonArray>
 #include <QTemporaryFile>
 #include <memory>
+#include "zoterocache.h"
 
 class QComboBox;
 class QFile;
 class QPushButton;
 class QLabel;
-class QNetworkAccessManager;
 class QNetworkReply;
 class QPdfDocument;
-
-// Represents a Zotero collection
-struct ZoteroCollection {
-    QString key;
-    QString name;
-    QString parentKey;
-    int level = 0;  // For indentation in display
-};
-
-// Represents a Zotero item (paper)
-struct ZoteroItem {
-    QString key;
-    QString title;
-    QString authors;
-    QString year;
-    bool hasPdf = false;
-    QString pdfAttachmentKey;
-};
+class BulkAnalysisQueue;
+class ZoteroDownloader;
+class ZoteroPrefetcher;
 
 // Widget for Zotero input functionality
 class ZoteroInputWidget : public QWidget {
@@ -60,6 +45,7 @@ public:
 
     // Get the downloaded PDF path
     QString getPdfPath() const { return m_downloadedPdfPath; }
+    QByteArray getPdfHash() const { return m_downloadedPdfHash; }
 
     // Reset state
     void reset();
@@ -78,11 +64,12 @@ private slots:
     void onCollectionChanged(int index);
     void onPaperChanged(int index);
     void onAnalyzeClicked();
+    void onAnalyzeCollectionClicked();
 
     // Network reply handlers
-    void handleCollectionsReply();
-    void handleItemsReply();
-    void handlePdfDownloadReply();
+    void handlePdfDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void handlePdfDownloadFinished(qint64 bytes, const QByteArray& sha256);
+    void handlePdfDownloadFailed(const QString& error);
     void handleChildrenReply();
     void handleKeyInfoReply();
 
@@ -96,19 +83,26 @@ private:
     void fetchChildrenForItem(const QString& itemKey);
     void downloadPdf(const QString& itemKey, const QString& attachmentKey);
 
+    // Library mirror
+    void handleSyncFinished(bool changed);
+    void handleSyncFailed(const QString& error);
+    bool showCollectionsFromCache();
+    bool usePrefetchedPdf();
+
+    // Collection-wide analysis
+    void offerToResumeCollectionAnalysis();
+    void updateCollectionButton();
+
     // Helper methods
     void clearCollections();
     void clearPapers();
-    void parseCollections(const QJsonArray& data);
-    void parseItems(const QJsonArray& data);
+    void populateCollections(const QList<ZoteroCollection>& collections);
+    void populateItems(const QList<ZoteroItem>& items);
     QString formatCollectionName(const ZoteroCollection& collection) const;
     QString formatPaperDisplay(const ZoteroItem& item) const;
     void setUIEnabled(bool enabled);
     void showError(const QString& error);
 
-    // Check for PDF attachments in item's children
-    void checkItemAttachments(const ZoteroItem& item);
-
     // Logging
     void logToFile(const QString& message);
     void logRequest(const QString& method, const QString& url, const QByteArray& headers = QByteArray());
@@ -125,11 +119,12 @@ private:
     QComboBox* m_papersCombo;
     QPushButton* m_refreshButton;
     QPushButton* m_analyzeButton;
+    QPushButton* m_analyzeCollectionButton;
     QLabel* m_statusLabel;
 
     // Network
-    QNetworkAccessManager* m_networkManager;
     QNetworkReply* m_currentReply;
+    ZoteroCache* m_zoteroCache;
 
     // Data
     QString m_userId;
@@ -140,6 +135,11 @@ private:
 
     // Temporary file for PDF
     std::unique_ptr<QTemporaryFile> m_tempPdfFile;
+    ZoteroPrefetcher* m_prefetcher;
+    QString m_awaitingPrefetchKey;   // Analyze clicked while this attachment was prefetching
+    ZoteroDownloader* m_downloader;  // Streams into m_tempPdfFile
+    QByteArray m_downloadedPdfHash;  // SHA-256 of m_downloadedPdfPath, computed while downloading
+    BulkAnalysisQueue* m_bulkQueue;
 
     // State
     bool m_isLoading;
@@ -151,8 +151,8 @@ private:
     void setState(State newState);
     void updateUIState();
 
-    // Logging
-    mutable QFile* m_logFile;
+    // Logging (written through AsyncLogger)
+    QString m_logPath;
 };
 
 #endif // ZOTEROINPUT_H
\ No newline at end of file
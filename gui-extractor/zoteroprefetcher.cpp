@@ -0,0 +1,274 @@
+#include "zoteroprefetcher.h"
+#include "mappedpdffile.h"
+#include "zoterodownloader.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkRequest>
+#include <QUrl>
+
+ZoteroPrefetcher::ZoteroPrefetcher(QObject *parent)
+    : QObject(parent)
+    , m_total(0)
+    , m_done(0)
+    , m_maxItems(DefaultMaxItems)
+    , m_concurrency(DefaultConcurrency)
+    , m_quotaBytes(DefaultQuotaBytes)
+{
+    m_directory = QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("zotero_prefetch");
+    QDir().mkpath(m_directory);
+
+    // Leftovers from an interrupted session
+    QDir dir(m_directory);
+    for (const QString& name : dir.entryList(QStringList() << "*.part", QDir::Files)) {
+        dir.remove(name);
+    }
+}
+
+ZoteroPrefetcher::~ZoteroPrefetcher() {
+    cancel();
+}
+
+void ZoteroPrefetcher::setLibrary(const QString& userId, const QString& apiKey) {
+    if (userId != m_userId || apiKey != m_apiKey) {
+        cancel();
+    }
+    m_userId = userId;
+    m_apiKey = apiKey;
+}
+
+void ZoteroPrefetcher::prefetch(const QList<ZoteroItem>& items) {
+    m_queue.clear();
+    m_wanted.clear();
+    m_total = 0;
+    m_done = 0;
+
+    if (m_userId.isEmpty() || m_apiKey.isEmpty() || m_maxItems == 0) {
+        cancel();
+        return;
+    }
+
+    QSet<QString> wantedKeys;
+    for (const ZoteroItem& item : items) {
+        if (m_total >= m_maxItems) {
+            break;
+        }
+        if (!item.hasPdf || item.pdfAttachmentKey.isEmpty()) {
+            continue;
+        }
+
+        m_total++;
+        wantedKeys.insert(item.pdfAttachmentKey);
+        m_wanted.insert(QFileInfo(filePath(item)).fileName());
+
+        if (QFile::exists(filePath(item))) {
+            m_done++;
+        } else if (!isDownloading(item)) {
+            m_queue.append(item);
+        }
+    }
+
+    // Drop downloads for the previous collection
+    for (int i = m_active.size() - 1; i >= 0; --i) {
+        if (!wantedKeys.contains(m_active[i].item.pdfAttachmentKey)) {
+            abortDownload(m_active[i]);
+            m_active.removeAt(i);
+        }
+    }
+
+    if (m_total > 0) {
+        qDebug() << "ZoteroPrefetcher:" << m_done << "of" << m_total << "PDFs already local,"
+                 << m_queue.size() << "queued";
+        emit progress(m_done, m_total);
+    }
+    startNext();
+}
+
+void ZoteroPrefetcher::cancel() {
+    m_queue.clear();
+    for (Download& download : m_active) {
+        abortDownload(download);
+    }
+    m_active.clear();
+}
+
+QString ZoteroPrefetcher::cachedPath(const ZoteroItem& item) {
+    if (item.pdfAttachmentKey.isEmpty()) {
+        return QString();
+    }
+
+    const QString path = filePath(item);
+    QFile file(path);
+    if (!file.exists() || !QFile::exists(hashPath(item))) {
+        return QString();
+    }
+
+    // Used files move to the back of the eviction order
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        file.close();
+    }
+    return path;
+}
+
+QByteArray ZoteroPrefetcher::cachedHash(const ZoteroItem& item) const {
+    QFile file(hashPath(item));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return QByteArray::fromHex(file.readAll().trimmed());
+}
+
+bool ZoteroPrefetcher::isDownloading(const ZoteroItem& item) const {
+    for (const Download& download : m_active) {
+        if (download.item.pdfAttachmentKey == item.pdfAttachmentKey) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ZoteroPrefetcher::startNext() {
+    while (m_active.size() < m_concurrency && !m_queue.isEmpty()) {
+        Download download;
+        download.item = m_queue.takeFirst();
+
+        // Make room before another file lands
+        enforceQuota();
+
+        download.file = new QFile(filePath(download.item) + ".part");
+        if (!download.file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qDebug() << "ZoteroPrefetcher: cannot create" << download.file->fileName();
+            delete download.file;
+            continue;
+        }
+
+        QNetworkRequest request{QUrl(QString("https://api.zotero.org/users/%1/items/%2/file")
+                                     .arg(m_userId, download.item.pdfAttachmentKey))};
+        request.setRawHeader("Zotero-API-Version", "3");
+        request.setRawHeader("Authorization", QString("Bearer %1").arg(m_apiKey).toUtf8());
+
+        const QString key = download.item.pdfAttachmentKey;
+        download.downloader = new ZoteroDownloader(this);
+        connect(download.downloader, &ZoteroDownloader::finished, this,
+                [this, key](qint64, const QByteArray& sha256) {
+            finishDownload(key, true, sha256, QString());
+        });
+        connect(download.downloader, &ZoteroDownloader::failed, this, [this, key](const QString& error) {
+            finishDownload(key, false, QByteArray(), error);
+        });
+
+        m_active.append(download);
+        download.downloader->start(request, download.file);
+    }
+}
+
+void ZoteroPrefetcher::finishDownload(const QString& attachmentKey, bool ok, const QByteArray& sha256,
+                                      const QString& error) {
+    int index = -1;
+    for (int i = 0; i < m_active.size(); ++i) {
+        if (m_active[i].item.pdfAttachmentKey == attachmentKey) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        return;
+    }
+
+    Download download = m_active.takeAt(index);
+    const QString partPath = download.file->fileName();
+    const QString finalPath = filePath(download.item);
+    download.file->close();
+    delete download.file;
+    download.downloader->deleteLater();
+
+    QString failure = error;
+    if (ok) {
+        // Cheap sanity check; a full parse happens when the paper is analyzed
+        MappedPdfFile mapped;
+        if (!mapped.open(partPath, failure)) {
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        QFile::remove(finalPath);
+        QFile hashFile(hashPath(download.item));
+        ok = QFile::rename(partPath, finalPath)
+             && hashFile.open(QIODevice::WriteOnly | QIODevice::Truncate)
+             && hashFile.write(sha256.toHex()) > 0;
+        if (!ok) {
+            failure = "Could not store prefetched PDF";
+        }
+    }
+
+    if (ok) {
+        m_done++;
+        qDebug() << "ZoteroPrefetcher: prefetched" << download.item.title.left(60)
+                 << "(" << m_done << "of" << m_total << ")";
+        emit prefetched(attachmentKey, finalPath);
+        emit progress(m_done, m_total);
+        enforceQuota();
+    } else {
+        QFile::remove(partPath);
+        QFile::remove(finalPath);
+        QFile::remove(hashPath(download.item));
+        qDebug() << "ZoteroPrefetcher: failed to prefetch" << attachmentKey << "-" << failure;
+        emit prefetchFailed(attachmentKey, failure);
+    }
+
+    startNext();
+}
+
+void ZoteroPrefetcher::abortDownload(Download& download) {
+    if (download.downloader) {
+        download.downloader->disconnect(this);
+        download.downloader->abort();
+        download.downloader->deleteLater();
+        download.downloader = nullptr;
+    }
+    if (download.file) {
+        const QString partPath = download.file->fileName();
+        download.file->close();
+        delete download.file;
+        download.file = nullptr;
+        QFile::remove(partPath);
+    }
+}
+
+void ZoteroPrefetcher::enforceQuota() {
+    if (m_quotaBytes <= 0) {
+        return;
+    }
+
+    QDir dir(m_directory);
+    QFileInfoList files = dir.entryInfoList(QStringList() << "*.pdf", QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    for (const QFileInfo& info : files) {
+        total += info.size();
+    }
+
+    // Oldest first; the current collection's files are kept even if that means going over
+    for (const QFileInfo& info : files) {
+        if (total <= m_quotaBytes) {
+            break;
+        }
+        if (m_wanted.contains(info.fileName())) {
+            continue;
+        }
+        if (QFile::remove(info.absoluteFilePath())) {
+            QFile::remove(info.absoluteFilePath() + ".sha256");
+            total -= info.size();
+            qDebug() << "ZoteroPrefetcher: evicted" << info.fileName();
+        }
+    }
+}
+
+QString ZoteroPrefetcher::filePath(const ZoteroItem& item) const {
+    return QDir(m_directory).absoluteFilePath(QString("%1_v%2.pdf")
+                                              .arg(item.pdfAttachmentKey).arg(item.pdfAttachmentVersion));
+}
@@ -0,0 +1,86 @@
+#ifndef ZOTEROPREFETCHER_H
+#define ZOTEROPREFETCHER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include "zoterocache.h"
+
+class QFile;
+class ZoteroDownloader;
+
+// Downloads the PDFs of the first few papers in the selected collection in the
+// background, so Analyze can go straight to extraction. Attachment keys come
+// from the ZoteroCache mirror, so no per-item /children lookup is needed.
+//
+// Files live in <app dir>/zotero_prefetch, named by attachment key and version
+// (a changed attachment gets a fresh download), with the SHA-256 computed while
+// downloading kept next to each file for the extraction cache key. Downloads run
+// with bounded concurrency into .part files and are renamed once complete. The
+// directory is held under a byte quota by evicting the least recently used
+// files, never ones belonging to the collection currently being prefetched.
+//
+// Main thread only.
+class ZoteroPrefetcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ZoteroPrefetcher(QObject *parent = nullptr);
+    ~ZoteroPrefetcher();
+
+    void setLibrary(const QString& userId, const QString& apiKey);
+
+    // Queue the first maxItems() downloadable PDFs of items, replacing the
+    // previous queue. Downloads already running for items still wanted continue.
+    void prefetch(const QList<ZoteroItem>& items);
+    void cancel();
+
+    // Path of a completed download for item, or empty. Marks the file as recently used.
+    QString cachedPath(const ZoteroItem& item);
+    QByteArray cachedHash(const ZoteroItem& item) const;
+    bool isDownloading(const ZoteroItem& item) const;
+
+    void setMaxItems(int maxItems) { m_maxItems = qMax(0, maxItems); }
+    int maxItems() const { return m_maxItems; }
+    void setConcurrency(int concurrency) { m_concurrency = qMax(1, concurrency); }
+    void setQuotaBytes(qint64 quotaBytes) { m_quotaBytes = quotaBytes; }
+
+    static constexpr int DefaultMaxItems = 8;
+    static constexpr int DefaultConcurrency = 2;
+    static constexpr qint64 DefaultQuotaBytes = 1024LL * 1024 * 1024;  // 1GB
+
+signals:
+    void prefetched(const QString& attachmentKey, const QString& path);
+    void prefetchFailed(const QString& attachmentKey, const QString& error);
+    void progress(int done, int total);
+
+private:
+    struct Download {
+        ZoteroItem item;
+        ZoteroDownloader* downloader = nullptr;
+        QFile* file = nullptr;
+    };
+
+    void startNext();
+    void finishDownload(const QString& attachmentKey, bool ok, const QByteArray& sha256, const QString& error);
+    void abortDownload(Download& download);
+    void enforceQuota();
+    QString filePath(const ZoteroItem& item) const;
+    QString hashPath(const ZoteroItem& item) const { return filePath(item) + ".sha256"; }
+
+    QString m_directory;
+    QString m_userId;
+    QString m_apiKey;
+    QList<ZoteroItem> m_queue;
+    QList<Download> m_active;
+    QSet<QString> m_wanted;  // File names for the current collection (exempt from eviction)
+    int m_total;
+    int m_done;
+    int m_maxItems;
+    int m_concurrency;
+    qint64 m_quotaBytes;
+};
+
+#endif // ZOTEROPREFETCHER_H
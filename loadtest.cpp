@@ -0,0 +1,307 @@
+// Load-test driver for the LLM client code path.
+//
+// Runs the same PromptQuery/HttpClientPool code the GUI uses against an
+// OpenAI-compatible endpoint (normally mock_lmstudio) with a fixed number of
+// requests in flight, and reports end-to-end throughput and latency
+// percentiles, time to first token (streaming) and the error breakdown.
+//
+// Usage: loadtest [--url URL] [--model id] [-n requests] [-c concurrency]
+//                 [--stream] [--prompt-chars n] [--timeout ms] [--json results.json]
+//
+// Typical offline run:
+//   mock_lmstudio --latency 300 --tokens-per-second 80 --output mixed &
+//   loadtest -n 200 -c 8 --stream
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "promptquery.h"
+#include "modellistfetcher.h"
+#include "httpclientpool.h"
+#include "asynclogger.h"
+
+namespace {
+
+struct LoadOptions {
+    QString url;
+    QString model;
+    int requests = 100;
+    int concurrency = 4;
+    bool streaming = false;
+    int promptChars = 8000;
+    int timeoutMs = 60000;
+};
+
+struct Sample {
+    double latencyMs = 0.0;
+    double ttftMs = -1.0;
+    int completionTokens = -1;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const std::size_t rank = static_cast<std::size_t>(std::ceil(p * values.size()));
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+QString syntheticDocument(int chars) {
+    static const QString sentence = "Transformer models have changed protein structure prediction and gene editing research. ";
+    QString text;
+    text.reserve(chars + sentence.size());
+    while (text.size() < chars) {
+        text += sentence;
+    }
+    return text.left(chars);
+}
+
+class LoadDriver : public QObject {
+public:
+    explicit LoadDriver(const LoadOptions& options, QObject *parent = nullptr)
+        : QObject(parent), m_options(options), m_document(syntheticDocument(options.promptChars)),
+          m_started(0), m_finished(0) {}
+
+    void start() {
+        m_wallTimer.start();
+        const int workers = qMin(m_options.concurrency, m_options.requests);
+        for (int i = 0; i < workers; ++i) {
+            auto* query = new KeywordsQuery(this);
+            query->setConnectionSettings(m_options.url, m_options.model);
+            query->setPromptSettings(0.3, 512, m_options.timeoutMs);
+            query->setPreprompt("You are a helpful assistant that extracts keywords.");
+            query->setPrompt("Extract the main keywords from this text as a comma-separated list:\n\n{text}");
+            query->setStreaming(m_options.streaming, m_options.timeoutMs);
+
+            connect(query, &PromptQuery::requestFinished, this, [this, query](const QString&, const RequestStats& stats) {
+                m_pendingStats[query] = stats;
+            });
+            connect(query, &PromptQuery::resultReady, this, [this, query](const QString&) {
+                complete(query, QString());
+            });
+            connect(query, &PromptQuery::errorOccurred, this, [this, query](const QString& error) {
+                complete(query, error);
+            });
+            launch(query);
+        }
+    }
+
+    void report(const QString& jsonPath) const;
+
+private:
+    void launch(KeywordsQuery* query) {
+        if (m_started >= m_options.requests) {
+            return;
+        }
+        m_started++;
+        m_pendingStats.remove(query);
+        m_requestTimers[query].start();
+        query->execute(m_document);
+    }
+
+    void complete(KeywordsQuery* query, const QString& error) {
+        Sample sample;
+        sample.latencyMs = m_requestTimers[query].nsecsElapsed() / 1e6;
+        if (m_pendingStats.contains(query)) {
+            const RequestStats stats = m_pendingStats.take(query);
+            sample.ttftMs = stats.timeToFirstTokenMs >= 0 ? double(stats.timeToFirstTokenMs) : -1.0;
+            sample.completionTokens = stats.completionTokens;
+        }
+
+        if (error.isEmpty()) {
+            m_samples.push_back(sample);
+        } else {
+            // Group by message without per-request details (e.g. timeouts in seconds)
+            m_errors[error.section(':', 0, 0)]++;
+        }
+
+        m_finished++;
+        if (m_finished % qMax(1, m_options.requests / 10) == 0) {
+            std::cout << "  " << m_finished << "/" << m_options.requests << " done" << std::endl;
+        }
+
+        if (m_finished >= m_options.requests) {
+            m_wallMs = m_wallTimer.nsecsElapsed() / 1e6;
+            QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+            return;
+        }
+
+        // The query may still be unwinding its own reply handling - start the next one afterwards
+        QTimer::singleShot(0, query, [this, query]() { launch(query); });
+    }
+
+    LoadOptions m_options;
+    QString m_document;
+    int m_started;
+    int m_finished;
+    double m_wallMs = 0.0;
+    QElapsedTimer m_wallTimer;
+    QMap<KeywordsQuery*, QElapsedTimer> m_requestTimers;
+    QMap<KeywordsQuery*, RequestStats> m_pendingStats;
+    std::vector<Sample> m_samples;
+    QMap<QString, int> m_errors;
+};
+
+void LoadDriver::report(const QString& jsonPath) const {
+    std::vector<double> latencies;
+    std::vector<double> ttfts;
+    qint64 completionTokens = 0;
+    for (const Sample& sample : m_samples) {
+        latencies.push_back(sample.latencyMs);
+        if (sample.ttftMs >= 0) {
+            ttfts.push_back(sample.ttftMs);
+        }
+        completionTokens += qMax(0, sample.completionTokens);
+    }
+
+    int errorCount = 0;
+    for (int count : m_errors) {
+        errorCount += count;
+    }
+
+    const double seconds = m_wallMs / 1000.0;
+    const double throughput = seconds > 0 ? m_samples.size() / seconds : 0.0;
+    const double tokenRate = seconds > 0 ? completionTokens / seconds : 0.0;
+
+    std::cout << "\nRequests: " << m_finished << " (" << m_samples.size() << " ok, " << errorCount << " failed), "
+              << "concurrency " << m_options.concurrency << (m_options.streaming ? ", streaming" : ", buffered") << std::endl;
+    std::cout << QString("Wall time: %1 s, throughput %2 req/s, %3 completion tokens/s")
+                     .arg(seconds, 0, 'f', 2).arg(throughput, 0, 'f', 2).arg(tokenRate, 0, 'f', 1).toStdString() << std::endl;
+    std::cout << QString("Latency ms: p50 %1  p90 %2  p95 %3  p99 %4  max %5")
+                     .arg(percentile(latencies, 0.50), 0, 'f', 1)
+                     .arg(percentile(latencies, 0.90), 0, 'f', 1)
+                     .arg(percentile(latencies, 0.95), 0, 'f', 1)
+                     .arg(percentile(latencies, 0.99), 0, 'f', 1)
+                     .arg(latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()), 0, 'f', 1)
+                     .toStdString() << std::endl;
+    if (!ttfts.empty()) {
+        std::cout << QString("Time to first token ms: p50 %1  p99 %2")
+                         .arg(percentile(ttfts, 0.50), 0, 'f', 1)
+                         .arg(percentile(ttfts, 0.99), 0, 'f', 1).toStdString() << std::endl;
+    }
+    for (auto it = m_errors.constBegin(); it != m_errors.constEnd(); ++it) {
+        std::cout << "  " << it.value() << " x " << it.key().toStdString() << std::endl;
+    }
+    std::cout << "Connection pool: " << HttpClientPool::instance()->statsSummary(QUrl(m_options.url)).toStdString()
+              << std::endl;
+
+    if (jsonPath.isEmpty()) {
+        return;
+    }
+
+    QJsonObject errors;
+    for (auto it = m_errors.constBegin(); it != m_errors.constEnd(); ++it) {
+        errors[it.key()] = it.value();
+    }
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["url"] = m_options.url;
+    root["requests"] = m_finished;
+    root["ok"] = static_cast<int>(m_samples.size());
+    root["failed"] = errorCount;
+    root["concurrency"] = m_options.concurrency;
+    root["streaming"] = m_options.streaming;
+    root["prompt_chars"] = m_options.promptChars;
+    root["wall_s"] = seconds;
+    root["requests_per_s"] = throughput;
+    root["completion_tokens_per_s"] = tokenRate;
+    root["latency_ms"] = QJsonObject{
+        { "p50", percentile(latencies, 0.50) }, { "p90", percentile(latencies, 0.90) },
+        { "p95", percentile(latencies, 0.95) }, { "p99", percentile(latencies, 0.99) },
+        { "max", latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()) } };
+    if (!ttfts.empty()) {
+        root["ttft_ms"] = QJsonObject{ { "p50", percentile(ttfts, 0.50) }, { "p99", percentile(ttfts, 0.99) } };
+    }
+    root["errors"] = errors;
+
+    QFile file(jsonPath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        std::cout << "Results written to " << jsonPath.toStdString() << std::endl;
+    } else {
+        std::cerr << "Cannot write " << jsonPath.toStdString() << std::endl;
+    }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("loadtest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure LLM client throughput and tail latency under concurrency");
+    parser.addHelpOption();
+    QCommandLineOption urlOption("url", "Chat completions endpoint (default http://127.0.0.1:8090/v1/chat/completions)",
+                                 "url", "http://127.0.0.1:8090/v1/chat/completions");
+    QCommandLineOption modelOption("model", "Model id (default: first model from /v1/models)", "id");
+    QCommandLineOption requestsOption(QStringList() << "n" << "requests", "Total requests (default 100)", "count", "100");
+    QCommandLineOption concurrencyOption(QStringList() << "c" << "concurrency", "Requests in flight (default 4)", "count", "4");
+    QCommandLineOption streamOption("stream", "Use \"stream\": true");
+    QCommandLineOption promptCharsOption("prompt-chars", "Size of the document sent with each request (default 8000)",
+                                         "chars", "8000");
+    QCommandLineOption timeoutOption("timeout", "Per-request timeout in ms (default 60000)", "ms", "60000");
+    QCommandLineOption jsonOption("json", "Write results as JSON to file", "file");
+    parser.addOptions({ urlOption, modelOption, requestsOption, concurrencyOption, streamOption,
+                        promptCharsOption, timeoutOption, jsonOption });
+    parser.process(app);
+
+    LoadOptions options;
+    options.url = parser.value(urlOption);
+    options.model = parser.value(modelOption);
+    options.requests = qMax(1, parser.value(requestsOption).toInt());
+    options.concurrency = qMax(1, parser.value(concurrencyOption).toInt());
+    options.streaming = parser.isSet(streamOption);
+    options.promptChars = qMax(1, parser.value(promptCharsOption).toInt());
+    options.timeoutMs = qMax(1000, parser.value(timeoutOption).toInt());
+
+    // Full prompts and responses would otherwise be logged for every request
+    AsyncLogger::instance()->setMinimumLevel(AsyncLogger::Warning);
+
+    // Check the server is up (and pick a model) through the same code the Settings dialog uses
+    QString baseUrl = options.url;
+    if (baseUrl.contains("/v1/chat/completions")) {
+        baseUrl = baseUrl.left(baseUrl.indexOf("/v1/chat/completions"));
+    }
+    ModelListFetcher fetcher;
+    QEventLoop fetchLoop;
+    QObject::connect(&fetcher, &ModelListFetcher::modelsReady, &fetchLoop, [&](const QStringList& models) {
+        if (options.model.isEmpty()) {
+            options.model = models.first();
+        }
+        std::cout << "Server has " << models.size() << " model(s), using " << options.model.toStdString() << std::endl;
+        fetchLoop.quit();
+    });
+    QObject::connect(&fetcher, &ModelListFetcher::errorOccurred, &fetchLoop, [&fetchLoop](const QString& error) {
+        std::cerr << error.toStdString() << std::endl;
+        fetchLoop.exit(1);
+    });
+    fetcher.fetchModels(baseUrl);
+    if (fetchLoop.exec() != 0) {
+        return 1;
+    }
+
+    LoadDriver run(options);
+    std::cout << "Sending " << options.requests << " request(s) to " << options.url.toStdString()
+              << " with " << options.concurrency << " in flight..." << std::endl;
+    run.start();
+    app.exec();
+
+    run.report(parser.value(jsonOption));
+    AsyncLogger::instance()->shutdown();
+    return 0;
+}
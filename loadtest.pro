@@ -0,0 +1,33 @@
+# Load-test driver for the LLM client (PromptQuery + HttpClientPool)
+# Build: qmake loadtest.pro && make
+# Run against mock_lmstudio or a real LM Studio: build/bench/loadtest --help
+
+QT += core network sql
+QT -= gui
+CONFIG += c++17 console release
+CONFIG -= app_bundle
+
+TARGET = loadtest
+
+INCLUDEPATH += gui-extractor
+
+SOURCES += loadtest.cpp \
+    gui-extractor/promptquery.cpp \
+    gui-extractor/modellistfetcher.cpp \
+    gui-extractor/responsecache.cpp \
+    gui-extractor/httpclientpool.cpp \
+    gui-extractor/ssestream.cpp \
+    gui-extractor/asynclogger.cpp \
+    gui-extractor/tokenbudget.cpp
+
+HEADERS += gui-extractor/promptquery.h \
+    gui-extractor/modellistfetcher.h \
+    gui-extractor/responsecache.h \
+    gui-extractor/httpclientpool.h \
+    gui-extractor/ssestream.h \
+    gui-extractor/asynclogger.h \
+    gui-extractor/tokenbudget.h
+
+DESTDIR = build/bench
+OBJECTS_DIR = $$DESTDIR/obj_loadtest
+MOC_DIR = $$DESTDIR/moc_loadtest
@@ -15,8 +15,28 @@
 #include <QJsonArray>
 #include <QEventLoop>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QDateTime>
+#include <QSet>
 #include <iostream>
+#include <functional>
+#include <memory>
 #include "tomlparser.h"
+#include "sectionsegmenter.h"
+#include "ssestream.h"
+
+// Default system prompts when the config doesn't provide one
+static const char* DefaultSummarySystemPrompt =
+    "You are an expert scientific reviewer. Provide clear, concise analysis of research papers focusing on key findings and significance.";
+static const char* DefaultKeywordsSystemPrompt =
+    "You are a scientific keyword extraction assistant. Focus on extracting specific scientific terms, organisms, chemicals, methods, and concepts from research papers.";
 
 class LMStudioClient : public QObject {
     Q_OBJECT
@@ -25,10 +45,25 @@ public:
     LMStudioClient(const QString &endpoint, int timeout, double temperature, int maxTokens,
                    const QString &model, bool verbose)
         : m_endpoint(endpoint), m_timeout(timeout), m_temperature(temperature),
-          m_maxTokens(maxTokens), m_model(model), m_verbose(verbose) {
+          m_maxTokens(maxTokens), m_model(model), m_verbose(verbose),
+          m_stream(false), m_inactivityTimeout(timeout) {
         m_networkManager = new QNetworkAccessManager(this);
     }
 
+    // Change sampling settings so one client (and its connections) can serve several tasks
+    void setSampling(double temperature, int maxTokens, const QString &model) {
+        m_temperature = temperature;
+        m_maxTokens = maxTokens;
+        m_model = model;
+    }
+
+    // Stream tokens to stdout as they arrive; the timeout then only applies
+    // to gaps between chunks
+    void setStreaming(bool stream, int inactivityTimeout) {
+        m_stream = stream;
+        m_inactivityTimeout = inactivityTimeout;
+    }
+
     QString sendPrompt(const QString &systemPrompt, const QString &userPrompt, const QString &text) {
         QString fullPrompt = userPrompt;
         // No truncation - let LM Studio handle token limits
@@ -51,7 +86,7 @@ public:
         requestData["messages"] = messages;
         requestData["temperature"] = m_temperature;
         requestData["max_tokens"] = m_maxTokens;
-        requestData["stream"] = false;
+        requestData["stream"] = m_stream;
 
         if (m_verbose) {
             std::cout << "[VERBOSE] Sending request to: " << m_endpoint.toStdString() << std::endl;
@@ -79,6 +114,46 @@ public:
         connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
         connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
 
+        // Server-sent events, decoded by the same parser as the GUI. Only the
+        // filtered text is echoed so <think> blocks and Harmony markup stay off
+        // the console; the raw content goes through the cleanup below.
+        SseStreamParser sseParser;
+        StreamTextFilter displayFilter;
+        QByteArray rawResponse;
+        QString streamed;
+        qint64 firstTokenMs = -1;
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        auto processStreamBytes = [&](const QByteArray &bytes) {
+            rawResponse.append(bytes);
+            const QList<SseStreamParser::Delta> deltas = sseParser.feed(bytes);
+            for (const SseStreamParser::Delta &delta : deltas) {
+                if (firstTokenMs < 0) {
+                    firstTokenMs = elapsed.elapsed();
+                    if (m_verbose) {
+                        std::cout << "[VERBOSE] Time to first token: " << firstTokenMs << " ms" << std::endl;
+                    }
+                }
+                if (delta.content.isEmpty()) {
+                    continue;
+                }
+                streamed += delta.content;
+                QString visible = displayFilter.feed(delta.content);
+                if (!visible.isEmpty()) {
+                    std::cout << visible.toStdString() << std::flush;
+                }
+            }
+        };
+
+        if (m_stream) {
+            connect(reply, &QNetworkReply::readyRead, &loop, [&]() {
+                processStreamBytes(reply->readAll());
+                // Data is flowing - from now on only inactivity counts
+                timer.start(m_inactivityTimeout);
+            });
+        }
+
         timer.start();
         loop.exec();
 
@@ -88,8 +163,26 @@ public:
             timer.stop();
             if (reply->error() == QNetworkReply::NoError) {
                 QByteArray response = reply->readAll();
-                QJsonDocument responseDoc = QJsonDocument::fromJson(response);
-                QJsonObject responseObj = responseDoc.object();
+                if (m_stream) {
+                    // Flush a final line that arrived without a trailing newline
+                    processStreamBytes(response + "\n");
+                }
+
+                QJsonObject responseObj;
+                if (m_stream && (sseParser.isDone() || !streamed.isEmpty())) {
+                    std::cout << displayFilter.finish().toStdString() << std::endl;
+                    if (m_verbose) {
+                        std::cout << "[VERBOSE] Stream finished after " << elapsed.elapsed() << " ms" << std::endl;
+                    }
+                    // Same shape as a non-streamed response so the cleanup below applies
+                    QJsonObject messageObj;
+                    messageObj["content"] = streamed;
+                    QJsonObject firstChoice;
+                    firstChoice["message"] = messageObj;
+                    responseObj["choices"] = QJsonArray{firstChoice};
+                } else {
+                    responseObj = QJsonDocument::fromJson(m_stream ? rawResponse : response).object();
+                }
 
                 if (responseObj.contains("choices")) {
                     QJsonArray choices = responseObj["choices"].toArray();
@@ -120,6 +213,8 @@ public:
             } else {
                 std::cerr << "Network error: " << reply->errorString().toStdString() << std::endl;
             }
+        } else if (m_stream && firstTokenMs >= 0) {
+            std::cerr << "\nRequest timeout: no data for " << m_inactivityTimeout << " ms" << std::endl;
         } else {
             std::cerr << "Request timeout" << std::endl;
         }
@@ -135,6 +230,8 @@ private:
     int m_maxTokens;
     QString m_model;
     bool m_verbose;
+    bool m_stream;
+    int m_inactivityTimeout;
     QNetworkAccessManager *m_networkManager;
 };
 
@@ -160,6 +257,508 @@ QString cleanCopyrightText(const QString &text) {
     return cleaned;
 }
 
+// Parse "a-b" or "n" (1-based) into a 0-based page range clamped to the document
+void parsePageRange(const QString &range, int pageCount, int &startPage, int &endPage) {
+    startPage = 0;
+    endPage = pageCount - 1;
+    if (range.isEmpty()) {
+        return;
+    }
+
+    if (range.contains("-")) {
+        QStringList parts = range.split("-");
+        if (parts.size() == 2) {
+            startPage = parts[0].toInt() - 1;
+            endPage = parts[1].toInt() - 1;
+        }
+    } else {
+        startPage = endPage = range.toInt() - 1;
+    }
+
+    startPage = qMax(0, startPage);
+    endPage = qMin(pageCount - 1, endPage);
+}
+
+// Check the file, then load it; returns why it failed, or an empty string
+static QString loadPdf(const QString &pdfPath, QPdfDocument &pdfDocument) {
+    QFileInfo info(pdfPath);
+    if (!info.exists()) {
+        return "File not found";
+    }
+    if (!info.isFile() || !info.isReadable()) {
+        return "Not a readable file";
+    }
+
+    switch (pdfDocument.load(pdfPath)) {
+        case QPdfDocument::Error::None:
+            return QString();
+        case QPdfDocument::Error::FileNotFound:
+            return "File not found";
+        case QPdfDocument::Error::InvalidFileFormat:
+            return "Invalid PDF format";
+        case QPdfDocument::Error::IncorrectPassword:
+            return "Password protected PDF";
+        case QPdfDocument::Error::UnsupportedSecurityScheme:
+            return "Unsupported security scheme";
+        default:
+            return "Unknown error";
+    }
+}
+
+// Drop the excluded sections from the text sent to the LLM; the output file keeps everything
+static QString selectSections(const QString &text, SectionSegmenter::Kinds excluded, QString &note) {
+    const SectionSegmenter::Selection selection = SectionSegmenter::select(text, excluded);
+    if (selection.droppedChars > 0) {
+        note = QString("left out %1 (%2 characters)")
+               .arg(selection.droppedHeadings.join(", ")).arg(selection.droppedChars);
+    } else if (!selection.segmented) {
+        note = "no section headings found, sending the whole text";
+    }
+    return selection.text;
+}
+
+struct ExtractionOptions {
+    QString pageRange;
+    bool preserveCopyright = false;
+    bool keepText = false;   // Return the text for the LLM stages
+    SectionSegmenter::Kinds excludedSections = 0;  // Applied to the returned text only
+};
+
+struct ExtractionResult {
+    QString error;           // Empty on success
+    bool loadFailed = false; // error came from opening the PDF, not the output file
+    int pages = 0;
+    qint64 chars = 0;
+    QString text;            // Only when keepText is set, without the excluded sections
+    QString sectionNote;     // What selectSections left out
+};
+
+// Extract a PDF page by page, streaming each page straight to outputPath so only
+// the text the LLM needs is held in memory. Used by single-file and batch mode.
+// progress(done, total) is called before the first page and every 10 pages.
+ExtractionResult extractToFile(const QString &pdfPath, const QString &outputPath, const ExtractionOptions &options,
+                               const std::function<void(int, int)> &progress = nullptr) {
+    ExtractionResult result;
+
+    QPdfDocument pdfDocument;
+    result.error = loadPdf(pdfPath, pdfDocument);
+    if (!result.error.isEmpty()) {
+        result.loadFailed = true;
+        return result;
+    }
+
+    int startPage, endPage;
+    parsePageRange(options.pageRange, pdfDocument.pageCount(), startPage, endPage);
+    const int total = qMax(0, endPage - startPage + 1);
+
+    QFile outputFile(outputPath);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        result.error = "Cannot open output file for writing: " + outputPath;
+        return result;
+    }
+    QTextStream out(&outputFile);
+
+    if (progress) {
+        progress(0, total);
+    }
+    for (int i = startPage; i <= endPage; ++i) {
+        QString pageText = pdfDocument.getAllText(i).text();
+
+        if (!options.preserveCopyright) {
+            pageText = cleanCopyrightText(pageText);
+        }
+
+        if (!pageText.isEmpty()) {
+            if (i < endPage) {
+                pageText += "\n\n--- Page " + QString::number(i + 2) + " ---\n\n";
+            }
+            out << pageText;
+            result.chars += pageText.length();
+            if (options.keepText) {
+                result.text += pageText;
+            }
+        }
+
+        const int done = i - startPage + 1;
+        if (done % 10 == 0 || i == endPage) {
+            out.flush();
+            if (progress) {
+                progress(done, total);
+            }
+        }
+    }
+
+    out.flush();
+    outputFile.close();
+    result.pages = total;
+
+    if (options.keepText && options.excludedSections) {
+        result.text = selectSections(result.text, options.excludedSections, result.sectionNote);
+    }
+    return result;
+}
+
+// ===== BATCH MODE =====
+
+struct BatchOptions {
+    QString source;          // Directory, glob pattern or manifest file
+    QString outputDir;
+    QString reportPath;
+    QString pageRange;
+    bool preserveCopyright = false;
+    int extractionJobs = 0;  // 0 = one per core
+    int llmJobs = 1;
+    QString configPath;      // Summary/keywords run for every prompt the config defines
+    SectionSegmenter::Kinds excludedSections = 0;  // Left out of the LLM input
+};
+
+static constexpr int BatchQueuedPerLlmJob = 2;  // Documents in flight per LLM worker, running one included
+
+struct BatchItem {
+    QString pdfPath;
+    QString baseName;        // Unique output name stem
+    QString status = "pending";
+    QString error;
+    int pages = 0;
+    qint64 chars = 0;
+    qint64 extractMs = 0;
+    qint64 summaryMs = -1;   // -1 = not run
+    qint64 keywordsMs = -1;
+    qint64 queuedMs = 0;     // Time spent waiting for a free LLM slot
+    qint64 totalMs = 0;
+};
+
+static QMutex batchLogMutex;
+
+static void batchLog(const QString &message) {
+    QMutexLocker locker(&batchLogMutex);
+    std::cout << message.toStdString() << std::endl;
+}
+
+// Collect PDFs from a directory, a glob ("papers/*.pdf") or a manifest (one path per line)
+QStringList collectBatchInputs(const QString &source, QString &errorMsg) {
+    QStringList files;
+    QFileInfo info(source);
+
+    if (info.isDir()) {
+        QDir dir(source);
+        for (const QString &name : dir.entryList(QStringList() << "*.pdf" << "*.PDF", QDir::Files, QDir::Name)) {
+            files << dir.absoluteFilePath(name);
+        }
+    } else if (source.contains('*') || source.contains('?')) {
+        QDir dir(info.path());
+        for (const QString &name : dir.entryList(QStringList() << info.fileName(), QDir::Files, QDir::Name)) {
+            files << dir.absoluteFilePath(name);
+        }
+    } else if (info.isFile()) {
+        QFile manifest(source);
+        if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            errorMsg = "Cannot open manifest: " + source;
+            return files;
+        }
+        QTextStream in(&manifest);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith("#")) {
+                continue;
+            }
+            // Relative entries are relative to the manifest, not the working directory
+            files << (QFileInfo(line).isAbsolute() ? line : info.dir().absoluteFilePath(line));
+        }
+    } else {
+        errorMsg = "Batch source not found: " + source;
+    }
+
+    if (files.isEmpty() && errorMsg.isEmpty()) {
+        errorMsg = "No PDF files found in: " + source;
+    }
+    return files;
+}
+
+// Extract one document to <outputDir>/<baseName>.txt; text is returned only if wanted
+bool extractBatchItem(BatchItem &item, const BatchOptions &options, bool keepText, QString &text) {
+    ExtractionOptions extraction;
+    extraction.pageRange = options.pageRange;
+    extraction.preserveCopyright = options.preserveCopyright;
+    extraction.keepText = keepText;
+    extraction.excludedSections = options.excludedSections;
+
+    ExtractionResult result = extractToFile(item.pdfPath,
+                                            QDir(options.outputDir).absoluteFilePath(item.baseName + ".txt"),
+                                            extraction);
+    if (!result.error.isEmpty()) {
+        item.error = result.loadFailed ? "Cannot load PDF: " + result.error : result.error;
+        return false;
+    }
+
+    item.pages = result.pages;
+    item.chars = result.chars;
+    text = result.text;
+    if (!result.sectionNote.isEmpty()) {
+        batchLog(item.baseName + ": " + result.sectionNote);
+    }
+    return true;
+}
+
+// One client per LLM worker thread, so its connection is reused across documents
+static LMStudioClient &batchClient(const QString &endpoint, int timeout) {
+    thread_local std::unique_ptr<LMStudioClient> client;
+    if (!client) {
+        client = std::make_unique<LMStudioClient>(endpoint, timeout, 0.7, 500, QString(), false);
+    }
+    return *client;
+}
+
+// Run "summary" or "keyword" for one document, using the same config keys as single-file mode
+bool runBatchAiTask(const QMap<QString, QString> &config, const QString &task, const QString &text,
+                    const QString &outputPath, qint64 &elapsedMs) {
+    QString endpoint = config.value("lmstudio.endpoint", "http://localhost:1234/v1/chat/completions");
+    int timeout = config.value("lmstudio.timeout", "30000").toInt();
+    double temperature = config.value("lmstudio.temperature", "0.7").toDouble();
+    int maxTokens = config.value("lmstudio.max_tokens", "500").toInt();
+    QString model = config.value("lmstudio.model_name", "gpt-oss-120b");
+
+    bool isSummary = (task == "summary");
+    QString promptKey = isSummary ? "prompts.summary" : "prompts.keywords";
+
+    LMStudioClient &client = batchClient(endpoint, timeout);
+    client.setSampling(config.value("lm_studio." + task + "_temperature", QString::number(temperature)).toDouble(),
+                       config.value("lm_studio." + task + "_max_tokens", QString::number(maxTokens)).toInt(),
+                       config.value("lm_studio." + task + "_model_name", model));
+
+    QElapsedTimer timer;
+    timer.start();
+    QString result = client.sendPrompt(
+        config.value("lm_studio." + task + "_system_prompt",
+                     isSummary ? DefaultSummarySystemPrompt : DefaultKeywordsSystemPrompt),
+        config.value(promptKey), text);
+    elapsedMs = timer.elapsed();
+
+    if (result.isEmpty()) {
+        return false;
+    }
+
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out << result;
+    return true;
+}
+
+void writeBatchReport(const QList<BatchItem> &items, const BatchOptions &options, qint64 wallMs) {
+    QJsonArray files;
+    int succeeded = 0;
+    for (const BatchItem &item : items) {
+        QJsonObject entry;
+        entry["file"] = item.pdfPath;
+        entry["output"] = item.baseName;
+        entry["status"] = item.status;
+        entry["pages"] = item.pages;
+        entry["chars"] = item.chars;
+        entry["extract_ms"] = item.extractMs;
+        entry["summary_ms"] = item.summaryMs;
+        entry["keywords_ms"] = item.keywordsMs;
+        entry["llm_queue_ms"] = item.queuedMs;
+        entry["total_ms"] = item.totalMs;
+        if (!item.error.isEmpty()) {
+            entry["error"] = item.error;
+        }
+        files.append(entry);
+        if (item.status == "ok") {
+            succeeded++;
+        }
+    }
+
+    QJsonObject report;
+    report["started"] = QDateTime::currentDateTime().addMSecs(-wallMs).toString(Qt::ISODate);
+    report["source"] = options.source;
+    report["files"] = files;
+    report["succeeded"] = succeeded;
+    report["failed"] = items.size() - succeeded;
+    report["wall_ms"] = wallMs;
+    report["extraction_jobs"] = options.extractionJobs;
+    report["llm_jobs"] = options.llmJobs;
+
+    QFile file(options.reportPath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(report).toJson());
+    } else {
+        std::cerr << "Warning: cannot write report to " << options.reportPath.toStdString() << std::endl;
+    }
+
+    std::cout << "\n==== Batch summary ====" << std::endl;
+    for (const BatchItem &item : items) {
+        std::cout << QString("%1  %2  %3 pages  extract %4 ms  summary %5  keywords %6  total %7 ms")
+                         .arg(item.status.leftJustified(6))
+                         .arg(QFileInfo(item.pdfPath).fileName().leftJustified(32))
+                         .arg(item.pages, 4)
+                         .arg(item.extractMs, 6)
+                         .arg(item.summaryMs < 0 ? QString("-") : QString("%1 ms").arg(item.summaryMs))
+                         .arg(item.keywordsMs < 0 ? QString("-") : QString("%1 ms").arg(item.keywordsMs))
+                         .arg(item.totalMs)
+                         .toStdString();
+        if (!item.error.isEmpty()) {
+            std::cout << "        " << item.error.toStdString();
+        }
+        std::cout << std::endl;
+    }
+    std::cout << succeeded << "/" << items.size() << " succeeded in " << wallMs << " ms" << std::endl;
+    std::cout << "Report written to: " << options.reportPath.toStdString() << std::endl;
+}
+
+// Extraction runs on a worker pool; finished documents are queued to a separate,
+// smaller pool for LLM calls. The queue is bounded: once it is full, extraction
+// workers wait for the LLM to take a document, so a slow model caps how many
+// extracted texts are held in memory instead of the whole batch piling up.
+int runBatch(BatchOptions options) {
+    QString errorMsg;
+    QStringList inputs = collectBatchInputs(options.source, errorMsg);
+    if (inputs.isEmpty()) {
+        std::cerr << "Error: " << errorMsg.toStdString() << std::endl;
+        return 1;
+    }
+
+    if (!QDir().mkpath(options.outputDir)) {
+        std::cerr << "Error: Cannot create output directory: " << options.outputDir.toStdString() << std::endl;
+        return 1;
+    }
+    if (options.reportPath.isEmpty()) {
+        options.reportPath = QDir(options.outputDir).absoluteFilePath("batch_report.json");
+    }
+    if (options.extractionJobs <= 0) {
+        options.extractionJobs = qMax(1, QThread::idealThreadCount());
+    }
+    options.llmJobs = qMax(1, options.llmJobs);
+
+    // Parse the config once for the whole batch
+    QMap<QString, QString> config;
+    if (!options.configPath.isEmpty()) {
+        SimpleTomlParser tomlParser;
+        config = tomlParser.parse(options.configPath);
+        if (config.isEmpty()) {
+            std::cerr << "Error: Cannot parse config file: " << options.configPath.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    const bool runSummary = !config.value("prompts.summary").isEmpty();
+    const bool runKeywords = !config.value("prompts.keywords").isEmpty();
+    const bool needText = runSummary || runKeywords;
+
+    // Unique output names, even for same-named files from different directories
+    QList<BatchItem> items;
+    QSet<QString> usedNames;
+    for (const QString &path : inputs) {
+        BatchItem item;
+        item.pdfPath = path;
+        QString base = QFileInfo(path).completeBaseName();
+        QString name = base;
+        for (int n = 2; usedNames.contains(name.toLower()); ++n) {
+            name = QString("%1_%2").arg(base).arg(n);
+        }
+        usedNames.insert(name.toLower());
+        item.baseName = name;
+        items.append(item);
+    }
+
+    std::cout << "Batch: " << items.size() << " PDF(s), " << options.extractionJobs << " extraction worker(s)";
+    if (needText) {
+        std::cout << ", " << options.llmJobs << " LLM worker(s)";
+    }
+    std::cout << std::endl;
+
+    QThreadPool extractionPool;
+    extractionPool.setMaxThreadCount(options.extractionJobs);
+    QThreadPool llmPool;
+    llmPool.setMaxThreadCount(options.llmJobs);
+    llmPool.setExpiryTimeout(-1);  // Keep LLM threads (and their connections) for the whole batch
+
+    // Documents handed to the LLM pool and not yet finished: one running and one waiting per LLM worker
+    QSemaphore llmSlots(options.llmJobs * BatchQueuedPerLlmJob);
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    // Each task only touches its own item; the list itself is never resized while running
+    for (int i = 0; i < items.size(); ++i) {
+        extractionPool.start([&, i]() {
+            BatchItem &item = items[i];
+            QElapsedTimer timer;
+            timer.start();
+
+            QString text;
+            bool ok = false;
+            try {
+                ok = extractBatchItem(item, options, needText, text);
+            } catch (const std::exception &e) {
+                item.error = QString("Extraction failed: %1").arg(e.what());
+            } catch (...) {
+                item.error = "Extraction failed: Unknown error";
+            }
+            item.extractMs = timer.elapsed();
+
+            if (!ok) {
+                item.status = "failed";
+                item.totalMs = timer.elapsed();
+                batchLog(QString("[FAIL] %1: %2").arg(item.pdfPath, item.error));
+                return;
+            }
+            batchLog(QString("[TEXT] %1 (%2 pages, %3 ms)").arg(item.baseName).arg(item.pages).arg(item.extractMs));
+
+            if (!needText) {
+                item.status = "ok";
+                item.totalMs = timer.elapsed();
+                return;
+            }
+
+            // Waiting for a slot counts as queue time
+            qint64 queuedAt = wallTimer.elapsed();
+            qint64 startedAt = queuedAt - item.extractMs;
+            llmSlots.acquire();
+            llmPool.start([&, i, text, queuedAt, startedAt]() {
+                BatchItem &item = items[i];
+                item.queuedMs = wallTimer.elapsed() - queuedAt;
+
+                QDir outDir(options.outputDir);
+                bool ok = true;
+                if (runSummary && !runBatchAiTask(config, "summary", text,
+                                                  outDir.absoluteFilePath(item.baseName + "_summary.txt"),
+                                                  item.summaryMs)) {
+                    ok = false;
+                    item.error = "Summary generation failed";
+                }
+                if (runKeywords && !runBatchAiTask(config, "keyword", text,
+                                                   outDir.absoluteFilePath(item.baseName + "_keywords.txt"),
+                                                   item.keywordsMs)) {
+                    ok = false;
+                    item.error += QString(item.error.isEmpty() ? "" : "; ") + "Keyword generation failed";
+                }
+
+                item.status = ok ? "ok" : "failed";
+                item.totalMs = wallTimer.elapsed() - startedAt;
+                batchLog(QString("[%1] %2 (summary %3 ms, keywords %4 ms)")
+                         .arg(ok ? "DONE" : "FAIL", item.baseName)
+                         .arg(item.summaryMs).arg(item.keywordsMs));
+                llmSlots.release();
+            });
+        });
+    }
+
+    // Extraction tasks enqueue LLM work (and wait for it when the queue is full), so drain them first
+    extractionPool.waitForDone();
+    llmPool.waitForDone();
+
+    writeBatchReport(items, options, wallTimer.elapsed());
+
+    for (const BatchItem &item : items) {
+        if (item.status != "ok") {
+            return 2;  // Partial failure
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
@@ -203,8 +802,75 @@ int main(int argc, char *argv[])
                                      "Enable verbose output");
     parser.addOption(verboseOption);
 
+    QCommandLineOption streamOption(QStringList() << "stream",
+                                    "Stream AI output to the console as it is generated (single file only)");
+    parser.addOption(streamOption);
+
+    QCommandLineOption sectionsOption(QStringList() << "sections",
+                                      "Send only these sections to the AI, comma-separated: front, abstract, "
+                                      "introduction, methods, results, discussion, conclusion, acknowledgments, "
+                                      "references, appendix, or all (default: the whole text)",
+                                      "list");
+    parser.addOption(sectionsOption);
+
+    // Batch options
+    QCommandLineOption batchOption(QStringList() << "b" << "batch",
+                                   "Process many PDFs: a directory, a glob (quoted) or a manifest file with one path per line",
+                                   "source");
+    parser.addOption(batchOption);
+
+    QCommandLineOption outputDirOption(QStringList() << "o" << "output-dir",
+                                       "Batch mode: directory for per-document outputs (default: current directory)",
+                                       "dir");
+    parser.addOption(outputDirOption);
+
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Batch mode: parallel extraction workers (default: one per core)",
+                                  "count");
+    parser.addOption(jobsOption);
+
+    QCommandLineOption llmJobsOption(QStringList() << "llm-jobs",
+                                     "Batch mode: concurrent LLM requests (default: 1)",
+                                     "count");
+    parser.addOption(llmJobsOption);
+
+    QCommandLineOption reportOption(QStringList() << "report",
+                                    "Batch mode: JSON report path (default: <output-dir>/batch_report.json)",
+                                    "file");
+    parser.addOption(reportOption);
+
     parser.process(app);
 
+    SectionSegmenter::Kinds excludedSections = 0;
+    if (parser.isSet(sectionsOption)) {
+        bool known = true;
+        excludedSections = SectionSegmenter::AllKinds & ~SectionSegmenter::parseKinds(parser.value(sectionsOption), &known);
+        if (!known) {
+            std::cerr << "Warning: Unknown section names in --sections ignored: "
+                      << parser.value(sectionsOption).toStdString() << std::endl;
+        }
+    }
+
+    if (parser.isSet(batchOption)) {
+        // Several documents share the console, so interleaved token streams would be unreadable
+        if (parser.isSet(streamOption)) {
+            std::cerr << "Error: --stream cannot be used with --batch" << std::endl;
+            return 1;
+        }
+
+        BatchOptions options;
+        options.source = parser.value(batchOption);
+        options.outputDir = parser.isSet(outputDirOption) ? parser.value(outputDirOption) : QDir::currentPath();
+        options.reportPath = parser.value(reportOption);
+        options.pageRange = parser.value(pageRangeOption);
+        options.preserveCopyright = parser.isSet(preserveOption);
+        options.extractionJobs = parser.value(jobsOption).toInt();
+        options.llmJobs = parser.isSet(llmJobsOption) ? parser.value(llmJobsOption).toInt() : 1;
+        options.configPath = parser.value(configOption);
+        options.excludedSections = excludedSections;
+        return runBatch(options);
+    }
+
     const QStringList args = parser.positionalArguments();
     if (args.size() != 2) {
         std::cerr << "Error: Please provide both input PDF and output text file." << std::endl;
@@ -215,93 +881,41 @@ int main(int argc, char *argv[])
     QString outputPath = args[1];
     bool preserveCopyright = parser.isSet(preserveOption);
 
-    // Load PDF document
-    QPdfDocument pdfDocument;
-    QPdfDocument::Error error = pdfDocument.load(pdfPath);
-
-    if (error != QPdfDocument::Error::None) {
-        std::cerr << "Error loading PDF file: ";
-        switch (error) {
-            case QPdfDocument::Error::FileNotFound:
-                std::cerr << "File not found" << std::endl;
-                break;
-            case QPdfDocument::Error::InvalidFileFormat:
-                std::cerr << "Invalid PDF format" << std::endl;
-                break;
-            case QPdfDocument::Error::IncorrectPassword:
-                std::cerr << "Password protected PDF" << std::endl;
-                break;
-            case QPdfDocument::Error::UnsupportedSecurityScheme:
-                std::cerr << "Unsupported security scheme" << std::endl;
-                break;
-            default:
-                std::cerr << "Unknown error" << std::endl;
-        }
-        return 1;
-    }
-
-    // Determine page range
-    int startPage = 0;
-    int endPage = pdfDocument.pageCount() - 1;
-
-    if (parser.isSet(pageRangeOption)) {
-        QString range = parser.value(pageRangeOption);
-        if (range.contains("-")) {
-            QStringList parts = range.split("-");
-            if (parts.size() == 2) {
-                startPage = parts[0].toInt() - 1;
-                endPage = parts[1].toInt() - 1;
-            }
+    // The document is only held in memory when an LLM stage needs it
+    ExtractionOptions extraction;
+    extraction.pageRange = parser.value(pageRangeOption);
+    extraction.preserveCopyright = preserveCopyright;
+    extraction.keepText = parser.isSet(configOption) &&
+                          (parser.isSet(summaryOption) || parser.isSet(keywordsOption));
+    extraction.excludedSections = excludedSections;
+
+    ExtractionResult extracted = extractToFile(pdfPath, outputPath, extraction, [](int done, int total) {
+        if (done == 0) {
+            std::cout << "Extracting text from " << total << " pages..." << std::endl;
         } else {
-            startPage = endPage = range.toInt() - 1;
-        }
-
-        startPage = qMax(0, startPage);
-        endPage = qMin(pdfDocument.pageCount() - 1, endPage);
-    }
-
-    // Extract text from pages
-    QString fullText;
-    std::cout << "Extracting text from " << (endPage - startPage + 1) << " pages..." << std::endl;
-
-    for (int i = startPage; i <= endPage; ++i) {
-        QString pageText = pdfDocument.getAllText(i).text();
-
-        if (!preserveCopyright) {
-            pageText = cleanCopyrightText(pageText);
+            std::cout << "Processed " << done << " pages" << std::endl;
         }
-
-        if (!pageText.isEmpty()) {
-            fullText += pageText;
-            if (i < endPage) {
-                fullText += "\n\n--- Page " + QString::number(i + 2) + " ---\n\n";
-            }
-        }
-
-        if ((i - startPage + 1) % 10 == 0 || i == endPage) {
-            std::cout << "Processed " << (i - startPage + 1) << " pages" << std::endl;
+    });
+    if (!extracted.error.isEmpty()) {
+        if (extracted.loadFailed) {
+            std::cerr << "Error loading PDF file: " << extracted.error.toStdString() << std::endl;
+        } else {
+            std::cerr << "Error: " << extracted.error.toStdString() << std::endl;
         }
-    }
-
-    // Write text to output file
-    QFile outputFile(outputPath);
-    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        std::cerr << "Error: Cannot open output file for writing: "
-                  << outputPath.toStdString() << std::endl;
         return 1;
     }
-
-    QTextStream out(&outputFile);
-    out << fullText;
-    outputFile.close();
+    const QString fullText = extracted.text;
 
     std::cout << "\nExtraction complete!" << std::endl;
-    std::cout << "Pages extracted: " << (endPage - startPage + 1) << std::endl;
+    std::cout << "Pages extracted: " << extracted.pages << std::endl;
     std::cout << "Output written to: " << outputPath.toStdString() << std::endl;
     if (!preserveCopyright) {
         std::cout << "Copyright notices removed" << std::endl;
     }
-    std::cout << "Text length: " << fullText.length() << " characters" << std::endl;
+    std::cout << "Text length: " << extracted.chars << " characters" << std::endl;
+    if (!extracted.sectionNote.isEmpty()) {
+        std::cout << "Sections: " << extracted.sectionNote.toStdString() << std::endl;
+    }
 
     // Process with LM Studio if config is provided
     if (parser.isSet(configOption)) {
@@ -318,6 +932,8 @@ int main(int argc, char *argv[])
             double temperature = config.value("lmstudio.temperature", "0.7").toDouble();
             int maxTokens = config.value("lmstudio.max_tokens", "500").toInt();
             QString model = config.value("lmstudio.model_name", "gpt-oss-120b");
+            bool stream = parser.isSet(streamOption);
+            int streamInactivityTimeout = config.value("lmstudio.stream_inactivity_timeout", "120000").toInt();
 
             if (verbose) {
                 std::cout << "\n[VERBOSE] Configuration loaded from: " << configPath.toStdString() << std::endl;
@@ -341,9 +957,9 @@ int main(int argc, char *argv[])
 
                 // Create client with summary-specific settings
                 LMStudioClient summaryClient(endpoint, timeout, summaryTemp, summaryMaxTokens, summaryModel, verbose);
+                summaryClient.setStreaming(stream, streamInactivityTimeout);
 
-                QString summarySystemPrompt = config.value("lm_studio.summary_system_prompt",
-                    "You are an expert scientific reviewer. Provide clear, concise analysis of research papers focusing on key findings and significance.");
+                QString summarySystemPrompt = config.value("lm_studio.summary_system_prompt", DefaultSummarySystemPrompt);
                 QString summaryPrompt = config.value("prompts.summary");
 
                 if (verbose) {
@@ -377,9 +993,9 @@ int main(int argc, char *argv[])
 
                 // Create client with keyword-specific settings
                 LMStudioClient keywordsClient(endpoint, timeout, keywordsTemp, keywordsMaxTokens, keywordsModel, verbose);
+                keywordsClient.setStreaming(stream, streamInactivityTimeout);
 
-                QString keywordsSystemPrompt = config.value("lm_studio.keyword_system_prompt",
-                    "You are a scientific keyword extraction assistant. Focus on extracting specific scientific terms, organisms, chemicals, methods, and concepts from research papers.");
+                QString keywordsSystemPrompt = config.value("lm_studio.keyword_system_prompt", DefaultKeywordsSystemPrompt);
                 QString keywordsPrompt = config.value("prompts.keywords");
 
                 if (verbose) {
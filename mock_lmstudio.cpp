@@ -0,0 +1,461 @@
+// Local stand-in for an LM Studio / OpenAI-compatible server, for offline
+// development, latency experiments and load testing.
+//
+// Implements:
+//   GET  /v1/models            model list (ids from --models)
+//   POST /v1/chat/completions  buffered or "stream": true (SSE, chunked)
+//
+// Responses are canned text shaped like what the real models return:
+//   plain      content only
+//   harmony    gpt-oss Harmony channel markers around the content
+//   think      <think>...</think> reasoning before the content
+//   reasoning  separate "reasoning" field (gpt-oss via LM Studio)
+//   mixed      rotates through all of the above
+// Prompts that mention keywords get a comma-separated keyword list, anything
+// else a summary paragraph.
+//
+// Usage: mock_lmstudio [--port 8090] [--latency ms] [--jitter ms] [--tokens-per-second n]
+//                      [--completion-tokens n] [--error-rate 0..1] [--error-status code]
+//                      [--disconnect-rate 0..1] [--output mode] [--models a,b] [--verbose]
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDateTime>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QPair>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+struct MockConfig {
+    quint16 port = 8090;
+    int latencyMs = 200;          // Before the first byte (prompt processing)
+    int jitterMs = 50;            // Uniform +/- on top of latencyMs
+    double tokensPerSecond = 50;  // Generation speed; 0 = instant
+    int completionTokens = 120;
+    double errorRate = 0.0;       // Fraction of requests answered with errorStatus
+    int errorStatus = 500;
+    double disconnectRate = 0.0;  // Fraction of requests whose connection is dropped mid-response
+    QString output = "plain";
+    QStringList models = { "mock-model", "openai/gpt-oss-20b" };
+    bool verbose = false;
+};
+
+struct ParsedRequest {
+    QByteArray method;
+    QByteArray path;
+    QByteArray body;
+    bool keepAlive = true;
+};
+
+class MockServer : public QObject {
+public:
+    explicit MockServer(const MockConfig& config, QObject *parent = nullptr)
+        : QObject(parent), m_config(config), m_server(new QTcpServer(this)), m_requestCount(0), m_outputIndex(0) {
+        connect(m_server, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+                m_buffers.insert(socket, QByteArray());
+                connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { handleReadyRead(socket); });
+                connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                    m_buffers.remove(socket);
+                    m_busy.remove(socket);
+                    socket->deleteLater();
+                });
+            }
+        });
+    }
+
+    bool listen() {
+        return m_server->listen(QHostAddress::LocalHost, m_config.port);
+    }
+
+    QString errorString() const { return m_server->errorString(); }
+
+private:
+    // ===== HTTP PLUMBING =====
+
+    void handleReadyRead(QTcpSocket* socket) {
+        m_buffers[socket].append(socket->readAll());
+        processBuffered(socket);
+    }
+
+    // One request per connection at a time; pipelined requests wait in the buffer
+    void processBuffered(QTcpSocket* socket) {
+        if (m_busy.contains(socket) || !m_buffers.contains(socket)) {
+            return;
+        }
+
+        QByteArray& buffer = m_buffers[socket];
+        const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+
+        ParsedRequest request;
+        const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+        request.method = requestLine.value(0);
+        request.path = requestLine.value(1);
+        request.keepAlive = !requestLine.value(2).endsWith("1.0");
+
+        qsizetype contentLength = 0;
+        for (int i = 1; i < lines.size(); ++i) {
+            const QByteArray line = lines[i].trimmed();
+            const qsizetype colon = line.indexOf(':');
+            if (colon < 0) {
+                continue;
+            }
+            const QByteArray name = line.left(colon).trimmed().toLower();
+            const QByteArray value = line.mid(colon + 1).trimmed();
+            if (name == "content-length") {
+                contentLength = value.toLongLong();
+            } else if (name == "connection") {
+                request.keepAlive = value.toLower() != "close";
+            }
+        }
+
+        if (buffer.size() < headerEnd + 4 + contentLength) {
+            return;  // Body still arriving
+        }
+        request.body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, headerEnd + 4 + contentLength);
+
+        m_busy.insert(socket);
+        dispatch(socket, request);
+    }
+
+    void finishRequest(QTcpSocket* socket, bool keepAlive) {
+        m_busy.remove(socket);
+        if (!keepAlive) {
+            socket->disconnectFromHost();
+            return;
+        }
+        processBuffered(socket);
+    }
+
+    static QByteArray statusText(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 429: return "Too Many Requests";
+            case 500: return "Internal Server Error";
+            case 503: return "Service Unavailable";
+            default: return "Error";
+        }
+    }
+
+    void sendResponse(QTcpSocket* socket, int status, const QByteArray& body, bool keepAlive) {
+        QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + " " + statusText(status) + "\r\n";
+        response += "Content-Type: application/json\r\n";
+        response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        response += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        response += "\r\n";
+        response += body;
+        socket->write(response);
+        finishRequest(socket, keepAlive);
+    }
+
+    static void writeChunk(QTcpSocket* socket, const QByteArray& data) {
+        socket->write(QByteArray::number(data.size(), 16) + "\r\n" + data + "\r\n");
+    }
+
+    // ===== ENDPOINTS =====
+
+    void dispatch(QTcpSocket* socket, const ParsedRequest& request) {
+        const int id = ++m_requestCount;
+        if (m_config.verbose) {
+            std::cout << QDateTime::currentDateTime().toString("hh:mm:ss.zzz").toStdString() << " #" << id << " "
+                      << request.method.toStdString() << " " << request.path.toStdString()
+                      << " (" << request.body.size() << " bytes)" << std::endl;
+        }
+
+        if (request.method == "GET" && request.path.startsWith("/v1/models")) {
+            QJsonArray data;
+            for (const QString& model : m_config.models) {
+                data.append(QJsonObject{ { "id", model }, { "object", "model" }, { "owned_by", "mock" } });
+            }
+            sendResponse(socket, 200, QJsonDocument(QJsonObject{ { "object", "list" }, { "data", data } }).toJson(QJsonDocument::Compact),
+                         request.keepAlive);
+            return;
+        }
+
+        if (request.method != "POST" || !request.path.startsWith("/v1/chat/completions")) {
+            sendResponse(socket, 404, errorBody("Unknown endpoint " + QString::fromLatin1(request.path)), request.keepAlive);
+            return;
+        }
+
+        const QJsonObject body = QJsonDocument::fromJson(request.body).object();
+        if (body.isEmpty() || !body["messages"].isArray()) {
+            sendResponse(socket, 400, errorBody("Request body must be JSON with a messages array"), request.keepAlive);
+            return;
+        }
+
+        QRandomGenerator* rng = QRandomGenerator::global();
+        const bool injectError = rng->generateDouble() < m_config.errorRate;
+        const bool injectDisconnect = !injectError && rng->generateDouble() < m_config.disconnectRate;
+
+        int delay = m_config.latencyMs;
+        if (m_config.jitterMs > 0) {
+            delay += rng->bounded(2 * m_config.jitterMs + 1) - m_config.jitterMs;
+        }
+        delay = qMax(0, delay);
+
+        QPointer<QTcpSocket> guard(socket);
+        QTimer::singleShot(delay, this, [this, guard, request, body, injectError, injectDisconnect]() {
+            if (!guard) {
+                return;  // Client gave up while we were "thinking"
+            }
+            if (injectError) {
+                sendResponse(guard, m_config.errorStatus, errorBody("Injected failure"), request.keepAlive);
+                return;
+            }
+            startCompletion(guard, body, request.keepAlive, injectDisconnect);
+        });
+    }
+
+    void startCompletion(QTcpSocket* socket, const QJsonObject& body, bool keepAlive, bool dropMidway) {
+        const QString prompt = promptText(body);
+        const QString mode = nextOutputMode();
+        QString reasoning;
+        const QStringList tokens = cannedTokens(prompt, mode, reasoning);
+
+        QJsonObject usage;
+        usage["prompt_tokens"] = static_cast<int>(prompt.length() / 4);
+        usage["completion_tokens"] = static_cast<int>(tokens.size());
+        usage["total_tokens"] = static_cast<int>(prompt.length() / 4 + tokens.size());
+
+        const QString model = body["model"].toString(m_config.models.value(0));
+        const int tokenIntervalMs = m_config.tokensPerSecond > 0 ? qRound(1000.0 / m_config.tokensPerSecond) : 0;
+
+        if (!body["stream"].toBool()) {
+            // Buffered: wait out the generation time, then send everything at once
+            QPointer<QTcpSocket> guard(socket);
+            QTimer::singleShot(tokenIntervalMs * static_cast<int>(tokens.size()), this,
+                               [this, guard, tokens, reasoning, usage, model, keepAlive, dropMidway]() {
+                if (!guard) {
+                    return;
+                }
+                if (dropMidway) {
+                    guard->abort();
+                    return;
+                }
+                QJsonObject message{ { "role", "assistant" }, { "content", tokens.join(QString()) } };
+                if (!reasoning.isEmpty()) {
+                    message["reasoning"] = reasoning;
+                }
+                QJsonObject response;
+                response["id"] = QString("chatcmpl-mock-%1").arg(m_requestCount);
+                response["object"] = "chat.completion";
+                response["created"] = QDateTime::currentSecsSinceEpoch();
+                response["model"] = model;
+                response["choices"] = QJsonArray{ QJsonObject{ { "index", 0 }, { "message", message }, { "finish_reason", "stop" } } };
+                response["usage"] = usage;
+                sendResponse(guard, 200, QJsonDocument(response).toJson(QJsonDocument::Compact), keepAlive);
+            });
+            return;
+        }
+
+        // Streaming: SSE over chunked transfer so the connection can stay open afterwards
+        QByteArray headers = "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: text/event-stream\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "Transfer-Encoding: chunked\r\n";
+        headers += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        socket->write(headers);
+
+        // Reasoning deltas first (as gpt-oss does), then content
+        QList<QPair<QString, QString>> deltas;  // (field, text)
+        if (!reasoning.isEmpty()) {
+            for (const QString& word : reasoning.split(' ')) {
+                deltas.append({ "reasoning", word + " " });
+            }
+        }
+        for (const QString& token : tokens) {
+            deltas.append({ "content", token });
+        }
+
+        auto* timer = new QTimer(socket);
+        timer->setInterval(tokenIntervalMs);
+        auto next = std::make_shared<int>(0);
+        const int dropAt = dropMidway ? static_cast<int>(deltas.size() / 2) : -1;
+        const QString id = QString("chatcmpl-mock-%1").arg(m_requestCount);
+        // Streams only report usage when asked to, like LM Studio and the OpenAI API
+        const bool includeUsage = body["stream_options"].toObject()["include_usage"].toBool();
+        connect(timer, &QTimer::timeout, socket, [this, socket, timer, deltas, next, dropAt, usage, includeUsage, model, id,
+                                                  keepAlive]() {
+            if (*next == dropAt) {
+                timer->stop();
+                socket->abort();
+                return;
+            }
+
+            if (*next < deltas.size()) {
+                const auto& delta = deltas[*next];
+                QJsonObject chunk;
+                chunk["id"] = id;
+                chunk["object"] = "chat.completion.chunk";
+                chunk["model"] = model;
+                chunk["choices"] = QJsonArray{ QJsonObject{ { "index", 0 }, { "delta", QJsonObject{ { delta.first, delta.second } } } } };
+                writeChunk(socket, "data: " + QJsonDocument(chunk).toJson(QJsonDocument::Compact) + "\n\n");
+                (*next)++;
+                return;
+            }
+
+            // Final chunk carries finish_reason, and usage if include_usage was set
+            timer->stop();
+            timer->deleteLater();
+            QJsonObject last;
+            last["id"] = id;
+            last["object"] = "chat.completion.chunk";
+            last["model"] = model;
+            last["choices"] = QJsonArray{ QJsonObject{ { "index", 0 }, { "delta", QJsonObject() }, { "finish_reason", "stop" } } };
+            if (includeUsage) {
+                last["usage"] = usage;
+            }
+            writeChunk(socket, "data: " + QJsonDocument(last).toJson(QJsonDocument::Compact) + "\n\n");
+            writeChunk(socket, "data: [DONE]\n\n");
+            socket->write("0\r\n\r\n");
+            finishRequest(socket, keepAlive);
+        });
+        timer->start();
+    }
+
+    // ===== CANNED OUTPUT =====
+
+    QString nextOutputMode() {
+        if (m_config.output != "mixed") {
+            return m_config.output;
+        }
+        static const QStringList modes = { "plain", "harmony", "think", "reasoning" };
+        return modes[m_outputIndex++ % modes.size()];
+    }
+
+    static QString promptText(const QJsonObject& body) {
+        QString text;
+        for (const QJsonValue& message : body["messages"].toArray()) {
+            text += message.toObject()["content"].toString();
+            text += "\n";
+        }
+        return text;
+    }
+
+    // Content split into streamable tokens; tags stay whole, like a real tokenizer would emit them
+    QStringList cannedTokens(const QString& prompt, const QString& mode, QString& reasoning) const {
+        static const QStringList topics = {
+            "protein folding", "transformer models", "gene editing", "neural networks", "attention",
+            "sequence alignment", "language modeling", "structure prediction", "CRISPR", "benchmarks"
+        };
+
+        QRandomGenerator rng(static_cast<quint32>(qHash(prompt)));
+        const bool keywords = prompt.contains("keyword", Qt::CaseInsensitive);
+        QStringList tokens;
+        for (int i = 0; i < m_config.completionTokens; ++i) {
+            if (keywords) {
+                tokens << (i == 0 ? QString() : QString(", ")) + topics[rng.bounded(static_cast<int>(topics.size()))];
+            } else {
+                tokens << (i == 0 ? QString() : QString(" ")) + topics[rng.bounded(static_cast<int>(topics.size()))].section(' ', 0, 0);
+            }
+        }
+        if (!keywords && !tokens.isEmpty()) {
+            tokens.last() += ".";
+        }
+
+        const QString thought = "The user wants " + QString(keywords ? "keywords" : "a summary") +
+                                ", so I will list the main topics of the text.";
+        if (mode == "harmony") {
+            tokens.prepend("<|start|>assistant<|channel|>final<|message|>");
+            tokens.append("<|end|>");
+        } else if (mode == "think") {
+            tokens.prepend("<think>" + thought + "</think>\n");
+        } else if (mode == "reasoning") {
+            reasoning = thought;
+        }
+        return tokens;
+    }
+
+    static QByteArray errorBody(const QString& message) {
+        return QJsonDocument(QJsonObject{ { "error", QJsonObject{ { "message", message }, { "type", "server_error" } } } })
+            .toJson(QJsonDocument::Compact);
+    }
+
+    MockConfig m_config;
+    QTcpServer* m_server;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QSet<QTcpSocket*> m_busy;
+    int m_requestCount;
+    int m_outputIndex;
+};
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("mock_lmstudio");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mock OpenAI-compatible server for offline testing");
+    parser.addHelpOption();
+
+    MockConfig config;
+    QCommandLineOption portOption("port", "Listen port on 127.0.0.1 (default 8090)", "port", "8090");
+    QCommandLineOption latencyOption("latency", "Delay before the first byte in ms (default 200)", "ms", "200");
+    QCommandLineOption jitterOption("jitter", "Random +/- latency in ms (default 50)", "ms", "50");
+    QCommandLineOption rateOption("tokens-per-second", "Generation speed, 0 = instant (default 50)", "rate", "50");
+    QCommandLineOption tokensOption("completion-tokens", "Tokens per response (default 120)", "count", "120");
+    QCommandLineOption errorRateOption("error-rate", "Fraction of requests that fail (default 0)", "fraction", "0");
+    QCommandLineOption errorStatusOption("error-status", "HTTP status for injected failures (default 500)", "code", "500");
+    QCommandLineOption disconnectOption("disconnect-rate", "Fraction of requests dropped mid-response (default 0)", "fraction", "0");
+    QCommandLineOption outputOption("output", "plain, harmony, think, reasoning or mixed (default plain)", "mode", "plain");
+    QCommandLineOption modelsOption("models", "Comma-separated model ids for /v1/models", "ids");
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Log every request");
+    parser.addOptions({ portOption, latencyOption, jitterOption, rateOption, tokensOption, errorRateOption,
+                        errorStatusOption, disconnectOption, outputOption, modelsOption, verboseOption });
+    parser.process(app);
+
+    config.port = static_cast<quint16>(parser.value(portOption).toUInt());
+    config.latencyMs = qMax(0, parser.value(latencyOption).toInt());
+    config.jitterMs = qMax(0, parser.value(jitterOption).toInt());
+    config.tokensPerSecond = qMax(0.0, parser.value(rateOption).toDouble());
+    config.completionTokens = qMax(1, parser.value(tokensOption).toInt());
+    config.errorRate = qBound(0.0, parser.value(errorRateOption).toDouble(), 1.0);
+    config.errorStatus = parser.value(errorStatusOption).toInt();
+    config.disconnectRate = qBound(0.0, parser.value(disconnectOption).toDouble(), 1.0);
+    config.output = parser.value(outputOption).toLower();
+    config.verbose = parser.isSet(verboseOption);
+    if (parser.isSet(modelsOption)) {
+        config.models = parser.value(modelsOption).split(',', Qt::SkipEmptyParts);
+    }
+
+    static const QStringList modes = { "plain", "harmony", "think", "reasoning", "mixed" };
+    if (!modes.contains(config.output)) {
+        std::cerr << "Unknown output mode: " << config.output.toStdString() << std::endl;
+        return 1;
+    }
+
+    MockServer server(config);
+    if (!server.listen()) {
+        std::cerr << "Cannot listen on port " << config.port << ": " << server.errorString().toStdString() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Mock LM Studio listening on http://127.0.0.1:" << config.port << "/v1/chat/completions" << std::endl;
+    std::cout << "Latency " << config.latencyMs << "+/-" << config.jitterMs << " ms, "
+              << config.tokensPerSecond << " tokens/s, " << config.completionTokens << " tokens, output "
+              << config.output.toStdString() << ", errors " << config.errorRate << ", drops " << config.disconnectRate
+              << std::endl;
+
+    return app.exec();
+}
@@ -0,0 +1,16 @@
+# Mock OpenAI-compatible server for offline latency and load testing
+# Build: qmake mock_lmstudio.pro && make
+# Run:   build/bench/mock_lmstudio --help
+
+QT += core network
+QT -= gui
+CONFIG += c++17 console release
+CONFIG -= app_bundle
+
+TARGET = mock_lmstudio
+
+SOURCES += mock_lmstudio.cpp
+
+DESTDIR = build/bench
+OBJECTS_DIR = $$DESTDIR/obj_mock
+MOC_DIR = $$DESTDIR/moc_mock
@@ -6,8 +6,14 @@ CONFIG -= app_bundle shared
 
 TARGET = pdfextract
 
-SOURCES += main_enhanced.cpp
-HEADERS += tomlparser.h
+INCLUDEPATH += gui-extractor
+
+SOURCES += main_enhanced.cpp \
+    gui-extractor/sectionsegmenter.cpp \
+    gui-extractor/ssestream.cpp
+HEADERS += tomlparser.h \
+    gui-extractor/sectionsegmenter.h \
+    gui-extractor/ssestream.h
 
 # Static linking configuration
 QMAKE_LFLAGS += -static -static-libgcc -static-libstdc++
@@ -0,0 +1,43 @@
+# Benchmark harness for the extraction and cleanup pipeline
+# Build: qmake pdfextract_bench.pro && make
+# Run from this directory to use the bundled paper*.pdf / test*.pdf files:
+#   build/bench/pdfextract_bench --json bench_results.json
+
+QT += core pdf network sql
+QT -= gui
+CONFIG += c++17 console release
+CONFIG -= app_bundle
+
+TARGET = pdfextract_bench
+
+INCLUDEPATH += gui-extractor
+
+SOURCES += benchmark.cpp \
+    gui-extractor/safepdfloader.cpp \
+    gui-extractor/mappedpdffile.cpp \
+    gui-extractor/textcleaner.cpp \
+    gui-extractor/promptquery.cpp \
+    gui-extractor/responsecache.cpp \
+    gui-extractor/httpclientpool.cpp \
+    gui-extractor/ssestream.cpp \
+    gui-extractor/asynclogger.cpp \
+    gui-extractor/tokenbudget.cpp \
+    gui-extractor/boilerplatefilter.cpp \
+    gui-extractor/structuredtext.cpp
+
+HEADERS += gui-extractor/safepdfloader.h \
+    gui-extractor/mappedpdffile.h \
+    gui-extractor/textcleaner.h \
+    gui-extractor/promptquery.h \
+    gui-extractor/responsecache.h \
+    gui-extractor/httpclientpool.h \
+    gui-extractor/ssestream.h \
+    gui-extractor/asynclogger.h \
+    gui-extractor/tokenbudget.h \
+    gui-extractor/boilerplatefilter.h \
+    gui-extractor/structuredtext.h
+
+DESTDIR = build/bench
+OBJECTS_DIR = $$DESTDIR/obj
+MOC_DIR = $$DESTDIR/moc
+QMAKE_CXXFLAGS_RELEASE += -O2
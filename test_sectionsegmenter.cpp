@@ -0,0 +1,100 @@
+#include <iostream>
+#include "sectionsegmenter.h"
+
+// Build: qmake test_sectionsegmenter.pro && make
+// Returns non-zero if any check fails.
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    std::cout << (condition ? "PASS: " : "FAIL: ") << what << std::endl;
+    if (!condition) {
+        ++failures;
+    }
+}
+
+// Enough body text that back matter headings fall after BackMatterMinPercent
+static QString paper(const QString& tail) {
+    QString body;
+    for (int i = 0; i < 40; ++i) {
+        body += "The measurements were repeated on every sample to estimate the variance.\n";
+    }
+    return "A Study of Things\n"
+           "Abstract\n"
+           "We study things.\n"
+           "1 Introduction\n" + body +
+           "2 Results\n" + body + tail;
+}
+
+static QVector<SectionSegmenter::Kind> kinds(const QString& text) {
+    QVector<SectionSegmenter::Kind> result;
+    for (const SectionSegmenter::Section& section : SectionSegmenter::segment(text)) {
+        result.append(section.kind);
+    }
+    return result;
+}
+
+int main() {
+    const QStringList headings = {
+        "Appendix",
+        "APPENDIX A",
+        "Appendix A. Proofs",
+        "Appendix B: Additional experiments",
+        "Appendix: Extra figures",
+        "Appendix S1: Methods",
+        "Supplementary Material",
+        "Supporting Information"
+    };
+    for (const QString& heading : headings) {
+        const QString text = paper("References\n[1] A. Author. A paper. 2020.\n" + heading + "\nProof of lemma 1.\n");
+        check(kinds(text).endsWith(SectionSegmenter::Appendix),
+              qPrintable("\"" + heading + "\" starts an appendix"));
+    }
+
+    // Body sentences starting with an appendix name stay part of their section
+    const QStringList sentences = {
+        "Supplementary material is available online.",
+        "Supporting information for this article is available from the publisher.",
+        "Appendix A contains the proofs of all lemmas.",
+        "Appendix is a word that also appears in running text."
+    };
+    for (const QString& sentence : sentences) {
+        const QString text = paper(sentence + "\nThe results are summarized in Table 2.\n");
+        check(!kinds(text).contains(SectionSegmenter::Appendix),
+              qPrintable("\"" + sentence + "\" is body text"));
+
+        const SectionSegmenter::Selection selection = SectionSegmenter::select(text, SectionSegmenter::DefaultExcluded);
+        check(selection.text.contains("Table 2"),
+              qPrintable("text after \"" + sentence + "\" is kept"));
+    }
+
+    // The end of a wrapped sentence on a line of its own isn't a heading either
+    const QStringList wrappedLines = {
+        "appendix.",
+        "references.",
+        "bibliography.",
+        "a discussion."
+    };
+    for (const QString& wrapped : wrappedLines) {
+        const QString text = paper("The derivation of the bound is given in the\n" + wrapped +
+                                   "\nThe results are summarized in Table 3.\n");
+        check(kinds(text).last() == SectionSegmenter::Results,
+              qPrintable("\"" + wrapped + "\" stays in the results"));
+
+        const SectionSegmenter::Selection selection = SectionSegmenter::select(text, SectionSegmenter::DefaultExcluded);
+        check(selection.text.contains("Table 3"),
+              qPrintable("text after \"" + wrapped + "\" is kept"));
+    }
+
+    // Title Case, sentence case and ALL CAPS headings are still found
+    const QString cased = "Abstract\nWe study things.\n"
+                          "2 Materials and methods\nWe measured.\n"
+                          "RESULTS AND DISCUSSION\nIt worked.\n"
+                          "4. Conclusions\nDone.\n";
+    check(kinds(cased) == QVector<SectionSegmenter::Kind>({ SectionSegmenter::Abstract, SectionSegmenter::Methods,
+                                                            SectionSegmenter::Results, SectionSegmenter::Conclusion }),
+          "Title Case, sentence case and ALL CAPS headings are found");
+
+    std::cout << std::endl << (failures == 0 ? "All checks passed" : "Some checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+# Checks for the section heading patterns used by --sections and "Send Sections"
+# Build: qmake test_sectionsegmenter.pro && make
+# Run:   build/test/test_sectionsegmenter
+
+QT += core
+QT -= gui
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = test_sectionsegmenter
+
+INCLUDEPATH += gui-extractor
+
+SOURCES += test_sectionsegmenter.cpp \
+    gui-extractor/sectionsegmenter.cpp
+HEADERS += gui-extractor/sectionsegmenter.h
+
+DESTDIR = build/test
+OBJECTS_DIR = $$DESTDIR/obj